@@ -0,0 +1,52 @@
+#ifndef BILATERAL_UPSAMPLE_H
+#define BILATERAL_UPSAMPLE_H
+
+// Depth difference relative to the view depth at which a texel's weight falls to 1/e
+const float BILATERAL_DEPTH_SIGMA = 0.05;
+const float BILATERAL_NORMAL_POWER = 16.0;
+
+/**
+ * Upsample a reduced resolution image with depth and normal aware weights. Texels of the bilinear footprint whose
+ * surface differs from the shading point are rejected, the closest texel in depth is used when all of them are.
+ * @param lowRes Reduced resolution image
+ * @param guide Normal (xyz) and view depth (w) each texel of the low resolution image was computed at
+ * @param vUV UV of the shading point
+ * @param vNormal Normal of the shading point, in the same space as the guide
+ * @param fViewDepth View depth of the shading point
+ */
+vec3 BilateralUpsample(sampler2D lowRes, sampler2D guide, vec2 vUV, vec3 vNormal, float fViewDepth)
+{
+    const ivec2 vSize = textureSize(lowRes, 0);
+    const vec2 vPos = vUV * vec2(vSize) - 0.5;
+    const ivec2 vBase = ivec2(floor(vPos));
+    const vec2 vFrac = vPos - vec2(vBase);
+
+    vec3 vSum = vec3(0.0);
+    float fWeightSum = 0.0;
+    vec3 vClosest = vec3(0.0);
+    float fClosestDepthDiff = 1e30;
+    for (int i = 0; i < 4; i++)
+    {
+        const ivec2 vOffset = ivec2(i & 1, i >> 1);
+        const ivec2 vCoord = clamp(vBase + vOffset, ivec2(0), vSize - 1);
+        const vec4 vGuide = texelFetch(guide, vCoord, 0);
+        const vec3 vValue = texelFetch(lowRes, vCoord, 0).rgb;
+
+        const vec2 vBilinear = mix(1.0 - vFrac, vFrac, vec2(vOffset));
+        const float fDepthDiff = abs(vGuide.w - fViewDepth);
+        const float fDepthWeight = exp(-fDepthDiff / (BILATERAL_DEPTH_SIGMA * max(fViewDepth, 1e-3)));
+        const float fNormalWeight = pow(max(dot(vNormal, vGuide.xyz), 0.0), BILATERAL_NORMAL_POWER);
+        const float fWeight = vBilinear.x * vBilinear.y * fDepthWeight * fNormalWeight;
+
+        vSum += vValue * fWeight;
+        fWeightSum += fWeight;
+        if (fDepthDiff < fClosestDepthDiff)
+        {
+            fClosestDepthDiff = fDepthDiff;
+            vClosest = vValue;
+        }
+    }
+    return fWeightSum > 1e-4 ? vSum / fWeightSum : vClosest;
+}
+
+#endif
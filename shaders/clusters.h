@@ -0,0 +1,32 @@
+#ifndef CLUSTERS_H
+#define CLUSTERS_H
+
+#include "shared/SharedStructures.h"
+
+// Macro to bind the culled light lists, follows LIGHTS_UBO in the same set
+#define LIGHT_CLUSTERS(SET)                                                                  \
+    layout(std430, set = SET, binding = 2) readonly buffer LightClusters_ { uvec2 i[]; }     \
+    lightClusters;                                                                           \
+    layout(std430, set = SET, binding = 3) readonly buffer ClusterLightIndices_ { uint i[]; } \
+    clusterLightIndices;
+
+// View depth where a depth slice begins, slices are distributed exponentially between near and far planes
+float GetClusterSliceDepth(uint nSlice, float fNear, float fFar)
+{
+    return fNear * pow(fFar / fNear, float(nSlice) / float(CLUSTER_GRID_Z));
+}
+
+/**
+ * Cluster containing a point
+ * @param vUV Screen UV of the point
+ * @param fViewDepth Positive view space depth of the point
+ */
+uint GetClusterIndex(vec2 vUV, float fViewDepth, float fNear, float fFar)
+{
+    const uvec2 vTile = min(uvec2(clamp(vUV, 0.0, 1.0) * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y)), uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    const float fSlice = log(max(fViewDepth, fNear) / fNear) / log(fFar / fNear) * float(CLUSTER_GRID_Z);
+    const uint nSlice = min(uint(fSlice), CLUSTER_GRID_Z - 1);
+    return vTile.x + CLUSTER_GRID_X * (vTile.y + CLUSTER_GRID_Y * nSlice);
+}
+
+#endif
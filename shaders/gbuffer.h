@@ -0,0 +1,51 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+// Compact G-buffer layout
+//   0: albedo (rgb, sRGB), AO (a)
+//   1: octahedral normal (rg), roughness (b), metalness (a)
+// Position isn't stored, it's reconstructed from the linearized depth buffer.
+const uint GBUFFER_ALBEDO_AO = 0;
+const uint GBUFFER_NORMAL_ROUGHNESS_METALNESS = 1;
+const uint GBUFFER_COUNT = 2;
+
+vec2 OctahedralWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(v, vec2(0.0)));
+}
+
+// Map a unit vector to [-1, 1]^2 by projecting it on an octahedron and unfolding the lower half
+vec2 EncodeOctahedral(vec3 vNormal)
+{
+    vNormal /= abs(vNormal.x) + abs(vNormal.y) + abs(vNormal.z);
+    return vNormal.z >= 0.0 ? vNormal.xy : OctahedralWrap(vNormal.xy);
+}
+
+vec3 DecodeOctahedral(vec2 vEncoded)
+{
+    vec3 vNormal = vec3(vEncoded, 1.0 - abs(vEncoded.x) - abs(vEncoded.y));
+    const float fFold = clamp(-vNormal.z, 0.0, 1.0);
+    vNormal.xy += mix(vec2(fFold), vec2(-fFold), greaterThanEqual(vNormal.xy, vec2(0.0)));
+    return normalize(vNormal);
+}
+
+// Positive view depth of a depth buffer value, perspective projection with [0, 1] depth range
+float LinearizeDepth(float fDepth, float fNear, float fFar)
+{
+    return fNear * fFar / (fFar - fDepth * (fFar - fNear));
+}
+
+/**
+ * View space position of a point on screen
+ * @param vUV Screen UV of the point
+ * @param fViewDepth Positive view depth of the point
+ * @param mProjInv Inverse projection
+ */
+vec3 ReconstructViewPosition(vec2 vUV, float fViewDepth, mat4 mProjInv)
+{
+    const vec4 vNearPos = mProjInv * vec4(vUV * 2.0 - 1.0, 0.0, 1.0);
+    const vec3 vRay = vNearPos.xyz / vNearPos.w;
+    return vRay * (fViewDepth / -vRay.z);
+}
+
+#endif
@@ -0,0 +1,25 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+#include "opaqueLighting.h"
+
+// Opaque lighting as the second subpass of the G-buffer render pass, the G-buffer is read from the input
+// attachments at the current pixel.
+
+layout(location = 0) in vec2 texCoords;
+layout(location = 0) out vec4 outColor;
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput inGBuffer_ALBEDO_AO;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput inGBuffer_NORMAL_ROUGHNESS_METALNESS;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput inDepth;
+
+void main() {
+    // GBuffer info
+    const float fViewDepth = LinearizeDepth(subpassLoad(inDepth).r, uboCamera.m_fNear, uboCamera.m_fFar);
+    const vec3 vViewPos = ReconstructViewPosition(texCoords, fViewDepth, uboCamera.projInv);
+    const vec4 vAlbedoAO = subpassLoad(inGBuffer_ALBEDO_AO);
+    const vec4 vNormalRoughnessMetalness = subpassLoad(inGBuffer_NORMAL_ROUGHNESS_METALNESS);
+
+    outColor = vec4(ShadeOpaque(texCoords, vViewPos, vAlbedoAO, vNormalRoughnessMetalness), 1.0);
+}
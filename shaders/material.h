@@ -1,15 +1,24 @@
-#ifndef METERIAL_H
+#ifndef MATERIAL_H
 #define MATERIAL_H
 
 #extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_nonuniform_qualifier : require
 #include "shared/SharedStructures.h"
-#define MATERIAL_UBO(SET)                                               \
-    layout(set = SET, binding = 0) uniform sampler2D texPBR[TEX_COUNT]; \
-    layout(std430, set = SET, binding = 1) uniform PBRFactorUBO { PBRMaterial factors; };
 
-#define MATERIAL_SSBO(SET)                                          \
-    layout(set = SET, binding = 0) uniform sampler2D AllTextures[]; \
-    layout(scalar, set = SET, binding = 1) readonly buffer PBRMaterial_ { PBRMaterial i[]; } AllMaterials;
+// Bindless heap, matches BindlessBinding in DescriptorManager.h
+//   0: global sampler table, indexed by SamplerTypes
+//   1: all materials
+//   2: all textures, indexed by PBRMaterial::textureIds
+#define MATERIAL_SSBO(SET)                                                                                  \
+    layout(set = SET, binding = 0) uniform sampler AllSamplers[];                                           \
+    layout(scalar, set = SET, binding = 1) readonly buffer PBRMaterial_ { PBRMaterial i[]; } AllMaterials; \
+    layout(set = SET, binding = 2) uniform texture2D AllTextures[];
 
-#endif
+// SAMPLER_1_MIPS
+const uint MATERIAL_SAMPLER = 0;
+
+// Texture ids are read from buffers, the compiler can't prove them uniform
+#define SampleMaterialTexture(nTextureId, vUV) \
+    texture(sampler2D(AllTextures[nonuniformEXT(nTextureId)], AllSamplers[MATERIAL_SAMPLER]), vUV)
 
+#endif
@@ -0,0 +1,135 @@
+#ifndef OPAQUE_LIGHTING_H
+#define OPAQUE_LIGHTING_H
+
+// Resources and shading of opaque lighting, shared by the standalone lighting pass and the lighting subpass. The
+// including shader declares the G-buffer inputs in set 1.
+
+#include "directLighting.h"
+#include "Camera.h"
+#include "lights.h"
+#include "clusters.h"
+#include "shadows.h"
+#include "random.h"
+#include "bilateralUpsample.h"
+#include "gbuffer.h"
+
+CAMERA_UBO(0)
+
+// IBL parameters
+layout(set = 2, binding = 0) uniform samplerCube irradianceMap;
+layout(set = 2, binding = 1) uniform samplerCube prefilteredMap;
+layout(set = 2, binding = 2) uniform sampler2D specularBrdfLut;
+
+LIGHTS_UBO(3)
+LIGHT_CLUSTERS(3)
+
+// Shadow atlas, sampled with comparison
+layout(set = 4, binding = 0) uniform sampler2DShadow RSMDepth;
+// Atlas UV offset (xy) and scale (zw) of each shadow map
+layout(std430, set = 4, binding = 1) readonly buffer ShadowAtlasTiles_ { vec4 i[]; }
+shadowAtlasTiles;
+layout(std140, set = 4, binding = 2) uniform ShadowFilterSettings_ { ShadowFilterSettings settings; }
+shadowFilter;
+// RSM indirect irradiance at reduced resolution, and the normal and view depth it was computed with
+layout(set = 4, binding = 3) uniform sampler2D RSMIndirect;
+layout(set = 4, binding = 4) uniform sampler2D RSMIndirectGuide;
+
+// Specialized per lighting pipeline, ids are LIGHTING_CONSTANT_*. Disabled features and unused filters are removed
+// when the pipeline is compiled, the filter loop has a constant bound.
+layout(constant_id = 0) const bool SHADOWS_ENABLED = true;
+layout(constant_id = 1) const uint SHADOW_FILTER_MODE = 1;  // SHADOW_FILTER_POISSON
+layout(constant_id = 2) const uint SHADOW_FILTER_MAX_TAP_COUNT = 16;  // Tap count bucket, the count is in the settings
+
+ShadowFilterSettings GetShadowFilterSettings()
+{
+    ShadowFilterSettings settings = shadowFilter.settings;
+    settings.nMode = SHADOW_FILTER_MODE;
+    return settings;
+}
+
+/**
+ * Shade a G-buffer texel
+ * @param vUV Screen UV of the texel
+ * @param vViewPos View space position reconstructed from depth
+ * @param vAlbedoAO Content of GBUFFER_ALBEDO_AO
+ * @param vNormalRoughnessMetalness Content of GBUFFER_NORMAL_ROUGHNESS_METALNESS
+ */
+vec3 ShadeOpaque(vec2 vUV, vec3 vViewPos, vec4 vAlbedoAO, vec4 vNormalRoughnessMetalness)
+{
+    const vec3 vWorldPos = (uboCamera.viewInv * vec4(vViewPos, 1.0)).xyz;
+    const vec3 vAlbedo = vAlbedoAO.xyz;
+    const float fAO = vAlbedoAO.w;
+    const vec3 vWorldNormal = DecodeOctahedral(vNormalRoughnessMetalness.xy);
+    const vec3 vFaceNormal = normalize((uboCamera.view * vec4(vWorldNormal, 0.0)).xyz);
+    const float fRoughness = vNormalRoughnessMetalness.z;
+    const float fMetalness = vNormalRoughnessMetalness.w;
+
+    Material material;
+    // populate material struct with material properties
+    material.vAlbedo = vAlbedo;
+    material.fAO = fAO;
+    material.fMetalness = fMetalness;
+    material.fRoughness = fRoughness;
+    material.vEmissive = vec3(0.0);
+
+
+    vec3 vLo = vec3(0.0);
+
+    // Only the lights whose range reaches the pixel's cluster
+    const uvec2 vCluster = lightClusters.i[GetClusterIndex(vUV, -vViewPos.z, uboCamera.m_fNear, uboCamera.m_fFar)];
+    for (uint n = 0; n < vCluster.y; ++n)
+    {
+        float fVisible = 1.0;
+        LightData light = lightDatas.i[clusterLightIndices.i[vCluster.x + n]];
+        const int nLightIdx = int(light.vLightData.w);
+        const bool bHasShadowMap = nLightIdx >= 0;
+        const vec4 vTile = SHADOWS_ENABLED && bHasShadowMap ? shadowAtlasTiles.i[nLightIdx] : vec4(0.0);
+        if (SHADOWS_ENABLED && bHasShadowMap)
+        {
+            float fBias = max(0.01 * (1.0 - dot(vWorldNormal, light.vPosition - vWorldPos)), 0.001);
+            fVisible = ShadowVisibility(vWorldPos, light.vPosition - vWorldPos, fBias, RSMDepth, vTile, light.mLightViewProjection, GetShadowFilterSettings(), SHADOW_FILTER_MAX_TAP_COUNT, gl_FragCoord.xy, uboCamera.uFrameId);
+        }
+        // Convert light position to view space
+        const vec4 lightPosition = uboCamera.view * vec4(light.vPosition, 1.0);
+        light.vPosition = lightPosition.xyz / lightPosition.w;
+        light.vDirection = (uboCamera.view * vec4(light.vDirection, 0.0)).xyz;
+
+        vLo += fVisible * ComputeDirectLighting(light, material, vViewPos, vFaceNormal);
+    }
+
+    // One bounce from the RSMs, gathered at reduced resolution. Treated as diffuse irradiance.
+    if (SHADOWS_ENABLED)
+    {
+        const vec3 vRSMIrradiance = BilateralUpsample(RSMIndirect, RSMIndirectGuide, vUV, vWorldNormal, -vViewPos.z);
+        vLo += vRSMIrradiance * vAlbedo * (1.0 - fMetalness) / PI;
+    }
+
+    // Add IBL
+    
+    const vec3 vF0 = mix(vec3(0.04), vAlbedo, fMetalness);
+    vec3 V = normalize(-vViewPos);
+    const float MAX_REFLECTION_LOD = 7.0;
+    vec3 R = -normalize(uboCamera.viewInv * vec4(reflect(V, vFaceNormal), 0.0)).xyz;
+    vec3 vPrefilteredColor = textureLod(prefilteredMap, R, fRoughness * MAX_REFLECTION_LOD).rgb;
+    vec3 F = fresnelSchlickRoughness(max(dot(vFaceNormal, V), 0.0), vF0, fRoughness);
+    vec2 vEnvBRDF  = texture(specularBrdfLut, vec2(max(dot(vFaceNormal, V), 0.0), fRoughness)).rg;
+    vec3 specular = vPrefilteredColor * (F * vEnvBRDF.x + vEnvBRDF.y);
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS;
+    kD *= 1.0 - fMetalness;
+    vec3 irradiance = texture(irradianceMap, vWorldNormal).xyz;
+    vec3 vDiffuse = vAlbedo * irradiance;
+    vec3 diffuse = irradiance * vAlbedo;
+
+    vec3 vAmbient = (kD * vDiffuse + specular);// * fAO;
+
+    vec3 vColor = vLo + vAmbient;
+    //vec3 vColor = vLo;
+
+    // Gamma correction
+    //vColor = vColor / (vColor + vec3(1.0));
+    //vColor = pow(vColor, vec3(1.0 / 2.2));
+    return vColor;
+}
+
+#endif
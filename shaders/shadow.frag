@@ -62,7 +62,7 @@ void main()
     uint materialIndex = perObjData.i[objIndex].vSubmeshDatas[submeshIndex].nMaterialIndex;
     PBRMaterial material = AllMaterials.i[materialIndex];
     
-    vec3 vAlbedo = texture(AllTextures[material.textureIds[TEX_ALBEDO]], inTexCoords[material.UVIndices[TEX_ALBEDO]]).xyz * material.vBaseColorFactors.xyz;
+    vec3 vAlbedo = SampleMaterialTexture(material.textureIds[TEX_ALBEDO], inTexCoords[material.UVIndices[TEX_ALBEDO]]).xyz * material.vBaseColorFactors.xyz;
 
     fOutFlux = vec4(light.vColor * light.fIntensity * vAlbedo, 0.0f);
 }
@@ -1,6 +1,7 @@
 #ifndef SHADOWS_H
 #define SHADOWS_H
 #include "random.h"
+#include "shared/SharedStructures.h"
 
 // PCF Shadow 
 /**
@@ -39,35 +40,133 @@ vec3 WorldToNdc(vec3 vWorldPos, mat4 mProjView)
 
     return vNdcPos.xyz;
 }
+/**
+ * Map a shadow map UV to the light's tile in the shadow atlas, clamped half a texel inside the tile so filtering
+ * doesn't read neighbouring tiles
+ * @param vUV UV in the light's shadow map
+ * @param vTile Atlas UV offset (xy) and scale (zw) of the tile
+ * @param vTexelSize Size of an atlas texel in UV
+ */
+vec2 ShadowAtlasUV(vec2 vUV, vec4 vTile, vec2 vTexelSize)
+{
+    const vec2 vHalfTexel = 0.5 * vTexelSize;
+    return vTile.xy + clamp(vUV * vTile.zw, vHalfTexel, vTile.zw - vHalfTexel);
+}
+
 /**
  * PCF shadow filter with fixed kernel size in world space
  * @param vShadingPoint Shading point in world space
- * @param fStep Search step size
- * @param fNSampleDimension Number of samples in each dimension
+ * @param nNumSamples Number of samples
+ * @param fSampleRadius Radius of the sample disk in world space
  * @param fBias Shadow Biase to remove acne
- * @param shadowMap Shadow map
+ * @param shadowMap Shadow atlas with comparison sampler
+ * @param vTile Atlas UV offset (xy) and scale (zw) of the light's tile
  */
-float PCFShadowVisibililty(vec3 vShadingPoint, vec3 vLightDir, uint nNumSamples, float nSampleRadius, uint nSeed, float fBias, sampler2D shadowMap, mat4 mShadowProjViewMatrix)
+float PCFShadowVisibililty(vec3 vShadingPoint, vec3 vLightDir, uint nNumSamples, float fSampleRadius, uint nSeed, float fBias, sampler2DShadow shadowMap, vec4 vTile, mat4 mShadowProjViewMatrix)
 {
     float fVisibility = 0.0;
-    int nSampleCount = 0;
+    const vec2 vTexelSize = 1.0 / vec2(textureSize(shadowMap, 0));
     vec3 vTangent = normalize(cross(vLightDir, vec3(0.0, 1.0, 0.0)));
     vec3 vBitangent = normalize(cross(vLightDir, vTangent));
     for (uint i = 0; i < nNumSamples; i++)
     {
         // offset sample in the disk oriented along the light direction
-        const vec2 vOffset = RandomInUnitDisk(nSeed) * nSampleRadius;
+        const vec2 vOffset = RandomInUnitDisk(nSeed) * fSampleRadius;
         const vec3 vSamplePosition = vTangent * vOffset.x + vBitangent * vOffset.y + vShadingPoint;
         // project sample to the shadow map
         vec3 vNdcPos = WorldToNdc(vSamplePosition, mShadowProjViewMatrix);
-        float fShadowDepth = texture(shadowMap, vNdcPos.xy).r;
-        if (vNdcPos.z - fShadowDepth <= fBias)
+        fVisibility += texture(shadowMap, vec3(ShadowAtlasUV(vNdcPos.xy, vTile, vTexelSize), vNdcPos.z - fBias));
+    }
+    return fVisibility / float(max(nNumSamples, 1u));
+}
+
+// Per pixel noise with low discrepancy between neighbours, used to rotate filter kernels
+float InterleavedGradientNoise(vec2 vPixel)
+{
+    return fract(52.9829189 * fract(dot(vPixel, vec2(0.06711056, 0.00583715))));
+}
+
+/**
+ * PCF shadow filter with a Poisson disk of hardware comparison taps in shadow map space, each tap filters 2x2
+ * texels. The kernel is rotated per pixel to turn banding into noise.
+ * @param vNdcPos Shading point projected to the light's shadow map
+ * @param fBias Shadow Biase to remove acne
+ * @param shadowMap Shadow atlas with comparison sampler
+ * @param vTile Atlas UV offset (xy) and scale (zw) of the light's tile
+ * @param settings Tap count, radius in texels and early-out switch
+ * @param nMaxTapCount Constant bound of the tap loop, the tap count is clamped to it
+ * @param fRotation Kernel rotation in radians
+ */
+float PoissonShadowVisibility(vec3 vNdcPos, float fBias, sampler2DShadow shadowMap, vec4 vTile, ShadowFilterSettings settings, uint nMaxTapCount, float fRotation)
+{
+    const vec2 vTexelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+    // Offsets are in the light's shadow map UV, scale the radius from atlas texels to tile UV
+    const vec2 vRadius = settings.fRadius * vTexelSize / vTile.zw;
+    const float fReference = vNdcPos.z - fBias;
+    const mat2 mRotation = mat2(cos(fRotation), sin(fRotation), -sin(fRotation), cos(fRotation));
+
+    if (settings.bEarlyOut != 0)
+    {
+        // Blocker search on the rim of the kernel, the whole kernel is lit or shadowed when all taps agree
+        const vec2 aRim[4] = vec2[](vec2(-0.7071, -0.7071), vec2(0.7071, -0.7071), vec2(-0.7071, 0.7071), vec2(0.7071, 0.7071));
+        float fRimVisibility = 0.0;
+        for (uint i = 0; i < 4; i++)
         {
-            fVisibility += 1.0;
+            const vec2 vUV = vNdcPos.xy + mRotation * aRim[i] * vRadius;
+            fRimVisibility += texture(shadowMap, vec3(ShadowAtlasUV(vUV, vTile, vTexelSize), fReference));
+        }
+        if (fRimVisibility < 0.001 || fRimVisibility > 3.999)
+        {
+            return fRimVisibility * 0.25;
         }
-        nSampleCount++;
     }
-    return fVisibility / nSampleCount;
+
+    const uint nTapCount = clamp(settings.nTapCount, 1u, min(nMaxTapCount, SHADOW_FILTER_MAX_TAPS));
+    float fVisibility = 0.0;
+    for (uint i = 0; i < nMaxTapCount; i++)
+    {
+        if (i >= nTapCount)
+        {
+            break;
+        }
+        const vec2 vUV = vNdcPos.xy + mRotation * poissonDisk64[i] * vRadius;
+        fVisibility += texture(shadowMap, vec3(ShadowAtlasUV(vUV, vTile, vTexelSize), fReference));
+    }
+    return fVisibility / float(nTapCount);
+}
+
+/**
+ * Shadow visibility of a shading point filtered with the selected shadow filter
+ * @param vShadingPoint Shading point in world space
+ * @param vLightDir Direction from the shading point to the light
+ * @param fBias Shadow Biase to remove acne
+ * @param shadowMap Shadow atlas with comparison sampler
+ * @param vTile Atlas UV offset (xy) and scale (zw) of the light's tile
+ * @param mShadowProjViewMatrix Light's view projection
+ * @param settings Shadow filter settings
+ * @param nMaxTapCount Constant bound of the Poisson tap loop
+ * @param vPixel Pixel coordinate, seeds the kernel rotation
+ * @param uFrameId Frame index, rotates the kernel over frames when temporal filtering is enabled
+ */
+float ShadowVisibility(vec3 vShadingPoint, vec3 vLightDir, float fBias, sampler2DShadow shadowMap, vec4 vTile, mat4 mShadowProjViewMatrix, ShadowFilterSettings settings, uint nMaxTapCount, vec2 vPixel, uint uFrameId)
+{
+    const uint uTemporalFrame = settings.bTemporal != 0 ? uFrameId : 0;
+    if (settings.nMode == SHADOW_FILTER_RANDOM_DISK)
+    {
+        const uint nSeed = InitRandomSeed(InitRandomSeed(uint(vPixel.x), uint(vPixel.y)), uTemporalFrame);
+        return PCFShadowVisibililty(vShadingPoint, vLightDir, settings.nTapCount, settings.fRadius, nSeed, fBias, shadowMap, vTile, mShadowProjViewMatrix);
+    }
+
+    const vec3 vNdcPos = WorldToNdc(vShadingPoint, mShadowProjViewMatrix);
+    if (settings.nMode == SHADOW_FILTER_HARDWARE_PCF)
+    {
+        const vec2 vTexelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+        return texture(shadowMap, vec3(ShadowAtlasUV(vNdcPos.xy, vTile, vTexelSize), vNdcPos.z - fBias));
+    }
+
+    // Offset the noise pattern every frame so an accumulated history sees a different rotation
+    const float fNoise = InterleavedGradientNoise(vPixel + 5.588238 * float(uTemporalFrame % 64u));
+    return PoissonShadowVisibility(vNdcPos, fBias, shadowMap, vTile, settings, nMaxTapCount, fNoise * 6.28318531);
 }
 
 // PCSS Shadow
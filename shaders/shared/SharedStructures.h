@@ -36,6 +36,50 @@ struct LightData
     mat4 mLightViewProjection;
 };
 
+// Clustered light culling
+// View frustum is split into CLUSTER_GRID_X * CLUSTER_GRID_Y screen tiles and CLUSTER_GRID_Z depth slices
+// distributed exponentially between near and far planes. Each cluster stores the offset and count of its lights
+// in a shared light index list.
+const uint CLUSTER_GRID_X = 16;
+const uint CLUSTER_GRID_Y = 9;
+const uint CLUSTER_GRID_Z = 24;
+const uint CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+const uint MAX_CLUSTER_LIGHT_INDICES = CLUSTER_COUNT * 32;  // 32 lights per cluster on average
+
+// Shadow filtering
+const uint SHADOW_FILTER_HARDWARE_PCF = 0;  // Single comparison tap, bilinear 2x2 PCF in the sampler
+const uint SHADOW_FILTER_POISSON = 1;       // Poisson disk of comparison taps rotated per pixel
+const uint SHADOW_FILTER_RANDOM_DISK = 2;   // Random world space disk, reference quality
+const uint SHADOW_FILTER_COUNT = 3;
+const uint SHADOW_FILTER_MAX_TAPS = 64;
+
+struct ShadowFilterSettings
+{
+    uint nMode;
+    uint nTapCount;
+    float fRadius;    // Kernel radius, in shadow map texels for Poisson and world units for random disk
+    uint bEarlyOut;   // Skip the kernel when the first taps are all lit or all shadowed
+    uint bTemporal;   // Rotate the kernel every frame
+    uint nPadding0;
+    uint nPadding1;
+    uint nPadding2;
+};
+
+// Specialization constant ids of the opaque lighting shaders. GLSL needs literal ids, keep opaqueLighting.h in sync.
+const uint LIGHTING_CONSTANT_SHADOWS = 0;             // Shadow atlas and RSM indirect lighting are bound
+const uint LIGHTING_CONSTANT_SHADOW_FILTER_MODE = 1;  // Replaces ShadowFilterSettings::nMode
+const uint LIGHTING_CONSTANT_SHADOW_FILTER_TAPS = 2;  // Upper bound of ShadowFilterSettings::nTapCount
+
+// RSM indirect lighting, gathered at reduced resolution and upsampled in lighting
+struct RSMIndirectSettings
+{
+    uint nDownscale;         // Resolution divisor, 2 for half and 4 for quarter resolution
+    uint bTemporal;          // Jitter the gather every frame and accumulate it while the camera is static
+    uint nMaxHistoryFrames;  // Accumulated frames are capped so changes in lighting still converge
+    uint nPadding;
+};
+
 // Material
 
 const uint TEX_ALBEDO = 0;
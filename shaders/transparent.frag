@@ -35,7 +35,7 @@ void main()
 
     PBRMaterial material = AllMaterials.i[materialIndex];
 
-    vec4 vAlbedo = vec4(texture(AllTextures[material.textureIds[TEX_ALBEDO]], inTexCoords[material.UVIndices[TEX_ALBEDO]]).xyz, 1.0) * material.vBaseColorFactors;
+    vec4 vAlbedo = vec4(SampleMaterialTexture(material.textureIds[TEX_ALBEDO], inTexCoords[material.UVIndices[TEX_ALBEDO]]).xyz, 1.0) * material.vBaseColorFactors;
 
     outColor = vec4(vAlbedo);
 }
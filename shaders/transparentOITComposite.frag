@@ -0,0 +1,25 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Resolve weighted blended transparency on top of the opaque image. Blended with
+// src * (1 - src alpha) + dst * src alpha, alpha holds the revealage.
+
+layout(location = 0) in vec2 inTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D inAccumulation;
+layout(set = 0, binding = 1) uniform sampler2D inRevealage;
+
+void main()
+{
+    float fRevealage = texture(inRevealage, inTexCoord).r;
+    if (fRevealage == 1.0)
+    {
+        // No transparent fragment
+        discard;
+    }
+    vec4 vAccumulation = texture(inAccumulation, inTexCoord);
+    vec3 vAverageColor = vAccumulation.rgb / clamp(vAccumulation.a, 1e-4, 5e4);
+    outColor = vec4(vAverageColor, fRevealage);
+}
@@ -81,9 +81,9 @@ public:
                          10.0f);
     }
     virtual void Update() = 0;
-    virtual void UpdatePerViewDataUBO(UniformBuffer<PerViewData> *ubo)
+    virtual void UpdatePerViewDataUBO(PerFrameUniformBuffer<PerViewData> *ubo, uint32_t nFrameIdx)
     {
-        ubo->SetData(m_perViewData);
+        ubo->SetData(m_perViewData, nFrameIdx);
     };
 
     void SetAperture(float fAperture)
@@ -206,12 +206,12 @@ public:
     {
     }
 
-    virtual void UpdatePerViewDataUBO(UniformBuffer<PerViewData> *ubo) override
+    virtual void UpdatePerViewDataUBO(PerFrameUniformBuffer<PerViewData> *ubo, uint32_t nFrameIdx) override
     {
         PerViewData perView = m_perViewData;
         perView.mView = GetViewMat();
         perView.mViewInv = glm::inverse(perView.mView);
-        ubo->SetData(perView);
+        ubo->SetData(perView, nFrameIdx);
     }
 
 protected:
@@ -293,6 +293,89 @@ void CameraDebugPage::Render() const
     }
 }
 
+void TransparencyDebugPage::Render() const
+{
+    ImGui::Begin(m_sName.c_str());
+    {
+        bool bOIT = GetRenderPassManager()->IsOrderIndependentTransparencyEnabled();
+        if (ImGui::Checkbox("Weighted blended OIT", &bOIT))
+        {
+            GetRenderPassManager()->SetOrderIndependentTransparency(bOIT);
+        }
+        ImGui::Text(bOIT ? "Single unsorted draw, approximated blending" : "Sorted back to front every frame");
+    }
+    ImGui::End();
+}
+
+void ShadowFilterDebugPage::Render() const
+{
+    ImGui::Begin(m_sName.c_str());
+    {
+        ShadowFilterSettings settings = GetRenderPassManager()->GetShadowFilterSettings();
+        bool bChanged = false;
+
+        const char* aModeNames[SHADOW_FILTER_COUNT] = {"Hardware PCF 2x2", "Poisson disk", "Random disk (reference)"};
+        int nMode = static_cast<int>(settings.nMode);
+        if (ImGui::Combo("Filter", &nMode, aModeNames, static_cast<int>(SHADOW_FILTER_COUNT)))
+        {
+            settings.nMode = static_cast<uint32_t>(nMode);
+            bChanged = true;
+        }
+        if (settings.nMode != SHADOW_FILTER_HARDWARE_PCF)
+        {
+            int nTapCount = static_cast<int>(settings.nTapCount);
+            if (ImGui::SliderInt("Taps", &nTapCount, 1, static_cast<int>(SHADOW_FILTER_MAX_TAPS)))
+            {
+                settings.nTapCount = static_cast<uint32_t>(nTapCount);
+                bChanged = true;
+            }
+            const bool bIsWorldSpace = settings.nMode == SHADOW_FILTER_RANDOM_DISK;
+            bChanged |= ImGui::SliderFloat(bIsWorldSpace ? "Radius (world)" : "Radius (texels)", &settings.fRadius, bIsWorldSpace ? 0.001f : 0.5f, bIsWorldSpace ? 0.2f : 8.0f);
+
+            bool bTemporal = settings.bTemporal != 0;
+            if (ImGui::Checkbox("Rotate kernel every frame", &bTemporal))
+            {
+                settings.bTemporal = bTemporal ? 1 : 0;
+                bChanged = true;
+            }
+        }
+        if (settings.nMode == SHADOW_FILTER_POISSON)
+        {
+            bool bEarlyOut = settings.bEarlyOut != 0;
+            if (ImGui::Checkbox("Early out when fully lit or shadowed", &bEarlyOut))
+            {
+                settings.bEarlyOut = bEarlyOut ? 1 : 0;
+                bChanged = true;
+            }
+        }
+        if (bChanged)
+        {
+            GetRenderPassManager()->SetShadowFilterSettings(settings);
+        }
+        bool bRSMTemporal = GetRenderPassManager()->IsRSMTemporalAccumulationEnabled();
+        if (ImGui::Checkbox("Accumulate RSM indirect lighting", &bRSMTemporal))
+        {
+            GetRenderPassManager()->SetRSMTemporalAccumulation(bRSMTemporal);
+        }
+        ImGui::Text("Lighting pass: %.3f ms", GetRenderPassManager()->GetLightingGPUTimeMs());
+    }
+    ImGui::End();
+}
+
+void DescriptorDebugPage::Render() const
+{
+    ImGui::Begin(m_sName.c_str());
+    {
+        const DescriptorAllocatorStats stats = GetDescriptorManager()->GetStats();
+        ImGui::Text("Persistent: %u sets in %u pools", stats.nPersistentSets, stats.nPersistentPools);
+        ImGui::Text("  Cached render pass sets: %u", stats.nCachedSets);
+        ImGui::Text("  Retired, waiting for GPU: %u", stats.nRetiredSets);
+        ImGui::Text("Transient: %u sets this frame, peak %u", stats.nTransientSets, stats.nPeakTransientSets);
+        ImGui::Text("  Pools of all frames: %u", stats.nTransientPools);
+    }
+    ImGui::End();
+}
+
 #undef GLM_ENABLE_EXPERIMENTAL
 
 }  // namespace Muyo
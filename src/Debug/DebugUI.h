@@ -139,4 +139,34 @@ public:
 private:
     Camera* m_pCamera = nullptr;
 };
+
+// Rendering technique switches of the transparent pass
+class TransparencyDebugPage : public IDebugUIPage
+{
+public:
+    explicit TransparencyDebugPage(const std::string& sName) : IDebugUIPage(sName) {}
+    void Render() const override;
+    bool ShouldRender() const override { return true; }
+    ~TransparencyDebugPage() override {}
+};
+
+// Shadow filter and RSM indirect lighting settings, with the measured cost of the lighting pass
+class ShadowFilterDebugPage : public IDebugUIPage
+{
+public:
+    explicit ShadowFilterDebugPage(const std::string& sName) : IDebugUIPage(sName) {}
+    void Render() const override;
+    bool ShouldRender() const override { return true; }
+    ~ShadowFilterDebugPage() override {}
+};
+
+// Descriptor pool usage of the persistent and per-frame allocators
+class DescriptorDebugPage : public IDebugUIPage
+{
+public:
+    explicit DescriptorDebugPage(const std::string& sName) : IDebugUIPage(sName) {}
+    void Render() const override;
+    bool ShouldRender() const override { return true; }
+    ~DescriptorDebugPage() override {}
+};
 }  // namespace Muyo
@@ -10,9 +10,23 @@ PerObjResourceManager *GetPerObjResourceManager()
 
 size_t PerObjResourceManager::AppendPerObjData(const PerObjData& perObjData)
 {
+    assert(!m_bUploaded && "Per object buffer is sized at upload, objects can't be added afterwards");
     m_vPerObjDataCPU.push_back(perObjData);
     memcpy(m_vPerObjDataCPU.back().vSubmeshDatas, perObjData.vSubmeshDatas, sizeof(PerSubmeshData) * perObjData.nSubmeshCount);
 
     return m_vPerObjDataCPU.size() - 1;
 }
+
+void PerObjResourceManager::SetWorldMatrix(size_t nPerObjId, const glm::mat4& mWorldMatrix)
+{
+    if (m_bUploaded)
+    {
+        (*m_pPerObjDataGPU)[static_cast<uint32_t>(nPerObjId)].mWorldMatrix = mWorldMatrix;
+    }
+    else
+    {
+        assert(nPerObjId < m_vPerObjDataCPU.size());
+        m_vPerObjDataCPU[nPerObjId].mWorldMatrix = mWorldMatrix;
+    }
+}
 };
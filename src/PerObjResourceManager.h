@@ -4,26 +4,33 @@
 
 namespace Muyo
 {
+// Per object data of all scene nodes lives in one persistently mapped storage buffer, objects are addressed by
+// their index in it. No object owns a buffer of its own.
 class PerObjResourceManager
 {
 public:
     // Append per object data and return the index in the array
     size_t AppendPerObjData(const PerObjData& perObjData);
+    // Written straight into the mapped buffer once uploaded
+    void SetWorldMatrix(size_t nPerObjId, const glm::mat4& mWorldMatrix);
     void Upload()
     {
-        m_pPerObjDataGPU = GetRenderResourceManager()->GetStorageBuffer("PerObjData", m_vPerObjDataCPU);
+        m_pPerObjDataGPU = GetRenderResourceManager()->GetMappedStorageBuffer("PerObjData", m_vPerObjDataCPU);
+        // The GPU buffer is the only copy from now on
+        m_vPerObjDataCPU.clear();
+        m_vPerObjDataCPU.shrink_to_fit();
         m_bUploaded = true;
     }
     bool HasUploaded() const {return m_bUploaded;}
-    const StorageBuffer<PerObjData>* GetPerObjResource()
+    // Null until uploaded, pipelines can be precompiled without a scene
+    const MappedStorageBuffer<PerObjData>* GetPerObjResource()
     {
-        assert(m_bUploaded);
         return m_pPerObjDataGPU;
     }
 
 private:
     std::vector<PerObjData> m_vPerObjDataCPU;
-    StorageBuffer<PerObjData> *m_pPerObjDataGPU = nullptr;
+    MappedStorageBuffer<PerObjData> *m_pPerObjDataGPU = nullptr;
 
     bool m_bUploaded = false;
 };
@@ -0,0 +1,104 @@
+#include "PipelineCache.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "Debug.h"
+#include "VkRenderDevice.h"
+
+namespace Muyo
+{
+
+static PipelineCache s_pipelineCache;
+
+PipelineCache* GetPipelineCache()
+{
+    return &s_pipelineCache;
+}
+
+bool PipelineCache::IsCompatible(const std::vector<char>& vData)
+{
+    VkPipelineCacheHeaderVersionOne header = {};
+    if (vData.size() < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, vData.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(GetRenderDevice()->GetPhysicalDevice(), &properties);
+
+    // The UUID changes with the driver version, the rest catches blobs copied from another machine
+    return header.headerSize >= sizeof(header) &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties.vendorID &&
+           header.deviceID == properties.deviceID &&
+           memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::Load(const std::filesystem::path& cachePath)
+{
+    assert(m_pipelineCache == VK_NULL_HANDLE);
+    m_cachePath = cachePath;
+
+    std::vector<char> vData;
+    std::ifstream inFile(cachePath, std::ios::binary | std::ios::ate);
+    if (inFile.is_open())
+    {
+        vData.resize(static_cast<size_t>(inFile.tellg()));
+        inFile.seekg(0);
+        inFile.read(vData.data(), vData.size());
+        if (!inFile || !IsCompatible(vData))
+        {
+            std::cerr << "Discarding incompatible pipeline cache " << cachePath << std::endl;
+            vData.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    info.initialDataSize = vData.size();
+    info.pInitialData = vData.empty() ? nullptr : vData.data();
+    VK_ASSERT(vkCreatePipelineCache(GetRenderDevice()->GetDevice(), &info, nullptr, &m_pipelineCache));
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipelineCache), VK_OBJECT_TYPE_PIPELINE_CACHE, "Pipeline cache");
+}
+
+void PipelineCache::Save() const
+{
+    assert(m_pipelineCache != VK_NULL_HANDLE);
+
+    size_t nDataSize = 0;
+    VK_ASSERT(vkGetPipelineCacheData(GetRenderDevice()->GetDevice(), m_pipelineCache, &nDataSize, nullptr));
+    std::vector<char> vData(nDataSize);
+    VK_ASSERT(vkGetPipelineCacheData(GetRenderDevice()->GetDevice(), m_pipelineCache, &nDataSize, vData.data()));
+
+    std::filesystem::path tempPath = m_cachePath;
+    tempPath += ".tmp";
+    {
+        std::ofstream outFile(tempPath, std::ios::binary | std::ios::trunc);
+        outFile.write(vData.data(), nDataSize);
+        if (!outFile)
+        {
+            std::cerr << "Failed to write pipeline cache " << tempPath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, m_cachePath, error);
+    if (error)
+    {
+        std::cerr << "Failed to replace pipeline cache " << m_cachePath << ": " << error.message() << std::endl;
+        std::filesystem::remove(tempPath, error);
+    }
+}
+
+void PipelineCache::Destroy()
+{
+    vkDestroyPipelineCache(GetRenderDevice()->GetDevice(), m_pipelineCache, nullptr);
+    m_pipelineCache = VK_NULL_HANDLE;
+}
+
+}  // namespace Muyo
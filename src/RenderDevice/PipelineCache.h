@@ -0,0 +1,32 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <filesystem>
+#include <vector>
+
+namespace Muyo
+{
+// Process wide VkPipelineCache, every pipeline is created through it.
+// The cache blob is loaded at startup and saved at shutdown, so a warm start skips the driver's shader compilation.
+// Blobs written by another driver, device or cache version are discarded and the cache starts empty.
+class PipelineCache
+{
+public:
+    // Device must be created
+    void Load(const std::filesystem::path& cachePath);
+    // Written to a temporary file first and renamed over the previous blob, a crash never leaves a truncated cache
+    void Save() const;
+    void Destroy();
+
+    VkPipelineCache GetPipelineCache() const { return m_pipelineCache; }
+
+private:
+    // Header of the blob matches this device
+    static bool IsCompatible(const std::vector<char>& vData);
+
+    VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+    std::filesystem::path m_cachePath;
+};
+
+PipelineCache* GetPipelineCache();
+}  // namespace Muyo
@@ -0,0 +1,29 @@
+#include "PipelinePermutationCache.h"
+
+#include "PipelineStateBuilder.h"
+#include "VkRenderDevice.h"
+
+namespace Muyo
+{
+
+VkPipeline PipelinePermutationCache::GetOrCreatePipeline(const SpecializationConstants& constants, VkPipelineLayout pipelineLayout, VkRenderPass renderPass,
+                                                         const CreatePipelineFunc& createPipeline)
+{
+    VkPipeline& pipeline = m_mPipelines[Key(pipelineLayout, renderPass, constants.GetKey())];
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        pipeline = createPipeline(constants.GetInfo());
+    }
+    return pipeline;
+}
+
+void PipelinePermutationCache::Destroy()
+{
+    for (const auto& [vKey, pipeline] : m_mPipelines)
+    {
+        vkDestroyPipeline(GetRenderDevice()->GetDevice(), pipeline, nullptr);
+    }
+    m_mPipelines.clear();
+}
+
+}  // namespace Muyo
@@ -0,0 +1,37 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace Muyo
+{
+class SpecializationConstants;
+
+/*
+ * Pipelines of a pass specialized with different constant values. Each permutation is compiled the first time it's
+ * requested and kept until the cache is destroyed, switching back to a permutation costs a lookup. Permutations are
+ * also keyed by the pipeline layout and render pass they are built against (null for compute pipelines), destroy the
+ * cache before those are destroyed so recycled handles can't hit stale pipelines.
+ * Not thread safe, a pass requests permutations from one pipeline job at a time.
+ */
+class PipelinePermutationCache
+{
+public:
+    using CreatePipelineFunc = std::function<VkPipeline(const VkSpecializationInfo* pSpecializationInfo)>;
+
+    ~PipelinePermutationCache() { Destroy(); }
+
+    VkPipeline GetOrCreatePipeline(const SpecializationConstants& constants, VkPipelineLayout pipelineLayout, VkRenderPass renderPass,
+                                   const CreatePipelineFunc& createPipeline);
+    uint32_t GetPermutationCount() const { return static_cast<uint32_t>(m_mPipelines.size()); }
+    void Destroy();
+
+private:
+    using Key = std::tuple<VkPipelineLayout, VkRenderPass, std::vector<uint32_t>>;  // Constants from SpecializationConstants::GetKey
+    std::map<Key, VkPipeline> m_mPipelines;
+};
+}  // namespace Muyo
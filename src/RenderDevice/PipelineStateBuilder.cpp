@@ -2,12 +2,54 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 
 namespace Muyo
 {
 
+SpecializationConstants& SpecializationConstants::SetUint(uint32_t nConstantId, uint32_t nValue)
+{
+    auto it = std::lower_bound(m_vEntries.begin(), m_vEntries.end(), nConstantId,
+                               [](const VkSpecializationMapEntry& entry, uint32_t nId) { return entry.constantID < nId; });
+    const size_t nIdx = static_cast<size_t>(it - m_vEntries.begin());
+    if (it != m_vEntries.end() && it->constantID == nConstantId)
+    {
+        m_vValues[nIdx] = nValue;
+        return *this;
+    }
+    m_vEntries.insert(it, {nConstantId, 0, sizeof(uint32_t)});
+    m_vValues.insert(m_vValues.begin() + nIdx, nValue);
+    // Entries after the new one moved in the data
+    for (size_t i = nIdx; i < m_vEntries.size(); i++)
+    {
+        m_vEntries[i].offset = static_cast<uint32_t>(i * sizeof(uint32_t));
+    }
+    return *this;
+}
+
+const VkSpecializationInfo* SpecializationConstants::GetInfo() const
+{
+    m_info.mapEntryCount = static_cast<uint32_t>(m_vEntries.size());
+    m_info.pMapEntries = m_vEntries.data();
+    m_info.dataSize = m_vValues.size() * sizeof(uint32_t);
+    m_info.pData = m_vValues.data();
+    return &m_info;
+}
+
+std::vector<uint32_t> SpecializationConstants::GetKey() const
+{
+    std::vector<uint32_t> vKey;
+    vKey.reserve(m_vEntries.size() * 2);
+    for (size_t i = 0; i < m_vEntries.size(); i++)
+    {
+        vKey.push_back(m_vEntries[i].constantID);
+        vKey.push_back(m_vValues[i]);
+    }
+    return vKey;
+}
+
 PipelineStateBuilder& PipelineStateBuilder::SetShaderModule(VkShaderModule shaderModule,
                                       VkShaderStageFlagBits shaderStageBit)
 {
@@ -80,6 +122,11 @@ PipelineStateBuilder& PipelineStateBuilder::setViewport(
 VkPipeline PipelineStateBuilder::Build(VkDevice device)
 {
     VkPipeline res = VK_NULL_HANDLE;
+    for (VkPipelineShaderStageCreateInfo& shaderStageInfo : m_vShaderStageInfos)
+    {
+        shaderStageInfo.pSpecializationInfo = m_pSpecializationInfo;
+    }
+
     VkGraphicsPipelineCreateInfo pipelineInfo = {};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineInfo.stageCount = (uint32_t)m_vShaderStageInfos.size();
@@ -109,7 +156,7 @@ VkPipeline PipelineStateBuilder::Build(VkDevice device)
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    VK_ASSERT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &res));
+    VK_ASSERT(vkCreateGraphicsPipelines(device, GetPipelineCache()->GetPipelineCache(), 1, &pipelineInfo, nullptr, &res));
     return res;
 }
 // Helper function
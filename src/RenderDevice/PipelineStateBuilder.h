@@ -8,10 +8,33 @@
 #include <string>
 #include <vector>
 
+#include "PipelineCache.h"
+#include "ShaderLibrary.h"
 #include "VkRenderDevice.h"
 
 namespace Muyo
 {
+/*
+ * Values of specialization constants, applied to every stage of a pipeline. Stages ignore the ids they don't
+ * declare. Values are 32 bits wide, like the bool, int, uint and float constants they specialize.
+ */
+class SpecializationConstants
+{
+public:
+    SpecializationConstants& SetUint(uint32_t nConstantId, uint32_t nValue);
+    SpecializationConstants& SetBool(uint32_t nConstantId, bool bValue) { return SetUint(nConstantId, bValue ? VK_TRUE : VK_FALSE); }
+
+    // Points into this object, which must outlive the pipeline creation
+    const VkSpecializationInfo* GetInfo() const;
+    // Constant ids and values interleaved, sorted by id. Identifies a pipeline permutation.
+    std::vector<uint32_t> GetKey() const;
+
+private:
+    std::vector<VkSpecializationMapEntry> m_vEntries;  // Sorted by constant id
+    std::vector<uint32_t> m_vValues;
+    mutable VkSpecializationInfo m_info = {};
+};
+
 // Fluent builder
 template <typename T>
 class VertexBuffer;
@@ -90,6 +113,12 @@ public:
         mSubpassIndex = subpassIndex;
         return *this;
     }
+    // Applied to all shader stages when the pipeline is built
+    PipelineStateBuilder& setSpecializationInfo(const VkSpecializationInfo* pSpecializationInfo)
+    {
+        m_pSpecializationInfo = pSpecializationInfo;
+        return *this;
+    }
 
     VkPipeline Build(VkDevice device);
 
@@ -108,6 +137,7 @@ private:
     VkPipelineDynamicStateCreateInfo m_dynamicStatesInfo = {VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO, nullptr, 0, 0, nullptr};
     VkRenderPass mRenderPass = {};
     uint32_t mSubpassIndex = 0;
+    const VkSpecializationInfo* m_pSpecializationInfo = nullptr;
 };
 
 // TODO: Finish other builders
@@ -147,6 +177,12 @@ public:
         return *this;
     }
     ComputePipelineBuilder& AddShaderModule(const VkShaderModule& shaderModule, VkShaderStageFlagBits shaderStage = VK_SHADER_STAGE_COMPUTE_BIT);
+    ComputePipelineBuilder& SetSpecializationInfo(const VkSpecializationInfo* pSpecializationInfo)
+    {
+        m_shaderStageInfo.pSpecializationInfo = pSpecializationInfo;
+        m_info.stage.pSpecializationInfo = pSpecializationInfo;
+        return *this;
+    }
 
 private:
     VkPipelineShaderStageCreateInfo m_shaderStageInfo = {};
@@ -311,6 +347,20 @@ public:
         m_info.pAttachments = blendAttachmentStates.data();
         return *this;
     }
+    // Override blend factors of an attachment added by setAttachments, blend op is always add
+    BlendStateCIBuilder& setBlendFactors(uint32_t nAttachment, VkBlendFactor srcColor, VkBlendFactor dstColor, VkBlendFactor srcAlpha, VkBlendFactor dstAlpha)
+    {
+        assert(nAttachment < blendAttachmentStates.size());
+        VkPipelineColorBlendAttachmentState& blendState = blendAttachmentStates[nAttachment];
+        blendState.blendEnable = VK_TRUE;
+        blendState.srcColorBlendFactor = srcColor;
+        blendState.dstColorBlendFactor = dstColor;
+        blendState.colorBlendOp = VK_BLEND_OP_ADD;
+        blendState.srcAlphaBlendFactor = srcAlpha;
+        blendState.dstAlphaBlendFactor = dstAlpha;
+        blendState.alphaBlendOp = VK_BLEND_OP_ADD;
+        return *this;
+    }
 
 private:
     static VkPipelineColorBlendAttachmentState getAttachmentBlendState(bool bEnabled)
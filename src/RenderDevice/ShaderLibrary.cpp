@@ -0,0 +1,104 @@
+#include "ShaderLibrary.h"
+
+#include <cassert>
+
+#include "Debug.h"
+#include "PipelineStateBuilder.h"
+#include "VkRenderDevice.h"
+
+namespace Muyo
+{
+
+static ShaderLibrary s_shaderLibrary;
+
+ShaderLibrary* GetShaderLibrary()
+{
+    return &s_shaderLibrary;
+}
+
+void ShaderLibrary::Preload(const std::filesystem::path& directory)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".spv")
+        {
+            GetSpv(entry.path().generic_string());
+        }
+    }
+}
+
+const std::vector<char>& ShaderLibrary::GetSpv(const std::string& sPath)
+{
+    auto it = m_mSpvs.find(sPath);
+    if (it == m_mSpvs.end())
+    {
+        it = m_mSpvs.emplace(sPath, ReadSpv(sPath)).first;
+    }
+    return it->second;
+}
+
+VkShaderModule ShaderLibrary::AcquireShaderModule(const std::string& sPath)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::vector<char>& vSpv = GetSpv(sPath);
+    const std::string_view spv(vSpv.data(), vSpv.size());
+
+    ShaderModule& shaderModule = m_mModules[spv];
+    if (shaderModule.shaderModule == VK_NULL_HANDLE)
+    {
+        shaderModule.shaderModule = CreateShaderModule(vSpv);
+        setDebugUtilsObjectName(reinterpret_cast<uint64_t>(shaderModule.shaderModule), VK_OBJECT_TYPE_SHADER_MODULE, sPath.c_str());
+        m_mModuleSpvs[shaderModule.shaderModule] = spv;
+    }
+    shaderModule.nRefCount++;
+    return shaderModule.shaderModule;
+}
+
+void ShaderLibrary::ReleaseShaderModule(VkShaderModule shaderModule)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_mModuleSpvs.find(shaderModule);
+    assert(it != m_mModuleSpvs.end() && "Module wasn't acquired from the library");
+    ShaderModule& entry = m_mModules[it->second];
+    assert(entry.nRefCount > 0);
+    entry.nRefCount--;
+}
+
+void ShaderLibrary::ReleaseUnusedModules()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_mModules.begin(); it != m_mModules.end();)
+    {
+        if (it->second.nRefCount == 0)
+        {
+            vkDestroyShaderModule(GetRenderDevice()->GetDevice(), it->second.shaderModule, nullptr);
+            m_mModuleSpvs.erase(it->second.shaderModule);
+            it = m_mModules.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void ShaderLibrary::Destroy()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& [spv, shaderModule] : m_mModules)
+    {
+        assert(shaderModule.nRefCount == 0 && "Pipeline build still holds a module");
+        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), shaderModule.shaderModule, nullptr);
+    }
+    m_mModules.clear();
+    m_mModuleSpvs.clear();
+}
+
+uint32_t ShaderLibrary::GetModuleCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<uint32_t>(m_mModules.size());
+}
+
+}  // namespace Muyo
@@ -0,0 +1,52 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Muyo
+{
+/*
+ * Owns the SPIR-V code and shader modules of all pipelines.
+ * Code is read from disk once per file and kept for the lifetime of the process. Modules are keyed by the code
+ * itself, pipelines built from the same shader share one module even when the file is listed under another name.
+ * Pipeline builds acquire modules and release them once the pipeline is created, modules nobody holds are destroyed
+ * by ReleaseUnusedModules. Pipelines are built on compiler threads, all functions are thread safe.
+ */
+class ShaderLibrary
+{
+public:
+    // Read every .spv file in the directory up front, acquiring them never touches the disk
+    void Preload(const std::filesystem::path& directory);
+
+    VkShaderModule AcquireShaderModule(const std::string& sPath);
+    void ReleaseShaderModule(VkShaderModule shaderModule);
+    // Call once pipeline builds are done, modules are recreated from the cached code when acquired again
+    void ReleaseUnusedModules();
+    void Destroy();
+
+    uint32_t GetModuleCount() const;
+
+private:
+    // Caller holds the mutex
+    const std::vector<char>& GetSpv(const std::string& sPath);
+
+    struct ShaderModule
+    {
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        uint32_t nRefCount = 0;
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::vector<char>> m_mSpvs;         // File path to code
+    std::unordered_map<std::string_view, ShaderModule> m_mModules;      // Views into m_mSpvs
+    std::unordered_map<VkShaderModule, std::string_view> m_mModuleSpvs;  // Code of each module
+};
+
+ShaderLibrary* GetShaderLibrary();
+}  // namespace Muyo
@@ -0,0 +1,89 @@
+#include "StagingRing.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "Debug.h"
+#include "VkMemoryAllocator.h"
+#include "VkRenderDevice.h"
+
+namespace Muyo
+{
+
+static StagingRing s_stagingRing;
+
+StagingRing* GetStagingRing()
+{
+    return &s_stagingRing;
+}
+
+void StagingRing::Initialize(VkDeviceSize nFrameSize)
+{
+    assert(m_buffer == VK_NULL_HANDLE);
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(GetRenderDevice()->GetPhysicalDevice(), &properties);
+    m_nAlignment = std::max<VkDeviceSize>(properties.limits.optimalBufferCopyOffsetAlignment, 1);
+    m_nFrameSize = (nFrameSize + m_nAlignment - 1) / m_nAlignment * m_nAlignment;
+
+    GetMemoryAllocator()->AllocateBuffer(m_nFrameSize * VkRenderDevice::FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                         VMA_MEMORY_USAGE_CPU_TO_GPU, m_buffer, m_allocation, "Staging ring");
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_buffer), VK_OBJECT_TYPE_BUFFER, "Staging ring");
+    m_pMappedData = static_cast<uint8_t*>(GetMemoryAllocator()->GetMappedData(m_allocation));
+}
+
+void StagingRing::Destroy()
+{
+    if (m_buffer != VK_NULL_HANDLE)
+    {
+        GetMemoryAllocator()->FreeBuffer(m_buffer, m_allocation);
+    }
+    m_buffer = VK_NULL_HANDLE;
+    m_allocation = VK_NULL_HANDLE;
+    m_pMappedData = nullptr;
+    m_aFrames = {};
+}
+
+void StagingRing::BeginFrame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_nCurrentFrame = (m_nCurrentFrame + 1) % VkRenderDevice::FRAMES_IN_FLIGHT;
+
+    // Copies out of the segment may still be running, it keeps its head and fills up until the next round
+    Frame& frame = m_aFrames[m_nCurrentFrame];
+    if (frame.nLiveAllocationCount == 0 &&
+        GetRenderDevice()->GetCompletedValue(VkRenderDevice::QUEUE_TRANSFER) >= frame.nLastUploadValue)
+    {
+        frame.nHead = 0;
+    }
+}
+
+bool StagingRing::Allocate(VkDeviceSize nSize, Allocation& allocation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Frame& frame = m_aFrames[m_nCurrentFrame];
+    const VkDeviceSize nOffset = (frame.nHead + m_nAlignment - 1) / m_nAlignment * m_nAlignment;
+    if (m_buffer == VK_NULL_HANDLE || nOffset + nSize > m_nFrameSize)
+    {
+        return false;
+    }
+    frame.nHead = nOffset + nSize;
+    frame.nLiveAllocationCount++;
+
+    allocation.buffer = m_buffer;
+    allocation.nOffset = m_nFrameSize * m_nCurrentFrame + nOffset;
+    allocation.pMappedData = m_pMappedData + allocation.nOffset;
+    return true;
+}
+
+void StagingRing::Free(const Allocation& allocation, uint64_t nUploadValue)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(allocation.buffer == m_buffer);
+    // The frame may have been retired since the allocation, uploads aren't tied to the render thread
+    Frame& frame = m_aFrames[allocation.nOffset / m_nFrameSize];
+    assert(frame.nLiveAllocationCount > 0);
+    frame.nLiveAllocationCount--;
+    frame.nLastUploadValue = std::max(frame.nLastUploadValue, nUploadValue);
+}
+
+}  // namespace Muyo
@@ -0,0 +1,60 @@
+#pragma once
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <mutex>
+
+#include "VkRenderDevice.h"
+
+namespace Muyo
+{
+/*
+ * Persistently mapped staging memory for updates of device local buffers.
+ * The ring is split into one segment per frame in flight. Uploads of a frame are suballocated linearly from its
+ * segment and freed with the transfer timeline value of their copy. When the frame comes around again the segment
+ * is rewound if the transfer queue is past its copies, otherwise it keeps filling up, nothing waits on the CPU.
+ * A per frame update costs a memcpy and no allocator calls. Uploads that don't fit return false, the caller falls
+ * back to a dedicated staging buffer (e.g. scene data at load time).
+ */
+class StagingRing
+{
+public:
+    struct Allocation
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize nOffset = 0;
+        void* pMappedData = nullptr;
+    };
+
+    // Memory allocator must be initialized
+    void Initialize(VkDeviceSize nFrameSize = DEFAULT_FRAME_SIZE);
+    void Destroy();
+    // Retire the current frame's segment and start the next one
+    void BeginFrame();
+    bool Allocate(VkDeviceSize nSize, Allocation& allocation);
+    // Copies out of the allocation are done once the transfer queue reaches nUploadValue
+    void Free(const Allocation& allocation, uint64_t nUploadValue);
+
+private:
+    static const VkDeviceSize DEFAULT_FRAME_SIZE = 4 * 1024 * 1024;
+
+    struct Frame
+    {
+        VkDeviceSize nHead = 0;                // Next free byte, relative to the segment
+        uint32_t nLiveAllocationCount = 0;     // Allocations not freed yet
+        uint64_t nLastUploadValue = 0;         // Transfer timeline value of the last copy out of the segment
+    };
+
+    std::mutex m_mutex;  // Uploads aren't tied to the render thread
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    VmaAllocation m_allocation = VK_NULL_HANDLE;
+    uint8_t* m_pMappedData = nullptr;
+    VkDeviceSize m_nFrameSize = 0;
+    VkDeviceSize m_nAlignment = 1;
+    std::array<Frame, VkRenderDevice::FRAMES_IN_FLIGHT> m_aFrames;
+    uint32_t m_nCurrentFrame = 0;
+};
+
+StagingRing* GetStagingRing();
+}  // namespace Muyo
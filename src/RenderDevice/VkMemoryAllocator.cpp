@@ -77,6 +77,10 @@ void VkMemoryAllocator::AllocateBuffer(VkDeviceSize nSize,
 
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage = nMemoryUsageFlags;
+    if (IsHostVisible(nMemoryUsageFlags))
+    {
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    }
 
     vmaCreateBuffer(m_allocator, &bufferInfo, &allocInfo, &buffer,
                     &allocation, nullptr);
@@ -99,6 +103,10 @@ void VkMemoryAllocator::AllocateBuffer(VkDeviceSize nSize,
     allocInfo.usage = nMemoryUsageFlags;
     allocInfo.flags = VMA_ALLOCATION_CREATE_USER_DATA_COPY_STRING_BIT;
     allocInfo.pUserData = bufferName.data();
+    if (IsHostVisible(nMemoryUsageFlags))
+    {
+        allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    }
 
     switch (ePoolType)
     {
@@ -131,6 +139,13 @@ void VkMemoryAllocator::UnmapBuffer(VmaAllocation& allocation)
     vmaUnmapMemory(m_allocator, allocation);
 }
 
+void* VkMemoryAllocator::GetMappedData(const VmaAllocation& allocation) const
+{
+    VmaAllocationInfo allocationInfo = {};
+    vmaGetAllocationInfo(m_allocator, allocation, &allocationInfo);
+    return allocationInfo.pMappedData;
+}
+
 void VkMemoryAllocator::AllocateImage(const VkImageCreateInfo* pImageInfo,
                                       VmaMemoryUsage nMemoryUsageFlags,
                                       VkImage& image, VmaAllocation& allocation)
@@ -146,6 +161,33 @@ void VkMemoryAllocator::FreeImage(VkImage& image, VmaAllocation& allocation)
     vmaDestroyImage(m_allocator, image, allocation);
 }
 
+void VkMemoryAllocator::AllocateMemory(const VkMemoryRequirements& memoryRequirements, VmaAllocation& allocation, bool bPreferLazilyAllocated)
+{
+    VmaAllocationCreateInfo allocInfo = {};
+    if (bPreferLazilyAllocated)
+    {
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+        if (vmaAllocateMemory(m_allocator, &memoryRequirements, &allocInfo, &allocation, nullptr) == VK_SUCCESS)
+        {
+            return;
+        }
+    }
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    VK_ASSERT(vmaAllocateMemory(m_allocator, &memoryRequirements, &allocInfo, &allocation, nullptr));
+}
+
+void VkMemoryAllocator::BindImageMemory(VmaAllocation& allocation, VkDeviceSize nOffset, VkImage image)
+{
+    VK_ASSERT(vmaBindImageMemory2(m_allocator, allocation, nOffset, image, nullptr));
+}
+
+void VkMemoryAllocator::FreeMemory(VmaAllocation& allocation)
+{
+    vmaFreeMemory(m_allocator, allocation);
+    allocation = VK_NULL_HANDLE;
+}
+
 static VkMemoryAllocator allocator;
 VkMemoryAllocator* GetMemoryAllocator() { return &allocator; }
 
@@ -31,12 +31,26 @@ public:
     void FreeBuffer(VkBuffer &buffer, VmaAllocation &allocation);
     void MapBuffer(VmaAllocation &allocation, void **ppData);
     void UnmapBuffer(VmaAllocation &allocation);
+    // Host visible buffers are mapped for their whole lifetime, the pointer stays valid until the buffer is freed
+    void *GetMappedData(const VmaAllocation &allocation) const;
+    static bool IsHostVisible(VmaMemoryUsage nMemoryUsage)
+    {
+        return nMemoryUsage == VMA_MEMORY_USAGE_CPU_ONLY || nMemoryUsage == VMA_MEMORY_USAGE_CPU_TO_GPU ||
+               nMemoryUsage == VMA_MEMORY_USAGE_GPU_TO_CPU;
+    }
 
     void AllocateImage(const VkImageCreateInfo *pImageInfo,
                        VmaMemoryUsage nMemoryUsageFlags, VkImage &image,
                        VmaAllocation &allocation);
     void FreeImage(VkImage &image, VmaAllocation &allocation);
 
+    // Raw memory allocations, images are bound to them manually so several images can alias the same memory.
+    // Lazily allocated memory is preferred for transient attachments, it falls back to device memory on devices
+    // without it.
+    void AllocateMemory(const VkMemoryRequirements &memoryRequirements, VmaAllocation &allocation, bool bPreferLazilyAllocated = false);
+    void BindImageMemory(VmaAllocation &allocation, VkDeviceSize nOffset, VkImage image);
+    void FreeMemory(VmaAllocation &allocation);
+
 private:
     VmaAllocator m_allocator = VK_NULL_HANDLE;
     VmaPool m_SBTPool = VK_NULL_HANDLE; // SBT pool uses another aligment, need to be allocated in a separate pool
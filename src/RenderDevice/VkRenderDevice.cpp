@@ -1,11 +1,16 @@
 #include "VkRenderDevice.h"
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
 #include <set>
+#include <string>
+#include <thread>
 
 #include "Debug.h"
 #include "RenderResourceManager.h"
 #include "ResourceBarrier.h"
+#include "VkMemoryAllocator.h"
 
 namespace Muyo
 {
@@ -199,6 +204,13 @@ void VkRenderDevice::CreateDevice(
     features12.bufferDeviceAddress = VK_TRUE;
     features12.separateDepthStencilLayouts = VK_TRUE;
     features12.runtimeDescriptorArray = VK_TRUE;
+    features12.timelineSemaphore = VK_TRUE;
+    // Bindless heap, see DescriptorManager
+    features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    features12.descriptorBindingPartiallyBound = VK_TRUE;
+    features12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
     VkPhysicalDeviceVulkan11Features features11 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES};
     features11.multiview = VK_TRUE;
 
@@ -274,6 +286,31 @@ void VkRenderDevice::CreateDevice(
         nQueueFamilyIdx++;
     }
 
+    // Prefer a compute only queue family so compute work can run asynchronously with graphics
+    nQueueFamilyIdx = 0;
+    for (const auto& queueFamily : queueFamilies)
+    {
+        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            m_queueFamilyIndices.nComputeQueueFamily = nQueueFamilyIdx;
+            break;
+        }
+        nQueueFamilyIdx++;
+    }
+
+    // Uploads go to a transfer only queue family if there is one, otherwise they share graphics queue
+    m_queueFamilyIndices.nTransferQueueFamily = m_queueFamilyIndices.nGraphicsQueueFamily;
+    nQueueFamilyIdx = 0;
+    for (const auto& queueFamily : queueFamilies)
+    {
+        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+        {
+            m_queueFamilyIndices.nTransferQueueFamily = nQueueFamilyIdx;
+            break;
+        }
+        nQueueFamilyIdx++;
+    }
+
     // We should at least have one graphics queue
     assert(m_queueFamilyIndices.nGraphicsQueueFamily >= 0);
 
@@ -313,6 +350,18 @@ void VkRenderDevice::CreateDevice(
         }));
     }
 
+    if (m_queueFamilyIndices.nTransferQueueFamily >= 0)
+    {
+        sQueueCreateInfos.insert(VkDeviceQueueCreateInfo({
+          VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,            // sType;
+          nullptr,                                               // pNext;
+          0,                                                     // flags;
+          (uint32_t)m_queueFamilyIndices.nTransferQueueFamily,   // queueFamilyIndex;
+          1,                                                     // queueCount;
+          &fQueuePriority                                        // pQueuePriorities;
+        }));
+    }
+
     // Make sure we have at least one queue
     assert(sQueueCreateInfos.size() > 0);
 
@@ -376,11 +425,41 @@ void VkRenderDevice::CreateDevice(
                 setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_computeQueue), VK_OBJECT_TYPE_QUEUE, "Compute Queue");
             }
         }
+
+        vkGetDeviceQueue(m_device, m_queueFamilyIndices.nTransferQueueFamily, 0, &m_transferQueue);
+        if (m_transferQueue != m_graphicsQueue)
+        {
+            setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_transferQueue), VK_OBJECT_TYPE_QUEUE, "Transfer Queue");
+        }
+    }
+
+    // Queue timelines
+    {
+        VkSemaphoreTypeCreateInfo typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        const std::array<const char*, QUEUE_COUNT> aNames = {"Graphics Timeline", "Compute Timeline", "Transfer Timeline"};
+        for (uint32_t i = 0; i < QUEUE_COUNT; i++)
+        {
+            VK_ASSERT(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_aTimelineSemaphores[i]));
+            setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_aTimelineSemaphores[i]), VK_OBJECT_TYPE_SEMAPHORE, aNames[i]);
+            m_aTimelineValues[i] = 0;
+        }
     }
 }
 
 void VkRenderDevice::DestroyDevice()
 {
+    for (auto& semaphore : m_aTimelineSemaphores)
+    {
+        vkDestroySemaphore(m_device, semaphore, nullptr);
+        semaphore = VK_NULL_HANDLE;
+    }
     vkDestroyDevice(m_device, nullptr);
     m_device = VK_NULL_HANDLE;
 }
@@ -416,14 +495,44 @@ void VkRenderDevice::CreateCommandPools()
         commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
         VK_ASSERT(vkCreateCommandPool(m_device, &commandPoolInfo, nullptr, &m_aCommandPools[COMPUTE_CMD_POOL]));
     }
+
+    // Upload pool
+    {
+        commandPoolInfo.queueFamilyIndex = m_queueFamilyIndices.nTransferQueueFamily;
+        commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        VK_ASSERT(vkCreateCommandPool(m_device, &commandPoolInfo, nullptr, &m_aCommandPools[TRANSFER_CMD_POOL]));
+    }
+
+    // Per thread pools for secondary command buffers
+    {
+        uint32_t nThreadCount = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_RECORDING_THREAD_COUNT);
+        m_vThreadCommandPools.resize(nThreadCount);
+        commandPoolInfo.queueFamilyIndex = m_queueFamilyIndices.nGraphicsQueueFamily;
+        commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        for (uint32_t i = 0; i < nThreadCount; i++)
+        {
+            VK_ASSERT(vkCreateCommandPool(m_device, &commandPoolInfo, nullptr, &m_vThreadCommandPools[i].commandPool));
+            setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_vThreadCommandPools[i].commandPool), VK_OBJECT_TYPE_COMMAND_POOL, "Recording thread " + std::to_string(i));
+        }
+    }
 }
 
 void VkRenderDevice::DestroyCommandPools()
 {
+    // Command buffers are freed with their pools, staging buffers aren't
+    WaitForAllQueues();
+    FreeCompletedUploads();
+    assert(m_vPendingBufferFrees.empty());
+    m_vPendingUploadCmdBufs.clear();
     for (auto& cmdPool : m_aCommandPools)
     {
         vkDestroyCommandPool(m_device, cmdPool, nullptr);
     }
+    for (auto& threadPool : m_vThreadCommandPools)
+    {
+        vkDestroyCommandPool(m_device, threadPool.commandPool, nullptr);
+    }
+    m_vThreadCommandPools.clear();
 }
 
 void VkRenderDevice::Unintialize()
@@ -471,15 +580,49 @@ void VkRenderDevice::FreeImmediateCommandBuffer(VkCommandBuffer& commandBuffer)
     FreePrimaryCommandbuffer(commandBuffer, IMMEDIATE_CMD_POOL);
 }
 
-VkCommandBuffer VkRenderDevice::AllocateSecondaryCommandBuffer()
+VkCommandBuffer VkRenderDevice::AllocateTransferCommandBuffer()
+{
+    return AllocatePrimaryCommandbuffer(TRANSFER_CMD_POOL);
+}
+
+void VkRenderDevice::FreeTransferCommandBuffer(VkCommandBuffer& commandBuffer)
 {
-    // TODO: Implement this
-    return VkCommandBuffer();
+    FreePrimaryCommandbuffer(commandBuffer, TRANSFER_CMD_POOL);
+}
+
+VkCommandBuffer VkRenderDevice::AllocateSecondaryCommandBuffer(uint32_t nThreadIdx)
+{
+    assert(nThreadIdx < m_vThreadCommandPools.size());
+    ThreadCommandPool& threadPool = m_vThreadCommandPools[nThreadIdx];
+    if (threadPool.nUsedCount == threadPool.vCommandBuffers.size())
+    {
+        VkCommandBuffer commandBuffer;
+        VkCommandBufferAllocateInfo cmdAllocInfo = {};
+        cmdAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmdAllocInfo.commandPool = threadPool.commandPool;
+        cmdAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        cmdAllocInfo.commandBufferCount = 1;
+        VK_ASSERT(vkAllocateCommandBuffers(m_device, &cmdAllocInfo, &commandBuffer));
+        threadPool.vCommandBuffers.push_back(commandBuffer);
+    }
+    return threadPool.vCommandBuffers[threadPool.nUsedCount++];
 }
-void VkRenderDevice::FreeSecondaryCommandBuffer(VkCommandBuffer& commandBuffer)
+
+void VkRenderDevice::ResetSecondaryCommandPools()
 {
-    vkFreeCommandBuffers(m_device, m_aCommandPools[MAIN_CMD_POOL], 1,
-                         &commandBuffer);
+    for (ThreadCommandPool& threadPool : m_vThreadCommandPools)
+    {
+        // Buffers go back to initial state, the ones the last recording didn't need are freed
+        VK_ASSERT(vkResetCommandPool(m_device, threadPool.commandPool, 0));
+        if (threadPool.nUsedCount < threadPool.vCommandBuffers.size())
+        {
+            vkFreeCommandBuffers(m_device, threadPool.commandPool,
+                                 static_cast<uint32_t>(threadPool.vCommandBuffers.size() - threadPool.nUsedCount),
+                                 threadPool.vCommandBuffers.data() + threadPool.nUsedCount);
+            threadPool.vCommandBuffers.resize(threadPool.nUsedCount);
+        }
+        threadPool.nUsedCount = 0;
+    }
 }
 
 // Helper functions
@@ -541,32 +684,280 @@ void VkRenderDevice::FreePrimaryCommandbuffer(VkCommandBuffer& commandBuffer,
     vkFreeCommandBuffers(m_device, m_aCommandPools[pool], 1, &commandBuffer);
 }
 
-void VkRenderDevice::SubmitCommandBuffers(std::vector<VkCommandBuffer>& vCmdBuffers, VkQueue queue, std::vector<VkSemaphore>& waitSemaphores, std::vector<VkSemaphore>& signalSemaphores, std::vector<VkPipelineStageFlags> flags, VkFence signalFence)
+uint64_t VkRenderDevice::SubmitCommandBuffers(const std::vector<VkCommandBuffer>& vCmdBuffers, QueueType queue, const std::vector<SemaphoreWait>& vWaits, const std::vector<VkSemaphore>& vBinarySignals)
 {
+    std::vector<VkSemaphore> vWaitSemaphores;
+    std::vector<uint64_t> vWaitValues;
+    std::vector<VkPipelineStageFlags> vWaitStages;
+    for (const SemaphoreWait& wait : vWaits)
+    {
+        vWaitSemaphores.push_back(wait.semaphore);
+        vWaitValues.push_back(wait.nValue);
+        vWaitStages.push_back(wait.stages);
+    }
+
+    // Queue timeline goes first, values of binary semaphores are ignored
+    const uint64_t nSignalValue = ++m_aTimelineValues[queue];
+    std::vector<VkSemaphore> vSignalSemaphores = {m_aTimelineSemaphores[queue]};
+    vSignalSemaphores.insert(vSignalSemaphores.end(), vBinarySignals.begin(), vBinarySignals.end());
+    std::vector<uint64_t> vSignalValues(vSignalSemaphores.size(), 0);
+    vSignalValues[0] = nSignalValue;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = (uint32_t)vWaitValues.size();
+    timelineInfo.pWaitSemaphoreValues = vWaitValues.data();
+    timelineInfo.signalSemaphoreValueCount = (uint32_t)vSignalValues.size();
+    timelineInfo.pSignalSemaphoreValues = vSignalValues.data();
+
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = (uint32_t)waitSemaphores.size();
-    submitInfo.pWaitSemaphores = waitSemaphores.data();
-    submitInfo.pWaitDstStageMask = flags.data();
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = (uint32_t)vWaitSemaphores.size();
+    submitInfo.pWaitSemaphores = vWaitSemaphores.data();
+    submitInfo.pWaitDstStageMask = vWaitStages.data();
 
     submitInfo.commandBufferCount = static_cast<uint32_t>(vCmdBuffers.size());
     submitInfo.pCommandBuffers = vCmdBuffers.data();
 
-    submitInfo.signalSemaphoreCount = (uint32_t)signalSemaphores.size();
-    submitInfo.pSignalSemaphores = signalSemaphores.data();
+    submitInfo.signalSemaphoreCount = (uint32_t)vSignalSemaphores.size();
+    submitInfo.pSignalSemaphores = vSignalSemaphores.data();
 
-    VK_ASSERT(vkQueueSubmit(queue, 1, &submitInfo, signalFence));
+    VK_ASSERT(vkQueueSubmit(GetQueue(queue), 1, &submitInfo, VK_NULL_HANDLE));
+    return nSignalValue;
 }
 
-void VkRenderDevice::SubmitCommandBuffersAndWait(std::vector<VkCommandBuffer>& vCmdBuffers)
+VkQueue VkRenderDevice::GetQueue(QueueType queue) const
 {
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = static_cast<uint32_t>(vCmdBuffers.size());
-    submitInfo.pCommandBuffers = vCmdBuffers.data();
+    switch (queue)
+    {
+        case QUEUE_COMPUTE:
+            return m_computeQueue;
+        case QUEUE_TRANSFER:
+            return m_transferQueue;
+        default:
+            return m_graphicsQueue;
+    }
+}
+
+uint32_t VkRenderDevice::GetQueueFamilyIndex(QueueType queue) const
+{
+    switch (queue)
+    {
+        case QUEUE_COMPUTE:
+            return GetComputeQueueFamilyIndex();
+        case QUEUE_TRANSFER:
+            return GetTransferQueueFamilyIndex();
+        default:
+            return GetGraphicsQueueFamilyIndex();
+    }
+}
 
-    VK_ASSERT(vkQueueSubmit(GetGraphicsQueue(), 1, &submitInfo, nullptr));
-    VK_ASSERT(vkQueueWaitIdle(GetGraphicsQueue()));
+VkCommandBuffer VkRenderDevice::AllocateOwnershipCommandBuffer(QueueType queue)
+{
+    assert(queue != QUEUE_TRANSFER);
+    VkCommandBuffer cmdBuf = AllocatePrimaryCommandbuffer(queue == QUEUE_COMPUTE ? COMPUTE_CMD_POOL : IMMEDIATE_CMD_POOL);
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmdBuf, &beginInfo);
+    return cmdBuf;
+}
+
+std::vector<VkRenderDevice::SemaphoreWait> VkRenderDevice::AcquireFromPrevOwner(VkCommandBuffer uploadCmdBuf,
+                                                                                const std::vector<VkBufferMemoryBarrier>& vBufferBarriers,
+                                                                                QueueType ePrevOwner)
+{
+    // Never uploaded, nothing reads the old content
+    if (ePrevOwner == QUEUE_COUNT || vBufferBarriers.empty())
+    {
+        return {};
+    }
+    assert(ePrevOwner != QUEUE_TRANSFER);
+
+    // The old content is discarded, only the execution dependency on the owner's reads and the ownership matter
+    const uint32_t nOwnerFamily = GetQueueFamilyIndex(ePrevOwner);
+    const uint32_t nTransferFamily = GetTransferQueueFamilyIndex();
+    uint64_t nOwnerValue = GetLastSubmittedValue(ePrevOwner);
+    if (nOwnerFamily != nTransferFamily)
+    {
+        std::vector<VkBufferMemoryBarrier> vReleases = vBufferBarriers;
+        for (VkBufferMemoryBarrier& barrier : vReleases)
+        {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = 0;
+            barrier.srcQueueFamilyIndex = nOwnerFamily;
+            barrier.dstQueueFamilyIndex = nTransferFamily;
+        }
+        VkCommandBuffer releaseCmdBuf = AllocateOwnershipCommandBuffer(ePrevOwner);
+        vkCmdPipelineBarrier(releaseCmdBuf, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                             0, nullptr,
+                             static_cast<uint32_t>(vReleases.size()), vReleases.data(),
+                             0, nullptr);
+        vkEndCommandBuffer(releaseCmdBuf);
+        nOwnerValue = SubmitCommandBuffers({releaseCmdBuf}, ePrevOwner);
+        m_vPendingUploadCmdBufs.push_back({releaseCmdBuf, ePrevOwner, nOwnerValue});
+
+        std::vector<VkBufferMemoryBarrier> vAcquires = vReleases;
+        for (VkBufferMemoryBarrier& barrier : vAcquires)
+        {
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        }
+        vkCmdPipelineBarrier(uploadCmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr,
+                             static_cast<uint32_t>(vAcquires.size()), vAcquires.data(),
+                             0, nullptr);
+    }
+    return {GetTimelineWait(ePrevOwner, nOwnerValue, VK_PIPELINE_STAGE_TRANSFER_BIT)};
+}
+
+uint64_t VkRenderDevice::SubmitUpload(VkCommandBuffer uploadCmdBuf,
+                                      std::vector<VkBufferMemoryBarrier>& vBufferBarriers,
+                                      std::vector<VkImageMemoryBarrier>& vImageBarriers,
+                                      const UploadConsumer& consumer,
+                                      const std::vector<SemaphoreWait>& vWaits)
+{
+    FreeCompletedUploads();
+    assert(consumer.queue != QUEUE_TRANSFER);
+
+    // Release: make copies available and hand the resources to the consumer queue. When the consumer is the
+    // transfer queue itself (no dedicated transfer queue, graphics consumer) this is a regular barrier.
+    const bool bSameQueue = GetQueue(consumer.queue) == GetQueue(QUEUE_TRANSFER);
+    const bool bTransferOwnership = GetQueueFamilyIndex(consumer.queue) != GetTransferQueueFamilyIndex();
+    const uint32_t nSrcQueueFamily = bTransferOwnership ? GetTransferQueueFamilyIndex() : VK_QUEUE_FAMILY_IGNORED;
+    const uint32_t nDstQueueFamily = bTransferOwnership ? GetQueueFamilyIndex(consumer.queue) : VK_QUEUE_FAMILY_IGNORED;
+    std::vector<VkBufferMemoryBarrier> vBufferReleases = vBufferBarriers;
+    for (VkBufferMemoryBarrier& barrier : vBufferReleases)
+    {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = bSameQueue ? barrier.dstAccessMask : 0;
+        barrier.srcQueueFamilyIndex = nSrcQueueFamily;
+        barrier.dstQueueFamilyIndex = nDstQueueFamily;
+    }
+    std::vector<VkImageMemoryBarrier> vImageReleases = vImageBarriers;
+    for (VkImageMemoryBarrier& barrier : vImageReleases)
+    {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = bSameQueue ? barrier.dstAccessMask : 0;
+        barrier.srcQueueFamilyIndex = nSrcQueueFamily;
+        barrier.dstQueueFamilyIndex = nDstQueueFamily;
+    }
+    vkCmdPipelineBarrier(uploadCmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         bSameQueue ? consumer.stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr,
+                         static_cast<uint32_t>(vBufferReleases.size()), vBufferReleases.data(),
+                         static_cast<uint32_t>(vImageReleases.size()), vImageReleases.data());
+    vkEndCommandBuffer(uploadCmdBuf);
+    uint64_t nUploadValue = SubmitCommandBuffers({uploadCmdBuf}, QUEUE_TRANSFER, vWaits);
+    m_vPendingUploadCmdBufs.push_back({uploadCmdBuf, QUEUE_TRANSFER, nUploadValue});
+
+    if (!bSameQueue)
+    {
+        // Acquire on the consumer queue, after the copies are done. Source stages chain with the semaphore wait.
+        // Within one family this only makes the copies visible to the consumer queue.
+        for (VkBufferMemoryBarrier& barrier : vBufferBarriers)
+        {
+            barrier.srcAccessMask = bTransferOwnership ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.srcQueueFamilyIndex = nSrcQueueFamily;
+            barrier.dstQueueFamilyIndex = nDstQueueFamily;
+        }
+        for (VkImageMemoryBarrier& barrier : vImageBarriers)
+        {
+            barrier.srcAccessMask = bTransferOwnership ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.srcQueueFamilyIndex = nSrcQueueFamily;
+            barrier.dstQueueFamilyIndex = nDstQueueFamily;
+        }
+        VkCommandBuffer acquireCmdBuf = AllocateOwnershipCommandBuffer(consumer.queue);
+        vkCmdPipelineBarrier(acquireCmdBuf, consumer.stages, consumer.stages, 0,
+                             0, nullptr,
+                             static_cast<uint32_t>(vBufferBarriers.size()), vBufferBarriers.data(),
+                             static_cast<uint32_t>(vImageBarriers.size()), vImageBarriers.data());
+        vkEndCommandBuffer(acquireCmdBuf);
+        uint64_t nAcquireValue = SubmitCommandBuffers({acquireCmdBuf}, consumer.queue, {GetTimelineWait(QUEUE_TRANSFER, nUploadValue, consumer.stages)});
+        m_vPendingUploadCmdBufs.push_back({acquireCmdBuf, consumer.queue, nAcquireValue});
+    }
+
+    // Staging memory is only read by the copies, callers free it once the transfer queue reaches the value
+    return nUploadValue;
+}
+
+void VkRenderDevice::FreeStagingBuffer(VkBuffer& buffer, VmaAllocation& allocation, uint64_t nUploadValue)
+{
+    m_vPendingBufferFrees.push_back({buffer, allocation, {0, 0, nUploadValue}});
+    buffer = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
+}
+
+void VkRenderDevice::FreeBufferAfterSubmitted(VkBuffer& buffer, VmaAllocation& allocation)
+{
+    m_vPendingBufferFrees.push_back({buffer, allocation, m_aTimelineValues});
+    buffer = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
+}
+
+void VkRenderDevice::FreeCompletedUploads()
+{
+    const std::array<uint64_t, QUEUE_COUNT> aCompletedValues = {GetCompletedValue(QUEUE_GRAPHICS), GetCompletedValue(QUEUE_COMPUTE), GetCompletedValue(QUEUE_TRANSFER)};
+    auto it = std::remove_if(m_vPendingUploadCmdBufs.begin(), m_vPendingUploadCmdBufs.end(), [this, &aCompletedValues](PendingUploadCommandBuffer& pending)
+                             {
+                                 if (pending.nValue > aCompletedValues[pending.queue])
+                                 {
+                                     return false;
+                                 }
+                                 const CommandPools pool = pending.queue == QUEUE_TRANSFER  ? TRANSFER_CMD_POOL
+                                                           : pending.queue == QUEUE_COMPUTE ? COMPUTE_CMD_POOL
+                                                                                            : IMMEDIATE_CMD_POOL;
+                                 FreePrimaryCommandbuffer(pending.cmdBuf, pool);
+                                 return true;
+                             });
+    m_vPendingUploadCmdBufs.erase(it, m_vPendingUploadCmdBufs.end());
+
+    auto itBuffer = std::remove_if(m_vPendingBufferFrees.begin(), m_vPendingBufferFrees.end(), [&aCompletedValues](PendingBufferFree& pending)
+                                   {
+                                       for (uint32_t i = 0; i < QUEUE_COUNT; i++)
+                                       {
+                                           if (pending.aValues[i] > aCompletedValues[i])
+                                           {
+                                               return false;
+                                           }
+                                       }
+                                       GetMemoryAllocator()->FreeBuffer(pending.buffer, pending.allocation);
+                                       return true;
+                                   });
+    m_vPendingBufferFrees.erase(itBuffer, m_vPendingBufferFrees.end());
+}
+
+void VkRenderDevice::SubmitCommandBuffersAndWait(const std::vector<VkCommandBuffer>& vCmdBuffers)
+{
+    uint64_t nValue = SubmitCommandBuffers(vCmdBuffers, QUEUE_GRAPHICS);
+    WaitForTimelineValue(QUEUE_GRAPHICS, nValue);
+}
+
+uint64_t VkRenderDevice::GetCompletedValue(QueueType queue) const
+{
+    uint64_t nValue = 0;
+    VK_ASSERT(vkGetSemaphoreCounterValue(m_device, m_aTimelineSemaphores[queue], &nValue));
+    return nValue;
+}
+
+void VkRenderDevice::WaitForTimelineValue(QueueType queue, uint64_t nValue) const
+{
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_aTimelineSemaphores[queue];
+    waitInfo.pValues = &nValue;
+    VK_ASSERT(vkWaitSemaphores(m_device, &waitInfo, std::numeric_limits<uint64_t>::max()));
+}
+
+void VkRenderDevice::WaitForAllQueues() const
+{
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = QUEUE_COUNT;
+    waitInfo.pSemaphores = m_aTimelineSemaphores.data();
+    waitInfo.pValues = m_aTimelineValues.data();
+    VK_ASSERT(vkWaitSemaphores(m_device, &waitInfo, std::numeric_limits<uint64_t>::max()));
 }
 
 VkDeviceAddress VkRenderDevice::GetBufferDeviceAddress(VkBuffer buffer) const
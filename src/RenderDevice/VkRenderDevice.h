@@ -1,9 +1,11 @@
 #pragma once
+#include <vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
 
 #include <array>
 #include <cstring>  // strcmp
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "Debug.h"
@@ -15,6 +17,32 @@ class RenderResourceManager;
 class VkRenderDevice
 {
 public:
+    // Each queue has a timeline semaphore, every submission signals the next value of its queue timeline
+    enum QueueType
+    {
+        QUEUE_GRAPHICS,
+        QUEUE_COMPUTE,
+        QUEUE_TRANSFER,  // Graphics queue if the device has no dedicated transfer queue
+        QUEUE_COUNT
+    };
+
+    // Frames the CPU may record ahead of the GPU, per frame resources are kept this many times
+    static const uint32_t FRAMES_IN_FLIGHT = 2;
+
+    struct SemaphoreWait
+    {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        uint64_t nValue = 0;  // Ignored for binary semaphores
+        VkPipelineStageFlags stages = 0;
+    };
+
+    // Queue that first reads an uploaded resource and the stages reading it, access masks come with the barriers
+    struct UploadConsumer
+    {
+        QueueType queue = QUEUE_GRAPHICS;
+        VkPipelineStageFlags stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    };
+
     constexpr bool IsRayTracingSupported() const
     {
 #ifdef FEATURE_RAY_TRACING
@@ -49,9 +77,17 @@ public:
     VkDevice& GetDevice() { return m_device; }
     VkPhysicalDevice& GetPhysicalDevice() { return m_physicalDevice; }
     VkQueue& GetGraphicsQueue() { return m_graphicsQueue; }
-    VkQueue& GetImmediateQueue() { return m_graphicsQueue; }  // TODO: Handle copy queue
+    VkQueue& GetImmediateQueue() { return m_graphicsQueue; }  // Immediate commands may need graphics stages, uploads use transfer queue
+    VkQueue& GetTransferQueue() { return m_transferQueue; }
     VkQueue& GetPresentQueue() { return m_presentQueue; }
     VkQueue& GetComputeQueue() { return m_computeQueue; }
+    uint32_t GetGraphicsQueueFamilyIndex() const { return (uint32_t)m_queueFamilyIndices.nGraphicsQueueFamily; }
+    uint32_t GetComputeQueueFamilyIndex() const { return (uint32_t)m_queueFamilyIndices.nComputeQueueFamily; }
+    uint32_t GetTransferQueueFamilyIndex() const { return (uint32_t)m_queueFamilyIndices.nTransferQueueFamily; }
+    uint32_t GetQueueFamilyIndex(QueueType queue) const;
+    // Compute queue is from a different family and runs in parallel with graphics queue
+    bool IsAsyncComputeSupported() const { return m_queueFamilyIndices.nComputeQueueFamily != m_queueFamilyIndices.nGraphicsQueueFamily; }
+    bool IsDedicatedTransferSupported() const { return m_queueFamilyIndices.nTransferQueueFamily != m_queueFamilyIndices.nGraphicsQueueFamily; }
     VkInstance& GetInstance() { return m_instance; }
 
     void SetDevice(VkDevice device) { m_device = device; }
@@ -76,12 +112,20 @@ public:
     VkCommandBuffer AllocateReusablePrimaryCommandbuffer();
     void FreeReusablePrimaryCommandbuffer(VkCommandBuffer& commandBuffer);
 
-    VkCommandBuffer AllocateSecondaryCommandBuffer();
-    void FreeSecondaryCommandBuffer(VkCommandBuffer& commandBuffer);
+    // Secondary command buffers are allocated from per-thread pools so they can be recorded in parallel.
+    // A command pool is externally synchronized, only the thread owning nThreadIdx should use it.
+    // Buffers live until the pools are reset, allocations after a reset hand out the existing buffers again.
+    VkCommandBuffer AllocateSecondaryCommandBuffer(uint32_t nThreadIdx = 0);
+    // Call before re-recording, the queues must be done with the previous recording
+    void ResetSecondaryCommandPools();
+    uint32_t GetRecordingThreadCount() const { return static_cast<uint32_t>(m_vThreadCommandPools.size()); }
 
     VkCommandBuffer AllocateImmediateCommandBuffer();
     void FreeImmediateCommandBuffer(VkCommandBuffer& commandBuffer);
 
+    VkCommandBuffer AllocateTransferCommandBuffer();
+    void FreeTransferCommandBuffer(VkCommandBuffer& commandBuffer);
+
     // Comamnd buffer executions
     template <typename Func>
     void ExecuteImmediateCommand(Func fImmediateGPUTask)
@@ -95,23 +139,59 @@ public:
         fImmediateGPUTask(immediateCmdBuf);
         vkEndCommandBuffer(immediateCmdBuf);
 
-        VkSubmitInfo submitInfo = {};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &immediateCmdBuf;
-        vkQueueSubmit(GetImmediateQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(GetImmediateQueue());  // wait for it to finish
+        uint64_t nValue = SubmitCommandBuffers({immediateCmdBuf}, QUEUE_GRAPHICS);
+        WaitForTimelineValue(QUEUE_GRAPHICS, nValue);  // wait for it to finish
 
         FreeImmediateCommandBuffer(immediateCmdBuf);
     }
 
+    // Record copies with fRecordCopies and submit them to the transfer queue. Barriers describe the resources written
+    // by the copies and how the consumer reads them (dst access, new layout), their ownership is transferred to the
+    // consumer queue. Buffers that were uploaded before are released by ePrevOwner first, the copies wait for the
+    // owner to be done reading the old content. Doesn't block, returns the transfer timeline value the copies are
+    // done at. Staging memory must stay alive until then, see FreeStagingBuffer.
+    template <typename Func>
+    uint64_t ExecuteUploadCommand(Func fRecordCopies,
+                              std::vector<VkBufferMemoryBarrier> vBufferBarriers,
+                              std::vector<VkImageMemoryBarrier> vImageBarriers,
+                              const UploadConsumer& consumer,
+                              QueueType ePrevOwner = QUEUE_COUNT)
+    {
+        VkCommandBuffer uploadCmdBuf = AllocateTransferCommandBuffer();
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(uploadCmdBuf, &beginInfo);
+        std::vector<SemaphoreWait> vWaits = AcquireFromPrevOwner(uploadCmdBuf, vBufferBarriers, ePrevOwner);
+        fRecordCopies(uploadCmdBuf);
+        return SubmitUpload(uploadCmdBuf, vBufferBarriers, vImageBarriers, consumer, vWaits);
+    }
+
+    // Free a staging buffer once the transfer queue reaches nUploadValue
+    void FreeStagingBuffer(VkBuffer& buffer, VmaAllocation& allocation, uint64_t nUploadValue);
+    // Free a buffer once all queues are done with the work submitted so far, e.g. a buffer replaced by a bigger one
+    void FreeBufferAfterSubmitted(VkBuffer& buffer, VmaAllocation& allocation);
+    // Free upload command buffers and staging buffers the queues are done with, called once per frame
+    void FreeCompletedUploads();
+
     // Helper functions
     VkSampler CreateSampler();
 
     void AddResourceBarrier(VkCommandBuffer cmdBuf, IResourceBarrier& resourceBarrier);
 
-    void SubmitCommandBuffers(std::vector<VkCommandBuffer>& vCmdBuffers, VkQueue queue, std::vector<VkSemaphore>& waitSemaphores, std::vector<VkSemaphore>& signalSemaphores, std::vector<VkPipelineStageFlags> stageFlags, VkFence signalFence = VK_NULL_HANDLE);
-    void SubmitCommandBuffersAndWait(std::vector<VkCommandBuffer>& vCmdBuffers);
+    // Returns the timeline value signaled when the command buffers are done. Binary semaphores are only needed
+    // for swapchain synchronization.
+    uint64_t SubmitCommandBuffers(const std::vector<VkCommandBuffer>& vCmdBuffers, QueueType queue, const std::vector<SemaphoreWait>& vWaits = {}, const std::vector<VkSemaphore>& vBinarySignals = {});
+    void SubmitCommandBuffersAndWait(const std::vector<VkCommandBuffer>& vCmdBuffers);
+
+    // Timeline synchronization
+    SemaphoreWait GetTimelineWait(QueueType queue, uint64_t nValue, VkPipelineStageFlags stages) const { return {m_aTimelineSemaphores[queue], nValue, stages}; }
+    uint64_t GetLastSubmittedValue(QueueType queue) const { return m_aTimelineValues[queue]; }
+    uint64_t GetCompletedValue(QueueType queue) const;
+    void WaitForTimelineValue(QueueType queue, uint64_t nValue) const;
+    // Wait for everything submitted so far
+    void WaitForAllQueues() const;
 
     VkDeviceAddress GetBufferDeviceAddress(VkBuffer buffer) const;
 
@@ -139,6 +219,7 @@ private:  // Private structures
         IMMEDIATE_CMD_POOL,
         PER_FRAME_CMD_POOL,
         COMPUTE_CMD_POOL,
+        TRANSFER_CMD_POOL,
         NUM_CMD_POOLS
     };
 
@@ -201,6 +282,22 @@ private:  // helper functions to create render device
     void PickPhysicalDevice();
     VkCommandBuffer AllocatePrimaryCommandbuffer(CommandPools pool);
     void FreePrimaryCommandbuffer(VkCommandBuffer& commandBuffer, CommandPools pool);
+    VkQueue GetQueue(QueueType queue) const;
+
+    // Release the buffers on their previous owner and record the acquire on the transfer queue before the copies
+    // overwrite them. Returns the waits the upload submission needs.
+    std::vector<SemaphoreWait> AcquireFromPrevOwner(VkCommandBuffer uploadCmdBuf,
+                                                    const std::vector<VkBufferMemoryBarrier>& vBufferBarriers,
+                                                    QueueType ePrevOwner);
+    // Ends the upload command buffer with the release barriers, submits it and the acquire barriers. Returns the
+    // transfer timeline value of the copies, the command buffers are freed once their queues are done.
+    uint64_t SubmitUpload(VkCommandBuffer uploadCmdBuf,
+                      std::vector<VkBufferMemoryBarrier>& vBufferBarriers,
+                      std::vector<VkImageMemoryBarrier>& vImageBarriers,
+                      const UploadConsumer& consumer,
+                      const std::vector<SemaphoreWait>& vWaits);
+    // Ownership transfer command buffers recorded for graphics or compute queue
+    VkCommandBuffer AllocateOwnershipCommandBuffer(QueueType queue);
 
 private:  // Members
     struct QueueFamilyIndice
@@ -208,6 +305,7 @@ private:  // Members
         int nGraphicsQueueFamily = -1;
         int nPresentQueneFamily = -1;
         int nComputeQueueFamily = -1;
+        int nTransferQueueFamily = -1;
         bool isComplete() { return nGraphicsQueueFamily >= 0 && nPresentQueneFamily >= 0 && nComputeQueueFamily >= 0; }
     } m_queueFamilyIndices;
 
@@ -215,10 +313,41 @@ private:  // Members
     VkQueue m_graphicsQueue = VK_NULL_HANDLE;
     VkQueue m_presentQueue = VK_NULL_HANDLE;
     VkQueue m_computeQueue = VK_NULL_HANDLE;
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
 
     std::array<VkCommandPool, NUM_CMD_POOLS> m_aCommandPools;
 
+    std::array<VkSemaphore, QUEUE_COUNT> m_aTimelineSemaphores = {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE};
+    std::array<uint64_t, QUEUE_COUNT> m_aTimelineValues = {0, 0, 0};  // Last value submitted to each queue
+
+    // Upload copy, acquire and release command buffers, the queue they run on and the timeline value they are done at
+    struct PendingUploadCommandBuffer
+    {
+        VkCommandBuffer cmdBuf = VK_NULL_HANDLE;
+        QueueType queue = QUEUE_GRAPHICS;
+        uint64_t nValue = 0;
+    };
+    std::vector<PendingUploadCommandBuffer> m_vPendingUploadCmdBufs;
+    // Buffers queues may still access, freed once every queue reaches its value
+    struct PendingBufferFree
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        std::array<uint64_t, QUEUE_COUNT> aValues = {0, 0, 0};
+    };
+    std::vector<PendingBufferFree> m_vPendingBufferFrees;
+
+    // One graphics command pool per recording thread
+    static const uint32_t MAX_RECORDING_THREAD_COUNT = 8;
+    struct ThreadCommandPool
+    {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> vCommandBuffers;  // All buffers allocated from the pool
+        size_t nUsedCount = 0;                         // Buffers handed out since the last reset
+    };
+    std::vector<ThreadCommandPool> m_vThreadCommandPools;
+
     bool m_bIsValidationEnabled = false;
     std::vector<const char*> m_vLayers;
 
@@ -14,14 +14,22 @@ template <class T>
 class DrawCommandBuffer : public BufferResource
 {
 public:
-    DrawCommandBuffer(const T* drawCommands, uint32_t drawCommandCount)
-        : BufferResource(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU), m_nDrawCommandCount(drawCommandCount)
+    // Transfer destinations are written with copies, see BufferResource::SetData
+    DrawCommandBuffer(const T* drawCommands, uint32_t drawCommandCount, VkBufferUsageFlags additionalUsage = 0)
+        : BufferResource(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | additionalUsage, VMA_MEMORY_USAGE_CPU_TO_GPU), m_nDrawCommandCount(drawCommandCount)
     {
         m_nSize = sizeof(T) * drawCommandCount;
-        GetMemoryAllocator()->AllocateBuffer(m_nSize, BUFFER_USAGE, MEMORY_USAGE, m_buffer, m_allocation, "DrawCommandBuffer");
+        AllocateBuffer(m_nSize, "DrawCommandBuffer");
         SetData((void*)drawCommands, m_nSize);
     }
 
+    // Replace the commands, e.g. when a pass is recorded again with a different draw list
+    void SetDrawCommands(const T* drawCommands, uint32_t drawCommandCount)
+    {
+        m_nDrawCommandCount = drawCommandCount;
+        SetData((void*)drawCommands, sizeof(T) * drawCommandCount);
+    }
+
     uint32_t GetStride() const { return sizeof(T); }
 
     uint32_t GetDrawCommandCount() const {return m_nDrawCommandCount;}
@@ -0,0 +1,40 @@
+#include "ParallelCommandRecorder.h"
+
+#include <algorithm>
+#include <future>
+
+#include "PipelineCompiler.h"
+#include "VkRenderDevice.h"
+
+namespace Muyo
+{
+
+void ParallelCommandRecorder::Execute()
+{
+    const uint32_t nThreadCount = std::min(GetRenderDevice()->GetRecordingThreadCount(), static_cast<uint32_t>(m_vJobs.size()));
+    // Jobs of a recording thread run in order on one worker at a time, so only one worker uses its command pool
+    auto RecordThreadJobs = [this, nThreadCount](uint32_t nThreadIdx)
+    {
+        for (size_t i = nThreadIdx; i < m_vJobs.size(); i += nThreadCount)
+        {
+            m_vJobs[i](nThreadIdx);
+        }
+    };
+
+    std::vector<std::future<void>> vFutures;
+    vFutures.reserve(nThreadCount);
+    for (uint32_t nThreadIdx = 1; nThreadIdx < nThreadCount; nThreadIdx++)
+    {
+        vFutures.push_back(GetPipelineCompiler()->AddJob([RecordThreadJobs, nThreadIdx]()
+                                                         { RecordThreadJobs(nThreadIdx); }));
+    }
+    if (nThreadCount > 0)
+    {
+        RecordThreadJobs(0);
+    }
+    std::for_each(vFutures.begin(), vFutures.end(), [](std::future<void>& future)
+                  { future.get(); });
+    m_vJobs.clear();
+}
+
+}  // namespace Muyo
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Muyo
+{
+/*
+ * Records secondary command buffers on worker threads.
+ * Jobs are distributed round robin over the recording threads of the render device. Each job receives the index of
+ * the thread it runs on and must allocate its command buffers with that index, so no command pool is shared
+ * between threads. Jobs must only record commands, resources and descriptor sets are created before Execute().
+ * Recording threads run on the persistent workers of the pipeline compiler, the caller records the first one.
+ */
+class ParallelCommandRecorder
+{
+public:
+    using RecordingJob = std::function<void(uint32_t nThreadIdx)>;
+
+    void AddJob(RecordingJob&& job) { m_vJobs.emplace_back(std::move(job)); }
+
+    // Blocks until all jobs are recorded
+    void Execute();
+
+private:
+    std::vector<RecordingJob> m_vJobs;
+};
+}  // namespace Muyo
@@ -0,0 +1,80 @@
+#include "PipelineCompiler.h"
+
+#include <algorithm>
+
+namespace Muyo
+{
+
+static PipelineCompiler s_pipelineCompiler;
+
+PipelineCompiler* GetPipelineCompiler()
+{
+    return &s_pipelineCompiler;
+}
+
+void PipelineCompiler::Initialize()
+{
+    if (!m_vThreads.empty())
+    {
+        return;
+    }
+    m_bIsStopping = false;
+    const uint32_t nThreadCount = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_THREAD_COUNT);
+    m_vThreads.reserve(nThreadCount);
+    for (uint32_t i = 0; i < nThreadCount; i++)
+    {
+        m_vThreads.emplace_back([this]()
+                                { WorkerLoop(); });
+    }
+}
+
+void PipelineCompiler::Uninitialize()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_jobsMutex);
+        m_bIsStopping = true;
+    }
+    m_jobsCondition.notify_all();
+    std::for_each(m_vThreads.begin(), m_vThreads.end(), [](std::thread& thread)
+                  { thread.join(); });
+    m_vThreads.clear();
+}
+
+std::future<void> PipelineCompiler::AddJob(CompileJob&& job)
+{
+    std::packaged_task<void()> task(std::move(job));
+    std::future<void> future = task.get_future();
+    if (m_vThreads.empty())
+    {
+        task();
+        return future;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_jobsMutex);
+        m_qJobs.emplace_back(std::move(task));
+    }
+    m_jobsCondition.notify_one();
+    return future;
+}
+
+void PipelineCompiler::WorkerLoop()
+{
+    while (true)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_jobsMutex);
+            m_jobsCondition.wait(lock, [this]()
+                                 { return m_bIsStopping || !m_qJobs.empty(); });
+            if (m_qJobs.empty())
+            {
+                return;
+            }
+            task = std::move(m_qJobs.front());
+            m_qJobs.pop_front();
+        }
+        task();
+    }
+}
+
+}  // namespace Muyo
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Muyo
+{
+/*
+ * Creates pipelines on worker threads.
+ * Pipeline creation only reads its create infos and the shared pipeline cache, so the pipelines of different passes
+ * are compiled concurrently while the render thread keeps preparing passes. Each job returns a future, the owner
+ * waits on it before recording commands that bind the pipelines. Without worker threads jobs run on the caller.
+ * The workers also run the recording threads of ParallelCommandRecorder.
+ */
+class PipelineCompiler
+{
+public:
+    using CompileJob = std::function<void()>;
+
+    ~PipelineCompiler() { Uninitialize(); }
+
+    void Initialize();
+    // Finishes queued jobs before joining the workers
+    void Uninitialize();
+
+    std::future<void> AddJob(CompileJob&& job);
+
+private:
+    void WorkerLoop();
+
+    static const uint32_t MAX_THREAD_COUNT = 8;
+    std::vector<std::thread> m_vThreads;
+    std::deque<std::packaged_task<void()>> m_qJobs;
+    std::mutex m_jobsMutex;
+    std::condition_variable m_jobsCondition;
+    bool m_bIsStopping = false;
+};
+
+PipelineCompiler* GetPipelineCompiler();
+}  // namespace Muyo
@@ -0,0 +1,644 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "Debug.h"
+#include "RenderPass.h"
+#include "RenderResourceManager.h"
+#include "VkMemoryAllocator.h"
+#include "VkRenderDevice.h"
+
+namespace Muyo
+{
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(const std::string& sImage, RenderGraphAccess access, VkImageLayout entryLayout, VkImageLayout exitLayout)
+{
+    assert(!IsWriteAccess(access) && "Use Write() for write accesses");
+    m_graph.AddAccess(m_nPassIdx, sImage, access, entryLayout, exitLayout, false);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(const std::string& sImage, RenderGraphAccess access, VkImageLayout entryLayout, VkImageLayout exitLayout)
+{
+    assert(IsWriteAccess(access) && "Use Read() for read accesses");
+    m_graph.AddAccess(m_nPassIdx, sImage, access, entryLayout, exitLayout, true);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetSideEffect()
+{
+    m_graph.m_vPasses[m_nPassIdx].bHasSideEffect = true;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetQueue(RenderGraphQueue queue)
+{
+    m_graph.m_vPasses[m_nPassIdx].queue = queue;
+    return *this;
+}
+
+void RenderGraph::DeclareTransientImage(const std::string& sName, VkExtent2D extent, VkFormat format, uint32_t nMips, uint32_t nLayers)
+{
+    assert(!m_bIsCompiled);
+    // Images already owned by resource manager are imported
+    if (GetRenderResourceManager()->GetResource<ImageResource>(sName) != nullptr)
+    {
+        return;
+    }
+    ImageNode& image = m_vImages[GetImageIndex(sName)];
+    image.bIsTransient = true;
+    image.extent = extent;
+    image.format = format;
+    image.nMips = nMips;
+    image.nLayers = nLayers;
+}
+
+void RenderGraph::MarkOutput(const std::string& sName)
+{
+    m_vImages[GetImageIndex(sName)].bIsOutput = true;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const std::string& sName, const IRenderPass* pPass)
+{
+    assert(!m_bIsCompiled);
+    assert(pPass != nullptr && m_mPassIndices.find(pPass) == m_mPassIndices.end());
+    uint32_t nPassIdx = static_cast<uint32_t>(m_vPasses.size());
+    m_vPasses.emplace_back();
+    m_vPasses.back().sName = sName;
+    m_vPasses.back().pPass = pPass;
+    m_mPassIndices[pPass] = nPassIdx;
+    return PassBuilder(*this, nPassIdx);
+}
+
+void RenderGraph::Compile()
+{
+    assert(!m_bIsCompiled);
+    CullPasses();
+    ComputeLifetimes();
+    AllocateTransientImages();
+    m_bIsCompiled = true;
+}
+
+void RenderGraph::RecordBarriers()
+{
+    assert(m_bIsCompiled);
+
+    // State of an image between passes
+    struct ImageState
+    {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags visibleStages = 0;  // Stages the last write is already visible to
+        VkPipelineStageFlags readStages = 0;     // Stages reading the image since the last write
+        uint32_t nQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t nLastPass = UINT32_MAX;
+    };
+    std::vector<ImageState> vStates(m_vImages.size());
+
+    // Barriers before each pass, and queue ownership releases after it
+    std::vector<BarrierBatch> vBarriers;
+    std::vector<BarrierBatch> vReleases;
+
+    // Imported images keep their content across frames. The first walk finds the state the previous frame leaves
+    // them in, the second one starts from it so their first use waits for the previous frame's accesses.
+    for (uint32_t nWalk = 0; nWalk < 2; nWalk++)
+    {
+        for (uint32_t nImageIdx = 0; nImageIdx < m_vImages.size(); nImageIdx++)
+        {
+            if (m_vImages[nImageIdx].bIsTransient)
+            {
+                vStates[nImageIdx] = {};
+            }
+        }
+        vBarriers.assign(m_vPasses.size(), {});
+        vReleases.assign(m_vPasses.size(), {});
+
+        for (uint32_t nPassIdx = 0; nPassIdx < m_vPasses.size(); nPassIdx++)
+        {
+            const PassNode& pass = m_vPasses[nPassIdx];
+            if (pass.bIsCulled)
+            {
+                continue;
+            }
+
+            const uint32_t nQueueFamily = GetQueueFamilyIndex(pass.queue);
+            BarrierBatch& batch = vBarriers[nPassIdx];
+
+            for (const ImageAccess& access : pass.vAccesses)
+            {
+                const ImageNode& image = m_vImages[access.nImageIdx];
+                const AccessInfo info = GetAccessInfo(access.access, pass.queue);
+                ImageState& state = vStates[access.nImageIdx];
+
+                const ImageResource* pImage = GetRenderResourceManager()->GetResource<ImageResource>(image.sName);
+                assert(pImage != nullptr && "Image used in render graph doesn't exist");
+                VkImageMemoryBarrier imageBarrier = {};
+                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.image = pImage->getImage();
+                imageBarrier.subresourceRange = {GetAspectMask(pImage->GetImageFormat()), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+
+                // The memory was used by another transient image, wait for it to be done before overwriting it.
+                // Aliased images used on another queue are synchronized by the semaphores between the queues.
+                if (image.bIsTransient && image.nFirstPass == nPassIdx && image.nAliasedImageIdx != UINT32_MAX &&
+                    vStates[image.nAliasedImageIdx].nQueueFamily == nQueueFamily)
+                {
+                    const ImageState& aliasedState = vStates[image.nAliasedImageIdx];
+                    batch.srcStages |= aliasedState.writeStages | aliasedState.readStages;
+                    batch.memoryBarrier.srcAccessMask |= aliasedState.writeAccess;
+                    batch.dstStages |= info.stages;
+                    batch.memoryBarrier.dstAccessMask |= info.accessMask;
+                }
+
+                const bool bQueueFamilyChanged = state.nQueueFamily != VK_QUEUE_FAMILY_IGNORED && state.nQueueFamily != nQueueFamily;
+                if (bQueueFamilyChanged && access.bRead)
+                {
+                    // Ownership transfer: release on the queue of the last pass, acquire on this one. Both barriers
+                    // must describe the same layout transition.
+                    imageBarrier.oldLayout = state.layout;
+                    imageBarrier.newLayout = access.entryLayout != VK_IMAGE_LAYOUT_UNDEFINED ? access.entryLayout : state.layout;
+                    imageBarrier.srcQueueFamilyIndex = state.nQueueFamily;
+                    imageBarrier.dstQueueFamilyIndex = nQueueFamily;
+
+                    BarrierBatch& release = vReleases[state.nLastPass];
+                    imageBarrier.srcAccessMask = state.writeAccess;
+                    imageBarrier.dstAccessMask = 0;
+                    release.vImageBarriers.push_back(imageBarrier);
+                    release.srcStages |= state.writeStages | state.readStages;
+                    release.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+                    // Source stages of the acquire chain with the semaphore wait, which uses the stages of this pass
+                    imageBarrier.srcAccessMask = 0;
+                    imageBarrier.dstAccessMask = info.accessMask;
+                    batch.vImageBarriers.push_back(imageBarrier);
+                    batch.srcStages |= info.stages;
+                    batch.dstStages |= info.stages;
+
+                    state.writeStages = 0;
+                    state.writeAccess = 0;
+                    state.readStages = 0;
+                    state.visibleStages = info.stages;
+                }
+                else if (bQueueFamilyChanged)
+                {
+                    // Content is discarded, no ownership transfer needed
+                    state.writeStages = 0;
+                    state.writeAccess = 0;
+                    state.readStages = 0;
+                    state.visibleStages = 0;
+                    if (!IsAttachmentAccess(access.access))
+                    {
+                        imageBarrier.dstAccessMask = info.accessMask;
+                        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                        imageBarrier.newLayout = access.exitLayout;
+                        batch.vImageBarriers.push_back(imageBarrier);
+                        batch.dstStages |= info.stages;
+                    }
+                }
+                else if (!access.bRead && !IsAttachmentAccess(access.access))
+                {
+                    // Render passes transition their attachments, other discarding writes transition from undefined
+                    imageBarrier.srcAccessMask = state.writeAccess;
+                    imageBarrier.dstAccessMask = info.accessMask;
+                    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                    imageBarrier.newLayout = access.exitLayout;
+                    batch.vImageBarriers.push_back(imageBarrier);
+                    batch.srcStages |= state.writeStages | state.readStages;
+                    batch.dstStages |= info.stages;
+                }
+                else if (access.entryLayout != VK_IMAGE_LAYOUT_UNDEFINED && state.layout != VK_IMAGE_LAYOUT_UNDEFINED && state.layout != access.entryLayout)
+                {
+                    // Layout transition, also makes the last write visible
+                    imageBarrier.srcAccessMask = state.writeAccess;
+                    imageBarrier.dstAccessMask = info.accessMask;
+                    imageBarrier.oldLayout = state.layout;
+                    imageBarrier.newLayout = access.entryLayout;
+                    batch.vImageBarriers.push_back(imageBarrier);
+
+                    batch.srcStages |= state.writeStages | state.readStages;
+                    batch.dstStages |= info.stages;
+                    state.visibleStages |= info.stages;
+                }
+                else
+                {
+                    // Read after write or write after write
+                    if (state.writeStages != 0 && (info.stages & ~state.visibleStages) != 0)
+                    {
+                        batch.srcStages |= state.writeStages;
+                        batch.memoryBarrier.srcAccessMask |= state.writeAccess;
+                        batch.dstStages |= info.stages;
+                        batch.memoryBarrier.dstAccessMask |= info.accessMask;
+                        state.visibleStages |= info.stages;
+                    }
+                    // Write after read only needs an execution dependency
+                    if (access.bWrite && state.readStages != 0)
+                    {
+                        batch.srcStages |= state.readStages;
+                        batch.dstStages |= info.stages;
+                    }
+                }
+
+                if (access.bWrite)
+                {
+                    state.writeStages = info.stages;
+                    state.writeAccess = info.accessMask;
+                    state.visibleStages = 0;
+                    state.readStages = 0;
+                }
+                else
+                {
+                    state.readStages |= info.stages;
+                }
+                state.layout = access.exitLayout != VK_IMAGE_LAYOUT_UNDEFINED ? access.exitLayout : access.entryLayout;
+                state.nQueueFamily = nQueueFamily;
+                state.nLastPass = nPassIdx;
+            }
+        }
+    }
+
+    // Releases are only known once later passes are visited, record everything at the end
+    for (uint32_t nPassIdx = 0; nPassIdx < m_vPasses.size(); nPassIdx++)
+    {
+        PassNode& pass = m_vPasses[nPassIdx];
+        if (pass.bIsCulled)
+        {
+            continue;
+        }
+        pass.barrierCmdBuf = RecordBarrierBatch(vBarriers[nPassIdx], pass.queue, "Barriers: " + pass.sName);
+        pass.releaseCmdBuf = RecordBarrierBatch(vReleases[nPassIdx], pass.queue, "Release: " + pass.sName);
+    }
+}
+
+void RenderGraph::AppendCommandBuffers(const IRenderPass* pPass, std::vector<VkCommandBuffer>& vCmdBufs) const
+{
+    auto it = m_mPassIndices.find(pPass);
+    if (it == m_mPassIndices.end())
+    {
+        if (VkCommandBuffer cmdBuf = pPass->GetCommandBuffer())
+        {
+            vCmdBufs.push_back(cmdBuf);
+        }
+        return;
+    }
+
+    const PassNode& pass = m_vPasses[it->second];
+    if (pass.bIsCulled)
+    {
+        return;
+    }
+    if (pass.barrierCmdBuf != VK_NULL_HANDLE)
+    {
+        vCmdBufs.push_back(pass.barrierCmdBuf);
+    }
+    if (VkCommandBuffer cmdBuf = pPass->GetCommandBuffer())
+    {
+        vCmdBufs.push_back(cmdBuf);
+    }
+    if (pass.releaseCmdBuf != VK_NULL_HANDLE)
+    {
+        vCmdBufs.push_back(pass.releaseCmdBuf);
+    }
+}
+
+bool RenderGraph::IsCulled(const IRenderPass* pPass) const
+{
+    auto it = m_mPassIndices.find(pPass);
+    return it != m_mPassIndices.end() && m_vPasses[it->second].bIsCulled;
+}
+
+void RenderGraph::Reset()
+{
+    for (PassNode& pass : m_vPasses)
+    {
+        FreeCommandBuffer(pass.barrierCmdBuf, pass.queue);
+        FreeCommandBuffer(pass.releaseCmdBuf, pass.queue);
+    }
+    // Destroy images before the memory they are bound to
+    for (const ImageNode& image : m_vImages)
+    {
+        if (image.bIsTransient)
+        {
+            GetRenderResourceManager()->RemoveResource(image.sName);
+        }
+    }
+    for (MemoryBlock& block : m_vMemoryBlocks)
+    {
+        if (block.allocation != VK_NULL_HANDLE)
+        {
+            GetMemoryAllocator()->FreeMemory(block.allocation);
+        }
+    }
+    m_vPasses.clear();
+    m_vImages.clear();
+    m_vMemoryBlocks.clear();
+    m_mImageIndices.clear();
+    m_mPassIndices.clear();
+    m_bIsCompiled = false;
+}
+
+uint32_t RenderGraph::GetImageIndex(const std::string& sName)
+{
+    auto it = m_mImageIndices.find(sName);
+    if (it != m_mImageIndices.end())
+    {
+        return it->second;
+    }
+    uint32_t nImageIdx = static_cast<uint32_t>(m_vImages.size());
+    m_vImages.emplace_back();
+    m_vImages.back().sName = sName;
+    m_mImageIndices[sName] = nImageIdx;
+    return nImageIdx;
+}
+
+void RenderGraph::AddAccess(uint32_t nPassIdx, const std::string& sImage, RenderGraphAccess access, VkImageLayout entryLayout, VkImageLayout exitLayout, bool bWrite)
+{
+    assert(!m_bIsCompiled);
+    ImageAccess imageAccess;
+    imageAccess.nImageIdx = GetImageIndex(sImage);
+    imageAccess.access = access;
+    imageAccess.entryLayout = entryLayout;
+    imageAccess.exitLayout = exitLayout;
+    imageAccess.bWrite = bWrite;
+    // Writing without discarding loads previous content
+    imageAccess.bRead = !bWrite || entryLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+    m_vPasses[nPassIdx].vAccesses.push_back(imageAccess);
+}
+
+void RenderGraph::CullPasses()
+{
+    // Reference count of a pass is the number of images it writes, reference count of an image is the number
+    // of passes reading it. Images nobody reads release their writers, culled writers release what they read.
+    for (PassNode& pass : m_vPasses)
+    {
+        for (const ImageAccess& access : pass.vAccesses)
+        {
+            if (access.bWrite)
+            {
+                pass.nRefCount++;
+            }
+            if (access.bRead)
+            {
+                m_vImages[access.nImageIdx].nRefCount++;
+            }
+        }
+    }
+
+    std::vector<uint32_t> vUnreferencedImages;
+    for (uint32_t i = 0; i < m_vImages.size(); i++)
+    {
+        if (m_vImages[i].nRefCount == 0 && !m_vImages[i].bIsOutput)
+        {
+            vUnreferencedImages.push_back(i);
+        }
+    }
+
+    while (!vUnreferencedImages.empty())
+    {
+        uint32_t nImageIdx = vUnreferencedImages.back();
+        vUnreferencedImages.pop_back();
+
+        for (PassNode& pass : m_vPasses)
+        {
+            if (pass.bIsCulled || pass.bHasSideEffect)
+            {
+                continue;
+            }
+            bool bWritesImage = false;
+            for (const ImageAccess& access : pass.vAccesses)
+            {
+                if (access.bWrite && access.nImageIdx == nImageIdx)
+                {
+                    pass.nRefCount--;
+                    bWritesImage = true;
+                }
+            }
+            if (!bWritesImage || pass.nRefCount > 0)
+            {
+                continue;
+            }
+
+            pass.bIsCulled = true;
+            for (const ImageAccess& access : pass.vAccesses)
+            {
+                ImageNode& image = m_vImages[access.nImageIdx];
+                if (access.bRead && --image.nRefCount == 0 && !image.bIsOutput)
+                {
+                    vUnreferencedImages.push_back(access.nImageIdx);
+                }
+            }
+        }
+    }
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+    for (uint32_t nPassIdx = 0; nPassIdx < m_vPasses.size(); nPassIdx++)
+    {
+        if (m_vPasses[nPassIdx].bIsCulled)
+        {
+            continue;
+        }
+        for (const ImageAccess& access : m_vPasses[nPassIdx].vAccesses)
+        {
+            ImageNode& image = m_vImages[access.nImageIdx];
+            image.nFirstPass = std::min(image.nFirstPass, nPassIdx);
+            image.nLastPass = std::max(image.nLastPass, nPassIdx);
+        }
+    }
+}
+
+void RenderGraph::AllocateTransientImages()
+{
+    // Greedily assign transient images to memory blocks in order of first use. A block can be reused when
+    // the last image placed in it is no longer used and the memory types are compatible. Images only used by one
+    // pass are transient attachments, they get a block of their own preferring lazily allocated memory.
+    std::vector<uint32_t> vTransientImages;
+    for (uint32_t i = 0; i < m_vImages.size(); i++)
+    {
+        if (m_vImages[i].bIsTransient && m_vImages[i].nFirstPass != UINT32_MAX)
+        {
+            vTransientImages.push_back(i);
+        }
+    }
+    std::stable_sort(vTransientImages.begin(), vTransientImages.end(), [this](uint32_t a, uint32_t b)
+                     { return m_vImages[a].nFirstPass < m_vImages[b].nFirstPass; });
+
+    for (uint32_t nImageIdx : vTransientImages)
+    {
+        ImageNode& image = m_vImages[nImageIdx];
+        image.bIsMemoryless = image.nFirstPass == image.nLastPass;
+
+        VkImageCreateInfo imageInfo = RenderTarget::GetImageCreateInfo(
+            image.format, RenderResourceManager::GetRenderTargetUsage(image.format, image.bIsMemoryless ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0),
+            image.extent.width, image.extent.height, image.nMips, image.nLayers);
+        VkDeviceImageMemoryRequirements requirementsInfo = {};
+        requirementsInfo.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+        requirementsInfo.pCreateInfo = &imageInfo;
+        VkMemoryRequirements2 requirements = {};
+        requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        vkGetDeviceImageMemoryRequirements(GetRenderDevice()->GetDevice(), &requirementsInfo, &requirements);
+        const VkMemoryRequirements& imageRequirements = requirements.memoryRequirements;
+
+        for (uint32_t nBlockIdx = 0; nBlockIdx < m_vMemoryBlocks.size() && !image.bIsMemoryless; nBlockIdx++)
+        {
+            MemoryBlock& block = m_vMemoryBlocks[nBlockIdx];
+            if (!block.bIsLazilyAllocated && block.nLastPass < image.nFirstPass && (block.requirements.memoryTypeBits & imageRequirements.memoryTypeBits) != 0)
+            {
+                block.requirements.size = std::max(block.requirements.size, imageRequirements.size);
+                block.requirements.alignment = std::max(block.requirements.alignment, imageRequirements.alignment);
+                block.requirements.memoryTypeBits &= imageRequirements.memoryTypeBits;
+                image.nMemoryBlockIdx = nBlockIdx;
+                break;
+            }
+        }
+        if (image.nMemoryBlockIdx == UINT32_MAX)
+        {
+            image.nMemoryBlockIdx = static_cast<uint32_t>(m_vMemoryBlocks.size());
+            m_vMemoryBlocks.emplace_back();
+            m_vMemoryBlocks.back().requirements = imageRequirements;
+            m_vMemoryBlocks.back().bIsLazilyAllocated = image.bIsMemoryless;
+        }
+
+        MemoryBlock& block = m_vMemoryBlocks[image.nMemoryBlockIdx];
+        image.nAliasedImageIdx = block.nLastImageIdx;
+        block.nLastImageIdx = nImageIdx;
+        block.nLastPass = image.nLastPass;
+    }
+
+    for (MemoryBlock& block : m_vMemoryBlocks)
+    {
+        GetMemoryAllocator()->AllocateMemory(block.requirements, block.allocation, block.bIsLazilyAllocated);
+    }
+
+    for (uint32_t nImageIdx : vTransientImages)
+    {
+        const ImageNode& image = m_vImages[nImageIdx];
+        GetRenderResourceManager()->GetAliasedRenderTarget(
+            image.sName, image.extent, image.format,
+            m_vMemoryBlocks[image.nMemoryBlockIdx].allocation, 0,
+            image.nMips, image.nLayers, image.bIsMemoryless ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+    }
+}
+
+VkCommandBuffer RenderGraph::RecordBarrierBatch(const BarrierBatch& batch, RenderGraphQueue queue, const std::string& sMarker) const
+{
+    if (batch.dstStages == 0)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    VkCommandBuffer cmdBuf = queue == RENDER_GRAPH_QUEUE_ASYNC_COMPUTE ? GetRenderDevice()->AllocateComputeCommandBuffer() : GetRenderDevice()->AllocateStaticPrimaryCommandbuffer();
+    vkBeginCommandBuffer(cmdBuf, &beginInfo);
+    {
+        SCOPED_MARKER(cmdBuf, std::string(sMarker));
+        bool bHasMemoryBarrier = batch.memoryBarrier.srcAccessMask != 0 || batch.memoryBarrier.dstAccessMask != 0;
+        vkCmdPipelineBarrier(cmdBuf, batch.srcStages != 0 ? batch.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, batch.dstStages, 0,
+                             bHasMemoryBarrier ? 1 : 0, &batch.memoryBarrier,
+                             0, nullptr,
+                             static_cast<uint32_t>(batch.vImageBarriers.size()), batch.vImageBarriers.data());
+    }
+    vkEndCommandBuffer(cmdBuf);
+    return cmdBuf;
+}
+
+void RenderGraph::FreeCommandBuffer(VkCommandBuffer& cmdBuf, RenderGraphQueue queue)
+{
+    if (cmdBuf == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    if (queue == RENDER_GRAPH_QUEUE_ASYNC_COMPUTE)
+    {
+        GetRenderDevice()->FreeComputeCommandBuffer(cmdBuf);
+    }
+    else
+    {
+        GetRenderDevice()->FreeStaticPrimaryCommandbuffer(cmdBuf);
+    }
+    cmdBuf = VK_NULL_HANDLE;
+}
+
+uint32_t RenderGraph::GetQueueFamilyIndex(RenderGraphQueue queue)
+{
+    return queue == RENDER_GRAPH_QUEUE_ASYNC_COMPUTE ? GetRenderDevice()->GetComputeQueueFamilyIndex() : GetRenderDevice()->GetGraphicsQueueFamilyIndex();
+}
+
+RenderGraph::AccessInfo RenderGraph::GetAccessInfo(RenderGraphAccess access, RenderGraphQueue queue)
+{
+    AccessInfo info = GetAccessInfo(access);
+    // A dedicated compute queue doesn't support graphics stages
+    if (GetQueueFamilyIndex(queue) != GetRenderDevice()->GetGraphicsQueueFamilyIndex())
+    {
+        info.stages &= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        assert(info.stages != 0 && "Access not supported on compute queue");
+    }
+    return info;
+}
+
+RenderGraph::AccessInfo RenderGraph::GetAccessInfo(RenderGraphAccess access)
+{
+    switch (access)
+    {
+        case RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT:
+            return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+        case RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT:
+            return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+        case RENDER_GRAPH_ACCESS_DEPTH_READ:
+            return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT};
+        case RENDER_GRAPH_ACCESS_SAMPLED:
+            return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT};
+        case RENDER_GRAPH_ACCESS_STORAGE_READ:
+            return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT};
+        case RENDER_GRAPH_ACCESS_STORAGE_WRITE:
+            return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+        case RENDER_GRAPH_ACCESS_TRANSFER_SRC:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+        case RENDER_GRAPH_ACCESS_TRANSFER_DST:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+        default:
+            assert(false && "Unknown render graph access");
+            return {0, 0};
+    }
+}
+
+bool RenderGraph::IsAttachmentAccess(RenderGraphAccess access)
+{
+    return access == RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT ||
+           access == RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT ||
+           access == RENDER_GRAPH_ACCESS_DEPTH_READ;
+}
+
+bool RenderGraph::IsWriteAccess(RenderGraphAccess access)
+{
+    return access == RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT ||
+           access == RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT ||
+           access == RENDER_GRAPH_ACCESS_STORAGE_WRITE ||
+           access == RENDER_GRAPH_ACCESS_TRANSFER_DST;
+}
+
+VkImageAspectFlags RenderGraph::GetAspectMask(VkFormat format)
+{
+    switch (format)
+    {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+}  // namespace Muyo
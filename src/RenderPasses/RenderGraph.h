@@ -0,0 +1,194 @@
+#pragma once
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Muyo
+{
+class IRenderPass;
+
+// How a pass accesses an image
+enum RenderGraphAccess
+{
+    RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT,  // Color attachment write
+    RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT,  // Depth test and write
+    RENDER_GRAPH_ACCESS_DEPTH_READ,        // Depth test without write
+    RENDER_GRAPH_ACCESS_SAMPLED,           // Sampled in fragment or compute shader
+    RENDER_GRAPH_ACCESS_STORAGE_READ,
+    RENDER_GRAPH_ACCESS_STORAGE_WRITE,
+    RENDER_GRAPH_ACCESS_TRANSFER_SRC,
+    RENDER_GRAPH_ACCESS_TRANSFER_DST,
+    RENDER_GRAPH_ACCESS_COUNT
+};
+
+// Queue a pass is submitted to
+enum RenderGraphQueue
+{
+    RENDER_GRAPH_QUEUE_GRAPHICS,
+    RENDER_GRAPH_QUEUE_ASYNC_COMPUTE,  // Compute queue, same as graphics queue if device has no async compute
+};
+
+/*
+ * Frame graph of the render passes.
+ * Setup: declare transient images, then add passes in submission order and describe the images they read and
+ * write. Images not declared as transient are imported, they are owned by the resource manager and their
+ * content outlives the frame.
+ * Compile: culls passes whose outputs are never consumed, then creates the transient images. Transient images
+ * whose lifetimes don't overlap share the same memory. Transient images only used within a single pass never
+ * leave its render pass, they are created as transient attachments on lazily allocated memory when available.
+ * After the passes have recorded their command buffers, RecordBarriers records the barriers needed before each
+ * pass into a single command buffer per pass, AppendCommandBuffers is then used to submit them.
+ * Images handed over between queue families get ownership transfers, a release after the last pass on the
+ * previous queue and an acquire before the pass. The submitter must synchronize the queues with semaphores, the
+ * acquire waits on the stages of its own accesses.
+ */
+class RenderGraph
+{
+public:
+    class PassBuilder
+    {
+    public:
+        PassBuilder(RenderGraph& graph, uint32_t nPassIdx) : m_graph(graph), m_nPassIdx(nPassIdx) {}
+
+        // Layouts are the layouts the image is expected in when the pass begins and left in when it ends, usually
+        // the initial and final layouts of the attachment. A write whose entry layout is defined loads the
+        // previous content, so it's also treated as a read.
+        PassBuilder& Read(const std::string& sImage, RenderGraphAccess access, VkImageLayout entryLayout, VkImageLayout exitLayout);
+        PassBuilder& Read(const std::string& sImage, RenderGraphAccess access, VkImageLayout layout) { return Read(sImage, access, layout, layout); }
+        PassBuilder& Write(const std::string& sImage, RenderGraphAccess access, VkImageLayout entryLayout, VkImageLayout exitLayout);
+
+        // Pass has effects outside the graph (e.g. presents), it is never culled
+        PassBuilder& SetSideEffect();
+
+        PassBuilder& SetQueue(RenderGraphQueue queue);
+
+    private:
+        RenderGraph& m_graph;
+        uint32_t m_nPassIdx = 0;
+    };
+
+    ~RenderGraph() { Reset(); }
+
+    // Image created and owned by the graph, only valid within the frame
+    void DeclareTransientImage(const std::string& sName, VkExtent2D extent, VkFormat format, uint32_t nMips = 1, uint32_t nLayers = 1);
+
+    // Imported image whose content is consumed outside the graph
+    void MarkOutput(const std::string& sName);
+
+    PassBuilder AddPass(const std::string& sName, const IRenderPass* pPass);
+
+    void Compile();
+
+    // Must be called after the passes have been prepared. Imported images start each frame in the state the
+    // previous frame left them in, they must be in the layout of their last access before the first frame.
+    void RecordBarriers();
+
+    // Append barriers, command buffer and queue ownership releases of a pass. Culled passes append nothing,
+    // passes not in graph only append their own command buffer.
+    void AppendCommandBuffers(const IRenderPass* pPass, std::vector<VkCommandBuffer>& vCmdBufs) const;
+
+    bool IsCulled(const IRenderPass* pPass) const;
+
+    // Destroy transient images and clear the graph
+    void Reset();
+
+private:
+    struct ImageAccess
+    {
+        uint32_t nImageIdx = 0;
+        RenderGraphAccess access = RENDER_GRAPH_ACCESS_COUNT;
+        VkImageLayout entryLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout exitLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        bool bRead = false;
+        bool bWrite = false;
+    };
+
+    struct PassNode
+    {
+        std::string sName;
+        const IRenderPass* pPass = nullptr;
+        std::vector<ImageAccess> vAccesses;
+        RenderGraphQueue queue = RENDER_GRAPH_QUEUE_GRAPHICS;
+        bool bHasSideEffect = false;
+        bool bIsCulled = false;
+        uint32_t nRefCount = 0;
+        VkCommandBuffer barrierCmdBuf = VK_NULL_HANDLE;
+        VkCommandBuffer releaseCmdBuf = VK_NULL_HANDLE;  // Queue ownership releases after the pass
+    };
+
+    // Barriers batched into a single vkCmdPipelineBarrier
+    struct BarrierBatch
+    {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkMemoryBarrier memoryBarrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, 0, 0};
+        std::vector<VkImageMemoryBarrier> vImageBarriers;
+    };
+
+    struct ImageNode
+    {
+        std::string sName;
+        bool bIsTransient = false;
+        bool bIsOutput = false;
+        uint32_t nRefCount = 0;
+
+        // Transient image description
+        VkExtent2D extent = {0, 0};
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t nMips = 1;
+        uint32_t nLayers = 1;
+
+        // Lifetime in pass indices, only valid for transient images used by a remaining pass
+        uint32_t nFirstPass = UINT32_MAX;
+        uint32_t nLastPass = 0;
+
+        // Memory block the transient image is bound to, and the image previously bound to the same block
+        uint32_t nMemoryBlockIdx = UINT32_MAX;
+        uint32_t nAliasedImageIdx = UINT32_MAX;
+
+        // Transient image whose content never leaves the pass using it
+        bool bIsMemoryless = false;
+    };
+
+    struct MemoryBlock
+    {
+        VkMemoryRequirements requirements = {};
+        uint32_t nLastPass = 0;
+        uint32_t nLastImageIdx = UINT32_MAX;
+        bool bIsLazilyAllocated = false;  // Not shared, lazily allocated memory is only backed while it's used
+        VmaAllocation allocation = VK_NULL_HANDLE;
+    };
+
+    struct AccessInfo
+    {
+        VkPipelineStageFlags stages;
+        VkAccessFlags accessMask;
+    };
+
+    uint32_t GetImageIndex(const std::string& sName);
+    void AddAccess(uint32_t nPassIdx, const std::string& sImage, RenderGraphAccess access, VkImageLayout entryLayout, VkImageLayout exitLayout, bool bWrite);
+    void CullPasses();
+    void ComputeLifetimes();
+    void AllocateTransientImages();
+
+    VkCommandBuffer RecordBarrierBatch(const BarrierBatch& batch, RenderGraphQueue queue, const std::string& sMarker) const;
+    static void FreeCommandBuffer(VkCommandBuffer& cmdBuf, RenderGraphQueue queue);
+    static uint32_t GetQueueFamilyIndex(RenderGraphQueue queue);
+    static AccessInfo GetAccessInfo(RenderGraphAccess access, RenderGraphQueue queue);
+    static AccessInfo GetAccessInfo(RenderGraphAccess access);
+    static bool IsAttachmentAccess(RenderGraphAccess access);
+    static bool IsWriteAccess(RenderGraphAccess access);
+    static VkImageAspectFlags GetAspectMask(VkFormat format);
+
+    std::vector<PassNode> m_vPasses;
+    std::vector<ImageNode> m_vImages;
+    std::vector<MemoryBlock> m_vMemoryBlocks;
+    std::unordered_map<std::string, uint32_t> m_mImageIndices;
+    std::unordered_map<const IRenderPass*, uint32_t> m_mPassIndices;
+    bool m_bIsCompiled = false;
+};
+}  // namespace Muyo
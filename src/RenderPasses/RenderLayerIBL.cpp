@@ -173,10 +173,8 @@ void RenderLayerIBL::CreatePipeline()
         std::vector<VkDynamicState> dynamicStateEnables = {
             VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
-        VkShaderModule vertShdr = CreateShaderModule(
-            ReadSpv("shaders/equirectangularToCubeMap.vert.spv"));
-        VkShaderModule fragShdr = CreateShaderModule(
-            ReadSpv("shaders/equirectangularToCubeMap.frag.spv"));
+        VkShaderModule vertShdr = GetShaderLibrary()->AcquireShaderModule("shaders/equirectangularToCubeMap.vert.spv");
+        VkShaderModule fragShdr = GetShaderLibrary()->AcquireShaderModule("shaders/equirectangularToCubeMap.frag.spv");
         PipelineStateBuilder builder;
 
         m_envCubeMapPipeline =
@@ -194,10 +192,8 @@ void RenderLayerIBL::CreatePipeline()
                 .setRenderPass(m_vRenderPasses[RENDERPASS_LOAD_ENV_MAP])
                 .Build(GetRenderDevice()->GetDevice());
 
-        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertShdr,
-                              nullptr);
-        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShdr,
-                              nullptr);
+        GetShaderLibrary()->ReleaseShaderModule(vertShdr);
+        GetShaderLibrary()->ReleaseShaderModule(fragShdr);
 
         // Set debug name for the pipeline
         setDebugUtilsObjectName(
@@ -248,10 +244,8 @@ void RenderLayerIBL::CreatePipeline()
         std::vector<VkDynamicState> dynamicStateEnables = {
             VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
-        VkShaderModule vertShdr = CreateShaderModule(
-            ReadSpv("shaders/CubeMapToIrradianceMap.vert.spv"));
-        VkShaderModule fragShdr = CreateShaderModule(
-            ReadSpv("shaders/CubeMapToIrradianceMap.frag.spv"));
+        VkShaderModule vertShdr = GetShaderLibrary()->AcquireShaderModule("shaders/CubeMapToIrradianceMap.vert.spv");
+        VkShaderModule fragShdr = GetShaderLibrary()->AcquireShaderModule("shaders/CubeMapToIrradianceMap.frag.spv");
         PipelineStateBuilder builder;
 
         m_irrCubeMapPipeline =
@@ -269,10 +263,8 @@ void RenderLayerIBL::CreatePipeline()
                 .setRenderPass(m_vRenderPasses[RENDERPASS_COMPUTE_IRR_CUBEMAP])
                 .Build(GetRenderDevice()->GetDevice());
 
-        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertShdr,
-                              nullptr);
-        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShdr,
-                              nullptr);
+        GetShaderLibrary()->ReleaseShaderModule(vertShdr);
+        GetShaderLibrary()->ReleaseShaderModule(fragShdr);
 
         // Set debug name for the pipeline
         setDebugUtilsObjectName(
@@ -324,10 +316,8 @@ void RenderLayerIBL::CreatePipeline()
         std::vector<VkDynamicState> dynamicStateEnables = {
             VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
-        VkShaderModule vertShdr = CreateShaderModule(
-            ReadSpv("shaders/CubeMapToIrradianceMap.vert.spv"));
-        VkShaderModule fragShdr = CreateShaderModule(
-            ReadSpv("shaders/GeneratePrefilteredCubemap.frag.spv"));
+        VkShaderModule vertShdr = GetShaderLibrary()->AcquireShaderModule("shaders/CubeMapToIrradianceMap.vert.spv");
+        VkShaderModule fragShdr = GetShaderLibrary()->AcquireShaderModule("shaders/GeneratePrefilteredCubemap.frag.spv");
 
         PipelineStateBuilder builder;
         m_prefilteredCubemapPipeline =
@@ -345,10 +335,8 @@ void RenderLayerIBL::CreatePipeline()
                 .setRenderPass(m_vRenderPasses[RENDERPASS_COMPUTE_IRR_CUBEMAP])
                 .Build(GetRenderDevice()->GetDevice());
 
-        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertShdr,
-                              nullptr);
-        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShdr,
-                              nullptr);
+        GetShaderLibrary()->ReleaseShaderModule(vertShdr);
+        GetShaderLibrary()->ReleaseShaderModule(fragShdr);
 
         // Set debug name for the pipeline
         setDebugUtilsObjectName(
@@ -389,10 +377,8 @@ void RenderLayerIBL::CreatePipeline()
         m_specularBrdfLutPipelineLayout =
             GetRenderDevice()->CreatePipelineLayout(descLayouts, pushConstants);
 
-        VkShaderModule vertShdr = CreateShaderModule(
-            ReadSpv("shaders/lighting.vert.spv"));
-        VkShaderModule fragShdr = CreateShaderModule(
-            ReadSpv("shaders/GenerateSpecularBrdfLut.frag.spv"));
+        VkShaderModule vertShdr = GetShaderLibrary()->AcquireShaderModule("shaders/lighting.vert.spv");
+        VkShaderModule fragShdr = GetShaderLibrary()->AcquireShaderModule("shaders/GenerateSpecularBrdfLut.frag.spv");
         PipelineStateBuilder builder;
 
         m_specularBrdfLutPipeline =
@@ -409,10 +395,8 @@ void RenderLayerIBL::CreatePipeline()
                 .setRenderPass(m_vRenderPasses[RENDERPASS_COMPUTE_SPECULAR_BRDF_LUT])
                 .Build(GetRenderDevice()->GetDevice());
 
-        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertShdr,
-                              nullptr);
-        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShdr,
-                              nullptr);
+        GetShaderLibrary()->ReleaseShaderModule(vertShdr);
+        GetShaderLibrary()->ReleaseShaderModule(fragShdr);
 
         // Set debug name for the pipeline
         setDebugUtilsObjectName(
@@ -4,6 +4,7 @@
 #include "DescriptorManager.h"
 #include "Geometry.h"
 #include "MeshResourceManager.h"
+#include "PipelineCompiler.h"
 #include "PipelineStateBuilder.h"
 #include "RenderResourceManager.h"
 #include "RenderResourceNames.h"
@@ -14,6 +15,89 @@
 namespace Muyo
 {
 
+void RenderPass::CreatePipelineAsync()
+{
+    WaitForPipelines();
+    m_pipelinesCreated = GetPipelineCompiler()->AddJob([this]()
+                                                      { CreatePipeline(); });
+}
+
+void RenderPass::WaitForPipelines()
+{
+    if (m_pipelinesCreated.valid())
+    {
+        m_pipelinesCreated.get();
+    }
+}
+
+VkCommandBuffer RenderPass::BeginSecondaryCommandBuffer(uint32_t nThreadIdx, const RenderPassParameters& renderPassParameters, uint32_t nSubpass) const
+{
+    VkCommandBuffer cmdBuf = GetRenderDevice()->AllocateSecondaryCommandBuffer(nThreadIdx);
+    RestartSecondaryCommandBuffer(cmdBuf, renderPassParameters, nSubpass);
+    return cmdBuf;
+}
+
+void RenderPass::RestartSecondaryCommandBuffer(VkCommandBuffer cmdBuf, const RenderPassParameters& renderPassParameters, uint32_t nSubpass) const
+{
+    // Thread pools allow resetting single command buffers, begin resets it implicitly
+    assert(cmdBuf != VK_NULL_HANDLE);
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPassParameters.GetRenderPass();
+    inheritanceInfo.subpass = nSubpass;
+    inheritanceInfo.framebuffer = renderPassParameters.GetFramebuffer();
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    VK_ASSERT(vkBeginCommandBuffer(cmdBuf, &beginInfo));
+}
+
+VkCommandBuffer RenderPass::RecordPrimaryFromSecondary(VkCommandBuffer secondaryCmdBuf, const std::vector<VkClearValue>& vClearValues, const std::string& sMarker) const
+{
+    return RecordPrimaryFromSecondary(std::vector<VkCommandBuffer>{secondaryCmdBuf}, vClearValues, sMarker);
+}
+
+VkCommandBuffer RenderPass::RecordPrimaryFromSecondary(const std::vector<VkCommandBuffer>& vSubpassCmdBufs, const std::vector<VkClearValue>& vClearValues, const std::string& sMarker) const
+{
+    assert(vSubpassCmdBufs.size() == m_renderPassParameters.GetSubpassCount());
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    VkCommandBuffer cmdBuf = GetRenderDevice()->AllocateStaticPrimaryCommandbuffer();
+    vkBeginCommandBuffer(cmdBuf, &beginInfo);
+    {
+        SCOPED_MARKER(cmdBuf, std::string(sMarker));
+        RenderPassBeginInfoBuilder builder;
+        VkRenderPassBeginInfo renderPassBeginInfo =
+            builder.setRenderPass(m_renderPassParameters.GetRenderPass())
+                .setFramebuffer(m_renderPassParameters.GetFramebuffer())
+                .setRenderArea(m_renderPassParameters.GetRenderArea())
+                .setClearValues(vClearValues)
+                .Build();
+
+        vkCmdBeginRenderPass(cmdBuf, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        for (size_t i = 0; i < vSubpassCmdBufs.size(); i++)
+        {
+            if (i > 0)
+            {
+                vkCmdNextSubpass(cmdBuf, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            }
+            if (vSubpassCmdBufs[i] != VK_NULL_HANDLE)
+            {
+                vkCmdExecuteCommands(cmdBuf, 1, &vSubpassCmdBufs[i]);
+            }
+        }
+        vkCmdEndRenderPass(cmdBuf);
+    }
+    vkEndCommandBuffer(cmdBuf);
+    return cmdBuf;
+}
+
 RenderPassFinal::RenderPassFinal(const Swapchain& swapchain, bool bClearAttachments)
 {
     m_renderArea                                          = swapchain.GetSwapchainExtent();
@@ -58,7 +142,7 @@ RenderPassFinal::RenderPassFinal(const Swapchain& swapchain, bool bClearAttachme
         // Descriptor set 2
         // Add perview
         m_vRenderPassParameters[i].AddParameter(
-          GetRenderResourceManager()->GetUniformBuffer<PerViewData>("perView"),
+          GetRenderResourceManager()->GetPerFrameUniformBuffer<PerViewData>("perView"),
           VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
           VK_SHADER_STAGE_FRAGMENT_BIT);
 #endif
@@ -70,11 +154,11 @@ RenderPassFinal::RenderPassFinal(const Swapchain& swapchain, bool bClearAttachme
         // Create pipelines
         VkPipelineLayout pipelineLayout = m_vRenderPassParameters[i].GetPipelineLayout();
 #ifdef FEATURE_RAY_TRACING
-        VkShaderModule fragShdr = CreateShaderModule(ReadSpv("shaders/triangle_rt.frag.spv"));
+        VkShaderModule fragShdr = GetShaderLibrary()->AcquireShaderModule("shaders/triangle_rt.frag.spv");
 #else
-        VkShaderModule vertexShader = CreateShaderModule(ReadSpv("shaders/triangle.vert.spv"));
+        VkShaderModule vertexShader = GetShaderLibrary()->AcquireShaderModule("shaders/triangle.vert.spv");
 #endif    // FEATURE_RAY_TRACING
-        VkShaderModule fragShader = CreateShaderModule(ReadSpv("shaders/triangle.frag.spv"));
+        VkShaderModule fragShader = GetShaderLibrary()->AcquireShaderModule("shaders/triangle.frag.spv");
 
         ViewportBuilder vpBuilder;
         VkViewport viewport = vpBuilder.setWH(swapchain.GetSwapchainExtent()).Build();
@@ -104,8 +188,8 @@ RenderPassFinal::RenderPassFinal(const Swapchain& swapchain, bool bClearAttachme
             .setRenderPass(m_vRenderPassParameters[i].GetRenderPass())
             .Build(GetRenderDevice()->GetDevice()));
 
-        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertexShader, nullptr);
-        vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShader, nullptr);
+        GetShaderLibrary()->ReleaseShaderModule(vertexShader);
+        GetShaderLibrary()->ReleaseShaderModule(fragShader);
 
         // Set debug name for the pipeline
         setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_vPipelines.back()), VK_OBJECT_TYPE_PIPELINE, "Final pass " + std::to_string(i));
@@ -3,6 +3,8 @@
 #include <vulkan/vulkan.h>
 
 #include <cassert>
+#include <future>
+#include <string>
 #include <vector>
 
 #include "RenderPassParameters.h"
@@ -26,9 +28,33 @@ class RenderPass : public IRenderPass
 public:
     virtual void PrepareRenderPass() override{};
 
+    // Block until the pipelines of CreatePipelineAsync() exist, call before recording commands binding them
+    void WaitForPipelines();
+
 protected:
+    // Run CreatePipeline() on a pipeline compiler thread. Render pass parameters must be finalized, the pass must
+    // not be modified until WaitForPipelines().
+    void CreatePipelineAsync();
+
+    // Begin a secondary command buffer continuing the render pass of m_renderPassParameters.
+    // It is allocated from the pool of nThreadIdx so it can be recorded on that thread.
+    VkCommandBuffer BeginSecondaryCommandBuffer(uint32_t nThreadIdx) const { return BeginSecondaryCommandBuffer(nThreadIdx, m_renderPassParameters); }
+    // Same as above for passes owning more than one render pass, or recording a later subpass of another pass
+    VkCommandBuffer BeginSecondaryCommandBuffer(uint32_t nThreadIdx, const RenderPassParameters& renderPassParameters, uint32_t nSubpass = 0) const;
+    // Begin a secondary command buffer of an earlier recording again, its commands are reset. It must not be pending
+    // and primary command buffers executing it must be recorded again.
+    void RestartSecondaryCommandBuffer(VkCommandBuffer cmdBuf, const RenderPassParameters& renderPassParameters, uint32_t nSubpass = 0) const;
+
+    // Record a static primary command buffer which begins the render pass and executes the secondary command buffer
+    VkCommandBuffer RecordPrimaryFromSecondary(VkCommandBuffer secondaryCmdBuf, const std::vector<VkClearValue>& vClearValues, const std::string& sMarker) const;
+    // Same as above with a secondary command buffer for each subpass, null ones leave their subpass empty
+    VkCommandBuffer RecordPrimaryFromSecondary(const std::vector<VkCommandBuffer>& vSubpassCmdBufs, const std::vector<VkClearValue>& vClearValues, const std::string& sMarker) const;
+
     VkPipeline m_pipeline = VK_NULL_HANDLE;
     RenderPassParameters m_renderPassParameters;
+
+private:
+    std::future<void> m_pipelinesCreated;
 };
 
 // The pass render to swap chain
@@ -19,6 +19,8 @@ RenderPassCubeMapGeneration::~RenderPassCubeMapGeneration()
 
 void RenderPassCubeMapGeneration::PrepareRenderPass()
 {
+    m_renderPassParameters.Reset();
+
     m_renderPassParameters.SetRenderArea(m_sizePerFace);
 
     m_renderPassParameters.AddAttachment(GetRenderResourceManager()->GetColorTarget("env_cube_map", m_sizePerFace, TEX_FORMAT, 1, 6), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true);
@@ -34,7 +36,7 @@ void RenderPassCubeMapGeneration::PrepareRenderPass()
 
     m_renderPassParameters.Finalize("Cube map generation");
 
-    CreatePipeline();
+    CreatePipelineAsync();
 }
 
 void RenderPassCubeMapGeneration::CreatePipeline()
@@ -42,8 +44,8 @@ void RenderPassCubeMapGeneration::CreatePipeline()
 
     VkPipelineLayout pipelineLayout = m_renderPassParameters.GetPipelineLayout();
 
-    VkShaderModule vertexShader = CreateShaderModule(ReadSpv("shaders/equirectangularToCubeMap.vert.spv"));
-    VkShaderModule fragShader = CreateShaderModule(ReadSpv("shaders/equirectangularToCubeMap.frag.spv"));
+    VkShaderModule vertexShader = GetShaderLibrary()->AcquireShaderModule("shaders/equirectangularToCubeMap.vert.spv");
+    VkShaderModule fragShader = GetShaderLibrary()->AcquireShaderModule("shaders/equirectangularToCubeMap.frag.spv");
 
     ViewportBuilder vpBuilder;
     VkViewport viewport = vpBuilder.setWH(m_sizePerFace).Build();
@@ -74,8 +76,8 @@ void RenderPassCubeMapGeneration::CreatePipeline()
         .setRenderPass(m_renderPassParameters.GetRenderPass())
         .Build(GetRenderDevice()->GetDevice());
 
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertexShader, nullptr);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShader, nullptr);
+    GetShaderLibrary()->ReleaseShaderModule(vertexShader);
+    GetShaderLibrary()->ReleaseShaderModule(fragShader);
 
     // Set debug name for the pipeline
     setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline), VK_OBJECT_TYPE_PIPELINE, "Cubemap Generation");
@@ -83,6 +85,8 @@ void RenderPassCubeMapGeneration::CreatePipeline()
 
 void RenderPassCubeMapGeneration::RecordCommandBuffers()
 {
+    WaitForPipelines();
+
     // Get skybox vertex data
     const Mesh& skyboxMesh = GetMeshResourceManager()->GetCube();
     const MeshVertexResources& meshVertexResources = GetMeshResourceManager()->GetMeshVertexResources();
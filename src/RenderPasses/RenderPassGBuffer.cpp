@@ -1,23 +1,23 @@
 #include "RenderPassGBuffer.h"
 #include "RenderResourceManager.h"
 #include "PerObjResourceManager.h"
-#include "Material.h"
+#include "DescriptorManager.h"
 #include "SamplerManager.h"
 #include "PipelineStateBuilder.h"
 #include "MeshVertex.h"
 #include "MeshResourceManager.h"
 #include "Scene.h"
 #include "Camera.h"
+#include "RenderResourceNames.h"
 
 namespace Muyo
 {
 
+// Compact layout, see shaders/gbuffer.h. Position is reconstructed from depth.
 const RenderPassGBuffer::GBufferAttachment RenderPassGBuffer::attachments[] =
     {
-        {"GBufferPositionAO_", VK_FORMAT_R16G16B16A16_SFLOAT, {.color = {0.0f, 0.0f, 0.0f, 0.0f}}},
-        {"GBufferAlbedoTransmittance_", VK_FORMAT_R16G16B16A16_SFLOAT, {.color = {0.0f, 0.0f, 0.0f, 0.0f}}},
-        {"GBufferNormalRoughness_", VK_FORMAT_R16G16B16A16_SFLOAT, {.color = {0.0f, 0.0f, 0.0f, 0.0f}}},
-        {"GbufferMetalnessTranslucency_", VK_FORMAT_R16G16B16A16_SFLOAT, {.color = {0.0f, 0.0f, 0.0f, 0.0f}}},
+        {"GBufferAlbedoAO_", VK_FORMAT_R8G8B8A8_SRGB, {.color = {0.0f, 0.0f, 0.0f, 0.0f}}},
+        {"GBufferNormalRoughnessMetalness_", VK_FORMAT_R16G16B16A16_SFLOAT, {.color = {0.0f, 0.0f, 0.0f, 0.0f}}},
         {"GBufferDepth_", VK_FORMAT_D32_SFLOAT, {.depthStencil = {1.0f, 0}}}};
 
 RenderPassGBuffer::~RenderPassGBuffer()
@@ -26,6 +26,8 @@ RenderPassGBuffer::~RenderPassGBuffer()
 }
 void RenderPassGBuffer::PrepareRenderPass()
 {
+    m_renderPassParameters.Reset();
+
     m_renderPassParameters.SetRenderArea(m_renderArea);
 
     // Output attachments
@@ -40,36 +42,37 @@ void RenderPassGBuffer::PrepareRenderPass()
                                              true);
     }
 
+    // Lighting reads all attachments at its pixel and writes the opaque lighting output
+    if (m_bLightingSubpass)
+    {
+        m_renderPassParameters.NextSubpass();
+        for (int i = 0; i < ATTACHMENT_COUNT; i++)
+        {
+            m_renderPassParameters.AddSubpassInput(GetRenderResourceManager()->GetResource<ImageResource>(attachments[i].sName));
+        }
+        const RenderTarget* pLightingOutput = GetRenderResourceManager()->GetRenderTarget(OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME, m_renderArea, VK_FORMAT_R16G16B16A16_SFLOAT);
+        m_renderPassParameters.AddAttachment(pLightingOutput, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+    }
+
     // Input resources
-    const UniformBuffer<PerViewData>* perView = GetRenderResourceManager()->GetUniformBuffer<PerViewData>("perView");
+    const UniformBuffer<PerViewData>* perView = GetRenderResourceManager()->GetPerFrameUniformBuffer<PerViewData>("perView");
     m_renderPassParameters.AddParameter(perView, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
 
     // Set 1, Binding 0: PerObjData
     m_renderPassParameters.AddParameter(GetPerObjResourceManager()->GetPerObjResource(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1);
 
-    // Set 2, Binding 0: All texture
-    const auto& vpUniquePtrTextures = GetTextureResourceManager()->GetTextures();
-    std::vector<const ImageResource*> vpTextures;
-    vpTextures.reserve(vpUniquePtrTextures.size());
-    for (const auto& pTexture : vpUniquePtrTextures)
-    {
-        vpTextures.push_back(pTexture.get());
-    }
-    m_renderPassParameters.AddImageParameter(vpTextures, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 2);
-
-    // Set 2, Binding 1: All materials
-    const auto* materialBuffer = GetMaterialManager()->GetMaterialBuffer();
-    m_renderPassParameters.AddParameter(materialBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 2);
+    // Set 2: Bindless samplers, materials and textures
+    m_renderPassParameters.AddExternalDescriptorSet(GetDescriptorManager()->getDescriptorLayout(DESCRIPTOR_LAYOUT_BINDLESS), GetDescriptorManager()->GetBindlessDescriptorSet(), 2);
 
     m_renderPassParameters.Finalize("Render pass gbuffer");
-    CreatePipeline();
+    CreatePipelineAsync();
 }
 
 void RenderPassGBuffer::CreatePipeline()
 {
     VkPipelineLayout pipelineLayout = m_renderPassParameters.GetPipelineLayout();
-    VkShaderModule vertexShader = CreateShaderModule(ReadSpv("shaders/GBuffer.vert.spv"));
-    VkShaderModule fragShader = CreateShaderModule(ReadSpv("shaders/GBuffer.frag.spv"));
+    VkShaderModule vertexShader = GetShaderLibrary()->AcquireShaderModule("shaders/GBuffer.vert.spv");
+    VkShaderModule fragShader = GetShaderLibrary()->AcquireShaderModule("shaders/GBuffer.frag.spv");
 
     ViewportBuilder vpBuilder;
     VkViewport viewport = vpBuilder.setWH(m_renderArea).Build();
@@ -99,14 +102,25 @@ void RenderPassGBuffer::CreatePipeline()
             .setRenderPass(m_renderPassParameters.GetRenderPass())
             .Build(GetRenderDevice()->GetDevice());
 
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertexShader, nullptr);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShader, nullptr);
+    GetShaderLibrary()->ReleaseShaderModule(vertexShader);
+    GetShaderLibrary()->ReleaseShaderModule(fragShader);
 
     // Set debug name for the pipeline
     setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline), VK_OBJECT_TYPE_PIPELINE, "Gbuffer pass");
 }
 
 void RenderPassGBuffer::RecordCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes)
+{
+    WaitForPipelines();
+
+    if (PrepareCommandBuffers(vpGeometryNodes))
+    {
+        RecordSecondaryCommandBuffer(0);
+        RecordPrimaryCommandBuffer();
+    }
+}
+
+bool RenderPassGBuffer::PrepareCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes)
 {
     // construct draw commands
     std::vector<VkDrawIndexedIndirectCommand> drawCommands;
@@ -129,70 +143,98 @@ void RenderPassGBuffer::RecordCommandBuffers(const std::vector<const SceneNode*>
         }
     }
 
+    // Secondary command buffers of the previous recording are reset with their pools
+    m_secondaryCommandBuffer = VK_NULL_HANDLE;
+    if (m_commandBuffer != VK_NULL_HANDLE)
+    {
+        GetRenderDevice()->FreeStaticPrimaryCommandbuffer(m_commandBuffer);
+        m_commandBuffer = VK_NULL_HANDLE;
+    }
+
     // Early return if there's nothing to draw;
-    if (drawCommands.size() == 0) return;
+    if (drawCommands.size() == 0)
+    {
+        m_pDrawCommandBuffer = nullptr;
+        return false;
+    }
 
-    VkCommandBufferBeginInfo beginInfo = {};
+    // Upload draw commands
+    m_pDrawCommandBuffer = GetRenderResourceManager()->GetDrawCommandBuffer("GBuffer draw commands", drawCommands);
 
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-    beginInfo.pInheritanceInfo = nullptr;
+    // Setup descriptor set for the whole pass
+    m_vDescSets = {
+        m_renderPassParameters.AllocateDescriptorSet("", 0),
+        m_renderPassParameters.AllocateDescriptorSet("", 1),
+        m_renderPassParameters.AllocateDescriptorSet("", 2)
+    };
+    return true;
+}
 
-    m_commandBuffer = GetRenderDevice()->AllocateStaticPrimaryCommandbuffer();
-    vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+void RenderPassGBuffer::RecordSecondaryCommandBuffer(uint32_t nThreadIdx)
+{
+    if (m_pDrawCommandBuffer == nullptr)
     {
-        SCOPED_MARKER(m_commandBuffer, "GBuffer pass");
-        std::vector<VkClearValue> clearValues;
-        clearValues.resize(ATTACHMENT_COUNT);
-        for (int i = 0; i < ATTACHMENT_COUNT; i++)
+        // Lighting subpass still runs, its render pass needs a command buffer for the G-buffer subpass
+        if (m_bLightingSubpass)
         {
-            clearValues[i] = attachments[i].clearValue;
+            m_secondaryCommandBuffer = BeginSecondaryCommandBuffer(nThreadIdx);
+            vkEndCommandBuffer(m_secondaryCommandBuffer);
         }
-       
-        RenderPassBeginInfoBuilder builder;
-        VkRenderPassBeginInfo renderPassBeginInfo =
-            builder.setRenderPass(m_renderPassParameters.GetRenderPass())
-                .setFramebuffer(m_renderPassParameters.GetFramebuffer())
-                .setRenderArea(m_renderArea)
-                .setClearValues(clearValues)
-                .Build();
-
-        vkCmdBeginRenderPass(m_commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        return;
+    }
 
+    m_secondaryCommandBuffer = BeginSecondaryCommandBuffer(nThreadIdx);
+    {
         // Global mesh resource
         const MeshVertexResources& vertexResource = GetMeshResourceManager()->GetMeshVertexResources();
         VkDeviceSize offset = 0;
         const VkBuffer& vertexBuffer = vertexResource.m_pVertexBuffer->buffer();
         const VkBuffer& indexBuffer = vertexResource.m_pIndexBuffer->buffer();
 
-        // Upload draw commands
-        const DrawCommandBuffer<VkDrawIndexedIndirectCommand>* pDrawCommandBuffer = GetRenderResourceManager()->GetDrawCommandBuffer("GBuffer draw commands", drawCommands);
-
-        // Setup descriptor set for the whole pass
-        std::vector<VkDescriptorSet> vDescSets = {
-            m_renderPassParameters.AllocateDescriptorSet("", 0),
-            m_renderPassParameters.AllocateDescriptorSet("", 1),
-            m_renderPassParameters.AllocateDescriptorSet("", 2)
-        };
-
         vkCmdBindDescriptorSets(
-            m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            m_secondaryCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
             m_renderPassParameters.GetPipelineLayout(), 0,
-            static_cast<uint32_t>(vDescSets.size()),
-            vDescSets.data(), 0, nullptr);
+            static_cast<uint32_t>(m_vDescSets.size()),
+            m_vDescSets.data(), 0, nullptr);
 
-        vkCmdBindVertexBuffers(m_commandBuffer, 0, 1, &vertexBuffer,
+        vkCmdBindVertexBuffers(m_secondaryCommandBuffer, 0, 1, &vertexBuffer,
                                &offset);
-        vkCmdBindIndexBuffer(m_commandBuffer, indexBuffer, 0,
+        vkCmdBindIndexBuffer(m_secondaryCommandBuffer, indexBuffer, 0,
                              VK_INDEX_TYPE_UINT32);
-        vkCmdBindPipeline(m_commandBuffer,
+        vkCmdBindPipeline(m_secondaryCommandBuffer,
                           VK_PIPELINE_BIND_POINT_GRAPHICS,
                           m_pipeline);
 
-        vkCmdDrawIndexedIndirect(m_commandBuffer, pDrawCommandBuffer->buffer(), 0, pDrawCommandBuffer->GetDrawCommandCount(), pDrawCommandBuffer->GetStride());
-        vkCmdEndRenderPass(m_commandBuffer);
+        vkCmdDrawIndexedIndirect(m_secondaryCommandBuffer, m_pDrawCommandBuffer->buffer(), 0, m_pDrawCommandBuffer->GetDrawCommandCount(), m_pDrawCommandBuffer->GetStride());
+    }
+    vkEndCommandBuffer(m_secondaryCommandBuffer);
+}
+
+void RenderPassGBuffer::RecordPrimaryCommandBuffer(VkCommandBuffer lightingCmdBuf)
+{
+    if (m_secondaryCommandBuffer == VK_NULL_HANDLE && lightingCmdBuf == VK_NULL_HANDLE) return;
+
+    // Recorded again when the lighting subpass changes
+    if (m_commandBuffer != VK_NULL_HANDLE)
+    {
+        GetRenderDevice()->FreeStaticPrimaryCommandbuffer(m_commandBuffer);
+    }
+
+    std::vector<VkClearValue> clearValues;
+    clearValues.resize(ATTACHMENT_COUNT);
+    for (int i = 0; i < ATTACHMENT_COUNT; i++)
+    {
+        clearValues[i] = attachments[i].clearValue;
+    }
+    if (m_bLightingSubpass)
+    {
+        clearValues.push_back({.color = {0.0f, 0.0f, 0.0f, 1.0f}});
+        m_commandBuffer = RecordPrimaryFromSecondary({m_secondaryCommandBuffer, lightingCmdBuf}, clearValues, "GBuffer and lighting pass");
+    }
+    else
+    {
+        m_commandBuffer = RecordPrimaryFromSecondary(m_secondaryCommandBuffer, clearValues, "GBuffer pass");
     }
-    vkEndCommandBuffer(m_commandBuffer);
 }
 }  // namespace Muyo
 
@@ -5,24 +5,50 @@
 namespace Muyo
 {
 class SceneNode;
+template <class T>
+class DrawCommandBuffer;
 class RenderPassGBuffer : public RenderPass
 {
     public:
-        explicit RenderPassGBuffer(const VkExtent2D& renderArea):m_renderArea(renderArea) {}
+        // With bLightingSubpass, opaque lighting runs as a second subpass reading the G-buffer from input attachments.
+        // Color attachments only read by lighting then never leave tile memory.
+        explicit RenderPassGBuffer(const VkExtent2D& renderArea, bool bLightingSubpass = false) : m_renderArea(renderArea), m_bLightingSubpass(bLightingSubpass) {}
         ~RenderPassGBuffer();
         void PrepareRenderPass() override;
         void CreatePipeline() override;
 
         void RecordCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes);
+
+        // Split recording for multi-threading, see RenderPassRSM
+        bool PrepareCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes);
+        void RecordSecondaryCommandBuffer(uint32_t nThreadIdx);
+        // Lighting subpass is recorded by RenderPassOpaqueLighting, it's ignored without lighting subpass
+        void RecordPrimaryCommandBuffer(VkCommandBuffer lightingCmdBuf = VK_NULL_HANDLE);
+
         VkCommandBuffer GetCommandBuffer() const override { return m_commandBuffer; }
+        const RenderPassParameters& GetRenderPassParameters() const { return m_renderPassParameters; }
+        bool HasLightingSubpass() const { return m_bLightingSubpass; }
+
+        static const uint32_t LIGHTING_SUBPASS = 1;
 
     private:
         VkPipeline m_pipeline = VK_NULL_HANDLE;
         VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+        VkCommandBuffer m_secondaryCommandBuffer = VK_NULL_HANDLE;
+        const DrawCommandBuffer<VkDrawIndexedIndirectCommand>* m_pDrawCommandBuffer = nullptr;
+        std::vector<VkDescriptorSet> m_vDescSets;
         VkExtent2D m_renderArea = {0, 0};
+        bool m_bLightingSubpass = false;
 
     public:
-        static const int ATTACHMENT_COUNT = 5;
+        // Matches the layout in shaders/gbuffer.h
+        enum AttachmentIdx
+        {
+            ALBEDO_AO,
+            NORMAL_ROUGHNESS_METALNESS,
+            DEPTH
+        };
+        static const int ATTACHMENT_COUNT = 3;
         static const int COLOR_ATTACHMENT_COUNT = ATTACHMENT_COUNT - 1;
         struct GBufferAttachment
         {
@@ -8,25 +8,27 @@ namespace Muyo
 {
 void RenderPassGBufferMeshShader::PrepareRenderPass()
 {
+    m_renderPassParameters.Reset();
+
     m_renderPassParameters.SetRenderArea(m_renderArea);
 
     RenderTarget* depthMap = GetRenderResourceManager()->GetDepthTarget("depthOnly", m_renderArea);
     m_renderPassParameters.AddAttachment(depthMap, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                                          true);
 
-    const UniformBuffer<PerViewData>* perView = GetRenderResourceManager()->GetUniformBuffer<PerViewData>("perView");
+    const UniformBuffer<PerViewData>* perView = GetRenderResourceManager()->GetPerFrameUniformBuffer<PerViewData>("perView");
     m_renderPassParameters.AddParameter(perView, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_MESH_BIT_EXT);
 
     m_renderPassParameters.Finalize("Render pass mesh shader");
-    CreatePipeline();
+    CreatePipelineAsync();
 }
 
 void RenderPassGBufferMeshShader::CreatePipeline()
 {
     VkPipelineLayout pipelineLayout = m_renderPassParameters.GetPipelineLayout();
 
-    VkShaderModule meshShader = CreateShaderModule(ReadSpv("shaders/meshShader.mesh.slang.spv"));
-    VkShaderModule fragShader = CreateShaderModule(ReadSpv("shaders/meshShader.frag.slang.spv"));
+    VkShaderModule meshShader = GetShaderLibrary()->AcquireShaderModule("shaders/meshShader.mesh.slang.spv");
+    VkShaderModule fragShader = GetShaderLibrary()->AcquireShaderModule("shaders/meshShader.frag.slang.spv");
 
     ViewportBuilder vpBuilder;
     VkViewport viewport = vpBuilder.setWH(m_renderArea).Build();
@@ -53,12 +55,14 @@ void RenderPassGBufferMeshShader::CreatePipeline()
                      .setRenderPass(m_renderPassParameters.GetRenderPass())
                      .Build(GetRenderDevice()->GetDevice());
 
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), meshShader, nullptr);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShader, nullptr);
+    GetShaderLibrary()->ReleaseShaderModule(meshShader);
+    GetShaderLibrary()->ReleaseShaderModule(fragShader);
 }
 
 void RenderPassGBufferMeshShader::RecordCommandBuffers()
 {
+    WaitForPipelines();
+
     m_commandBuffer = GetRenderDevice()->AllocateStaticPrimaryCommandbuffer();
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
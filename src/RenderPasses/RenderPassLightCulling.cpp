@@ -0,0 +1,124 @@
+#include "RenderPassLightCulling.h"
+
+#include "Camera.h"
+#include "Debug.h"
+#include "PipelineStateBuilder.h"
+#include "RenderResourceManager.h"
+#include "RenderResourceNames.h"
+#include "SharedStructures.h"
+
+namespace Muyo
+{
+
+RenderPassLightCulling::~RenderPassLightCulling()
+{
+    if (m_pipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(GetRenderDevice()->GetDevice(), m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+}
+
+void RenderPassLightCulling::PrepareRenderPass()
+{
+    m_renderPassParameters.Reset();
+
+    // Set 0, Binding 0, perview
+    m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<UniformBuffer<PerViewData>>(PER_VIEW), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0);
+
+    // Set 1, light count and light data
+    m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<UniformBuffer<uint32_t>>(LIGHT_COUNT), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+    m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<StorageBuffer<LightData>>(LIGHT_DATA), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+
+    // Set 2, cluster light lists
+    const StorageBuffer<glm::uvec2>* pClusters = GetRenderResourceManager()->GetStorageBuffer(LIGHT_CLUSTERS, std::vector<glm::uvec2>(CLUSTER_COUNT, glm::uvec2(0)));
+    const StorageBuffer<uint32_t>* pIndices = GetRenderResourceManager()->GetStorageBuffer(CLUSTER_LIGHT_INDICES, std::vector<uint32_t>(MAX_CLUSTER_LIGHT_INDICES, 0));
+    const StorageBuffer<uint32_t>* pIndexCount = GetRenderResourceManager()->GetStorageBuffer(CLUSTER_LIGHT_INDEX_COUNT, std::vector<uint32_t>(1, 0));
+    m_renderPassParameters.AddParameter(pClusters, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2);
+    m_renderPassParameters.AddParameter(pIndices, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2);
+    m_renderPassParameters.AddParameter(pIndexCount, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2);
+
+    m_renderPassParameters.Finalize("Light culling");
+
+    CreatePipelineAsync();
+}
+
+void RenderPassLightCulling::CreatePipeline()
+{
+    VkShaderModule compShader = GetShaderLibrary()->AcquireShaderModule("shaders/lightCulling.comp.spv");
+
+    ComputePipelineBuilder builder;
+    VkComputePipelineCreateInfo createInfo = builder.AddShaderModule(compShader).SetPipelineLayout(m_renderPassParameters.GetPipelineLayout()).Build();
+    VK_ASSERT(vkCreateComputePipelines(GetRenderDevice()->GetDevice(), GetPipelineCache()->GetPipelineCache(), 1, &createInfo, nullptr, &m_pipeline));
+
+    GetShaderLibrary()->ReleaseShaderModule(compShader);
+
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline), VK_OBJECT_TYPE_PIPELINE, "Light culling");
+}
+
+void RenderPassLightCulling::RecordCommandBuffers()
+{
+    WaitForPipelines();
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    // Buffers are not tracked by the render graph, the pass is submitted on graphics queue before lighting and
+    // synchronizes its own accesses
+    if (m_commandBuffer == VK_NULL_HANDLE)
+    {
+        m_commandBuffer = GetRenderDevice()->AllocateStaticPrimaryCommandbuffer();
+    }
+    else
+    {
+        vkResetCommandBuffer(m_commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
+    }
+    vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+    {
+        SCOPED_MARKER(m_commandBuffer, "Light culling");
+
+        const VkBuffer indexCountBuffer = GetRenderResourceManager()->GetResource<StorageBuffer<uint32_t>>(CLUSTER_LIGHT_INDEX_COUNT)->buffer();
+        const VkBuffer clustersBuffer = GetRenderResourceManager()->GetResource<StorageBuffer<glm::uvec2>>(LIGHT_CLUSTERS)->buffer();
+        const VkBuffer indicesBuffer = GetRenderResourceManager()->GetResource<StorageBuffer<uint32_t>>(CLUSTER_LIGHT_INDICES)->buffer();
+
+        // Lighting of the previous frame may still read the light lists, culling of the previous frame may still
+        // count indices
+        VkMemoryBarrier prevFrameBarrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+        vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &prevFrameBarrier, 0, nullptr, 0, nullptr);
+
+        // Reset the index allocator
+        vkCmdFillBuffer(m_commandBuffer, indexCountBuffer, 0, VK_WHOLE_SIZE, 0);
+        VkMemoryBarrier clearBarrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+        vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+        std::vector<VkDescriptorSet> vDescSets = {
+            m_renderPassParameters.AllocateDescriptorSet("", 0),
+            m_renderPassParameters.AllocateDescriptorSet("", 1),
+            m_renderPassParameters.AllocateDescriptorSet("", 2)};
+
+        vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_renderPassParameters.GetPipelineLayout(), 0, (uint32_t)vDescSets.size(), vDescSets.data(), 0, nullptr);
+        vkCmdDispatch(m_commandBuffer, (CLUSTER_COUNT + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+
+        // Light lists are read by the lighting fragment shader
+        std::vector<VkBufferMemoryBarrier> vBarriers;
+        for (VkBuffer buffer : {clustersBuffer, indicesBuffer})
+        {
+            VkBufferMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            vBarriers.push_back(barrier);
+        }
+        vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, static_cast<uint32_t>(vBarriers.size()), vBarriers.data(), 0, nullptr);
+    }
+    vkEndCommandBuffer(m_commandBuffer);
+}
+}  // namespace Muyo
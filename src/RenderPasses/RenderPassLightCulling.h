@@ -0,0 +1,23 @@
+#pragma once
+#include "RenderPass.h"
+
+namespace Muyo
+{
+// Compute pass binning lights into view space clusters, opaque lighting only evaluates the lights of the pixel's
+// cluster. Cluster lists are rebuilt every frame from the camera.
+class RenderPassLightCulling : public RenderPass
+{
+public:
+    RenderPassLightCulling() = default;
+    ~RenderPassLightCulling() override;
+    void CreatePipeline() override;
+    void PrepareRenderPass() override;
+    void RecordCommandBuffers();
+    VkCommandBuffer GetCommandBuffer() const override { return m_commandBuffer; }
+
+private:
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+    VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+    const uint32_t GROUP_SIZE = 64;  // Matches local size in lightCulling.comp
+};
+}  // namespace Muyo
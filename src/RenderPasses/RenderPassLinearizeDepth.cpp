@@ -0,0 +1,82 @@
+#include "RenderPassLinearizeDepth.h"
+
+#include "Camera.h"
+#include "PipelineStateBuilder.h"
+#include "RenderResourceManager.h"
+#include "SamplerManager.h"
+
+namespace Muyo
+{
+const std::string RenderPassLinearizeDepth::OUTPUT_NAME = "linearDepth";
+
+RenderPassLinearizeDepth::~RenderPassLinearizeDepth()
+{
+    if (m_pipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(GetRenderDevice()->GetDevice(), m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+}
+
+void RenderPassLinearizeDepth::PrepareRenderPass()
+{
+    m_renderPassParameters.Reset();
+
+    m_renderPassParameters.SetRenderArea(m_renderArea);
+
+    // Set 0, Binding 0, depth
+    const ImageResource* pDepth = GetRenderResourceManager()->GetResource<ImageResource>("GBufferDepth_");
+    m_renderPassParameters.AddImageParameter(pDepth, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 0);
+
+    // Set 1, Binding 0, linear depth
+    const StorageImageResource* pLinearDepth = GetRenderResourceManager()->GetStorageImageResource(OUTPUT_NAME, m_renderArea, VK_FORMAT_R32_SFLOAT);
+    m_renderPassParameters.AddImageParameter(pLinearDepth, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE, 1);
+
+    // Set 2, Binding 0, perview
+    m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<UniformBuffer<PerViewData>>("perView"), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2);
+
+    m_renderPassParameters.Finalize("Linearize depth");
+
+    CreatePipelineAsync();
+}
+
+void RenderPassLinearizeDepth::CreatePipeline()
+{
+    VkShaderModule compShader = GetShaderLibrary()->AcquireShaderModule("shaders/linearizeDepth.comp.spv");
+
+    ComputePipelineBuilder builder;
+    VkComputePipelineCreateInfo createInfo = builder.AddShaderModule(compShader).SetPipelineLayout(m_renderPassParameters.GetPipelineLayout()).Build();
+    VK_ASSERT(vkCreateComputePipelines(GetRenderDevice()->GetDevice(), GetPipelineCache()->GetPipelineCache(), 1, &createInfo, nullptr, &m_pipeline));
+
+    GetShaderLibrary()->ReleaseShaderModule(compShader);
+
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline), VK_OBJECT_TYPE_PIPELINE, "Linearize depth");
+}
+
+void RenderPassLinearizeDepth::RecordCommandBuffers()
+{
+    WaitForPipelines();
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    // Compute pool is created on the compute queue family, which is the graphics family without async compute
+    m_commandBuffer = GetRenderDevice()->AllocateComputeCommandBuffer();
+    vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+    {
+        SCOPED_MARKER(m_commandBuffer, "Linearize depth");
+
+        std::vector<VkDescriptorSet> vDescSets = {
+            m_renderPassParameters.AllocateDescriptorSet("", 0),
+            m_renderPassParameters.AllocateDescriptorSet("", 1),
+            m_renderPassParameters.AllocateDescriptorSet("", 2)};
+
+        vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_renderPassParameters.GetPipelineLayout(), 0, (uint32_t)vDescSets.size(), vDescSets.data(), 0, nullptr);
+        vkCmdDispatch(m_commandBuffer, (m_renderArea.width + GROUP_SIZE - 1) / GROUP_SIZE, (m_renderArea.height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+    }
+    vkEndCommandBuffer(m_commandBuffer);
+}
+}  // namespace Muyo
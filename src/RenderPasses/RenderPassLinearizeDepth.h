@@ -0,0 +1,26 @@
+#pragma once
+#include "RenderPass.h"
+
+namespace Muyo
+{
+// Compute pass converting GBuffer depth to linear view depth, scheduled on the async compute queue when the device
+// has one.
+class RenderPassLinearizeDepth : public RenderPass
+{
+public:
+    explicit RenderPassLinearizeDepth(VkExtent2D renderArea) : m_renderArea(renderArea) {}
+    ~RenderPassLinearizeDepth() override;
+    void CreatePipeline() override;
+    void PrepareRenderPass() override;
+    void RecordCommandBuffers();
+    VkCommandBuffer GetCommandBuffer() const override { return m_commandBuffer; }
+
+    static const std::string OUTPUT_NAME;
+
+private:
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+    VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+    VkExtent2D m_renderArea = {0, 0};
+    const uint32_t GROUP_SIZE = 8;  // Matches local size in linearizeDepth.comp
+};
+}  // namespace Muyo
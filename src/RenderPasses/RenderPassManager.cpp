@@ -4,18 +4,28 @@
 #include <memory>
 
 #include "DebugUI.h"
+#include "DescriptorManager.h"
+#include "ParallelCommandRecorder.h"
+#include "PipelineCompiler.h"
+#include "RenderGraph.h"
 #include "RenderLayerIBL.h"
 #include "RenderPass.h"
 #include "RenderPassCubeMapGeneration.h"
 #include "RenderPassGBuffer.h"
+#include "RenderPassLightCulling.h"
+#include "RenderPassLinearizeDepth.h"
 #include "RenderPassOpaqueLighting.h"
 #include "RenderPassRSM.h"
+#include "RenderPassRSMIndirect.h"
 #include "RenderPassSkybox.h"
 #include "RenderPassTransparent.h"
 #include "RenderPassUI.h"
 #include "RenderResourceManager.h"
+#include "RenderResourceNames.h"
 #include "RenderPassGBufferMeshShader.h"
 #include "Scene.h"
+#include "ShaderLibrary.h"
+#include "StagingRing.h"
 #ifdef FEATURE_RAY_TRACING
 #include "RayTracingSceneManager.h"
 #include "RenderPassRayTracing.h"
@@ -42,6 +52,20 @@ void RenderPassManager::CreateSwapchain(const VkSurfaceKHR &swapchainSurface)
 
 void RenderPassManager::BeginFrame()
 {
+    // Wait for the frame that used this slot before updating its resources, later frames may still be running
+    m_nFrameIdx = (m_nFrameIdx + 1) % VkRenderDevice::FRAMES_IN_FLIGHT;
+    GetRenderDevice()->WaitForTimelineValue(VkRenderDevice::QUEUE_GRAPHICS, m_aFrameTimelineValues[m_nFrameIdx]);
+    GetDescriptorManager()->BeginFrame();
+    GetRenderDevice()->FreeCompletedUploads();
+    GetStagingRing()->BeginFrame();
+
+    if (m_bIsLightingPermutationDirty)
+    {
+        // Lighting command buffers are recorded again in place, all frames in flight must be done with them
+        GetRenderDevice()->WaitForTimelineValue(VkRenderDevice::QUEUE_GRAPHICS, GetRenderDevice()->GetLastSubmittedValue(VkRenderDevice::QUEUE_GRAPHICS));
+        SwitchLightingPermutation();
+    }
+
     if (m_pCamera->IsTransforationUpdated())
     {
         // Hack: Use frame id to track number of frame without transformation
@@ -51,16 +75,75 @@ void RenderPassManager::BeginFrame()
     m_temporalInfo.nFrameId++;
     m_temporalInfo.nFrameNoCameraMove++;
 
-    UniformBuffer<PerViewData> *pUniformBuffer = GetRenderResourceManager()->GetUniformBuffer<PerViewData>("perView");
-    m_pCamera->UpdatePerViewDataUBO(pUniformBuffer);
+    // Written to the copies of this frame, RecordFrameUpdateCmdBuffer copies them to the buffers the passes read
+    PerFrameUniformBuffer<PerViewData> *pUniformBuffer = GetRenderResourceManager()->GetPerFrameUniformBuffer<PerViewData>("perView");
+    m_pCamera->UpdatePerViewDataUBO(pUniformBuffer, m_nFrameIdx);
+    m_pShadowPassManager->UpdateFilterSettings(m_nFrameIdx);
+    // No-op in OIT mode
+    static_cast<RenderPassTransparent *>(m_vpRenderPasses[RENDERPASS_TRANSPARENT].get())->SortDrawCommands(m_pCamera->GetViewMat(), m_nFrameIdx);
+    RecordFrameUpdateCmdBuffer();
 
-    m_uImageIdx2Present = m_pSwapchain->GetNextImage(m_imageAvailable);
+    m_uImageIdx2Present = m_pSwapchain->GetNextImage(m_aImageAvailable[m_nFrameIdx]);
 
     static_cast<RenderPassFinal *>(m_vpRenderPasses[RENDERPASS_FINAL].get())->SetCurrentSwapchainImageIndex(m_uImageIdx2Present);
+}
+
+void RenderPassManager::SetOrderIndependentTransparency(bool bEnabled)
+{
+    static_cast<RenderPassTransparent *>(m_vpRenderPasses[RENDERPASS_TRANSPARENT].get())->SetMode(bEnabled ? RenderPassTransparent::MODE_WEIGHTED_BLENDED_OIT : RenderPassTransparent::MODE_SORTED);
+}
 
-    // Wait for previous command renders to current swaphchain image to finish
-    vkWaitForFences(GetRenderDevice()->GetDevice(), 1, &m_aGPUExecutionFence[m_uImageIdx2Present], VK_TRUE, std::numeric_limits<uint64_t>::max());
-    vkResetFences(GetRenderDevice()->GetDevice(), 1, &m_aGPUExecutionFence[m_uImageIdx2Present]);
+bool RenderPassManager::IsOrderIndependentTransparencyEnabled() const
+{
+    return static_cast<const RenderPassTransparent *>(m_vpRenderPasses[RENDERPASS_TRANSPARENT].get())->GetMode() == RenderPassTransparent::MODE_WEIGHTED_BLENDED_OIT;
+}
+
+void RenderPassManager::SetShadowFilterSettings(const ShadowFilterSettings &settings)
+{
+    const ShadowFilterSettings previousSettings = m_pShadowPassManager->GetFilterSettings();
+    m_pShadowPassManager->SetFilterSettings(settings);
+    // Filter mode and tap count bucket select the lighting pipeline permutation, which is bound by static command
+    // buffers. Tap counts within a bucket only change the filter settings buffer.
+    const ShadowFilterSettings &newSettings = m_pShadowPassManager->GetFilterSettings();
+    if (newSettings.nMode != previousSettings.nMode ||
+        ShadowPassManager::GetTapCountBucket(newSettings.nTapCount) != ShadowPassManager::GetTapCountBucket(previousSettings.nTapCount))
+    {
+        m_bIsLightingPermutationDirty = true;
+    }
+}
+
+void RenderPassManager::SwitchLightingPermutation()
+{
+    m_bIsLightingPermutationDirty = false;
+    RenderPassOpaqueLighting *pOpaqueLightingPass = static_cast<RenderPassOpaqueLighting *>(m_vpRenderPasses[RENDERPASS_OPAQUE_LIGHTING].get());
+    pOpaqueLightingPass->SwitchPermutation();
+    if (LIGHTING_SUBPASS)
+    {
+        // G-buffer primary command buffer executes the lighting subpass, the G-buffer subpass is kept
+        static_cast<RenderPassGBuffer *>(m_vpRenderPasses[RENDERPASS_GBUFFER].get())->RecordPrimaryCommandBuffer(pOpaqueLightingPass->GetSubpassCommandBuffer());
+    }
+}
+
+const ShadowFilterSettings &RenderPassManager::GetShadowFilterSettings() const
+{
+    return m_pShadowPassManager->GetFilterSettings();
+}
+
+float RenderPassManager::GetLightingGPUTimeMs() const
+{
+    return static_cast<const RenderPassOpaqueLighting *>(m_vpRenderPasses[RENDERPASS_OPAQUE_LIGHTING].get())->GetGPUTimeMs();
+}
+
+void RenderPassManager::SetRSMTemporalAccumulation(bool bEnabled)
+{
+    // Settings buffer is shared by the frames in flight, rare enough to wait for them
+    GetRenderDevice()->WaitForTimelineValue(VkRenderDevice::QUEUE_GRAPHICS, GetRenderDevice()->GetLastSubmittedValue(VkRenderDevice::QUEUE_GRAPHICS));
+    static_cast<RenderPassRSMIndirect *>(m_vpRenderPasses[RENDERPASS_RSM_INDIRECT].get())->SetTemporalAccumulation(bEnabled);
+}
+
+bool RenderPassManager::IsRSMTemporalAccumulationEnabled() const
+{
+    return static_cast<const RenderPassRSMIndirect *>(m_vpRenderPasses[RENDERPASS_RSM_INDIRECT].get())->IsTemporalAccumulationEnabled();
 }
 
 void RenderPassManager::Present()
@@ -68,7 +151,7 @@ void RenderPassManager::Present()
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &m_renderFinished;
+    presentInfo.pWaitSemaphores = &m_aRenderFinished[m_nFrameIdx];
 
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = &(m_pSwapchain->GetSwapChain());
@@ -81,18 +164,10 @@ void RenderPassManager::Present()
 
 void RenderPassManager::Initialize(uint32_t uWidth, uint32_t uHeight, const VkSurfaceKHR &swapchainSurface)
 {
-    m_uWidth = uWidth;
-    m_uHeight = uHeight;
-
     CreateSwapchain(swapchainSurface);
+    CreateOffscreenRenderPasses(uWidth, uHeight);
 
-    m_pShadowPassManager = std::make_unique<ShadowPassManager>();
     VkExtent2D vp = {uWidth, uHeight};
-    // GBuffer and opaque lighting
-    {
-        m_vpRenderPasses[RENDERPASS_GBUFFER] = std::make_unique<RenderPassGBuffer>(vp);
-        m_vpRenderPasses[RENDERPASS_OPAQUE_LIGHTING] = std::make_unique<RenderPassOpaqueLighting>(vp, *m_pShadowPassManager);
-    }
     // Final pass
     m_vpRenderPasses[RENDERPASS_FINAL] = std::make_unique<RenderPassFinal>(*m_pSwapchain, true);
     // UI Pass
@@ -105,22 +180,14 @@ void RenderPassManager::Initialize(uint32_t uWidth, uint32_t uHeight, const VkSu
     pUIPass->RegisterDebugPage<SceneDebugPage>("Loaded Scenes");
     pUIPass->RegisterDebugPage<EnvironmentMapDebugPage>("Env HDRs");
     pUIPass->RegisterDebugPage<LightsDebugPage>("Lights");
+    pUIPass->RegisterDebugPage<TransparencyDebugPage>("Transparency");
+    pUIPass->RegisterDebugPage<ShadowFilterDebugPage>("Shadows");
+    pUIPass->RegisterDebugPage<DescriptorDebugPage>("Descriptors");
     CameraDebugPage *pCameraDebugPage = pUIPass->RegisterDebugPage<CameraDebugPage>("MainCamera");
+    pCameraDebugPage->SetCamera(GetCamera());
 
     // pUIPass->RegisterDebugPage<DemoDebugPage>("demo");
 
-    // IBL pass
-    m_vpRenderPasses[RENDERPASS_IBL] = std::make_unique<RenderLayerIBL>();
-
-    m_vpRenderPasses[RENDERPASS_CUBEMAP_GENERATION] = std::make_unique<RenderPassCubeMapGeneration>(VkExtent2D({128, 128}));
-
-    m_vpRenderPasses[RENDERPASS_MESH_SHADER] = std::make_unique<RenderPassGBufferMeshShader>(VkExtent2D({m_uWidth, m_uHeight}));
-
-    // IBL pass separated
-    // Transparent pass
-    m_vpRenderPasses[RENDERPASS_TRANSPARENT] = std::make_unique<RenderPassTransparent>(vp);
-    // Skybox pass
-    m_vpRenderPasses[RENDERPASS_SKYBOX] = std::make_unique<RenderPassSkybox>(vp);
 #ifdef FEATURE_RAY_TRACING
     // RenderPass Ray Tracing
     m_vpRenderPasses[RENDERPASS_RAY_TRACING] = std::make_unique<RenderPassRayTracing>(vp);
@@ -128,31 +195,59 @@ void RenderPassManager::Initialize(uint32_t uWidth, uint32_t uHeight, const VkSu
     m_vpRenderPasses[RENDERPASS_RAY_TRACING] = nullptr;
 #endif
 
-    RenderTarget *pDepthResource = GetRenderResourceManager()->GetDepthTarget("depthTarget", VkExtent2D({m_uWidth, m_uHeight}));
-
     // Create semaphores
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    VK_ASSERT(vkCreateSemaphore(GetRenderDevice()->GetDevice(), &semaphoreInfo, nullptr, &m_depthReady));
+    for (uint32_t i = 0; i < VkRenderDevice::FRAMES_IN_FLIGHT; i++)
+    {
+        VK_ASSERT(vkCreateSemaphore(GetRenderDevice()->GetDevice(), &semaphoreInfo, nullptr, &m_aImageAvailable[i]));
+        VK_ASSERT(vkCreateSemaphore(GetRenderDevice()->GetDevice(), &semaphoreInfo, nullptr, &m_aRenderFinished[i]));
+        setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_aImageAvailable[i]), VK_OBJECT_TYPE_SEMAPHORE, "Swapchian ImageAvailable " + std::to_string(i));
+        setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_aRenderFinished[i]), VK_OBJECT_TYPE_SEMAPHORE, "Render Finished " + std::to_string(i));
+    }
+}
+
+void RenderPassManager::InitializeHeadless(uint32_t uWidth, uint32_t uHeight)
+{
+    // Final and UI passes render to the swapchain, ray tracing needs a built scene
+    CreateOffscreenRenderPasses(uWidth, uHeight);
+}
 
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_depthReady), VK_OBJECT_TYPE_SEMAPHORE, "Depth Ready");
+void RenderPassManager::CreateOffscreenRenderPasses(uint32_t uWidth, uint32_t uHeight)
+{
+    m_uWidth = uWidth;
+    m_uHeight = uHeight;
 
-    VK_ASSERT(vkCreateSemaphore(GetRenderDevice()->GetDevice(), &semaphoreInfo, nullptr, &m_imageAvailable));
-    VK_ASSERT(vkCreateSemaphore(GetRenderDevice()->GetDevice(), &semaphoreInfo, nullptr, &m_renderFinished));
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_imageAvailable), VK_OBJECT_TYPE_SEMAPHORE, "Swapchian ImageAvailable");
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_renderFinished), VK_OBJECT_TYPE_SEMAPHORE, "Render Finished");
+    GetPipelineCompiler()->Initialize();
 
-    // Create a fence to wait for GPU execution for each swapchain image
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    for (auto &fence : m_aGPUExecutionFence)
+    m_pShadowPassManager = std::make_unique<ShadowPassManager>();
+    VkExtent2D vp = {uWidth, uHeight};
+    // GBuffer and opaque lighting
     {
-        VK_ASSERT(vkCreateFence(GetRenderDevice()->GetDevice(), &fenceInfo, nullptr, &fence));
-        setDebugUtilsObjectName(reinterpret_cast<uint64_t>(fence), VK_OBJECT_TYPE_FENCE, "renderFinished");
+        m_vpRenderPasses[RENDERPASS_LIGHT_CULLING] = std::make_unique<RenderPassLightCulling>();
+        m_vpRenderPasses[RENDERPASS_GBUFFER] = std::make_unique<RenderPassGBuffer>(vp, LIGHTING_SUBPASS);
+        m_vpRenderPasses[RENDERPASS_LINEARIZE_DEPTH] = std::make_unique<RenderPassLinearizeDepth>(vp);
+        m_vpRenderPasses[RENDERPASS_RSM_INDIRECT] = std::make_unique<RenderPassRSMIndirect>(vp, RSM_INDIRECT_DOWNSCALE, *m_pShadowPassManager);
+        const RenderPassGBuffer *pGBufferPass = static_cast<const RenderPassGBuffer *>(m_vpRenderPasses[RENDERPASS_GBUFFER].get());
+        m_vpRenderPasses[RENDERPASS_OPAQUE_LIGHTING] = std::make_unique<RenderPassOpaqueLighting>(vp, *m_pShadowPassManager, LIGHTING_SUBPASS ? pGBufferPass : nullptr);
     }
 
+    // IBL pass
+    m_vpRenderPasses[RENDERPASS_IBL] = std::make_unique<RenderLayerIBL>();
+
+    m_vpRenderPasses[RENDERPASS_CUBEMAP_GENERATION] = std::make_unique<RenderPassCubeMapGeneration>(VkExtent2D({128, 128}));
+
+    m_vpRenderPasses[RENDERPASS_MESH_SHADER] = std::make_unique<RenderPassGBufferMeshShader>(VkExtent2D({m_uWidth, m_uHeight}));
+
+    // IBL pass separated
+    // Transparent pass
+    m_vpRenderPasses[RENDERPASS_TRANSPARENT] = std::make_unique<RenderPassTransparent>(vp);
+    // Skybox pass
+    m_vpRenderPasses[RENDERPASS_SKYBOX] = std::make_unique<RenderPassSkybox>(vp);
+
+    RenderTarget *pDepthResource = GetRenderResourceManager()->GetDepthTarget("depthTarget", VkExtent2D({m_uWidth, m_uHeight}));
+
     // Allocate an arcball camera
     // TODO: Allocate camera as needed if we ever support mulit render targets
     const float FAR = 100.0f;
@@ -167,7 +262,6 @@ void RenderPassManager::Initialize(uint32_t uWidth, uint32_t uHeight, const VkSu
         FAR,                                       // far
         (float)m_uWidth,
         (float)m_uHeight);
-    pCameraDebugPage->SetCamera(GetCamera());
 }
 
 void RenderPassManager::OnResize(uint32_t uWidth, uint32_t uHeight)
@@ -204,58 +298,270 @@ void RenderPassManager::OnResize(uint32_t uWidth, uint32_t uHeight)
 
 void RenderPassManager::Unintialize()
 {
+    m_pRenderGraph = nullptr;
     m_pShadowPassManager = nullptr;
     for (auto &pPass : m_vpRenderPasses)
     {
         pPass = nullptr;
     }
-    vkDestroySemaphore(GetRenderDevice()->GetDevice(), m_depthReady, nullptr);
-    vkDestroySemaphore(GetRenderDevice()->GetDevice(), m_imageAvailable, nullptr);
-    vkDestroySemaphore(GetRenderDevice()->GetDevice(), m_renderFinished, nullptr);
-    for (auto &fence : m_aGPUExecutionFence)
+    GetPipelineCompiler()->Uninitialize();
+    for (uint32_t i = 0; i < VkRenderDevice::FRAMES_IN_FLIGHT; i++)
+    {
+        vkDestroySemaphore(GetRenderDevice()->GetDevice(), m_aImageAvailable[i], nullptr);
+        vkDestroySemaphore(GetRenderDevice()->GetDevice(), m_aRenderFinished[i], nullptr);
+        m_aImageAvailable[i] = VK_NULL_HANDLE;
+        m_aRenderFinished[i] = VK_NULL_HANDLE;
+    }
+    if (m_pSwapchain)
     {
-        vkDestroyFence(GetRenderDevice()->GetDevice(), fence, nullptr);
+        m_pSwapchain->DestroySwapchain();
+        m_pSwapchain = nullptr;
     }
-    m_pSwapchain->DestroySwapchain();
-    m_pSwapchain = nullptr;
+}
+
+void RenderPassManager::SetupRenderGraph()
+{
+    m_pRenderGraph = std::make_unique<RenderGraph>();
+    RenderGraph &graph = *m_pRenderGraph;
+    VkExtent2D vp = {m_uWidth, m_uHeight};
+
+    // GBuffer color attachments only live within a frame
+    for (int i = 0; i < RenderPassGBuffer::COLOR_ATTACHMENT_COUNT; i++)
+    {
+        graph.DeclareTransientImage(RenderPassGBuffer::attachments[i].sName, vp, RenderPassGBuffer::attachments[i].format);
+    }
+    // Shadow atlases are cached across frames, only stale tiles are re-rendered
+    if (m_pShadowPassManager->HasShadowMaps())
+    {
+        for (const std::string &sRSMName : RenderPassRSM::GetRSMNames())
+        {
+            graph.MarkOutput(sRSMName);
+        }
+        // History of the accumulated indirect lighting
+        graph.MarkOutput(RenderPassRSMIndirect::OUTPUT_NAME);
+    }
+#ifdef FEATURE_RAY_TRACING
+    graph.MarkOutput("env_cube_map");
+#endif
+    if (IsHeadless())
+    {
+        // Nothing consumes the debug passes and the lit image without a swapchain, keep them so their pipelines are
+        // compiled
+        graph.MarkOutput("env_cube_map");
+        graph.MarkOutput("depthOnly");
+        graph.MarkOutput(OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME);
+    }
+
+    graph.AddPass("Cube map generation", m_vpRenderPasses[RENDERPASS_CUBEMAP_GENERATION].get())
+        .Write("env_cube_map", RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    graph.AddPass("Mesh shader", m_vpRenderPasses[RENDERPASS_MESH_SHADER].get())
+        .Write("depthOnly", RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // Atlases stay in shader read layout between frames, the pass loads them and only clears its tiles
+    auto addShadowAtlasPass = [this, &graph]()
+    {
+        const auto &aRSMNames = RenderPassRSM::GetRSMNames();
+        RenderGraph::PassBuilder builder = graph.AddPass("Shadow atlas", m_pShadowPassManager->GetShadowPass());
+        builder.Write(aRSMNames[0], RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        for (size_t i = 1; i < aRSMNames.size(); i++)
+        {
+            builder.Write(aRSMNames[i], RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+    };
+    // Inputs of opaque lighting besides the G-buffer
+    auto readLightingInputs = [this](RenderGraph::PassBuilder &builder)
+    {
+        if (m_pShadowPassManager->HasShadowMaps())
+        {
+            builder.Read(RenderPassRSM::GetRSMNames()[0], RENDER_GRAPH_ACCESS_SAMPLED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+                .Read(RenderPassRSMIndirect::OUTPUT_NAME, RENDER_GRAPH_ACCESS_SAMPLED, VK_IMAGE_LAYOUT_GENERAL)
+                .Read(RenderPassRSMIndirect::GUIDE_NAME, RENDER_GRAPH_ACCESS_SAMPLED, VK_IMAGE_LAYOUT_GENERAL);
+        }
+        builder.Write(OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME, RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    };
+
+    // With lighting subpass, lighting samples the shadow atlas within the G-buffer pass. RSM indirect needs the
+    // G-buffer so it runs afterwards, lighting uses the result of the previous frame.
+    if (LIGHTING_SUBPASS && m_pShadowPassManager->HasShadowMaps())
+    {
+        addShadowAtlasPass();
+        graph.MarkOutput(RenderPassRSMIndirect::GUIDE_NAME);
+    }
+
+    {
+        RenderGraph::PassBuilder builder = graph.AddPass(LIGHTING_SUBPASS ? "GBuffer and lighting" : "GBuffer", m_vpRenderPasses[RENDERPASS_GBUFFER].get());
+        for (int i = 0; i < RenderPassGBuffer::COLOR_ATTACHMENT_COUNT; i++)
+        {
+            builder.Write(RenderPassGBuffer::attachments[i].sName, RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+        builder.Write("GBufferDepth_", RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+        if (LIGHTING_SUBPASS)
+        {
+            readLightingInputs(builder);
+        }
+    }
+
+    // Runs on compute queue in parallel with the shadow atlas, lighting reconstructs positions from its output
+    graph.AddPass("Linearize depth", m_vpRenderPasses[RENDERPASS_LINEARIZE_DEPTH].get())
+        .Read("GBufferDepth_", RENDER_GRAPH_ACCESS_SAMPLED, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL)
+        .Write(RenderPassLinearizeDepth::OUTPUT_NAME, RENDER_GRAPH_ACCESS_STORAGE_WRITE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL)
+        .SetQueue(RENDER_GRAPH_QUEUE_ASYNC_COMPUTE);
+
+    if (!LIGHTING_SUBPASS && m_pShadowPassManager->HasShadowMaps())
+    {
+        addShadowAtlasPass();
+    }
+
+    if (m_pShadowPassManager->HasShadowMaps())
+    {
+        // Indirect lighting is blended with the previous frame, it's loaded in general layout
+        const auto &aRSMNames = RenderPassRSM::GetRSMNames();
+        RenderGraph::PassBuilder builder = graph.AddPass("RSM indirect", m_vpRenderPasses[RENDERPASS_RSM_INDIRECT].get());
+        builder.Read(RenderPassGBuffer::attachments[RenderPassGBuffer::NORMAL_ROUGHNESS_METALNESS].sName, RENDER_GRAPH_ACCESS_SAMPLED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .Read(RenderPassLinearizeDepth::OUTPUT_NAME, RENDER_GRAPH_ACCESS_SAMPLED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        for (size_t i = 1; i < aRSMNames.size(); i++)
+        {
+            builder.Read(aRSMNames[i], RENDER_GRAPH_ACCESS_SAMPLED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+        builder.Write(RenderPassRSMIndirect::OUTPUT_NAME, RENDER_GRAPH_ACCESS_STORAGE_WRITE, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL)
+            .Write(RenderPassRSMIndirect::GUIDE_NAME, RENDER_GRAPH_ACCESS_STORAGE_WRITE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    if (!LIGHTING_SUBPASS)
+    {
+        RenderGraph::PassBuilder builder = graph.AddPass("Opaque lighting", m_vpRenderPasses[RENDERPASS_OPAQUE_LIGHTING].get());
+        for (int i = 0; i < RenderPassGBuffer::COLOR_ATTACHMENT_COUNT; i++)
+        {
+            builder.Read(RenderPassGBuffer::attachments[i].sName, RENDER_GRAPH_ACCESS_SAMPLED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+        builder.Read(RenderPassLinearizeDepth::OUTPUT_NAME, RENDER_GRAPH_ACCESS_SAMPLED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        readLightingInputs(builder);
+    }
+
+    graph.AddPass("Skybox", m_vpRenderPasses[RENDERPASS_SKYBOX].get())
+        .Write(OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME, RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+        .Read("GBufferDepth_", RENDER_GRAPH_ACCESS_DEPTH_READ, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+
+    // Both transparency modes access the images the same way, OIT targets are internal to the pass
+    graph.AddPass("Transparent", m_vpRenderPasses[RENDERPASS_TRANSPARENT].get())
+        .Write(OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME, RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+        .Write("GBufferDepth_", RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+    if (!IsHeadless())
+    {
+        graph.AddPass("UI", m_vpRenderPasses[RENDERPASS_UI].get())
+            .Write(OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME, RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        // Swapchain images are not tracked, the final pass presents
+        graph.AddPass("Final", m_vpRenderPasses[RENDERPASS_FINAL].get())
+            .Read(OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME, RENDER_GRAPH_ACCESS_SAMPLED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .Write("GBufferDepth_", RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)
+            .SetSideEffect();
+    }
+
+    graph.Compile();
 }
 
 void RenderPassManager::RecordStaticCmdBuffers(const DrawLists &drawLists)
 {
+    // Lighting is prepared with the current permutation
+    m_bIsLightingPermutationDirty = false;
+
+    // Secondary command buffers of the previous recording are recycled
+    GetRenderDevice()->ResetSecondaryCommandPools();
+
+    m_pShadowPassManager->SetLights(drawLists.m_aDrawLists[DrawLists::DL_LIGHT]);
+    // Tile resolutions are only re-evaluated when static command buffers are recorded
+    m_pShadowPassManager->AllocateAtlasTiles(m_pCamera->GetViewMat(), m_pCamera->GetProjMat());
+    SetupRenderGraph();
+
+    // All passes are prepared before any is recorded. Preparing a pass queues its pipelines on the pipeline
+    // compiler, they compile while later passes are prepared. Recording a pass waits for its own pipelines only.
+    RenderPassCubeMapGeneration* pCubeMapGenerationPass = static_cast<RenderPassCubeMapGeneration*>(m_vpRenderPasses[RENDERPASS_CUBEMAP_GENERATION].get());
+    const bool bRecordCubeMapGeneration = !m_pRenderGraph->IsCulled(pCubeMapGenerationPass);
+    if (bRecordCubeMapGeneration)
     {
-        RenderPassCubeMapGeneration* pCubeMapGenerationPass = static_cast<RenderPassCubeMapGeneration*>(m_vpRenderPasses[RENDERPASS_CUBEMAP_GENERATION].get());
         pCubeMapGenerationPass->PrepareRenderPass();
-        pCubeMapGenerationPass->RecordCommandBuffers();
     }
 
+    RenderPassGBufferMeshShader* pMeshShaderPass = static_cast<RenderPassGBufferMeshShader*>(m_vpRenderPasses[RENDERPASS_MESH_SHADER].get());
+    const bool bRecordMeshShader = !m_pRenderGraph->IsCulled(pMeshShaderPass);
+    if (bRecordMeshShader)
     {
-        RenderPassGBufferMeshShader* pMeshShaderPass = static_cast<RenderPassGBufferMeshShader*>(m_vpRenderPasses[RENDERPASS_MESH_SHADER].get());
         pMeshShaderPass->PrepareRenderPass();
-        pMeshShaderPass->RecordCommandBuffers();
     }
-    // Prepare shadow pass
+    // Shadow, gbuffer and transparent passes are recorded into secondary command buffers in parallel.
+    // Resources and descriptor sets are prepared on this thread first, primary command buffers are recorded after
+    // all jobs are done.
+    const std::vector<const SceneNode *> &opaqueDrawList = drawLists.m_aDrawLists[DrawLists::DL_OPAQUE];
+    const std::vector<const SceneNode *> &transparentDrawList = drawLists.m_aDrawLists[DrawLists::DL_TRANSPARENT];
+    RenderPassGBuffer *pGBufferPass = static_cast<RenderPassGBuffer *>(m_vpRenderPasses[RENDERPASS_GBUFFER].get());
+    RenderPassTransparent *pTransparentPass = static_cast<RenderPassTransparent *>(m_vpRenderPasses[RENDERPASS_TRANSPARENT].get());
     {
-        m_pShadowPassManager->SetLights(drawLists.m_aDrawLists[DrawLists::DL_LIGHT]);
         m_pShadowPassManager->PrepareRenderPasses();
-        const std::vector<const SceneNode *> &opaqueDrawList = drawLists.m_aDrawLists[DrawLists::DL_OPAQUE];
-        m_pShadowPassManager->RecordCommandBuffers(opaqueDrawList);
+        m_pShadowPassManager->PrepareCommandBuffers(opaqueDrawList);
+        pGBufferPass->PrepareRenderPass();
+        pGBufferPass->PrepareCommandBuffers(opaqueDrawList);
     }
+    RenderPassLinearizeDepth *pLinearizeDepthPass = static_cast<RenderPassLinearizeDepth *>(m_vpRenderPasses[RENDERPASS_LINEARIZE_DEPTH].get());
+    const bool bRecordLinearizeDepth = !m_pRenderGraph->IsCulled(pLinearizeDepthPass);
+    if (bRecordLinearizeDepth)
     {
-        RenderPassGBuffer *pGBufferPass = static_cast<RenderPassGBuffer*>(m_vpRenderPasses[RENDERPASS_GBUFFER].get());
-        pGBufferPass->PrepareRenderPass();
-        const std::vector<const SceneNode *> &opaqueDrawList = drawLists.m_aDrawLists[DrawLists::DL_OPAQUE];
-        pGBufferPass->RecordCommandBuffers(opaqueDrawList);
+        pLinearizeDepthPass->PrepareRenderPass();
     }
+    RenderPassRSMIndirect *pRSMIndirectPass = static_cast<RenderPassRSMIndirect *>(m_vpRenderPasses[RENDERPASS_RSM_INDIRECT].get());
+    const bool bRecordRSMIndirect = m_pShadowPassManager->HasShadowMaps() && !m_pRenderGraph->IsCulled(pRSMIndirectPass);
+    if (bRecordRSMIndirect)
     {
-        RenderPassOpaqueLighting *pOpaqueLightingPass = static_cast<RenderPassOpaqueLighting *>(m_vpRenderPasses[RENDERPASS_OPAQUE_LIGHTING].get());
-        pOpaqueLightingPass->PrepareRenderPass();
-        pOpaqueLightingPass->RecordCommandBuffers();
+        pRSMIndirectPass->PrepareRenderPass();
     }
+    // Lighting reads the cluster light lists
+    RenderPassLightCulling *pLightCullingPass = static_cast<RenderPassLightCulling *>(m_vpRenderPasses[RENDERPASS_LIGHT_CULLING].get());
+    pLightCullingPass->PrepareRenderPass();
+    // Subpass lighting is a secondary command buffer executed by the G-buffer pass
+    RenderPassOpaqueLighting *pOpaqueLightingPass = static_cast<RenderPassOpaqueLighting *>(m_vpRenderPasses[RENDERPASS_OPAQUE_LIGHTING].get());
+    pOpaqueLightingPass->PrepareRenderPass();
     {
-        RenderPassTransparent *pTransparentPass = static_cast<RenderPassTransparent *>(m_vpRenderPasses[RENDERPASS_TRANSPARENT].get());
-        const std::vector<const SceneNode *> &transparentDrawList = drawLists.m_aDrawLists[DrawLists::DL_TRANSPARENT];
         pTransparentPass->PrepareRenderPass();
-        pTransparentPass->RecordCommandBuffers(transparentDrawList);
+        pTransparentPass->PrepareCommandBuffers(transparentDrawList);
+    }
+    RenderPassSkybox *pSkybox = static_cast<RenderPassSkybox *>(m_vpRenderPasses[RENDERPASS_SKYBOX].get());
+    pSkybox->PrepareRenderPass();
+
+    if (bRecordCubeMapGeneration)
+    {
+        pCubeMapGenerationPass->RecordCommandBuffers();
+    }
+    if (bRecordMeshShader)
+    {
+        pMeshShaderPass->RecordCommandBuffers();
+    }
+    if (bRecordLinearizeDepth)
+    {
+        pLinearizeDepthPass->RecordCommandBuffers();
+    }
+    if (bRecordRSMIndirect)
+    {
+        pRSMIndirectPass->RecordCommandBuffers();
+    }
+    pLightCullingPass->RecordCommandBuffers();
+    pOpaqueLightingPass->RecordCommandBuffers();
+    {
+        // Recording jobs bind the pipelines on other threads
+        pGBufferPass->WaitForPipelines();
+        pTransparentPass->WaitForPipelines();
+
+        ParallelCommandRecorder recorder;
+        m_pShadowPassManager->AddRecordingJobs(recorder);
+        recorder.AddJob([pGBufferPass](uint32_t nThreadIdx)
+                        { pGBufferPass->RecordSecondaryCommandBuffer(nThreadIdx); });
+        recorder.AddJob([pTransparentPass](uint32_t nThreadIdx)
+                        { pTransparentPass->RecordSecondaryCommandBuffer(nThreadIdx); });
+        recorder.Execute();
+
+        pGBufferPass->RecordPrimaryCommandBuffer(pOpaqueLightingPass->GetSubpassCommandBuffer());
+        pTransparentPass->RecordPrimaryCommandBuffer();
     }
 
 #ifdef FEATURE_RAY_TRACING
@@ -266,13 +572,59 @@ void RenderPassManager::RecordStaticCmdBuffers(const DrawLists &drawLists)
         pRTPass->RecordCommandBuffer();
     }
 #endif
-    RenderPassSkybox *pSkybox = static_cast<RenderPassSkybox *>(m_vpRenderPasses[RENDERPASS_SKYBOX].get());
-    pSkybox->PrepareRenderPass();
     pSkybox->RecordCommandBuffers();
 
-    RenderPassFinal *pFinalPass = static_cast<RenderPassFinal *>(m_vpRenderPasses[RENDERPASS_FINAL].get());
-    pFinalPass->PrepareRenderPass();
-    pFinalPass->RecordCommandBuffers();
+    if (!IsHeadless())
+    {
+        RenderPassFinal *pFinalPass = static_cast<RenderPassFinal *>(m_vpRenderPasses[RENDERPASS_FINAL].get());
+        pFinalPass->PrepareRenderPass();
+        pFinalPass->RecordCommandBuffers();
+    }
+
+    m_pRenderGraph->RecordBarriers();
+
+    // Sets of the previous recording that weren't requested again are freed once in-flight frames are done
+    GetDescriptorManager()->RetireUnusedDescriptorSets();
+    // All pipelines of the recording are built
+    GetShaderLibrary()->ReleaseUnusedModules();
+}
+
+void RenderPassManager::PrecompilePipelines()
+{
+    assert(IsHeadless());
+    // Passes are prepared from their descriptions. Layouts only need the descriptor types, resources that come with
+    // a scene (lights, per object data) are left unbound.
+    std::vector<RenderPass *> vpPasses;
+    auto prepare = [&vpPasses](IRenderPass *pPass)
+    {
+        pPass->PrepareRenderPass();
+        vpPasses.push_back(static_cast<RenderPass *>(pPass));
+    };
+    prepare(m_vpRenderPasses[RENDERPASS_CUBEMAP_GENERATION].get());
+    prepare(m_vpRenderPasses[RENDERPASS_MESH_SHADER].get());
+    // Atlas and indirect lighting are built even though no light casts shadows
+    m_pShadowPassManager->PrecompilePipelines();
+    prepare(m_vpRenderPasses[RENDERPASS_GBUFFER].get());
+    prepare(m_vpRenderPasses[RENDERPASS_LINEARIZE_DEPTH].get());
+    prepare(m_vpRenderPasses[RENDERPASS_RSM_INDIRECT].get());
+    prepare(m_vpRenderPasses[RENDERPASS_LIGHT_CULLING].get());
+    // Permutations compile on this thread while the passes above compile on the pipeline compiler. Lighting creates
+    // the output later passes render to.
+    static_cast<RenderPassOpaqueLighting *>(m_vpRenderPasses[RENDERPASS_OPAQUE_LIGHTING].get())->PrecompilePipelines();
+    // Both transparency modes are built by the transparent pass
+    prepare(m_vpRenderPasses[RENDERPASS_TRANSPARENT].get());
+    prepare(m_vpRenderPasses[RENDERPASS_SKYBOX].get());
+    // UI renders to the lighting output, not the swapchain
+    if (!m_vpRenderPasses[RENDERPASS_UI])
+    {
+        m_vpRenderPasses[RENDERPASS_UI] = std::make_unique<RenderPassUI>(VkExtent2D({m_uWidth, m_uHeight}));
+    }
+    m_vpRenderPasses[RENDERPASS_UI]->PrepareRenderPass();
+
+    for (RenderPass *pPass : vpPasses)
+    {
+        pPass->WaitForPipelines();
+    }
 }
 
 void RenderPassManager::RecordDynamicCmdBuffers()
@@ -280,8 +632,34 @@ void RenderPassManager::RecordDynamicCmdBuffers()
     VkExtent2D vpExtent = {m_uWidth, m_uHeight};
     RenderPassUI *pUIPass = static_cast<RenderPassUI *>(m_vpRenderPasses[RENDERPASS_UI].get());
     pUIPass->NewFrame(vpExtent);
-    pUIPass->UpdateBuffers();
+    pUIPass->UpdateBuffers(m_nFrameIdx);
     pUIPass->RecordCommandBuffer();
+
+    // Shadow atlas only re-renders the tiles of stale maps
+    m_pShadowPassManager->RecordDirtyShadowMaps(m_nFrameIdx);
+}
+
+void RenderPassManager::RecordFrameUpdateCmdBuffer()
+{
+    VkCommandBuffer &cmdBuf = m_aFrameUpdateCmdBufs[m_nFrameIdx];
+    if (cmdBuf == VK_NULL_HANDLE)
+    {
+        // No need to free it as it will be destroyed with the pool
+        cmdBuf = GetRenderDevice()->AllocateReusablePrimaryCommandbuffer();
+        setDebugUtilsObjectName(reinterpret_cast<uint64_t>(cmdBuf), VK_OBJECT_TYPE_COMMAND_BUFFER, "[CB] Frame update");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmdBuf, &beginInfo);
+    {
+        SCOPED_MARKER(cmdBuf, "Frame update");
+        GetRenderResourceManager()->GetPerFrameUniformBuffer<PerViewData>("perView")->RecordCopy(cmdBuf, m_nFrameIdx);
+        GetRenderResourceManager()->GetPerFrameUniformBuffer<ShadowFilterSettings>(ShadowPassManager::FILTER_SETTINGS_NAME)->RecordCopy(cmdBuf, m_nFrameIdx);
+        static_cast<const RenderPassTransparent *>(m_vpRenderPasses[RENDERPASS_TRANSPARENT].get())->RecordDrawCommandCopy(cmdBuf, m_nFrameIdx);
+    }
+    vkEndCommandBuffer(cmdBuf);
 }
 
 void RenderPassManager::ReloadEnvironmentMap(const std::string &sNewEnvMapPath)
@@ -294,71 +672,100 @@ void RenderPassManager::ReloadEnvironmentMap(const std::string &sNewEnvMapPath)
 
 void RenderPassManager::SubmitCommandBuffers()
 {
-    // This function manages command buffer submissions and queue synchronizations
+    // This function manages command buffer submissions and queue synchronizations.
+    // With async compute, compute passes overlap with the shadow atlas, queues wait on each other's timeline:
+    //   Graphics: light culling, gbuffer -> shadow atlas ------------> rsm indirect, lighting ... final
+    //   Compute:            (wait gbuffer) -> linearize -> (waited by rsm indirect and lighting)
+    // With lighting subpass the shadow atlas moves before the G-buffer, which also does the lighting:
+    //   Graphics: light culling, shadow atlas, gbuffer and lighting -> rsm indirect ... final
+    //   Compute:                               (wait gbuffer) -> linearize -> (waited by rsm indirect)
+    VkRenderDevice *pDevice = GetRenderDevice();
     std::vector<VkCommandBuffer> vCmdBufs;
-    std::vector<VkSemaphore> vWaitForSemaphores;
-    std::vector<VkPipelineStageFlags> vWaitStages;
-    std::vector<VkSemaphore> vSignalSemaphores;
+    std::vector<VkRenderDevice::SemaphoreWait> vFinalWaits;
+
+    const IRenderPass *pLinearizeDepthPass = m_vpRenderPasses[RENDERPASS_LINEARIZE_DEPTH].get();
+    const bool bAsyncCompute = pDevice->IsAsyncComputeSupported() && !m_pRenderGraph->IsCulled(pLinearizeDepthPass);
 
+    // Per frame buffer copies go first, every pass of the frame reads them
+    vCmdBufs.push_back(m_aFrameUpdateCmdBufs[m_nFrameIdx]);
+
+    // Render graph adds the barriers before each pass and skips culled passes
     if (!m_bIsIrradianceGenerated)
     {
-        vCmdBufs.push_back(m_vpRenderPasses[RENDERPASS_IBL]->GetCommandBuffer());
+        m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_IBL].get(), vCmdBufs);
         m_bIsIrradianceGenerated = true;
     }
 
     // Debug cubemap generation
-    vCmdBufs.push_back(m_vpRenderPasses[RENDERPASS_CUBEMAP_GENERATION]->GetCommandBuffer());
-   
-    // Mesh shader
-    vCmdBufs.push_back(m_vpRenderPasses[RENDERPASS_MESH_SHADER]->GetCommandBuffer());
+    m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_CUBEMAP_GENERATION].get(), vCmdBufs);
 
-    // Shadow pass
-    // vCmdBufs.push_back(m_vpRenderPasses[RENDERPASS_SHADOW]->GetCommandBuffer());
-    auto vShadowPassCmds = m_pShadowPassManager->GetCommandBuffers();
-    vCmdBufs.insert(std::end(vCmdBufs), std::begin(vShadowPassCmds), std::end(vShadowPassCmds));
-
-    // Submit graphics queue to signal depth ready semaphore
-    vCmdBufs.push_back(m_vpRenderPasses[RENDERPASS_GBUFFER]->GetCommandBuffer());
-    vCmdBufs.push_back(m_vpRenderPasses[RENDERPASS_OPAQUE_LIGHTING]->GetCommandBuffer());
-    vSignalSemaphores.push_back(m_depthReady);
-    GetRenderDevice()->SubmitCommandBuffers(vCmdBufs, GetRenderDevice()->GetGraphicsQueue(), vWaitForSemaphores, vSignalSemaphores, vWaitStages);
+    // Mesh shader
+    m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_MESH_SHADER].get(), vCmdBufs);
 
-    vCmdBufs.clear();
-    vSignalSemaphores.clear();
+    // Light culling only depends on camera and lights, it's not part of the graph
+    m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_LIGHT_CULLING].get(), vCmdBufs);
 
-    // Submit other graphics tasks
-    vCmdBufs.push_back(m_vpRenderPasses[RENDERPASS_SKYBOX]->GetCommandBuffer());
-    if (auto cmdBuf = m_vpRenderPasses[RENDERPASS_TRANSPARENT]->GetCommandBuffer())
+    if (LIGHTING_SUBPASS)
     {
-        vCmdBufs.push_back(cmdBuf);
+        m_pRenderGraph->AppendCommandBuffers(m_pShadowPassManager->GetShadowPass(), vCmdBufs);
+    }
+    m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_GBUFFER].get(), vCmdBufs);
+    if (bAsyncCompute)
+    {
+        // Depth is ready once the graphics submission is done
+        uint64_t nDepthReady = pDevice->SubmitCommandBuffers(vCmdBufs, VkRenderDevice::QUEUE_GRAPHICS);
+        vCmdBufs.clear();
+
+        // Submit compute tasks
+        m_pRenderGraph->AppendCommandBuffers(pLinearizeDepthPass, vCmdBufs);
+        uint64_t nComputeFinished = pDevice->SubmitCommandBuffers(vCmdBufs, VkRenderDevice::QUEUE_COMPUTE,
+                                                                  {pDevice->GetTimelineWait(VkRenderDevice::QUEUE_GRAPHICS, nDepthReady, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)});
+        vCmdBufs.clear();
+
+        // Shadow atlas doesn't depend on compute results, it has no command buffer when all maps are cached
+        if (!LIGHTING_SUBPASS)
+        {
+            m_pRenderGraph->AppendCommandBuffers(m_pShadowPassManager->GetShadowPass(), vCmdBufs);
+        }
+        if (!vCmdBufs.empty())
+        {
+            pDevice->SubmitCommandBuffers(vCmdBufs, VkRenderDevice::QUEUE_GRAPHICS);
+            vCmdBufs.clear();
+        }
+
+        // Linear depth and depth are handed back to graphics queue, lighting reconstructs positions from linear depth
+        vFinalWaits.push_back(pDevice->GetTimelineWait(VkRenderDevice::QUEUE_COMPUTE, nComputeFinished,
+                                                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                                           VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT));
+    }
+    else
+    {
+        // Compute queue is the graphics queue, compute passes are submitted in order
+        m_pRenderGraph->AppendCommandBuffers(pLinearizeDepthPass, vCmdBufs);
+        if (!LIGHTING_SUBPASS)
+        {
+            m_pRenderGraph->AppendCommandBuffers(m_pShadowPassManager->GetShadowPass(), vCmdBufs);
+        }
     }
 
-    vCmdBufs.clear();
-    // Submit compute tasks
-    vWaitForSemaphores.push_back(m_depthReady);
-    vWaitStages.push_back(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-    GetRenderDevice()->SubmitCommandBuffers(vCmdBufs, GetRenderDevice()->GetComputeQueue(), vWaitForSemaphores, vSignalSemaphores, vWaitStages);
+    m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_RSM_INDIRECT].get(), vCmdBufs);
+    // Nothing to append with lighting subpass
+    m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_OPAQUE_LIGHTING].get(), vCmdBufs);
 
-    vCmdBufs.clear();
-    vWaitForSemaphores.clear();
-    vSignalSemaphores.clear();
-    vWaitStages.clear();
+    // Submit other graphics tasks
+    m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_SKYBOX].get(), vCmdBufs);
+    m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_TRANSPARENT].get(), vCmdBufs);
 
-    // Submit UI pass
-    VkCommandBuffer uiCmdBuffer = m_vpRenderPasses[RENDERPASS_UI]->GetCommandBuffer();
-    if (uiCmdBuffer != VK_NULL_HANDLE)    // it's possible there's no UI to draw
-    {
-        vCmdBufs.push_back(m_vpRenderPasses[RENDERPASS_UI]->GetCommandBuffer());
-    }
+    // Submit UI pass, it's possible there's no UI to draw
+    m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_UI].get(), vCmdBufs);
     // Submit passes to swapchain
-    vCmdBufs.push_back(m_vpRenderPasses[RENDERPASS_FINAL]->GetCommandBuffer());
-
-    
-    vWaitForSemaphores.push_back(m_imageAvailable);
-    vWaitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-    vWaitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-    vSignalSemaphores.push_back(m_renderFinished);
-    GetRenderDevice()->SubmitCommandBuffers(vCmdBufs, GetRenderDevice()->GetComputeQueue(), vWaitForSemaphores, vSignalSemaphores, vWaitStages, m_aGPUExecutionFence[m_uImageIdx2Present]);
+    m_pRenderGraph->AppendCommandBuffers(m_vpRenderPasses[RENDERPASS_FINAL].get(), vCmdBufs);
+
+    vFinalWaits.push_back({m_aImageAvailable[m_nFrameIdx], 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT});
+    // Graphics queue waits for compute, so this value also covers compute work of the frame
+    m_aFrameTimelineValues[m_nFrameIdx] = pDevice->SubmitCommandBuffers(vCmdBufs, VkRenderDevice::QUEUE_GRAPHICS, vFinalWaits, {m_aRenderFinished[m_nFrameIdx]});
+    // Shadow maps re-rendered by the atlas command buffer can be reused from now on
+    m_pShadowPassManager->OnShadowMapsSubmitted();
 }
 
 }  // namespace Muyo
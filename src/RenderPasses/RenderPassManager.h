@@ -12,6 +12,7 @@
 namespace Muyo
 {
 class IRenderPass;
+class RenderGraph;
 class RayTracingSceneManager;
 class Camera;
 struct DrawLists;
@@ -25,7 +26,10 @@ enum RenderPassNames
     RENDERPASS_CUBEMAP_GENERATION,
     RENDERPASS_MESH_SHADER,
 
+    RENDERPASS_LIGHT_CULLING,
     RENDERPASS_GBUFFER,
+    RENDERPASS_LINEARIZE_DEPTH,  // Async compute
+    RENDERPASS_RSM_INDIRECT,
     RENDERPASS_OPAQUE_LIGHTING,
 
     RENDERPASS_SKYBOX,
@@ -47,9 +51,15 @@ public:
     void Present();
 
     void Initialize(uint32_t uWidth, uint32_t uHeight, const VkSurfaceKHR& swapchainSurface);
+    // Offscreen passes only, without swapchain, final and UI passes. Frames can't be submitted.
+    void InitializeHeadless(uint32_t uWidth, uint32_t uHeight);
+    bool IsHeadless() const { return m_pSwapchain == nullptr; }
     void OnResize(uint32_t uWidth, uint32_t uHeight);
     void Unintialize();
     void RecordStaticCmdBuffers(const DrawLists& drawLists);
+    // Headless only. Build the pipelines of every offscreen and UI pass, and every lighting permutation, without
+    // scene data or command buffers. Final pass needs a swapchain and ray tracing a built scene, they are skipped.
+    void PrecompilePipelines();
     void RecordDynamicCmdBuffers();
     void ReloadEnvironmentMap(const std::string& sNewEnvMapPath);
     VkExtent2D GetViewportSize() const { return VkExtent2D({m_uWidth, m_uHeight}); }
@@ -58,6 +68,22 @@ public:
 
     Camera* GetCamera() { return m_pCamera.get(); }
 
+    // Switch transparent pass between sorted alpha blending and weighted blended OIT, takes effect next submission
+    void SetOrderIndependentTransparency(bool bEnabled);
+    bool IsOrderIndependentTransparencyEnabled() const;
+
+    // Filter used for shadow map lookups in lighting, takes effect next frame. Changing the filter mode or tap count
+    // switches the lighting pipeline permutation, only the lighting command buffers are recorded again.
+    void SetShadowFilterSettings(const ShadowFilterSettings& settings);
+    const ShadowFilterSettings& GetShadowFilterSettings() const;
+
+    // GPU time of the opaque lighting pass, which contains the shadow filtering
+    float GetLightingGPUTimeMs() const;
+
+    // Accumulate RSM indirect lighting over frames while the camera is static
+    void SetRSMTemporalAccumulation(bool bEnabled);
+    bool IsRSMTemporalAccumulationEnabled() const;
+
 #ifdef FEATURE_RAY_TRACING
     void SetRayTracingSceneManager(const RayTracingSceneManager* pSceneManager)
     {
@@ -73,22 +99,48 @@ private:
 #endif
     const VkSurfaceFormatKHR SWAPCHAIN_FORMAT = {VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
     const VkPresentModeKHR PRESENT_MODE = VK_PRESENT_MODE_FIFO_KHR;
+    // Resolution divisor of RSM indirect lighting, 2 for half and 4 for quarter resolution
+    static const uint32_t RSM_INDIRECT_DOWNSCALE = 2;
+    // Opaque lighting as a subpass of the G-buffer pass, see RenderPassGBuffer
+#ifdef FEATURE_GBUFFER_SUBPASSES
+    static const bool LIGHTING_SUBPASS = true;
+#else
+    static const bool LIGHTING_SUBPASS = false;
+#endif
+
+    // Passes rendering to offscreen targets and the camera
+    void CreateOffscreenRenderPasses(uint32_t uWidth, uint32_t uHeight);
+
+    // Describe image accesses of the frame in render graph, must be done before passes are prepared
+    void SetupRenderGraph();
+
+    // Rebind the lighting pipeline permutation of the current shadow filter, the GPU must be done with the frame
+    void SwitchLightingPermutation();
 
     std::array<std::unique_ptr<IRenderPass>, RENDERPASS_COUNT> m_vpRenderPasses = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
     uint32_t m_uWidth = 0;
     uint32_t m_uHeight = 0;
     bool m_bIsIrradianceGenerated = false;
 
-    // Synchronization elements required in passes
-    VkSemaphore m_depthReady = VK_NULL_HANDLE;
-    VkSemaphore m_imageAvailable = VK_NULL_HANDLE;  // Semaphores to notify the frame when the current image is ready
-    VkSemaphore m_renderFinished = VK_NULL_HANDLE;
+    // Copy the frame's per view data, filter settings and sorted transparent draws into the buffers the static
+    // command buffers read, submitted first in the frame
+    void RecordFrameUpdateCmdBuffer();
+
+    // Synchronization elements required in passes, queues are synchronized with the device timelines. Swapchain
+    // only supports binary semaphores, each frame in flight has its own.
+    std::array<VkSemaphore, VkRenderDevice::FRAMES_IN_FLIGHT> m_aImageAvailable = {};  // Notify the frame when the current image is ready
+    std::array<VkSemaphore, VkRenderDevice::FRAMES_IN_FLIGHT> m_aRenderFinished = {};
 
-    std::array<VkFence, NUM_BUFFERS> m_aGPUExecutionFence;
+    // The CPU records up to FRAMES_IN_FLIGHT frames ahead of the GPU. Per frame resources of a slot are reused once
+    // the graphics timeline reaches the value of the frame that used the slot before.
+    std::array<uint64_t, VkRenderDevice::FRAMES_IN_FLIGHT> m_aFrameTimelineValues = {};
+    uint32_t m_nFrameIdx = 0;
+    std::array<VkCommandBuffer, VkRenderDevice::FRAMES_IN_FLIGHT> m_aFrameUpdateCmdBufs = {};
     uint32_t m_uImageIdx2Present = 0;
 
     std::unique_ptr<Swapchain> m_pSwapchain = nullptr;
     std::unique_ptr<Camera> m_pCamera = nullptr;
+    bool m_bIsLightingPermutationDirty = false;
 
 #ifdef FEATURE_RAY_TRACING
 
@@ -103,6 +155,7 @@ private:
     } m_temporalInfo;
 
     std::unique_ptr<ShadowPassManager> m_pShadowPassManager;
+    std::unique_ptr<RenderGraph> m_pRenderGraph;
 };
 
 RenderPassManager* GetRenderPassManager();
@@ -1,12 +1,15 @@
 #include "RenderPassOpaqueLighting.h"
 
 #include <algorithm>
+#include <array>
 
 #include "Camera.h"
 #include "MeshResourceManager.h"
 #include "MeshVertex.h"
 #include "PipelineStateBuilder.h"
 #include "RenderPassGBuffer.h"
+#include "RenderPassLinearizeDepth.h"
+#include "RenderPassRSMIndirect.h"
 #include "RenderResourceManager.h"
 #include "RenderResourceNames.h"
 #include "SamplerManager.h"
@@ -17,22 +20,75 @@ namespace Muyo
 
 void RenderPassOpaqueLighting::PrepareRenderPass()
 {
-    m_renderPassParameters.SetRenderArea(m_renderArea);
+    PrepareParameters(m_shadowPassManager.HasShadowMaps());
+
+    UpdateSpecializationConstants();
+    CreatePipelineAsync();
+    if (!IsSubpass())
+    {
+        CreateTimestampQueries();
+    }
+}
+
+void RenderPassOpaqueLighting::PrecompilePipelines()
+{
+    // Shadows add a descriptor set, the filter permutations are built against the layouts with and without it
+    for (const bool bShadows : {false, true})
+    {
+        PrepareParameters(bShadows);
+        for (uint32_t nMode = 0; nMode < SHADOW_FILTER_COUNT; nMode++)
+        {
+            for (uint32_t nTapCount : ShadowPassManager::TAP_COUNT_BUCKETS)
+            {
+                m_specializationConstants.SetBool(LIGHTING_CONSTANT_SHADOWS, bShadows)
+                    .SetUint(LIGHTING_CONSTANT_SHADOW_FILTER_MODE, nMode)
+                    .SetUint(LIGHTING_CONSTANT_SHADOW_FILTER_TAPS, nTapCount);
+                CreatePipeline();
+            }
+        }
+    }
+}
 
-    // opaque lighting output
-    const RenderTarget* pRenderTarget = GetRenderResourceManager()->GetRenderTarget(OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME, m_renderArea, VK_FORMAT_R16G16B16A16_SFLOAT);
-    m_renderPassParameters.AddAttachment(pRenderTarget, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+void RenderPassOpaqueLighting::PrepareParameters(bool bShadows)
+{
+    // Permutations were built against the layout and render pass being destroyed
+    m_pipelinePermutations.Destroy();
+    m_renderPassParameters.Reset();
+
+    m_renderPassParameters.SetRenderArea(m_renderArea);
 
     // Set 0: Camera UBO
-    const UniformBuffer<PerViewData>* perView = GetRenderResourceManager()->GetUniformBuffer<PerViewData>("perView");
+    const UniformBuffer<PerViewData>* perView = GetRenderResourceManager()->GetPerFrameUniformBuffer<PerViewData>("perView");
     m_renderPassParameters.AddParameter(perView, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
 
-    // Set 1: GBuffer textures
-    for (int i = 0; i < RenderPassGBuffer::COLOR_ATTACHMENT_COUNT; i++)
+    if (IsSubpass())
     {
-        const RenderPassGBuffer::GBufferAttachment& attachment = RenderPassGBuffer::attachments[i];
-        m_renderPassParameters.AddImageParameter(GetRenderResourceManager()->GetResource<ImageResource>(attachment.sName),
-                                                 VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
+        // Set 1: GBuffer and depth as input attachments, output is an attachment of the G-buffer pass
+        for (int i = 0; i < RenderPassGBuffer::ATTACHMENT_COUNT; i++)
+        {
+            const RenderPassGBuffer::GBufferAttachment& attachment = RenderPassGBuffer::attachments[i];
+            const VkImageLayout layout = i == RenderPassGBuffer::DEPTH ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            m_renderPassParameters.AddImageParameter(GetRenderResourceManager()->GetResource<ImageResource>(attachment.sName),
+                                                     VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT, layout, VK_NULL_HANDLE, 1);
+        }
+    }
+    else
+    {
+        // opaque lighting output
+        const RenderTarget* pRenderTarget = GetRenderResourceManager()->GetRenderTarget(OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME, m_renderArea, VK_FORMAT_R16G16B16A16_SFLOAT);
+        m_renderPassParameters.AddAttachment(pRenderTarget, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+
+        // Set 1: GBuffer textures
+        for (int i = 0; i < RenderPassGBuffer::COLOR_ATTACHMENT_COUNT; i++)
+        {
+            const RenderPassGBuffer::GBufferAttachment& attachment = RenderPassGBuffer::attachments[i];
+            m_renderPassParameters.AddImageParameter(GetRenderResourceManager()->GetResource<ImageResource>(attachment.sName),
+                                                     VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
+                                                     GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 1);
+        }
+        // Position is reconstructed from linear depth
+        m_renderPassParameters.AddImageParameter(GetRenderResourceManager()->GetResource<ImageResource>(RenderPassLinearizeDepth::OUTPUT_NAME),
+                                                 VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                                                  GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 1);
     }
 
@@ -50,45 +106,106 @@ void RenderPassOpaqueLighting::PrepareRenderPass()
     m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<UniformBuffer<uint32_t>>("light count"), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 3);
     const StorageBuffer<LightData>* lightDataStorageBuffer = GetRenderResourceManager()->GetResource<StorageBuffer<LightData>>("light data");
     m_renderPassParameters.AddParameter(lightDataStorageBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 3);
+    // Light lists of each cluster, built by the light culling pass
+    m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<StorageBuffer<glm::uvec2>>(LIGHT_CLUSTERS), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 3);
+    m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<StorageBuffer<uint32_t>>(CLUSTER_LIGHT_INDICES), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 3);
 
-    // Set 4: Shadows
+    // Set 4: Shadow atlas, shadow map tiles, filter settings and the RSM indirect lighting
+    if (bShadows)
+    {
+        // Depth is filtered with hardware comparison
+        const RSMResources rsm = m_shadowPassManager.GetShadowMaps();
+        m_renderPassParameters.AddImageParameter(rsm.pDepth, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_SHADOW_COMPARE), 4);
+        const StorageBuffer<glm::vec4>* pTileBuffer = GetRenderResourceManager()->GetResource<StorageBuffer<glm::vec4>>(ShadowPassManager::TILE_BUFFER_NAME);
+        m_renderPassParameters.AddParameter(pTileBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 4);
+        const UniformBuffer<ShadowFilterSettings>* pFilterSettings = GetRenderResourceManager()->GetResource<UniformBuffer<ShadowFilterSettings>>(ShadowPassManager::FILTER_SETTINGS_NAME);
+        m_renderPassParameters.AddParameter(pFilterSettings, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 4);
+
+        // Reduced resolution indirect lighting and its upsampling guide, written as storage images in general layout
+        for (const std::string& sName : {RenderPassRSMIndirect::OUTPUT_NAME, RenderPassRSMIndirect::GUIDE_NAME})
+        {
+            m_renderPassParameters.AddImageParameter(GetRenderResourceManager()->GetResource<ImageResource>(sName), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_GENERAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 4);
+        }
+    }
+    m_renderPassParameters.Finalize("Lighting");
+}
 
-    std::vector<RSMResources> vpShadowMaps = m_shadowPassManager.GetShadowMaps();
+void RenderPassOpaqueLighting::UpdateSpecializationConstants()
+{
+    const ShadowFilterSettings& filterSettings = m_shadowPassManager.GetFilterSettings();
+    m_specializationConstants.SetBool(LIGHTING_CONSTANT_SHADOWS, m_shadowPassManager.HasShadowMaps())
+        .SetUint(LIGHTING_CONSTANT_SHADOW_FILTER_MODE, filterSettings.nMode)
+        .SetUint(LIGHTING_CONSTANT_SHADOW_FILTER_TAPS, ShadowPassManager::GetTapCountBucket(filterSettings.nTapCount));
+}
 
-    if (vpShadowMaps.size() > 0)
+void RenderPassOpaqueLighting::SwitchPermutation()
+{
+    UpdateSpecializationConstants();
+    CreatePipelineAsync();
+    if (!IsSubpass())
     {
-        std::vector<const ImageResource*> vpDepthResources;
-        std::vector<const ImageResource*> vpNormalResources;
-        std::vector<const ImageResource*> vpPositionResources;
-        std::vector<const ImageResource*> vpFluxResources;
-        std::for_each(vpShadowMaps.begin(), vpShadowMaps.end(),
-                      [&vpDepthResources,
-                       &vpNormalResources,
-                       &vpPositionResources,
-                       &vpFluxResources](const RSMResources& rsmResources)
-                      {
-                          vpDepthResources.push_back(rsmResources.pDepth);
-                          vpNormalResources.push_back(rsmResources.pNormal);
-                          vpPositionResources.push_back(rsmResources.pPosition);
-                          vpFluxResources.push_back(rsmResources.pFlux);
-                      });
-
-        m_renderPassParameters.AddImageParameter(vpDepthResources, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 4);
-        m_renderPassParameters.AddImageParameter(vpNormalResources, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 4);
-        m_renderPassParameters.AddImageParameter(vpPositionResources, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 4);
-        m_renderPassParameters.AddImageParameter(vpFluxResources, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 4);
+        RecordCommandBuffers();
+        return;
     }
-    m_renderPassParameters.Finalize("Lighting");
 
-    CreatePipeline();
+    // Render pass and framebuffer are unchanged, the G-buffer pass records its primary command buffer again
+    WaitForPipelines();
+    RestartSecondaryCommandBuffer(m_subpassCommandBuffer, m_pGBufferPass->GetRenderPassParameters(), RenderPassGBuffer::LIGHTING_SUBPASS);
+    RecordDraw(m_subpassCommandBuffer);
+    vkEndCommandBuffer(m_subpassCommandBuffer);
+}
+
+void RenderPassOpaqueLighting::CreateTimestampQueries()
+{
+    if (m_queryPool != VK_NULL_HANDLE)
+    {
+        return;
+    }
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = TIMESTAMP_COUNT;
+    VK_ASSERT(vkCreateQueryPool(GetRenderDevice()->GetDevice(), &queryPoolInfo, nullptr, &m_queryPool));
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_queryPool), VK_OBJECT_TYPE_QUERY_POOL, "lighting pass timestamps");
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(GetRenderDevice()->GetPhysicalDevice(), &properties);
+    m_fTimestampPeriod = properties.limits.timestampPeriod;
+}
+
+float RenderPassOpaqueLighting::GetGPUTimeMs() const
+{
+    if (m_queryPool == VK_NULL_HANDLE)
+    {
+        return 0.0f;
+    }
+    // Queries of the last submitted frame, keep the previous value while they are not available
+    std::array<uint64_t, TIMESTAMP_COUNT> aTimestamps = {0, 0};
+    if (vkGetQueryPoolResults(GetRenderDevice()->GetDevice(), m_queryPool, 0, TIMESTAMP_COUNT, sizeof(aTimestamps), aTimestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+    {
+        m_fGPUTimeMs = static_cast<float>(aTimestamps[1] - aTimestamps[0]) * m_fTimestampPeriod * 1e-6f;
+    }
+    return m_fGPUTimeMs;
 }
 
 void RenderPassOpaqueLighting::CreatePipeline()
+{
+    m_pipeline = m_pipelinePermutations.GetOrCreatePipeline(m_specializationConstants, m_renderPassParameters.GetPipelineLayout(), GetTargetRenderPass(),
+                                                            [this](const VkSpecializationInfo* pSpecializationInfo)
+                                                            { return CreatePipelinePermutation(pSpecializationInfo); });
+}
+
+VkRenderPass RenderPassOpaqueLighting::GetTargetRenderPass() const
+{
+    return IsSubpass() ? m_pGBufferPass->GetRenderPassParameters().GetRenderPass() : m_renderPassParameters.GetRenderPass();
+}
+
+VkPipeline RenderPassOpaqueLighting::CreatePipelinePermutation(const VkSpecializationInfo* pSpecializationInfo)
 {
     VkPipelineLayout pipelineLayout = m_renderPassParameters.GetPipelineLayout();
 
-    VkShaderModule vertexShader = CreateShaderModule(ReadSpv("shaders/lighting.vert.spv"));
-    VkShaderModule fragShader = CreateShaderModule(ReadSpv("shaders/lighting.frag.spv"));
+    VkShaderModule vertexShader = GetShaderLibrary()->AcquireShaderModule("shaders/lighting.vert.spv");
+    VkShaderModule fragShader = GetShaderLibrary()->AcquireShaderModule(IsSubpass() ? "shaders/lightingSubpass.frag.spv" : "shaders/lighting.frag.spv");
 
     ViewportBuilder vpBuilder;
     VkViewport viewport = vpBuilder.setWH(m_renderArea).Build();
@@ -103,8 +220,12 @@ void RenderPassOpaqueLighting::CreatePipeline()
     blendBuilder.setAttachments(1, false);
     DepthStencilCIBuilder depthStencilBuilder;
     PipelineStateBuilder builder;
+    if (IsSubpass())
+    {
+        builder.setSubpassIndex(RenderPassGBuffer::LIGHTING_SUBPASS);
+    }
 
-    m_pipeline =
+    VkPipeline pipeline =
         builder.setShaderModules({vertexShader, fragShader})
             .setVertextInfo({Vertex::getBindingDescription()},
                             Vertex::getAttributeDescriptions())
@@ -115,18 +236,36 @@ void RenderPassOpaqueLighting::CreatePipeline()
             .setColorBlending(blendBuilder.Build())
             .setPipelineLayout(pipelineLayout)
             .setDepthStencil(depthStencilBuilder.setDepthTestEnabled(false).setDepthWriteEnabled(false).Build())
-            .setRenderPass(m_renderPassParameters.GetRenderPass())
+            .setRenderPass(GetTargetRenderPass())
+            .setSpecializationInfo(pSpecializationInfo)
             .Build(GetRenderDevice()->GetDevice());
 
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertexShader, nullptr);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShader, nullptr);
+    GetShaderLibrary()->ReleaseShaderModule(vertexShader);
+    GetShaderLibrary()->ReleaseShaderModule(fragShader);
 
     // Set debug name for the pipeline
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline), VK_OBJECT_TYPE_PIPELINE, "lighting pass");
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(pipeline), VK_OBJECT_TYPE_PIPELINE, "lighting pass");
+    return pipeline;
 }
 
 void RenderPassOpaqueLighting::RecordCommandBuffers()
 {
+    WaitForPipelines();
+
+    if (IsSubpass())
+    {
+        // Executed by the G-buffer pass after its geometry subpass
+        m_subpassCommandBuffer = BeginSecondaryCommandBuffer(0, m_pGBufferPass->GetRenderPassParameters(), RenderPassGBuffer::LIGHTING_SUBPASS);
+        RecordDraw(m_subpassCommandBuffer);
+        vkEndCommandBuffer(m_subpassCommandBuffer);
+        return;
+    }
+
+    if (m_commandBuffer != VK_NULL_HANDLE)
+    {
+        GetRenderDevice()->FreeStaticPrimaryCommandbuffer(m_commandBuffer);
+    }
+
     VkCommandBufferBeginInfo beginInfo = {};
 
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -137,6 +276,8 @@ void RenderPassOpaqueLighting::RecordCommandBuffers()
     vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
     {
         SCOPED_MARKER(m_commandBuffer, "Opaque lighting");
+        vkCmdResetQueryPool(m_commandBuffer, m_queryPool, 0, TIMESTAMP_COUNT);
+        vkCmdWriteTimestamp(m_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, 0);
 
         RenderPassBeginInfoBuilder builder;
 
@@ -148,37 +289,42 @@ void RenderPassOpaqueLighting::RecordCommandBuffers()
                 .setClearValues(clearValues)
                 .Build();
         vkCmdBeginRenderPass(m_commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        const Mesh& quadMesh = GetMeshResourceManager()->GetQuad();
-        const MeshVertexResources& meshVertexResources = GetMeshResourceManager()->GetMeshVertexResources();
-        VkDeviceSize offset = 0;
-        VkBuffer vertexBuffer = meshVertexResources.m_pVertexBuffer->buffer();
-        VkBuffer indexBuffer = meshVertexResources.m_pIndexBuffer->buffer();
-        uint32_t nIndexCount = quadMesh.m_nIndexCount;
-        uint32_t nIndexOffset = quadMesh.m_nIndexOffset;
-
-
-        std::vector<VkDescriptorSet> vDescSets = {
-            m_renderPassParameters.AllocateDescriptorSet("", 0),
-            m_renderPassParameters.AllocateDescriptorSet("", 1),
-            m_renderPassParameters.AllocateDescriptorSet("", 2),
-            m_renderPassParameters.AllocateDescriptorSet("", 3),
-            m_renderPassParameters.AllocateDescriptorSet("", 4)
-        };
-
-        vkCmdBindVertexBuffers(m_commandBuffer, 0, 1, &vertexBuffer,
-                               &offset);
-        vkCmdBindIndexBuffer(m_commandBuffer, indexBuffer, 0,
-                             VK_INDEX_TYPE_UINT32);
-        vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          m_pipeline);
-        vkCmdBindDescriptorSets(
-            m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-            m_renderPassParameters.GetPipelineLayout(), 0, vDescSets.size(),
-            vDescSets.data(), 0, nullptr);
-        vkCmdDrawIndexed(m_commandBuffer, nIndexCount, 1, nIndexOffset, 0, 0);
+        RecordDraw(m_commandBuffer);
         vkCmdEndRenderPass(m_commandBuffer);
+        vkCmdWriteTimestamp(m_commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, 1);
     }
     vkEndCommandBuffer(m_commandBuffer);
 }
+
+void RenderPassOpaqueLighting::RecordDraw(VkCommandBuffer cmdBuf)
+{
+    const Mesh& quadMesh = GetMeshResourceManager()->GetQuad();
+    const MeshVertexResources& meshVertexResources = GetMeshResourceManager()->GetMeshVertexResources();
+    VkDeviceSize offset = 0;
+    VkBuffer vertexBuffer = meshVertexResources.m_pVertexBuffer->buffer();
+    VkBuffer indexBuffer = meshVertexResources.m_pIndexBuffer->buffer();
+    uint32_t nIndexCount = quadMesh.m_nIndexCount;
+    uint32_t nIndexOffset = quadMesh.m_nIndexOffset;
+
+
+    std::vector<VkDescriptorSet> vDescSets = {
+        m_renderPassParameters.AllocateDescriptorSet("", 0),
+        m_renderPassParameters.AllocateDescriptorSet("", 1),
+        m_renderPassParameters.AllocateDescriptorSet("", 2),
+        m_renderPassParameters.AllocateDescriptorSet("", 3),
+        m_renderPassParameters.AllocateDescriptorSet("", 4)
+    };
+
+    vkCmdBindVertexBuffers(cmdBuf, 0, 1, &vertexBuffer,
+                           &offset);
+    vkCmdBindIndexBuffer(cmdBuf, indexBuffer, 0,
+                         VK_INDEX_TYPE_UINT32);
+    vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      m_pipeline);
+    vkCmdBindDescriptorSets(
+        cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        m_renderPassParameters.GetPipelineLayout(), 0, vDescSets.size(),
+        vDescSets.data(), 0, nullptr);
+    vkCmdDrawIndexed(cmdBuf, nIndexCount, 1, nIndexOffset, 0, 0);
+}
 }
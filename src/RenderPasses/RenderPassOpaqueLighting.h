@@ -1,33 +1,73 @@
 #pragma once
+#include "PipelinePermutationCache.h"
+#include "PipelineStateBuilder.h"
 #include "RenderPass.h"
 #include "ShadowPassManager.h"
 
 namespace Muyo
 {
+class RenderPassGBuffer;
 class RenderPassOpaqueLighting : public RenderPass
 {
     public:
-        RenderPassOpaqueLighting(const VkExtent2D renderArea, const ShadowPassManager& shadowPassManager) : m_renderArea(renderArea), m_shadowPassManager(shadowPassManager){};
+        // When the G-buffer pass has a lighting subpass, lighting is recorded into it instead of a render pass of its own
+        RenderPassOpaqueLighting(const VkExtent2D renderArea, const ShadowPassManager& shadowPassManager, const RenderPassGBuffer* pGBufferPass = nullptr)
+            : m_renderArea(renderArea), m_shadowPassManager(shadowPassManager), m_pGBufferPass(pGBufferPass){};
         ~RenderPassOpaqueLighting()
         {
-            vkDestroyPipeline(GetRenderDevice()->GetDevice(), m_pipeline, nullptr);
+            vkDestroyQueryPool(GetRenderDevice()->GetDevice(), m_queryPool, nullptr);
         }
 
         void PrepareRenderPass() override;
         void CreatePipeline() override;
 
+        // Build every shadow and filter permutation without recording, lights don't need to exist. The shadow
+        // atlas and RSM indirect passes must be prepared.
+        void PrecompilePipelines();
+
         void RecordCommandBuffers();
+        // Pick the pipeline permutation of the current shadow filter and record the lighting command buffers again,
+        // the GPU must be done with them. The subpass command buffer is re-recorded in place.
+        void SwitchPermutation();
 
         VkCommandBuffer GetCommandBuffer() const override
         {
             return m_commandBuffer;
         }
+        // Secondary command buffer executed in the lighting subpass of the G-buffer pass
+        VkCommandBuffer GetSubpassCommandBuffer() const { return m_subpassCommandBuffer; }
+
+        // GPU time of the lighting pass in the last finished frame, measured with timestamp queries. Not measured
+        // in a subpass, queries can't be reset inside the render pass.
+        float GetGPUTimeMs() const;
 
     private:
+        // Parameters with the shadow descriptor set when bShadows is set
+        void PrepareParameters(bool bShadows);
+        void CreateTimestampQueries();
+        void UpdateSpecializationConstants();
+        VkPipeline CreatePipelinePermutation(const VkSpecializationInfo* pSpecializationInfo);
+        void RecordDraw(VkCommandBuffer cmdBuf);
+        bool IsSubpass() const { return m_pGBufferPass != nullptr; }
+        // Render pass the pipelines are built against, the G-buffer pass owns it with a lighting subpass
+        VkRenderPass GetTargetRenderPass() const;
+
+        static constexpr uint32_t TIMESTAMP_COUNT = 2;  // Before and after the render pass
+
         VkExtent2D m_renderArea = {0, 0};
-        VkPipeline m_pipeline = VK_NULL_HANDLE;
+        VkPipeline m_pipeline = VK_NULL_HANDLE;  // Owned by the permutation cache
+        // Pipelines specialized by shadow state and filter, the current permutation is selected when the pass is
+        // prepared
+        PipelinePermutationCache m_pipelinePermutations;
+        SpecializationConstants m_specializationConstants;
         VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+        VkCommandBuffer m_subpassCommandBuffer = VK_NULL_HANDLE;
+
+        VkQueryPool m_queryPool = VK_NULL_HANDLE;
+        float m_fTimestampPeriod = 1.0f;  // Nanoseconds per timestamp tick
+        mutable float m_fGPUTimeMs = 0.0f;
 
         const ShadowPassManager& m_shadowPassManager;
+        const RenderPassGBuffer* m_pGBufferPass = nullptr;
 };
 }
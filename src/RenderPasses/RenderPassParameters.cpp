@@ -7,6 +7,54 @@
 namespace Muyo
 {
 
+// TODO: add more depth formats if we start to use them
+static bool IsDepthFormat(VkFormat format)
+{
+    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D32_SFLOAT;
+}
+
+RenderPassParameters::~RenderPassParameters()
+{
+    Reset();
+}
+
+void RenderPassParameters::Reset()
+{
+    for (size_t i = 0; i < m_vDescSetLayouts.size(); i++)
+    {
+        if (!IsExternalDescriptorSet(i))
+        {
+            // Cached sets of the layout are freed once submitted frames are done with them
+            GetDescriptorManager()->RetireDescriptorSets(m_vDescSetLayouts[i]);
+            vkDestroyDescriptorSetLayout(GetRenderDevice()->GetDevice(), m_vDescSetLayouts[i], nullptr);
+        }
+    }
+    vkDestroyPipelineLayout(GetRenderDevice()->GetDevice(), m_pipelineLayout, nullptr);
+    vkDestroyRenderPass(GetRenderDevice()->GetDevice(), m_renderPass, nullptr);
+    vkDestroyFramebuffer(GetRenderDevice()->GetDevice(), m_framebuffer, nullptr);
+
+    m_vWriteDescSet.clear();
+    m_vpResources.clear();
+    m_vDescriptorInfoIndex.clear();
+    m_vBindings.clear();
+    m_vAccelerationStructureWrites.clear();
+    m_vImageInfos.clear();
+    m_vBufferInfos.clear();
+    m_vPushConstantRanges.clear();
+    m_vDescSetLayouts.clear();
+    m_vExternalDescSets.clear();
+    m_vExternalDescSetLayouts.clear();
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_vAttachmentDescriptions.clear();
+    m_vSubpasses = std::vector<Subpass>(1);
+    m_vAttachmentResources.clear();
+    m_renderPass = VK_NULL_HANDLE;
+    m_nMultiviewMask = 0;
+    m_framebuffer = VK_NULL_HANDLE;
+    m_renderArea = {0, 0};
+    m_bIsFinalized = false;
+}
+
 void RenderPassParameters::AddParameter(const IRenderResource* pResource, VkDescriptorType type, VkShaderStageFlags stages, uint32_t nDescSetIdx)
 {
     AddBinding(type, 1, stages, nDescSetIdx);
@@ -131,6 +179,32 @@ void RenderPassParameters::AddBinding(VkDescriptorType type, uint32_t nCount, Vk
     m_vBindings[nDescSetIdx].push_back(bindingInfo);
 }
 
+void RenderPassParameters::AddExternalDescriptorSet(VkDescriptorSetLayout layout, VkDescriptorSet descriptorSet, uint32_t nDescSetIdx)
+{
+    // Keep the per set arrays aligned, the external set has no bindings or writes of its own
+    if (m_vBindings.size() <= nDescSetIdx)
+    {
+        m_vBindings.resize(nDescSetIdx + 1);
+    }
+    if (m_vWriteDescSet.size() <= nDescSetIdx)
+    {
+        m_vWriteDescSet.resize(nDescSetIdx + 1);
+        m_vpResources.resize(nDescSetIdx + 1);
+    }
+    if (m_vDescriptorInfoIndex.size() <= nDescSetIdx)
+    {
+        m_vDescriptorInfoIndex.resize(nDescSetIdx + 1);
+    }
+    if (m_vExternalDescSets.size() <= nDescSetIdx)
+    {
+        m_vExternalDescSets.resize(nDescSetIdx + 1, VK_NULL_HANDLE);
+        m_vExternalDescSetLayouts.resize(nDescSetIdx + 1, VK_NULL_HANDLE);
+    }
+    assert(m_vBindings[nDescSetIdx].empty() && "Parameters were added to an external descriptor set");
+    m_vExternalDescSets[nDescSetIdx] = descriptorSet;
+    m_vExternalDescSetLayouts[nDescSetIdx] = layout;
+}
+
 const VkDescriptorSetLayout& RenderPassParameters::GetDescriptorSetLayout(uint32_t nDescSetIdx) const
 {
     return m_vDescSetLayouts[nDescSetIdx];
@@ -138,8 +212,14 @@ const VkDescriptorSetLayout& RenderPassParameters::GetDescriptorSetLayout(uint32
 
 void RenderPassParameters::CreateDescriptorSetLayout()
 {
-    std::for_each(m_vBindings.begin(), m_vBindings.end(), [this](const std::vector<VkDescriptorSetLayoutBinding>& vBindings)
-                  {
+    for (size_t i = 0; i < m_vBindings.size(); i++)
+    {
+        if (IsExternalDescriptorSet(i))
+        {
+            m_vDescSetLayouts.push_back(m_vExternalDescSetLayouts[i]);
+            continue;
+        }
+        const std::vector<VkDescriptorSetLayoutBinding>& vBindings = m_vBindings[i];
         VkDescriptorSetLayoutCreateInfo layoutInfo = {};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         layoutInfo.pBindings = vBindings.data();
@@ -147,48 +227,103 @@ void RenderPassParameters::CreateDescriptorSetLayout()
 
         VkDescriptorSetLayout layout;
         VK_ASSERT(vkCreateDescriptorSetLayout(GetRenderDevice()->GetDevice(), &layoutInfo, nullptr, &layout));
-        m_vDescSetLayouts.push_back(layout); });
+        m_vDescSetLayouts.push_back(layout);
+    }
 }
 
 VkDescriptorSet RenderPassParameters::AllocateDescriptorSet(const std::string& sDescSetName, uint32_t nDescSetIdx)
 {
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-    // Create descriptor sets
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = GetDescriptorManager()->GetDescriptorPool();
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &m_vDescSetLayouts[nDescSetIdx];
-    VK_ASSERT(vkAllocateDescriptorSets(GetRenderDevice()->GetDevice(), &allocInfo, &descriptorSet));
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(descriptorSet), VK_OBJECT_TYPE_DESCRIPTOR_SET, sDescSetName.c_str());
+    if (IsExternalDescriptorSet(nDescSetIdx))
+    {
+        return m_vExternalDescSets[nDescSetIdx];
+    }
+    return GetOrAllocateDescriptorSet(sDescSetName, m_vpResources[nDescSetIdx], nDescSetIdx);
+}
+
+VkDescriptorSet RenderPassParameters::AllocateDescriptorSet(const std::string& sDescSetName, const std::vector<const IRenderResource*>& vpResources, uint32_t nDescSetIdx)
+{
+    assert(!IsExternalDescriptorSet(nDescSetIdx) && "External descriptor sets are updated by their owner");
+    VkDescriptorSet descriptorSet = GetOrAllocateDescriptorSet(sDescSetName, vpResources, nDescSetIdx);
 
-    bool bUpdated = UpdateDescriptorSet(m_vpResources[nDescSetIdx], nDescSetIdx, descriptorSet);
-    assert(bUpdated);
+    // Update resource array
+    m_vpResources[nDescSetIdx] = vpResources;
 
     return descriptorSet;
 }
 
-VkDescriptorSet RenderPassParameters::AllocateDescriptorSet(const std::string& sDescSetName, const std::vector<const IRenderResource*>& vpResources, uint32_t nDescSetIdx)
+VkDescriptorSet RenderPassParameters::GetOrAllocateDescriptorSet(const std::string& sDescSetName, const std::vector<const IRenderResource*>& vpResources, uint32_t nDescSetIdx)
 {
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-    // Create descriptor sets
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = GetDescriptorManager()->GetDescriptorPool();
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &m_vDescSetLayouts[nDescSetIdx];
-    VK_ASSERT(vkAllocateDescriptorSets(GetRenderDevice()->GetDevice(), &allocInfo, &descriptorSet));
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(descriptorSet), VK_OBJECT_TYPE_DESCRIPTOR_SET, sDescSetName.c_str());
+    const bool bResolved = ResolveDescriptorWrites(vpResources, nDescSetIdx);
+    assert(bResolved);
 
-    bool bUpdated = UpdateDescriptorSet(vpResources, nDescSetIdx, descriptorSet);
-    assert(bUpdated);
+    DescriptorSetKey key;
+    if (bResolved)
+    {
+        key = MakeDescriptorSetKey(vpResources, nDescSetIdx);
+        VkDescriptorSet cachedSet = GetDescriptorManager()->GetCachedDescriptorSet(key);
+        if (cachedSet != VK_NULL_HANDLE)
+        {
+            return cachedSet;
+        }
+    }
 
-    // Update resource array
-    m_vpResources[nDescSetIdx] = vpResources;
+    VkDescriptorSet descriptorSet = GetDescriptorManager()->AllocatePersistentDescriptorSet(m_vDescSetLayouts[nDescSetIdx]);
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(descriptorSet), VK_OBJECT_TYPE_DESCRIPTOR_SET, sDescSetName.c_str());
+
+    // Sets with missing resources are neither written nor cached
+    if (bResolved)
+    {
+        std::vector<VkWriteDescriptorSet>& vWriteDescriptorSets = m_vWriteDescSet[nDescSetIdx];
+        for (VkWriteDescriptorSet& writeDescSet : vWriteDescriptorSets)
+        {
+            writeDescSet.dstSet = descriptorSet;
+        }
+        vkUpdateDescriptorSets(GetRenderDevice()->GetDevice(), vWriteDescriptorSets.size(), vWriteDescriptorSets.data(), 0, nullptr);
+        GetDescriptorManager()->AddCachedDescriptorSet(key, descriptorSet);
+    }
 
     return descriptorSet;
 }
 
+DescriptorSetKey RenderPassParameters::MakeDescriptorSetKey(const std::vector<const IRenderResource*>& vpResources, uint32_t nDescSetIdx) const
+{
+    DescriptorSetKey key;
+    key.layout = m_vDescSetLayouts[nDescSetIdx];
+
+    // Resource ids tell apart resources whose handles were reused, the resolved descriptors cover the rest
+    for (const IRenderResource* pResource : vpResources)
+    {
+        key.vDescriptors.push_back(pResource->GetResourceId());
+    }
+    const std::vector<VkWriteDescriptorSet>& vWriteDescriptorSets = m_vWriteDescSet[nDescSetIdx];
+    const std::vector<size_t>& vDescriptorInfoIndex = m_vDescriptorInfoIndex[nDescSetIdx];
+    for (size_t i = 0; i < vWriteDescriptorSets.size(); ++i)
+    {
+        const VkWriteDescriptorSet& writeDescSet = vWriteDescriptorSets[i];
+        if (writeDescSet.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || writeDescSet.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        {
+            const VkDescriptorBufferInfo& bufferInfo = m_vBufferInfos[vDescriptorInfoIndex[i]];
+            key.vDescriptors.push_back(reinterpret_cast<uint64_t>(bufferInfo.buffer));
+            key.vDescriptors.push_back(bufferInfo.range);
+        }
+        else if (writeDescSet.descriptorType == VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR)
+        {
+            key.vDescriptors.push_back(reinterpret_cast<uint64_t>(*m_vAccelerationStructureWrites[vDescriptorInfoIndex[i]].pAccelerationStructures));
+        }
+        else
+        {
+            for (uint32_t descIdx = 0; descIdx < writeDescSet.descriptorCount; ++descIdx)
+            {
+                const VkDescriptorImageInfo& imageInfo = m_vImageInfos[vDescriptorInfoIndex[i] + descIdx];
+                key.vDescriptors.push_back(reinterpret_cast<uint64_t>(imageInfo.imageView));
+                key.vDescriptors.push_back(reinterpret_cast<uint64_t>(imageInfo.sampler));
+                key.vDescriptors.push_back(imageInfo.imageLayout);
+            }
+        }
+    }
+    return key;
+}
+
 std::vector<VkDescriptorSet> RenderPassParameters::AllocateDescriptorSets()
 {
     std::vector<VkDescriptorSet> vkDescSets;
@@ -200,7 +335,7 @@ std::vector<VkDescriptorSet> RenderPassParameters::AllocateDescriptorSets()
     return vkDescSets;
 }
 
-bool RenderPassParameters::UpdateDescriptorSet(const std::vector<const IRenderResource*>& vpResources, uint32_t nDescSetIdx, VkDescriptorSet descriptorSet)
+bool RenderPassParameters::ResolveDescriptorWrites(const std::vector<const IRenderResource*>& vpResources, uint32_t nDescSetIdx)
 {
     std::vector<VkWriteDescriptorSet>& vWriteDescriptorSets = m_vWriteDescSet[nDescSetIdx];
     std::vector<size_t>& vDescriptorInfoIndex = m_vDescriptorInfoIndex[nDescSetIdx];
@@ -211,7 +346,6 @@ bool RenderPassParameters::UpdateDescriptorSet(const std::vector<const IRenderRe
     for (size_t i = 0; i < vWriteDescriptorSets.size(); ++i)
     {
         VkWriteDescriptorSet& writeDescSet = vWriteDescriptorSets[i];
-        writeDescSet.dstSet = descriptorSet;
         // Resolve write descriptor set info
         if (writeDescSet.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || writeDescSet.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
         {
@@ -230,7 +364,8 @@ bool RenderPassParameters::UpdateDescriptorSet(const std::vector<const IRenderRe
             }
             writeDescSet.pBufferInfo = &m_vBufferInfos[vDescriptorInfoIndex[i]];
         }
-        else if (writeDescSet.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || writeDescSet.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+        else if (writeDescSet.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || writeDescSet.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+                 writeDescSet.descriptorType == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT)
         {
             for (uint32_t descIdx = 0; descIdx < writeDescSet.descriptorCount; ++descIdx)
             {
@@ -264,10 +399,6 @@ bool RenderPassParameters::UpdateDescriptorSet(const std::vector<const IRenderRe
             assert(false && u8"Unhandled descriptor type");
         }
     }
-    if (bShouldExeUpdate)
-    {
-        vkUpdateDescriptorSets(GetRenderDevice()->GetDevice(), vWriteDescriptorSets.size(), vWriteDescriptorSets.data(), 0, nullptr);
-    }
     return bShouldExeUpdate;
 }
 
@@ -279,7 +410,9 @@ void RenderPassParameters::AddAttachment(const ImageResource* pResource, VkImage
     attachmentDesc.format = format;
     attachmentDesc.samples = VK_SAMPLE_COUNT_1_BIT;
     attachmentDesc.loadOp = bClearAttachment ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
-    attachmentDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    // Transient attachments only live within the render pass, they can stay in tile memory
+    const bool bIsTransient = (pResource->GetImageUsage() & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+    attachmentDesc.storeOp = bIsTransient ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
     attachmentDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachmentDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     attachmentDesc.initialLayout = initialLayout;
@@ -289,24 +422,39 @@ void RenderPassParameters::AddAttachment(const ImageResource* pResource, VkImage
 
     // Create attachment reference
     VkAttachmentReference attachmentRef = {};
-    // check if format is depth format
-    // TODO: add more depth foramts if we start to use them
     attachmentRef.attachment = (uint32_t)m_vAttachmentDescriptions.size() - 1;
-    if (format == VK_FORMAT_D32_SFLOAT_S8_UINT | format == VK_FORMAT_D32_SFLOAT)
+    Subpass& subpass = m_vSubpasses.back();
+    if (IsDepthFormat(format))
     {
         attachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-        m_depthAttachmentReference = attachmentRef;
-        assert(m_depthAttachmentReference.attachment != VK_ATTACHMENT_UNUSED);
+        subpass.depthAttachmentReference = attachmentRef;
+        assert(subpass.depthAttachmentReference.attachment != VK_ATTACHMENT_UNUSED);
     }
     else
     {
         attachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-        m_vColorAttachmentReferences.push_back(attachmentRef);
+        subpass.vColorAttachmentReferences.push_back(attachmentRef);
     }
 
     m_vAttachmentResources.push_back(pResource);
 }
 
+void RenderPassParameters::NextSubpass()
+{
+    m_vSubpasses.emplace_back();
+}
+
+void RenderPassParameters::AddSubpassInput(const ImageResource* pResource)
+{
+    auto it = std::find(m_vAttachmentResources.begin(), m_vAttachmentResources.end(), pResource);
+    assert(it != m_vAttachmentResources.end() && "Subpass input must be an attachment of the render pass");
+
+    VkAttachmentReference attachmentRef = {};
+    attachmentRef.attachment = static_cast<uint32_t>(it - m_vAttachmentResources.begin());
+    attachmentRef.layout = IsDepthFormat(pResource->GetImageFormat()) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    m_vSubpasses.back().vInputAttachmentReferences.push_back(attachmentRef);
+}
+
 void RenderPassParameters::CreatePipelineLayout()
 {
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
@@ -325,19 +473,27 @@ void RenderPassParameters::CreatePipelineLayout()
 
 void RenderPassParameters::CreateRenderPass()
 {
-        // Subpass
-    VkSubpassDescription subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = (uint32_t)m_vColorAttachmentReferences.size();
-    subpass.pColorAttachments = m_vColorAttachmentReferences.data();
-
-    subpass.pDepthStencilAttachment = &m_depthAttachmentReference;
-    if (m_depthAttachmentReference.attachment == VK_ATTACHMENT_UNUSED)
+    // Subpasses
+    std::vector<VkSubpassDescription> vSubpassDescs(m_vSubpasses.size());
+    for (size_t i = 0; i < m_vSubpasses.size(); i++)
     {
-        subpass.pDepthStencilAttachment = nullptr;
+        const Subpass& subpass = m_vSubpasses[i];
+        VkSubpassDescription& subpassDesc = vSubpassDescs[i];
+        subpassDesc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpassDesc.colorAttachmentCount = (uint32_t)subpass.vColorAttachmentReferences.size();
+        subpassDesc.pColorAttachments = subpass.vColorAttachmentReferences.data();
+        subpassDesc.inputAttachmentCount = (uint32_t)subpass.vInputAttachmentReferences.size();
+        subpassDesc.pInputAttachments = subpass.vInputAttachmentReferences.data();
+
+        subpassDesc.pDepthStencilAttachment = &subpass.depthAttachmentReference;
+        if (subpass.depthAttachmentReference.attachment == VK_ATTACHMENT_UNUSED)
+        {
+            subpassDesc.pDepthStencilAttachment = nullptr;
+        }
     }
 
-    // Subpass dependency
+    // Subpass dependencies
+    std::vector<VkSubpassDependency> vSubpassDeps;
     VkSubpassDependency subpassDep = {};
     subpassDep.srcSubpass = VK_SUBPASS_EXTERNAL;
     subpassDep.dstSubpass = 0;
@@ -346,28 +502,38 @@ void RenderPassParameters::CreateRenderPass()
     subpassDep.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     subpassDep.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
                                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    vSubpassDeps.push_back(subpassDep);
 
-    VkRenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &subpassDep;
+    // Each subpass reads the attachments written by the previous ones at the same pixel
+    for (uint32_t i = 1; i < m_vSubpasses.size(); i++)
+    {
+        subpassDep.srcSubpass = i - 1;
+        subpassDep.dstSubpass = i;
+        subpassDep.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDep.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDep.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        subpassDep.dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        subpassDep.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+        vSubpassDeps.push_back(subpassDep);
+    }
 
+    VkRenderPassCreateInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     renderPassInfo.attachmentCount = static_cast<uint32_t>(m_vAttachmentDescriptions.size());
     renderPassInfo.pAttachments = m_vAttachmentDescriptions.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &subpassDep;
+    renderPassInfo.subpassCount = static_cast<uint32_t>(vSubpassDescs.size());
+    renderPassInfo.pSubpasses = vSubpassDescs.data();
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(vSubpassDeps.size());
+    renderPassInfo.pDependencies = vSubpassDeps.data();
 
-    // Multiview structure
+    // Multiview structure, all subpasses render the same views
     VkRenderPassMultiviewCreateInfo multiViewCI = {};
+    std::vector<uint32_t> vViewMasks(m_vSubpasses.size(), m_nMultiviewMask);
     if (m_nMultiviewMask != 0)
     {
         multiViewCI.sType        = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
-        multiViewCI.subpassCount = 1;
-        multiViewCI.pViewMasks   = &m_nMultiviewMask;
+        multiViewCI.subpassCount = static_cast<uint32_t>(vViewMasks.size());
+        multiViewCI.pViewMasks   = vViewMasks.data();
         renderPassInfo.pNext = &multiViewCI;
     }
 
@@ -13,34 +13,44 @@ namespace Muyo
  *
  *         Descriptor create info and update writes will be created. As well as resource infos required .
  *
- *      b. Call AddAttachment to setup render pass outputs.
+ *      b. Call AddAttachment to setup render pass outputs. For more than one subpass, call NextSubpass and add
+ *         the attachments of the next subpass, AddSubpassInput reads an attachment of an earlier subpass.
  *
  *      c. Call finalize to create renderpass
  *
  *      d. Allocate descriptor set when using the resources in the pass.
+ *
+ * 2. Preparing the pass again, e.g. after a resize, starts with Reset. It destroys the created objects and drops the
+ *    parameters, the GPU must be done with them.
  */
 
 class IRenderResource;
 class ImageResource;
+struct DescriptorSetKey;
 
 class RenderPassParameters
 {
 public:
-    ~RenderPassParameters()
-    {
-        std::for_each(m_vDescSetLayouts.begin(), m_vDescSetLayouts.end(), [](VkDescriptorSetLayout layout)
-                      { vkDestroyDescriptorSetLayout(GetRenderDevice()->GetDevice(), layout, nullptr); });
-        vkDestroyPipelineLayout(GetRenderDevice()->GetDevice(), m_pipelineLayout, nullptr);
-        vkDestroyRenderPass(GetRenderDevice()->GetDevice(), m_renderPass, nullptr);
-        vkDestroyFramebuffer(GetRenderDevice()->GetDevice(), m_framebuffer, nullptr);
-    }
+    ~RenderPassParameters();
+    void Reset();
     void AddParameter(const IRenderResource* pResource, VkDescriptorType type, VkShaderStageFlags stages, uint32_t nDescSetIdx = 0);
     void AddImageParameter(const ImageResource* pResource, VkDescriptorType type, VkShaderStageFlags stages, VkImageLayout imageLayout, VkSampler sampler = VK_NULL_HANDLE, uint32_t nDescSetIdx = 0);
     void AddImageParameter(std::vector<const ImageResource*>& vpResource, VkDescriptorType type, VkShaderStageFlags stages, VkImageLayout imageLayout, VkSampler sampler = VK_NULL_HANDLE, uint32_t nDescSetIdx = 0);
 
-    // Color and depth outputs
+    // Use a descriptor set owned elsewhere, e.g. the bindless heap, at nDescSetIdx. The set is bound as is and no
+    // parameters can be added to it.
+    void AddExternalDescriptorSet(VkDescriptorSetLayout layout, VkDescriptorSet descriptorSet, uint32_t nDescSetIdx);
+
+    // Color and depth outputs of the current subpass. Content of transient attachments isn't stored.
     void AddAttachment(const ImageResource* pResource, VkImageLayout initialLayout, VkImageLayout finalLayout, bool bClearAttachment);
 
+    // Start the next subpass, it depends on the previous one
+    void NextSubpass();
+    // Attachment written by an earlier subpass and read as input attachment in the current one, in the order of
+    // input_attachment_index. The descriptor is added separately with VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT.
+    void AddSubpassInput(const ImageResource* pResource);
+    uint32_t GetSubpassCount() const { return static_cast<uint32_t>(m_vSubpasses.size()); }
+
     template <class T>
     void AddPushConstantParameter(VkShaderStageFlags stages = VK_SHADER_STAGE_ALL)
     {
@@ -73,15 +83,22 @@ public:
     void AddImageDescriptorWrite(const std::vector<const ImageResource*> vpResources, VkDescriptorType type, VkImageLayout imageLayout, VkSampler sampler, uint32_t nDescSetIdx);  // Use a single sampler for all image resources for now
     void AddDescriptorWrite(const IRenderResource* pResource, VkDescriptorType type, uint32_t nDescSetIdx);
 
+    bool IsExternalDescriptorSet(size_t nDescSetIdx) const
+    {
+        return nDescSetIdx < m_vExternalDescSets.size() && m_vExternalDescSets[nDescSetIdx] != VK_NULL_HANDLE;
+    }
     void CreateDescriptorSetLayout();
     void CreatePipelineLayout();
     void CreateRenderPass();
     void CreateFrameBuffer();
 
-    /** Update descriptor with resources at nDescSetIdx
-     * return true if descriptor update is executed
+    /** Fill the descriptor writes at nDescSetIdx with resources
+     * return false if any of the resources isn't ready
      */
-    bool UpdateDescriptorSet(const std::vector<const IRenderResource*>& vpResources, uint32_t nDescSetIdx, VkDescriptorSet descriptorSet);
+    bool ResolveDescriptorWrites(const std::vector<const IRenderResource*>& vpResources, uint32_t nDescSetIdx);
+    DescriptorSetKey MakeDescriptorSetKey(const std::vector<const IRenderResource*>& vpResources, uint32_t nDescSetIdx) const;
+    // Sets are cached by the descriptor manager, identical bindings share a set
+    VkDescriptorSet GetOrAllocateDescriptorSet(const std::string& sDescSetName, const std::vector<const IRenderResource*>& vpResources, uint32_t nDescSetIdx);
 
 private:
     // [DescSetIndex][BindingIndex]
@@ -106,13 +123,21 @@ private:
 
     // [DescSetIndex]
     std::vector<VkDescriptorSetLayout> m_vDescSetLayouts;
+    // [DescSetIndex], VK_NULL_HANDLE for sets allocated by the pass
+    std::vector<VkDescriptorSet> m_vExternalDescSets;
+    std::vector<VkDescriptorSetLayout> m_vExternalDescSetLayouts;
 
     VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
 
     // Framebuffer related
+    struct Subpass
+    {
+        std::vector<VkAttachmentReference> vColorAttachmentReferences;
+        std::vector<VkAttachmentReference> vInputAttachmentReferences;
+        VkAttachmentReference depthAttachmentReference = {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED};
+    };
     std::vector<VkAttachmentDescription> m_vAttachmentDescriptions;
-    std::vector<VkAttachmentReference> m_vColorAttachmentReferences;
-    VkAttachmentReference m_depthAttachmentReference = {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED};
+    std::vector<Subpass> m_vSubpasses = std::vector<Subpass>(1);
     std::vector<const ImageResource*> m_vAttachmentResources;
     VkRenderPass m_renderPass = VK_NULL_HANDLE;
     uint32_t m_nMultiviewMask = 0;
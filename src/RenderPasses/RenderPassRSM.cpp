@@ -1,6 +1,9 @@
 #include "RenderPassRSM.h"
 
+#include <array>
+
 #include "Camera.h"
+#include "Debug.h"
 #include "DescriptorManager.h"
 #include "Geometry.h"
 #include "MeshResourceManager.h"
@@ -23,67 +26,108 @@ RenderPassRSM::~RenderPassRSM()
     }
 }
 
+const std::array<std::string, 4>& RenderPassRSM::GetRSMNames()
+{
+    static const std::array<std::string, 4> aRSMNames = {
+        "ShadowAtlas_depth",
+        "ShadowAtlas_normal",
+        "ShadowAtlas_position",
+        "ShadowAtlas_flux",
+    };
+    return aRSMNames;
+}
+
 void RenderPassRSM::PrepareRenderPass()
 {
-    m_renderPassParameters.SetRenderArea(m_shadowMapSize);
+    m_renderPassParameters.Reset();
+
+    m_renderPassParameters.SetRenderArea(m_atlasSize);
+    const auto& aRSMNames = GetRSMNames();
 
+    // Atlases keep the tiles that are not re-rendered, attachments are loaded and left in shader read layout
     // Depth attachments
-    RenderTarget* shadowMap = GetRenderResourceManager()->GetDepthTarget(m_aRSMNames[SHADOW_MAP_DEPTH], m_shadowMapSize);
-    m_renderPassParameters.AddAttachment(shadowMap, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true);
+    RenderTarget* shadowMap = GetRenderResourceManager()->GetDepthTarget(aRSMNames[SHADOW_MAP_DEPTH], m_atlasSize, DEPTH_FORMAT);
+    m_renderPassParameters.AddAttachment(shadowMap, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
 
     // Shadow Normal
-    RenderTarget* shadowNormal = GetRenderResourceManager()->GetColorTarget(m_aRSMNames[SHADOW_MAP_NORMAL], m_shadowMapSize);
-    m_renderPassParameters.AddAttachment(shadowNormal, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true);
+    RenderTarget* shadowNormal = GetRenderResourceManager()->GetColorTarget(aRSMNames[SHADOW_MAP_NORMAL], m_atlasSize, COLOR_FORMAT);
+    m_renderPassParameters.AddAttachment(shadowNormal, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
 
     // Shadow position
-    RenderTarget* shadowPosition = GetRenderResourceManager()->GetColorTarget(m_aRSMNames[SHADOW_MAP_POSITION], m_shadowMapSize);
-    m_renderPassParameters.AddAttachment(shadowPosition, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true);
+    RenderTarget* shadowPosition = GetRenderResourceManager()->GetColorTarget(aRSMNames[SHADOW_MAP_POSITION], m_atlasSize, COLOR_FORMAT);
+    m_renderPassParameters.AddAttachment(shadowPosition, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
 
     // Shadow flux
-    RenderTarget* shadowFlux = GetRenderResourceManager()->GetColorTarget(m_aRSMNames[SHADOW_MAP_FLUX], m_shadowMapSize);
-    m_renderPassParameters.AddAttachment(shadowFlux, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true);
+    RenderTarget* shadowFlux = GetRenderResourceManager()->GetColorTarget(aRSMNames[SHADOW_MAP_FLUX], m_atlasSize, COLOR_FORMAT);
+    m_renderPassParameters.AddAttachment(shadowFlux, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+
+    if (!m_bIsAtlasInitialized)
+    {
+        InitializeAtlasLayouts();
+        m_bIsAtlasInitialized = true;
+    }
 
     // Set0, Binding 0
     const StorageBuffer<LightData>* lightDataStorageBuffer = GetRenderResourceManager()->GetResource<StorageBuffer<LightData>>("light data");
     m_renderPassParameters.AddParameter(lightDataStorageBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
 
-    // Set 1, Binding 0
-    // All textures
-    const auto& vpUniquePtrTextures = GetTextureResourceManager()->GetTextures();
-    std::vector<const ImageResource*> vpTextures;
-    vpTextures.reserve(vpUniquePtrTextures.size());
-    for (const auto& pTexture : vpUniquePtrTextures)
-    {
-        vpTextures.push_back(pTexture.get());
-    }
-    m_renderPassParameters.AddImageParameter(vpTextures, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 1);
-
-    // Set 1, Binding 1
-    const auto* materialBuffer = GetMaterialManager()->GetMaterialBuffer();
-    m_renderPassParameters.AddParameter(materialBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1);
+    // Set 1, bindless samplers, materials and textures
+    m_renderPassParameters.AddExternalDescriptorSet(GetDescriptorManager()->getDescriptorLayout(DESCRIPTOR_LAYOUT_BINDLESS), GetDescriptorManager()->GetBindlessDescriptorSet(), 1);
 
     // Set 2, binding 0 PerObjData
     m_renderPassParameters.AddParameter(GetPerObjResourceManager()->GetPerObjResource(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 2);
     // Push constants for light index
     m_renderPassParameters.AddPushConstantParameter<PushConstant>(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
 
-    m_renderPassParameters.Finalize("Render pass shadow");
+    m_renderPassParameters.Finalize("Render pass shadow atlas");
 
-    CreatePipeline();
+    CreatePipelineAsync();
+}
+
+void RenderPassRSM::InitializeAtlasLayouts()
+{
+    const RSMResources rsm = GetRSM();
+    std::vector<VkImageMemoryBarrier> vBarriers;
+    for (const RenderTarget* pAtlas : {rsm.pDepth, rsm.pNormal, rsm.pPosition, rsm.pFlux})
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = pAtlas->getImage();
+        barrier.subresourceRange.aspectMask = pAtlas->GetImageFormat() == DEPTH_FORMAT ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        vBarriers.push_back(barrier);
+    }
+    GetRenderDevice()->ExecuteImmediateCommand(
+        [&vBarriers](VkCommandBuffer commandBuffer)
+        {
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(vBarriers.size()), vBarriers.data());
+        });
 }
 
 void RenderPassRSM::CreatePipeline()
 {
     VkPipelineLayout pipelineLayout = m_renderPassParameters.GetPipelineLayout();
 
-    VkShaderModule vertexShader = CreateShaderModule(ReadSpv("shaders/shadow.vert.spv"));
-    VkShaderModule fragShader = CreateShaderModule(ReadSpv("shaders/shadow.frag.spv"));
+    VkShaderModule vertexShader = GetShaderLibrary()->AcquireShaderModule("shaders/shadow.vert.spv");
+    VkShaderModule fragShader = GetShaderLibrary()->AcquireShaderModule("shaders/shadow.frag.spv");
 
+    // Viewport and scissor are set to the tile of each light
     ViewportBuilder vpBuilder;
-    VkViewport viewport = vpBuilder.setWH(m_shadowMapSize).Build();
+    VkViewport viewport = vpBuilder.setWH(m_atlasSize).Build();
     VkRect2D scissorRect;
     scissorRect.offset = {0, 0};
-    scissorRect.extent = m_shadowMapSize;
+    scissorRect.extent = m_atlasSize;
+    std::vector<VkDynamicState> dynamicStateEnables = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
     InputAssemblyStateCIBuilder iaBuilder;
     RasterizationStateCIBuilder rsBuilder;
@@ -104,68 +148,103 @@ void RenderPassRSM::CreatePipeline()
             .setColorBlending(blendBuilder.Build())
             .setPipelineLayout(pipelineLayout)
             .setDepthStencil(depthStencilBuilder.Build())
+            .setDynamicStates(dynamicStateEnables)
             .setRenderPass(m_renderPassParameters.GetRenderPass())
             .Build(GetRenderDevice()->GetDevice());
 
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertexShader, nullptr);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShader, nullptr);
+    GetShaderLibrary()->ReleaseShaderModule(vertexShader);
+    GetShaderLibrary()->ReleaseShaderModule(fragShader);
 
     // Set debug name for the pipeline
     setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline), VK_OBJECT_TYPE_PIPELINE, "Shadow pass");
 }
 
-void RenderPassRSM::RecordCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes)
+void RenderPassRSM::SetTiles(const std::vector<ShadowTile>& vTiles)
 {
-    // construct draw commands
-    std::vector<VkDrawIndexedIndirectCommand> drawCommands;
-    for (const SceneNode* pGeometryNode : vpGeometryNodes)
+    m_vTiles = vTiles;
+    m_vTileCommands.assign(m_vTiles.size(), TileCommands());
+}
+
+void RenderPassRSM::PrepareCommandBuffers(const std::vector<std::vector<const SceneNode*>>& vvpTileCasters)
+{
+    assert(vvpTileCasters.size() == m_vTiles.size());
+    for (size_t nTileIdx = 0; nTileIdx < m_vTiles.size(); nTileIdx++)
     {
-        const Geometry* pGeometry = static_cast<const GeometrySceneNode*>(pGeometryNode)->GetGeometry();
-        uint32_t nSubmeshIndex = 0;
-        for (const auto& pSubmesh : pGeometry->getSubmeshes())
+        // construct draw commands
+        std::vector<VkDrawIndexedIndirectCommand> drawCommands;
+        for (const SceneNode* pGeometryNode : vvpTileCasters[nTileIdx])
         {
-            VkDrawIndexedIndirectCommand drawCommand;
-            const Mesh& mesh = GetMeshResourceManager()->GetMesh(pSubmesh->GetMeshIndex());
-
-            drawCommand.indexCount = mesh.m_nIndexCount;
-            drawCommand.instanceCount = 1;
-            drawCommand.firstIndex = mesh.m_nIndexOffset;
-            drawCommand.vertexOffset = 0;
-            drawCommand.firstInstance = PackSubmeshObjectIndex(pGeometryNode->GetPerObjId(), nSubmeshIndex++);
-
-            drawCommands.push_back(drawCommand);
+            const Geometry* pGeometry = static_cast<const GeometrySceneNode*>(pGeometryNode)->GetGeometry();
+            uint32_t nSubmeshIndex = 0;
+            for (const auto& pSubmesh : pGeometry->getSubmeshes())
+            {
+                VkDrawIndexedIndirectCommand drawCommand;
+                const Mesh& mesh = GetMeshResourceManager()->GetMesh(pSubmesh->GetMeshIndex());
+
+                drawCommand.indexCount = mesh.m_nIndexCount;
+                drawCommand.instanceCount = 1;
+                drawCommand.firstIndex = mesh.m_nIndexOffset;
+                drawCommand.vertexOffset = 0;
+                drawCommand.firstInstance = PackSubmeshObjectIndex(pGeometryNode->GetPerObjId(), nSubmeshIndex++);
+
+                drawCommands.push_back(drawCommand);
+            }
         }
-    }
 
-    // Early return if there's nothing to draw;
-    if (drawCommands.size() == 0) return;
-
-    VkCommandBufferBeginInfo beginInfo = {};
+        // Upload draw commands, a tile without casters is only cleared
+        m_vTileCommands[nTileIdx].pDrawCommandBuffer = drawCommands.empty()
+                                                           ? nullptr
+                                                           : GetRenderResourceManager()->GetDrawCommandBuffer("rsm shadow " + std::to_string(nTileIdx), drawCommands);
+    }
 
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-    beginInfo.pInheritanceInfo = nullptr;
+    // Setup descriptor set for the whole pass
+    m_vDescSets = {
+        m_renderPassParameters.AllocateDescriptorSet("", 0),
+        m_renderPassParameters.AllocateDescriptorSet("", 1),
+        m_renderPassParameters.AllocateDescriptorSet("", 2)};
+}
 
-    m_commandBuffer = GetRenderDevice()->AllocateStaticPrimaryCommandbuffer();
-    vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+void RenderPassRSM::RecordSecondaryCommandBuffer(uint32_t nTileIdx, uint32_t nThreadIdx)
+{
+    const ShadowTile& tile = m_vTiles[nTileIdx];
+    TileCommands& tileCommands = m_vTileCommands[nTileIdx];
+    VkCommandBuffer cmdBuf = BeginSecondaryCommandBuffer(nThreadIdx);
+    // Light left without a tile when the atlas is full
+    if (tile.rect.extent.width == 0)
     {
-        RenderPassBeginInfoBuilder builder;
-        std::vector<VkClearValue> clearValue = {
-            {.depthStencil = {1.0, 0}},
-            {.color = {0.0, 0.0, 0.0, 0.0}},
-            {.color = {0.0, 0.0, 0.0, 0.0}},
-            {.color = {0.0, 0.0, 0.0, 0.0}}};
-        VkRenderPassBeginInfo renderPassBeginInfo =
-            builder.setRenderPass(m_renderPassParameters.GetRenderPass())
-                .setFramebuffer(m_renderPassParameters.GetFramebuffer())
-                .setRenderArea(m_shadowMapSize)
-                .setClearValues(clearValue)
-                .Build();
+        vkEndCommandBuffer(cmdBuf);
+        tileCommands.secondaryCommandBuffer = cmdBuf;
+        return;
+    }
 
-        vkCmdBeginRenderPass(m_commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    VkViewport viewport = {};
+    viewport.x = static_cast<float>(tile.rect.offset.x);
+    viewport.y = static_cast<float>(tile.rect.offset.y);
+    viewport.width = static_cast<float>(tile.rect.extent.width);
+    viewport.height = static_cast<float>(tile.rect.extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmdBuf, 0, 1, &viewport);
+    vkCmdSetScissor(cmdBuf, 0, 1, &tile.rect);
+
+    // Atlases are loaded, clear the tile only. A light without casters still clears it, lighting samples the
+    // cleared maps.
+    std::array<VkClearAttachment, 4> aClears = {};
+    aClears[0].aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    aClears[0].clearValue.depthStencil = {1.0, 0};
+    for (uint32_t i = 1; i < aClears.size(); i++)
+    {
+        aClears[i].aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        aClears[i].colorAttachment = i - 1;
+        aClears[i].clearValue.color = {{0.0, 0.0, 0.0, 0.0}};
+    }
+    VkClearRect clearRect = {tile.rect, 0, 1};
+    vkCmdClearAttachments(cmdBuf, static_cast<uint32_t>(aClears.size()), aClears.data(), 1, &clearRect);
 
-        PushConstant pushConstant = {m_nLightIndex, m_shadowMapSize.width};
-        vkCmdPushConstants(m_commandBuffer, m_renderPassParameters.GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstant), &pushConstant);
+    if (tileCommands.pDrawCommandBuffer != nullptr)
+    {
+        PushConstant pushConstant = {tile.nLightIndex, tile.rect.extent.width};
+        vkCmdPushConstants(cmdBuf, m_renderPassParameters.GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstant), &pushConstant);
 
         // Global mesh resource
         const MeshVertexResources& vertexResource = GetMeshResourceManager()->GetMeshVertexResources();
@@ -173,44 +252,89 @@ void RenderPassRSM::RecordCommandBuffers(const std::vector<const SceneNode*>& vp
         const VkBuffer& vertexBuffer = vertexResource.m_pVertexBuffer->buffer();
         const VkBuffer& indexBuffer = vertexResource.m_pIndexBuffer->buffer();
 
-        // Upload draw commands
-        const DrawCommandBuffer<VkDrawIndexedIndirectCommand>* pDrawCommandBuffer = GetRenderResourceManager()->GetDrawCommandBuffer("rsm shadow " + m_shadowCasterName, drawCommands);
-
-        // Setup descriptor set for the whole pass
-
-        std::vector<VkDescriptorSet> vDescSets = {
-            m_renderPassParameters.AllocateDescriptorSet("", 0),
-            m_renderPassParameters.AllocateDescriptorSet("", 1),
-            m_renderPassParameters.AllocateDescriptorSet("", 2)};
-
         vkCmdBindDescriptorSets(
-            m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS,
             m_renderPassParameters.GetPipelineLayout(), 0,
-            static_cast<uint32_t>(vDescSets.size()),
-            vDescSets.data(), 0, nullptr);
+            static_cast<uint32_t>(m_vDescSets.size()),
+            m_vDescSets.data(), 0, nullptr);
 
-        vkCmdBindVertexBuffers(m_commandBuffer, 0, 1, &vertexBuffer,
+        vkCmdBindVertexBuffers(cmdBuf, 0, 1, &vertexBuffer,
                                &offset);
-        vkCmdBindIndexBuffer(m_commandBuffer, indexBuffer, 0,
+        vkCmdBindIndexBuffer(cmdBuf, indexBuffer, 0,
                              VK_INDEX_TYPE_UINT32);
-        vkCmdBindPipeline(m_commandBuffer,
+        vkCmdBindPipeline(cmdBuf,
                           VK_PIPELINE_BIND_POINT_GRAPHICS,
                           m_pipeline);
 
-        SCOPED_MARKER(m_commandBuffer, "Shadow pass: " + m_shadowCasterName);
-        vkCmdDrawIndexedIndirect(m_commandBuffer, pDrawCommandBuffer->buffer(), 0, pDrawCommandBuffer->GetDrawCommandCount(), pDrawCommandBuffer->GetStride());
-        vkCmdEndRenderPass(m_commandBuffer);
+        const DrawCommandBuffer<VkDrawIndexedIndirectCommand>* pDrawCommandBuffer = tileCommands.pDrawCommandBuffer;
+        vkCmdDrawIndexedIndirect(cmdBuf, pDrawCommandBuffer->buffer(), 0, pDrawCommandBuffer->GetDrawCommandCount(), pDrawCommandBuffer->GetStride());
+    }
+    vkEndCommandBuffer(cmdBuf);
+    tileCommands.secondaryCommandBuffer = cmdBuf;
+}
+
+void RenderPassRSM::RecordPrimaryCommandBuffer(const std::vector<uint32_t>& vTileIndices, uint32_t nFrameIdx)
+{
+    std::vector<VkCommandBuffer> vSecondaryCmdBufs;
+    vSecondaryCmdBufs.reserve(vTileIndices.size());
+    for (uint32_t nTileIdx : vTileIndices)
+    {
+        if (m_vTileCommands[nTileIdx].secondaryCommandBuffer != VK_NULL_HANDLE)
+        {
+            vSecondaryCmdBufs.push_back(m_vTileCommands[nTileIdx].secondaryCommandBuffer);
+        }
+    }
+
+    // Nothing to re-render, skip the render pass
+    if (vSecondaryCmdBufs.empty())
+    {
+        m_commandBuffer = VK_NULL_HANDLE;
+        return;
+    }
+
+    // Earlier frames in flight may still be executing their own buffers
+    VkCommandBuffer& frameCommandBuffer = m_aFrameCommandBuffers[nFrameIdx];
+    if (frameCommandBuffer == VK_NULL_HANDLE)
+    {
+        // No need to free it as it will be destroyed with the pool
+        frameCommandBuffer = GetRenderDevice()->AllocateReusablePrimaryCommandbuffer();
+        setDebugUtilsObjectName(reinterpret_cast<uint64_t>(frameCommandBuffer), VK_OBJECT_TYPE_COMMAND_BUFFER, "[CB] Shadow atlas");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    vkBeginCommandBuffer(frameCommandBuffer, &beginInfo);
+    {
+        SCOPED_MARKER(frameCommandBuffer, "Shadow atlas");
+        // Attachments are loaded, no clear values needed
+        std::vector<VkClearValue> vClearValues;
+        RenderPassBeginInfoBuilder builder;
+        VkRenderPassBeginInfo renderPassBeginInfo =
+            builder.setRenderPass(m_renderPassParameters.GetRenderPass())
+                .setFramebuffer(m_renderPassParameters.GetFramebuffer())
+                .setRenderArea(m_renderPassParameters.GetRenderArea())
+                .setClearValues(vClearValues)
+                .Build();
+
+        vkCmdBeginRenderPass(frameCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands(frameCommandBuffer, static_cast<uint32_t>(vSecondaryCmdBufs.size()), vSecondaryCmdBufs.data());
+        vkCmdEndRenderPass(frameCommandBuffer);
     }
-    vkEndCommandBuffer(m_commandBuffer);
+    vkEndCommandBuffer(frameCommandBuffer);
+    m_commandBuffer = frameCommandBuffer;
 }
 
-RSMResources RenderPassRSM::GetRSM()
+RSMResources RenderPassRSM::GetRSM() const
 {
+    const auto& aRSMNames = GetRSMNames();
     return {
-        GetRenderResourceManager()->GetResource<RenderTarget>(m_aRSMNames[SHADOW_MAP_DEPTH]),
-        GetRenderResourceManager()->GetResource<RenderTarget>(m_aRSMNames[SHADOW_MAP_NORMAL]),
-        GetRenderResourceManager()->GetResource<RenderTarget>(m_aRSMNames[SHADOW_MAP_POSITION]),
-        GetRenderResourceManager()->GetResource<RenderTarget>(m_aRSMNames[SHADOW_MAP_FLUX])};
+        GetRenderResourceManager()->GetResource<RenderTarget>(aRSMNames[SHADOW_MAP_DEPTH]),
+        GetRenderResourceManager()->GetResource<RenderTarget>(aRSMNames[SHADOW_MAP_NORMAL]),
+        GetRenderResourceManager()->GetResource<RenderTarget>(aRSMNames[SHADOW_MAP_POSITION]),
+        GetRenderResourceManager()->GetResource<RenderTarget>(aRSMNames[SHADOW_MAP_FLUX])};
 }
 
 }  // namespace Muyo
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <array>
+
 #include "RenderPass.h"
 
 namespace Muyo
 {
 class RenderTarget;
 class SceneNode;
+template <class T>
+class DrawCommandBuffer;
 struct RSMResources
 {
     const RenderTarget* pDepth;
@@ -13,24 +17,49 @@ struct RSMResources
     const RenderTarget* pPosition;
     const RenderTarget* pFlux;
 };
+
+/*
+ * Renders the reflective shadow maps of all shadow casting lights into shared atlases, one for each of the depth,
+ * normal, position and flux maps. Each light owns a tile of the atlases and is recorded into its own secondary
+ * command buffer, so a frame only re-renders the tiles it needs. Atlases are kept in shader read layout between
+ * frames and loaded, each tile clears its own region.
+ */
 class RenderPassRSM : public RenderPass
 {
 public:
-    RenderPassRSM(const std::string& sCasterName, VkExtent2D shadowMapSize, uint32_t nLightIndex) : m_shadowMapSize(shadowMapSize), m_shadowCasterName(sCasterName), m_nLightIndex(nLightIndex), m_aRSMNames({
-                                                                                                                                                                                                     sCasterName + "_depth",
-                                                                                                                                                                                                     sCasterName + "_normal",
-                                                                                                                                                                                                     sCasterName + "_position",
-                                                                                                                                                                                                     sCasterName + "_flux",
-                                                                                                                                                                                                 })
+    // Region of the atlases a light renders to
+    struct ShadowTile
     {
-    }
+        uint32_t nLightIndex = 0;  // Index in light data
+        VkRect2D rect = {{0, 0}, {0, 0}};
+    };
+
+    explicit RenderPassRSM(VkExtent2D atlasSize) : m_atlasSize(atlasSize) {}
     ~RenderPassRSM() override;
     virtual void CreatePipeline() override;
     virtual void PrepareRenderPass() override;
-    void RecordCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes);
+
+    // Tiles must be set before preparing command buffers
+    void SetTiles(const std::vector<ShadowTile>& vTiles);
+    const std::vector<ShadowTile>& GetTiles() const { return m_vTiles; }
+
+    // Split recording for multi-threading. Prepare on the main thread with the casters of each tile, record the
+    // secondary command buffer of each tile on a recording thread. The primary command buffer is recorded every
+    // frame with the tiles to re-render, into the buffer of frame slot nFrameIdx.
+    void PrepareCommandBuffers(const std::vector<std::vector<const SceneNode*>>& vvpTileCasters);
+    void RecordSecondaryCommandBuffer(uint32_t nTileIdx, uint32_t nThreadIdx);
+    void RecordPrimaryCommandBuffer(const std::vector<uint32_t>& vTileIndices, uint32_t nFrameIdx);
+
+    // Null when no tile was recorded this frame
     VkCommandBuffer GetCommandBuffer() const override { return m_commandBuffer; }
 
-    RSMResources GetRSM();
+    RSMResources GetRSM() const;
+
+    // Names of the depth, normal, position and flux atlases in resource manager
+    static const std::array<std::string, 4>& GetRSMNames();
+    VkExtent2D GetAtlasSize() const { return m_atlasSize; }
+    static constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+    static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
 
 private:
     struct PushConstant
@@ -39,14 +68,30 @@ private:
         uint32_t nRSMSize;
     };
 
+    // Resources prepared for the secondary command buffer of a tile
+    struct TileCommands
+    {
+        const DrawCommandBuffer<VkDrawIndexedIndirectCommand>* pDrawCommandBuffer = nullptr;
+        VkCommandBuffer secondaryCommandBuffer = VK_NULL_HANDLE;
+    };
+
+    // Atlases are loaded by the render pass, move them out of undefined layout once after creation
+    void InitializeAtlasLayouts();
+
 private:
     VkPipeline m_pipeline = VK_NULL_HANDLE;
 
-    VkExtent2D m_shadowMapSize = {0, 0};
+    VkExtent2D m_atlasSize = {0, 0};
+    bool m_bIsAtlasInitialized = false;
+
+    // Re-recorded every frame, one per frame in flight. m_commandBuffer is set to the frame's buffer only when it
+    // contains tiles.
+    std::array<VkCommandBuffer, VkRenderDevice::FRAMES_IN_FLIGHT> m_aFrameCommandBuffers = {};
     VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
 
-    const std::string m_shadowCasterName = "RSM";
-    uint32_t m_nLightIndex = 0;
+    std::vector<ShadowTile> m_vTiles;
+    std::vector<TileCommands> m_vTileCommands;
+    std::vector<VkDescriptorSet> m_vDescSets;
 
     // Store shadow map names
     enum RSMNameIdx
@@ -56,6 +101,5 @@ private:
         SHADOW_MAP_POSITION,
         SHADOW_MAP_FLUX
     };
-    const std::array<std::string, 4> m_aRSMNames;
 };
 }  // namespace Muyo
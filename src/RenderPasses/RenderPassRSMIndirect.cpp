@@ -0,0 +1,175 @@
+#include "RenderPassRSMIndirect.h"
+
+#include <array>
+
+#include "Camera.h"
+#include "Debug.h"
+#include "PipelineStateBuilder.h"
+#include "RenderPassGBuffer.h"
+#include "RenderPassLinearizeDepth.h"
+#include "RenderResourceManager.h"
+#include "RenderResourceNames.h"
+#include "SamplerManager.h"
+#include "ShadowPassManager.h"
+
+namespace Muyo
+{
+const std::string RenderPassRSMIndirect::OUTPUT_NAME = "RSMIndirect";
+const std::string RenderPassRSMIndirect::GUIDE_NAME = "RSMIndirectGuide";
+const std::string RenderPassRSMIndirect::SETTINGS_NAME = "rsm indirect settings";
+
+RenderPassRSMIndirect::RenderPassRSMIndirect(VkExtent2D renderArea, uint32_t nDownscale, const ShadowPassManager& shadowPassManager)
+    : m_extent({(renderArea.width + nDownscale - 1) / nDownscale, (renderArea.height + nDownscale - 1) / nDownscale}),
+      m_shadowPassManager(shadowPassManager)
+{
+    m_settings.nDownscale = nDownscale;
+}
+
+RenderPassRSMIndirect::~RenderPassRSMIndirect()
+{
+    if (m_pipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(GetRenderDevice()->GetDevice(), m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+}
+
+void RenderPassRSMIndirect::SetTemporalAccumulation(bool bEnabled)
+{
+    // Caller waits for the frames in flight, none of them reads the settings anymore
+    m_settings.bTemporal = bEnabled ? 1 : 0;
+    GetRenderResourceManager()->GetUniformBuffer<RSMIndirectSettings>(SETTINGS_NAME)->SetData(m_settings);
+}
+
+void RenderPassRSMIndirect::PrepareRenderPass()
+{
+    m_renderPassParameters.Reset();
+
+    m_renderPassParameters.SetRenderArea(m_extent);
+
+    // Set 0, perview
+    m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<UniformBuffer<PerViewData>>(PER_VIEW), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0);
+
+    // Set 1, light count and light data
+    m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<UniformBuffer<uint32_t>>(LIGHT_COUNT), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+    m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<StorageBuffer<LightData>>(LIGHT_DATA), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+
+    // Set 2, G-buffer normal and linear depth
+    for (const std::string& sName : {RenderPassGBuffer::attachments[RenderPassGBuffer::NORMAL_ROUGHNESS_METALNESS].sName, RenderPassLinearizeDepth::OUTPUT_NAME})
+    {
+        m_renderPassParameters.AddImageParameter(GetRenderResourceManager()->GetResource<ImageResource>(sName), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 2);
+    }
+
+    // Set 3, RSM atlases and shadow map tiles
+    const RSMResources rsm = m_shadowPassManager.GetShadowMaps();
+    for (const RenderTarget* pAtlas : {rsm.pNormal, rsm.pPosition, rsm.pFlux})
+    {
+        m_renderPassParameters.AddImageParameter(pAtlas, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 3);
+    }
+    m_renderPassParameters.AddParameter(GetRenderResourceManager()->GetResource<StorageBuffer<glm::vec4>>(ShadowPassManager::TILE_BUFFER_NAME), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3);
+
+    // Set 4, output, guide and settings
+    const StorageImageResource* pOutput = GetRenderResourceManager()->GetStorageImageResource(OUTPUT_NAME, m_extent, VK_FORMAT_R16G16B16A16_SFLOAT);
+    const StorageImageResource* pGuide = GetRenderResourceManager()->GetStorageImageResource(GUIDE_NAME, m_extent, VK_FORMAT_R16G16B16A16_SFLOAT);
+    m_renderPassParameters.AddImageParameter(pOutput, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE, 4);
+    m_renderPassParameters.AddImageParameter(pGuide, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE, 4);
+    UniformBuffer<RSMIndirectSettings>* pSettings = GetRenderResourceManager()->GetUniformBuffer<RSMIndirectSettings>(SETTINGS_NAME);
+    pSettings->SetData(m_settings);
+    m_renderPassParameters.AddParameter(pSettings, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4);
+
+    m_renderPassParameters.Finalize("RSM indirect");
+
+    if (!m_bIsOutputInitialized)
+    {
+        InitializeOutputLayout();
+        m_bIsOutputInitialized = true;
+    }
+
+    CreatePipelineAsync();
+}
+
+void RenderPassRSMIndirect::InitializeOutputLayout()
+{
+    // The guide is cleared too, with subpass lighting it's read before the first gather
+    const std::array<VkImage, 2> images = {GetRenderResourceManager()->GetResource<ImageResource>(OUTPUT_NAME)->getImage(), GetRenderResourceManager()->GetResource<ImageResource>(GUIDE_NAME)->getImage()};
+    GetRenderDevice()->ExecuteImmediateCommand(
+        [images](VkCommandBuffer commandBuffer)
+        {
+            std::array<VkImageMemoryBarrier, 2> barriers = {};
+            for (size_t i = 0; i < images.size(); i++)
+            {
+                barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barriers[i].srcAccessMask = 0;
+                barriers[i].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barriers[i].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+                barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barriers[i].image = images[i];
+                barriers[i].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            }
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+
+            // Empty history, the first frame doesn't blend with garbage
+            const VkClearColorValue clearColor = {{0.0f, 0.0f, 0.0f, 0.0f}};
+            for (size_t i = 0; i < images.size(); i++)
+            {
+                vkCmdClearColorImage(commandBuffer, images[i], VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &barriers[i].subresourceRange);
+
+                barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                barriers[i].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            }
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+        });
+}
+
+void RenderPassRSMIndirect::CreatePipeline()
+{
+    VkShaderModule compShader = GetShaderLibrary()->AcquireShaderModule("shaders/rsmIndirect.comp.spv");
+
+    ComputePipelineBuilder builder;
+    VkComputePipelineCreateInfo createInfo = builder.AddShaderModule(compShader).SetPipelineLayout(m_renderPassParameters.GetPipelineLayout()).Build();
+    VK_ASSERT(vkCreateComputePipelines(GetRenderDevice()->GetDevice(), GetPipelineCache()->GetPipelineCache(), 1, &createInfo, nullptr, &m_pipeline));
+
+    GetShaderLibrary()->ReleaseShaderModule(compShader);
+
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline), VK_OBJECT_TYPE_PIPELINE, "RSM indirect");
+}
+
+void RenderPassRSMIndirect::RecordCommandBuffers()
+{
+    WaitForPipelines();
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    // Submitted on graphics queue between G-buffer and lighting, image accesses are synchronized by the render graph
+    if (m_commandBuffer == VK_NULL_HANDLE)
+    {
+        m_commandBuffer = GetRenderDevice()->AllocateStaticPrimaryCommandbuffer();
+    }
+    else
+    {
+        vkResetCommandBuffer(m_commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
+    }
+    vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+    {
+        SCOPED_MARKER(m_commandBuffer, "RSM indirect");
+
+        std::vector<VkDescriptorSet> vDescSets = {
+            m_renderPassParameters.AllocateDescriptorSet("", 0),
+            m_renderPassParameters.AllocateDescriptorSet("", 1),
+            m_renderPassParameters.AllocateDescriptorSet("", 2),
+            m_renderPassParameters.AllocateDescriptorSet("", 3),
+            m_renderPassParameters.AllocateDescriptorSet("", 4)};
+
+        vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_renderPassParameters.GetPipelineLayout(), 0, (uint32_t)vDescSets.size(), vDescSets.data(), 0, nullptr);
+        vkCmdDispatch(m_commandBuffer, (m_extent.width + GROUP_SIZE - 1) / GROUP_SIZE, (m_extent.height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+    }
+    vkEndCommandBuffer(m_commandBuffer);
+}
+}  // namespace Muyo
@@ -0,0 +1,42 @@
+#pragma once
+#include "RenderPass.h"
+#include "SharedStructures.h"
+
+namespace Muyo
+{
+class ShadowPassManager;
+
+// Compute pass gathering one bounce indirect lighting from the reflective shadow maps at a fraction of the screen
+// resolution. Opaque lighting upsamples the result with depth and normal aware weights. With temporal accumulation
+// the gather is jittered every frame and blended with the previous result while the camera is static.
+class RenderPassRSMIndirect : public RenderPass
+{
+public:
+    RenderPassRSMIndirect(VkExtent2D renderArea, uint32_t nDownscale, const ShadowPassManager& shadowPassManager);
+    ~RenderPassRSMIndirect() override;
+    void CreatePipeline() override;
+    void PrepareRenderPass() override;
+    void RecordCommandBuffers();
+    VkCommandBuffer GetCommandBuffer() const override { return m_commandBuffer; }
+
+    // Settings are read by the shader every frame, the command buffer doesn't need to be re-recorded
+    void SetTemporalAccumulation(bool bEnabled);
+    bool IsTemporalAccumulationEnabled() const { return m_settings.bTemporal != 0; }
+
+    static const std::string OUTPUT_NAME;  // Irradiance and number of accumulated frames, kept across frames
+    static const std::string GUIDE_NAME;   // Normal and view depth of each output texel
+    static const std::string SETTINGS_NAME;
+
+private:
+    // Output is accumulated in general layout, move it and the guide out of undefined layout once after creation
+    void InitializeOutputLayout();
+
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+    VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+    VkExtent2D m_extent = {0, 0};
+    bool m_bIsOutputInitialized = false;
+    RSMIndirectSettings m_settings = {2, 1, 32, 0};
+    const ShadowPassManager& m_shadowPassManager;
+    const uint32_t GROUP_SIZE = 8;  // Matches local size in rsmIndirect.comp
+};
+}  // namespace Muyo
@@ -15,6 +15,8 @@ namespace Muyo
 
 void RenderPassRayTracing::PrepareRenderPass()
 {
+    m_renderPassParameters.Reset();
+
     // Prepare render pass parameters
 
     // Set 0
@@ -62,14 +64,9 @@ void RenderPassRayTracing::PrepareRenderPass()
 void RenderPassRayTracing::CreatePipeline()
 {
     // shader stages
-    VkShaderModule rayGenShdr = CreateShaderModule(ReadSpv("shaders/pathTracing.rgen.spv"));
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(rayGenShdr), VK_OBJECT_TYPE_SHADER_MODULE, "pathTracing.rgen.spv");
-
-    VkShaderModule missShdr = CreateShaderModule(ReadSpv("shaders/pathTracing.rmiss.spv"));
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(missShdr), VK_OBJECT_TYPE_SHADER_MODULE, "pathTracing.rmiss.spv");
-
-    VkShaderModule chitShdr = CreateShaderModule(ReadSpv("shaders/pathTracing.rchit.spv"));
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(chitShdr), VK_OBJECT_TYPE_SHADER_MODULE, "pathTracing.rchit.spv");
+    VkShaderModule rayGenShdr = GetShaderLibrary()->AcquireShaderModule("shaders/pathTracing.rgen.spv");
+    VkShaderModule missShdr = GetShaderLibrary()->AcquireShaderModule("shaders/pathTracing.rmiss.spv");
+    VkShaderModule chitShdr = GetShaderLibrary()->AcquireShaderModule("shaders/pathTracing.rchit.spv");
 
     RayTracingPipelineBuilder builder;
     builder.AddShaderModule(rayGenShdr, VK_SHADER_STAGE_RAYGEN_BIT_KHR)
@@ -90,15 +87,15 @@ void RenderPassRayTracing::CreatePipeline()
 
     VK_ASSERT(VkExt::vkCreateRayTracingPipelinesKHR(GetRenderDevice()->GetDevice(),
                                                     VK_NULL_HANDLE,
-                                                    VK_NULL_HANDLE,
+                                                    GetPipelineCache()->GetPipelineCache(),
                                                     1,
                                                     &createInfo,
                                                     nullptr,
                                                     &m_pipeline));
 
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), rayGenShdr, nullptr);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), missShdr, nullptr);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), chitShdr, nullptr);
+    GetShaderLibrary()->ReleaseShaderModule(rayGenShdr);
+    GetShaderLibrary()->ReleaseShaderModule(missShdr);
+    GetShaderLibrary()->ReleaseShaderModule(chitShdr);
 
     AllocateShaderBindingTable();
 }
@@ -273,8 +270,6 @@ void RenderPassRayTracing::AllocateShaderBindingTable()
         nHandleOffset += nHandleSize;
         pRayHitHandleGPU += hitRegion.stride;
     }
-
-    pSBTBuffer->Unmap();
 }
 
 }  // namespace Muyo
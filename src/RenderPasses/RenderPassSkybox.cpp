@@ -21,6 +21,8 @@ RenderPassSkybox::~RenderPassSkybox()
 
 void RenderPassSkybox::PrepareRenderPass()
 {
+    m_renderPassParameters.Reset();
+
     // Resources should have been created
 
     // color attachment
@@ -32,7 +34,7 @@ void RenderPassSkybox::PrepareRenderPass()
     m_renderPassParameters.AddAttachment(depthTarget, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, false);
 
     // Binding 0: Per view data
-    UniformBuffer<PerViewData>* perViewDataUniformBuffer = GetRenderResourceManager()->GetUniformBuffer<PerViewData>("perView");
+    UniformBuffer<PerViewData>* perViewDataUniformBuffer = GetRenderResourceManager()->GetPerFrameUniformBuffer<PerViewData>("perView");
     m_renderPassParameters.AddParameter(perViewDataUniformBuffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
 
     // Binding 1: skybox texture
@@ -42,7 +44,7 @@ void RenderPassSkybox::PrepareRenderPass()
 
     m_renderPassParameters.Finalize("Render pass skybox");
 
-    CreatePipeline();
+    CreatePipelineAsync();
 }
 
 void RenderPassSkybox::CreatePipeline()
@@ -56,8 +58,8 @@ void RenderPassSkybox::CreatePipeline()
     VkPipelineLayout pipelineLayout = m_renderPassParameters.GetPipelineLayout();
     setDebugUtilsObjectName(reinterpret_cast<uint64_t>(pipelineLayout), VK_OBJECT_TYPE_PIPELINE_LAYOUT, "Skybox");
 
-    VkShaderModule vertShdr = CreateShaderModule(ReadSpv("shaders/Skybox.vert.spv"));
-    VkShaderModule fragShdr = CreateShaderModule(ReadSpv("shaders/Skybox.frag.spv"));
+    VkShaderModule vertShdr = GetShaderLibrary()->AcquireShaderModule("shaders/Skybox.vert.spv");
+    VkShaderModule fragShdr = GetShaderLibrary()->AcquireShaderModule("shaders/Skybox.frag.spv");
 
     InputAssemblyStateCIBuilder iaBuilder;
     RasterizationStateCIBuilder rsBuilder;
@@ -86,10 +88,8 @@ void RenderPassSkybox::CreatePipeline()
                      .setSubpassIndex(0)
                      .Build(GetRenderDevice()->GetDevice());
 
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertShdr,
-                          nullptr);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShdr,
-                          nullptr);
+    GetShaderLibrary()->ReleaseShaderModule(vertShdr);
+    GetShaderLibrary()->ReleaseShaderModule(fragShdr);
 
     // Set debug name for the pipeline
     setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline),
@@ -98,6 +98,8 @@ void RenderPassSkybox::CreatePipeline()
 
 void RenderPassSkybox::RecordCommandBuffers()
 {
+    WaitForPipelines();
+
     VkCommandBufferBeginInfo beginInfo = {};
 
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
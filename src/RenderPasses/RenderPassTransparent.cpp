@@ -1,5 +1,9 @@
 #include "RenderPassTransparent.h"
 
+#include <array>
+#include <cassert>
+#include <cstring>
+
 #include "Debug.h"
 #include "DescriptorManager.h"
 #include "MeshResourceManager.h"
@@ -13,12 +17,68 @@
 namespace Muyo
 {
 
+// Map float to uint32 preserving order
+static uint32_t FloatToSortableKey(float fValue)
+{
+    uint32_t nBits = 0;
+    memcpy(&nBits, &fValue, sizeof(nBits));
+    return (nBits & 0x80000000u) ? ~nBits : (nBits | 0x80000000u);
+}
+
+// LSD radix sort on the upper 32 bits of the keys, 8 bits per pass. It's stable so draws at the same depth keep
+// scene order. Passes where all keys share the same digit are skipped.
+static void RadixSortKeys(std::vector<uint64_t>& vKeys, std::vector<uint64_t>& vScratch)
+{
+    vScratch.resize(vKeys.size());
+    for (uint32_t nShift = 32; nShift < 64; nShift += 8)
+    {
+        std::array<uint32_t, 256> aOffsets = {};
+        for (uint64_t nKey : vKeys)
+        {
+            aOffsets[(nKey >> nShift) & 0xFF]++;
+        }
+        if (aOffsets[(vKeys[0] >> nShift) & 0xFF] == vKeys.size())
+        {
+            continue;
+        }
+        uint32_t nOffset = 0;
+        for (uint32_t& nCount : aOffsets)
+        {
+            uint32_t nDigitCount = nCount;
+            nCount = nOffset;
+            nOffset += nDigitCount;
+        }
+        for (uint64_t nKey : vKeys)
+        {
+            vScratch[aOffsets[(nKey >> nShift) & 0xFF]++] = nKey;
+        }
+        vKeys.swap(vScratch);
+    }
+}
+
 RenderPassTransparent::RenderPassTransparent(VkExtent2D renderArea) : m_renderArea(renderArea)
 {
 }
 
+void RenderPassTransparent::AddSceneParameters(RenderPassParameters& renderPassParameters)
+{
+    // Set 0: Perview
+    const UniformBuffer<PerViewData>* perView = GetRenderResourceManager()->GetPerFrameUniformBuffer<PerViewData>("perView");
+    renderPassParameters.AddParameter(perView, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+
+    // Set 1: Per object
+    renderPassParameters.AddParameter(GetPerObjResourceManager()->GetPerObjResource(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1);
+
+    // Set 2: Bindless samplers, materials and textures
+    renderPassParameters.AddExternalDescriptorSet(GetDescriptorManager()->getDescriptorLayout(DESCRIPTOR_LAYOUT_BINDLESS), GetDescriptorManager()->GetBindlessDescriptorSet(), 2);
+}
+
 void RenderPassTransparent::PrepareRenderPass()
 {
+    m_renderPassParameters.Reset();
+    m_oitParameters.Reset();
+    m_compositeParameters.Reset();
+
     m_renderPassParameters.SetRenderArea(m_renderArea);
 
     // Attachments
@@ -28,41 +88,59 @@ void RenderPassTransparent::PrepareRenderPass()
     auto* depthAttachment = GetRenderResourceManager()->GetResource<RenderTarget>("GBufferDepth_");
     m_renderPassParameters.AddAttachment(depthAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, false);
 
-    // Set 0: Perview
-    const UniformBuffer<PerViewData>* perView = GetRenderResourceManager()->GetUniformBuffer<PerViewData>("perView");
-    m_renderPassParameters.AddParameter(perView, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
-
-    // Set 1: Per object
-    m_renderPassParameters.AddParameter(GetPerObjResourceManager()->GetPerObjResource(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1);
-
-    // Set 2 Binding 0: All textures
-    const auto& vpUniquePtrTextures = GetTextureResourceManager()->GetTextures();
-    std::vector<const ImageResource*> vpTextures;
-    vpTextures.reserve(vpUniquePtrTextures.size());
-    for (const auto& pTexture : vpUniquePtrTextures)
-    {
-        vpTextures.push_back(pTexture.get());
-    }
-    m_renderPassParameters.AddImageParameter(vpTextures, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS), 2);
-
-    // Set 2, Binding 1: All materials
-    const auto* materialBuffer = GetMaterialManager()->GetMaterialBuffer();
-    m_renderPassParameters.AddParameter(materialBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 2);
-
+    AddSceneParameters(m_renderPassParameters);
     m_renderPassParameters.Finalize("transparent pass");
-    CreatePipeline();
+
+    // OIT accumulation, depth is left in the layout the sorted pass leaves it in
+    const RenderTarget* pAccumulation = GetRenderResourceManager()->GetRenderTarget("OITAccumulation", m_renderArea, OIT_ACCUMULATION_FORMAT, 1, 1, VK_IMAGE_USAGE_SAMPLED_BIT);
+    const RenderTarget* pRevealage = GetRenderResourceManager()->GetRenderTarget("OITRevealage", m_renderArea, OIT_REVEALAGE_FORMAT, 1, 1, VK_IMAGE_USAGE_SAMPLED_BIT);
+    m_oitParameters.SetRenderArea(m_renderArea);
+    m_oitParameters.AddAttachment(pAccumulation, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true);
+    m_oitParameters.AddAttachment(pRevealage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true);
+    m_oitParameters.AddAttachment(depthAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, false);
+    AddSceneParameters(m_oitParameters);
+    m_oitParameters.Finalize("transparent OIT accumulation");
+
+    // OIT composite
+    m_compositeParameters.SetRenderArea(m_renderArea);
+    m_compositeParameters.AddAttachment(colorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, false);
+    m_compositeParameters.AddImageParameter(pAccumulation, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS));
+    m_compositeParameters.AddImageParameter(pRevealage, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GetSamplerManager()->getSampler(SAMPLER_1_MIPS));
+    m_compositeParameters.Finalize("transparent OIT composite");
+
+    CreatePipelineAsync();
 }
 
 RenderPassTransparent::~RenderPassTransparent()
 {
     vkDestroyPipeline(GetRenderDevice()->GetDevice(), m_pipeline, nullptr);
+    vkDestroyPipeline(GetRenderDevice()->GetDevice(), m_oitPipeline, nullptr);
+    vkDestroyPipeline(GetRenderDevice()->GetDevice(), m_compositePipeline, nullptr);
 }
 
 void RenderPassTransparent::CreatePipeline()
 {
-    VkPipelineLayout pipelineLayout = m_renderPassParameters.GetPipelineLayout();
-    VkShaderModule vertShader = CreateShaderModule(ReadSpv("shaders/GBuffer.vert.spv"));
-    VkShaderModule fragShader = CreateShaderModule(ReadSpv("shaders/transparent.frag.spv"));
+    BlendStateCIBuilder blendBuilder;
+    blendBuilder.setAttachments(1);
+    m_pipeline = CreateScenePipeline(m_renderPassParameters, "shaders/transparent.frag.spv", blendBuilder);
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline), VK_OBJECT_TYPE_PIPELINE, "Transparent");
+
+    // Accumulation is additive, revealage is multiplied by (1 - alpha)
+    BlendStateCIBuilder oitBlendBuilder;
+    oitBlendBuilder.setAttachments(2)
+        .setBlendFactors(0, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE)
+        .setBlendFactors(1, VK_BLEND_FACTOR_ZERO, VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR, VK_BLEND_FACTOR_ZERO, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA);
+    m_oitPipeline = CreateScenePipeline(m_oitParameters, "shaders/transparentOIT.frag.spv", oitBlendBuilder);
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_oitPipeline), VK_OBJECT_TYPE_PIPELINE, "Transparent OIT accumulation");
+
+    CreateCompositePipeline();
+}
+
+VkPipeline RenderPassTransparent::CreateScenePipeline(const RenderPassParameters& renderPassParameters, const std::string& sFragShader, const BlendStateCIBuilder& blendBuilder) const
+{
+    VkPipelineLayout pipelineLayout = renderPassParameters.GetPipelineLayout();
+    VkShaderModule vertShader = GetShaderLibrary()->AcquireShaderModule("shaders/GBuffer.vert.spv");
+    VkShaderModule fragShader = GetShaderLibrary()->AcquireShaderModule(sFragShader);
 
     ViewportBuilder vpBuilder;
     VkViewport viewport = vpBuilder.setWH(m_renderArea).Build();
@@ -70,23 +148,10 @@ void RenderPassTransparent::CreatePipeline()
     scissorRect.offset = {0, 0};
     scissorRect.extent = m_renderArea;
 
-    // Descriptor layouts
-    std::vector<VkDescriptorSetLayout> descLayouts = {
-        GetDescriptorManager()->getDescriptorLayout(
-            DESCRIPTOR_LAYOUT_PER_VIEW_DATA),
-        GetDescriptorManager()->getDescriptorLayout(
-            DESCRIPTOR_LAYOUT_MATERIALS),
-        GetDescriptorManager()->getDescriptorLayout(
-            DESCRIPTOR_LAYOUT_PER_OBJ_DATA)};
-
-    std::vector<VkPushConstantRange> pushConstants;
-
     InputAssemblyStateCIBuilder iaBuilder;
     RasterizationStateCIBuilder rsBuilder;
     rsBuilder.SetCullMode(VK_CULL_MODE_NONE);
     MultisampleStateCIBuilder msBuilder;
-    BlendStateCIBuilder blendBuilder;
-    blendBuilder.setAttachments(1);
 
     // Disable depth write, enable depth test with opaque pass
     DepthStencilCIBuilder depthStencilBuilder;
@@ -94,7 +159,7 @@ void RenderPassTransparent::CreatePipeline()
 
     PipelineStateBuilder builder;
 
-    m_pipeline =
+    VkPipeline pipeline =
         builder.setShaderModules({vertShader, fragShader})
             .setVertextInfo({Vertex::getBindingDescription()},
                             Vertex::getAttributeDescriptions())
@@ -105,25 +170,77 @@ void RenderPassTransparent::CreatePipeline()
             .setColorBlending(blendBuilder.Build())
             .setPipelineLayout(pipelineLayout)
             .setDepthStencil(depthStencilBuilder.Build())
-            .setRenderPass(m_renderPassParameters.GetRenderPass())
+            .setRenderPass(renderPassParameters.GetRenderPass())
             .setSubpassIndex(0)
             .Build(GetRenderDevice()->GetDevice());
 
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertShader, nullptr);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShader, nullptr);
+    GetShaderLibrary()->ReleaseShaderModule(vertShader);
+    GetShaderLibrary()->ReleaseShaderModule(fragShader);
+    return pipeline;
+}
+
+void RenderPassTransparent::CreateCompositePipeline()
+{
+    VkShaderModule vertShader = GetShaderLibrary()->AcquireShaderModule("shaders/lighting.vert.spv");
+    VkShaderModule fragShader = GetShaderLibrary()->AcquireShaderModule("shaders/transparentOITComposite.frag.spv");
 
-    // Set debug name for the pipeline
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline),
-                            VK_OBJECT_TYPE_PIPELINE, "Transparent");
+    ViewportBuilder vpBuilder;
+    VkViewport viewport = vpBuilder.setWH(m_renderArea).Build();
+    VkRect2D scissorRect;
+    scissorRect.offset = {0, 0};
+    scissorRect.extent = m_renderArea;
+
+    InputAssemblyStateCIBuilder iaBuilder;
+    RasterizationStateCIBuilder rsBuilder;
+    MultisampleStateCIBuilder msBuilder;
+    // Shader outputs average color and revealage: color * (1 - revealage) + dst * revealage
+    BlendStateCIBuilder blendBuilder;
+    blendBuilder.setAttachments(1).setBlendFactors(0, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ZERO, VK_BLEND_FACTOR_ONE);
+    DepthStencilCIBuilder depthStencilBuilder;
+    PipelineStateBuilder builder;
+
+    m_compositePipeline =
+        builder.setShaderModules({vertShader, fragShader})
+            .setVertextInfo({Vertex::getBindingDescription()},
+                            Vertex::getAttributeDescriptions())
+            .setAssembly(iaBuilder.Build())
+            .setViewport(viewport, scissorRect)
+            .setRasterizer(rsBuilder.Build())
+            .setMSAA(msBuilder.Build())
+            .setColorBlending(blendBuilder.Build())
+            .setPipelineLayout(m_compositeParameters.GetPipelineLayout())
+            .setDepthStencil(depthStencilBuilder.setDepthTestEnabled(false).setDepthWriteEnabled(false).Build())
+            .setRenderPass(m_compositeParameters.GetRenderPass())
+            .Build(GetRenderDevice()->GetDevice());
+
+    GetShaderLibrary()->ReleaseShaderModule(vertShader);
+    GetShaderLibrary()->ReleaseShaderModule(fragShader);
+
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_compositePipeline), VK_OBJECT_TYPE_PIPELINE, "Transparent OIT composite");
 }
 
 void RenderPassTransparent::RecordCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes)
+{
+    WaitForPipelines();
+
+    if (PrepareCommandBuffers(vpGeometryNodes))
+    {
+        RecordSecondaryCommandBuffer(0);
+        RecordPrimaryCommandBuffer();
+    }
+}
+
+bool RenderPassTransparent::PrepareCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes)
 {
     // construct draw commands
     std::vector<VkDrawIndexedIndirectCommand> drawCommands;
+    m_vDraws.clear();
     for (const SceneNode* pGeometryNode : vpGeometryNodes)
     {
         const Geometry* pGeometry = static_cast<const GeometrySceneNode*>(pGeometryNode)->GetGeometry();
+        // Submeshes don't have bounds, they are sorted by the center of the node
+        const AABB aabb = pGeometryNode->GetAABB();
+        const glm::vec3 vObjectCenter = 0.5f * (aabb.vMin + aabb.vMax);
         uint32_t nSubmeshIndex = 0;
         for (const auto& pSubmesh : pGeometry->getSubmeshes())
         {
@@ -137,58 +254,191 @@ void RenderPassTransparent::RecordCommandBuffers(const std::vector<const SceneNo
             drawCommand.firstInstance = PackSubmeshObjectIndex(pGeometryNode->GetPerObjId(), nSubmeshIndex++);
 
             drawCommands.push_back(drawCommand);
+            m_vDraws.push_back({pGeometry, vObjectCenter, drawCommand});
         }
     }
-    if (drawCommands.size() == 0) return;
-    VkCommandBufferBeginInfo beginInfo = {};
+    // Secondary command buffers of the previous recording are reset with their pools
+    m_secondaryCommandBuffer = VK_NULL_HANDLE;
+    m_oitSecondaryCommandBuffer = VK_NULL_HANDLE;
+    if (m_commandBuffer != VK_NULL_HANDLE)
+    {
+        GetRenderDevice()->FreeStaticPrimaryCommandbuffer(m_commandBuffer);
+        m_commandBuffer = VK_NULL_HANDLE;
+    }
+    if (m_oitCommandBuffer != VK_NULL_HANDLE)
+    {
+        GetRenderDevice()->FreeStaticPrimaryCommandbuffer(m_oitCommandBuffer);
+        m_oitCommandBuffer = VK_NULL_HANDLE;
+    }
+    if (drawCommands.size() == 0)
+    {
+        m_pDrawCommandBuffer = nullptr;
+        return false;
+    }
 
+    // Upload draw commands
+    m_pDrawCommandBuffer = GetRenderResourceManager()->GetDrawCommandBuffer("transparent draw commands", drawCommands, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    // Static command buffers are recorded again once the queues are idle, nothing reads the old copies
+    const VkDeviceSize nDrawCommandsSize = sizeof(VkDrawIndexedIndirectCommand) * drawCommands.size();
+    if (m_sortedDrawCommands.GetFrameSize() != nDrawCommandsSize)
+    {
+        m_sortedDrawCommands.Allocate(nDrawCommandsSize, "Sorted transparent draw commands");
+    }
+    m_vDescSets = m_renderPassParameters.AllocateDescriptorSets();
+    m_vOITDescSets = m_oitParameters.AllocateDescriptorSets();
+    m_compositeDescSet = m_compositeParameters.AllocateDescriptorSet("OIT composite", 0);
+    return true;
+}
+
+void RenderPassTransparent::SortDrawCommands(const glm::mat4& mView, uint32_t nFrameIdx)
+{
+    // OIT doesn't depend on draw order
+    if (m_pDrawCommandBuffer == nullptr || m_mode != MODE_SORTED)
+    {
+        return;
+    }
+    assert(m_vDraws.size() == m_pDrawCommandBuffer->GetDrawCommandCount());
+
+    m_vSortKeys.resize(m_vDraws.size());
+    for (uint32_t i = 0; i < m_vDraws.size(); i++)
+    {
+        const TransparentDraw& draw = m_vDraws[i];
+        glm::vec4 vViewPos = mView * draw.pGeometry->GetWorldMatrix() * glm::vec4(draw.vObjectCenter, 1.0f);
+        // Camera looks down -z, farthest draws go first
+        uint32_t nDepthKey = ~FloatToSortableKey(-vViewPos.z);
+        m_vSortKeys[i] = (static_cast<uint64_t>(nDepthKey) << 32) | i;
+    }
+    RadixSortKeys(m_vSortKeys, m_vSortScratch);
+
+    auto* pCommands = static_cast<VkDrawIndexedIndirectCommand*>(m_sortedDrawCommands.GetFrameData(nFrameIdx));
+    for (uint32_t i = 0; i < m_vSortKeys.size(); i++)
+    {
+        pCommands[i] = m_vDraws[m_vSortKeys[i] & 0xFFFFFFFFu].command;
+    }
+}
+
+void RenderPassTransparent::RecordDrawCommandCopy(VkCommandBuffer cmdBuf, uint32_t nFrameIdx) const
+{
+    // Same condition as sorting, OIT keeps the scene order
+    if (m_pDrawCommandBuffer == nullptr || m_mode != MODE_SORTED)
+    {
+        return;
+    }
+    m_sortedDrawCommands.RecordCopy(cmdBuf, nFrameIdx, m_pDrawCommandBuffer->buffer(), m_sortedDrawCommands.GetFrameSize(),
+                                    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+void RenderPassTransparent::RecordDraws(VkCommandBuffer cmdBuf, VkPipeline pipeline, VkPipelineLayout pipelineLayout, const std::vector<VkDescriptorSet>& vDescSets) const
+{
+    // Global mesh resource
+    const MeshVertexResources& vertexResource = GetMeshResourceManager()->GetMeshVertexResources();
+    VkDeviceSize offset = 0;
+    const VkBuffer& vertexBuffer = vertexResource.m_pVertexBuffer->buffer();
+    const VkBuffer& indexBuffer = vertexResource.m_pIndexBuffer->buffer();
+
+    vkCmdBindDescriptorSets(
+        cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout, 0,
+        static_cast<uint32_t>(vDescSets.size()),
+        vDescSets.data(), 0, nullptr);
+
+    vkCmdBindVertexBuffers(cmdBuf, 0, 1, &vertexBuffer,
+                           &offset);
+    vkCmdBindIndexBuffer(cmdBuf, indexBuffer, 0,
+                         VK_INDEX_TYPE_UINT32);
+    vkCmdBindPipeline(cmdBuf,
+                      VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      pipeline);
+
+    vkCmdDrawIndexedIndirect(cmdBuf, m_pDrawCommandBuffer->buffer(), 0, m_pDrawCommandBuffer->GetDrawCommandCount(), m_pDrawCommandBuffer->GetStride());
+}
+
+void RenderPassTransparent::RecordSecondaryCommandBuffer(uint32_t nThreadIdx)
+{
+    if (m_pDrawCommandBuffer == nullptr) return;
+
+    m_secondaryCommandBuffer = BeginSecondaryCommandBuffer(nThreadIdx);
+    RecordDraws(m_secondaryCommandBuffer, m_pipeline, m_renderPassParameters.GetPipelineLayout(), m_vDescSets);
+    vkEndCommandBuffer(m_secondaryCommandBuffer);
+
+    m_oitSecondaryCommandBuffer = BeginSecondaryCommandBuffer(nThreadIdx, m_oitParameters);
+    RecordDraws(m_oitSecondaryCommandBuffer, m_oitPipeline, m_oitParameters.GetPipelineLayout(), m_vOITDescSets);
+    vkEndCommandBuffer(m_oitSecondaryCommandBuffer);
+}
+
+void RenderPassTransparent::RecordPrimaryCommandBuffer()
+{
+    if (m_secondaryCommandBuffer == VK_NULL_HANDLE) return;
+
+    std::vector<VkClearValue> vClearValeus = {{{.color = {0.0f, 0.0f, 0.0f, 0.0f}},
+                                               {.depthStencil = {1.0f, 0}}}};
+    m_commandBuffer = RecordPrimaryFromSecondary(m_secondaryCommandBuffer, vClearValeus, "Transparent pass");
+    RecordOITPrimaryCommandBuffer();
+}
+
+void RenderPassTransparent::RecordOITPrimaryCommandBuffer()
+{
+    VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
     beginInfo.pInheritanceInfo = nullptr;
 
-    m_commandBuffer = GetRenderDevice()->AllocateStaticPrimaryCommandbuffer();
-    vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+    m_oitCommandBuffer = GetRenderDevice()->AllocateStaticPrimaryCommandbuffer();
+    vkBeginCommandBuffer(m_oitCommandBuffer, &beginInfo);
     {
-        RenderPassBeginInfoBuilder builder;
-        std::vector<VkClearValue> vClearValeus = {{{.color = {0.0f, 0.0f, 0.0f, 0.0f}},
-                                                   {.depthStencil = {1.0f, 0}}}};
-        VkRenderPassBeginInfo renderPassBeginInfo =
-            builder.setRenderPass(m_renderPassParameters.GetRenderPass())
-                .setFramebuffer(m_renderPassParameters.GetFramebuffer())
-                .setRenderArea(m_renderArea)
-                .setClearValues(vClearValeus)
-                .Build();
-
-        vkCmdBeginRenderPass(m_commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        // Global mesh resource
-        const MeshVertexResources& vertexResource = GetMeshResourceManager()->GetMeshVertexResources();
-        VkDeviceSize offset = 0;
-        const VkBuffer& vertexBuffer = vertexResource.m_pVertexBuffer->buffer();
-        const VkBuffer& indexBuffer = vertexResource.m_pIndexBuffer->buffer();
-
-        // Upload draw commands
-        const DrawCommandBuffer<VkDrawIndexedIndirectCommand>* pDrawCommandBuffer = GetRenderResourceManager()->GetDrawCommandBuffer("transparent draw commands", drawCommands);
-
-        std::vector<VkDescriptorSet> vDescSets = m_renderPassParameters.AllocateDescriptorSets();
-        vkCmdBindDescriptorSets(
-            m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-            m_renderPassParameters.GetPipelineLayout(), 0,
-            static_cast<uint32_t>(vDescSets.size()),
-            vDescSets.data(), 0, nullptr);
-
-        vkCmdBindVertexBuffers(m_commandBuffer, 0, 1, &vertexBuffer,
-                               &offset);
-        vkCmdBindIndexBuffer(m_commandBuffer, indexBuffer, 0,
-                             VK_INDEX_TYPE_UINT32);
-        vkCmdBindPipeline(m_commandBuffer,
-                          VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          m_pipeline);
-
-        vkCmdDrawIndexedIndirect(m_commandBuffer, pDrawCommandBuffer->buffer(), 0, pDrawCommandBuffer->GetDrawCommandCount(), pDrawCommandBuffer->GetStride());
-        vkCmdEndRenderPass(m_commandBuffer);
+        SCOPED_MARKER(m_oitCommandBuffer, "Transparent OIT");
+        // Accumulation, revealage is cleared to fully visible
+        {
+            std::vector<VkClearValue> vClearValues = {{.color = {0.0f, 0.0f, 0.0f, 0.0f}},
+                                                      {.color = {1.0f, 0.0f, 0.0f, 0.0f}},
+                                                      {.depthStencil = {1.0f, 0}}};
+            RenderPassBeginInfoBuilder builder;
+            VkRenderPassBeginInfo renderPassBeginInfo =
+                builder.setRenderPass(m_oitParameters.GetRenderPass())
+                    .setFramebuffer(m_oitParameters.GetFramebuffer())
+                    .setRenderArea(m_renderArea)
+                    .setClearValues(vClearValues)
+                    .Build();
+            vkCmdBeginRenderPass(m_oitCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            vkCmdExecuteCommands(m_oitCommandBuffer, 1, &m_oitSecondaryCommandBuffer);
+            vkCmdEndRenderPass(m_oitCommandBuffer);
+        }
+
+        // Render pass already transitioned the targets to shader read, make the writes visible to the composite
+        VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(m_oitCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             1, &barrier, 0, nullptr, 0, nullptr);
+
+        // Composite onto the lighting output with a full screen quad
+        {
+            std::vector<VkClearValue> vClearValues = {{.color = {0.0f, 0.0f, 0.0f, 0.0f}}};
+            RenderPassBeginInfoBuilder builder;
+            VkRenderPassBeginInfo renderPassBeginInfo =
+                builder.setRenderPass(m_compositeParameters.GetRenderPass())
+                    .setFramebuffer(m_compositeParameters.GetFramebuffer())
+                    .setRenderArea(m_renderArea)
+                    .setClearValues(vClearValues)
+                    .Build();
+            vkCmdBeginRenderPass(m_oitCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            const Mesh& quadMesh = GetMeshResourceManager()->GetQuad();
+            const MeshVertexResources& meshVertexResources = GetMeshResourceManager()->GetMeshVertexResources();
+            VkDeviceSize offset = 0;
+            VkBuffer vertexBuffer = meshVertexResources.m_pVertexBuffer->buffer();
+            VkBuffer indexBuffer = meshVertexResources.m_pIndexBuffer->buffer();
+
+            vkCmdBindVertexBuffers(m_oitCommandBuffer, 0, 1, &vertexBuffer, &offset);
+            vkCmdBindIndexBuffer(m_oitCommandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindPipeline(m_oitCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_compositePipeline);
+            vkCmdBindDescriptorSets(m_oitCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    m_compositeParameters.GetPipelineLayout(), 0, 1, &m_compositeDescSet, 0, nullptr);
+            vkCmdDrawIndexed(m_oitCommandBuffer, quadMesh.m_nIndexCount, 1, quadMesh.m_nIndexOffset, 0, 0);
+            vkCmdEndRenderPass(m_oitCommandBuffer);
+        }
     }
-    vkEndCommandBuffer(m_commandBuffer);
+    vkEndCommandBuffer(m_oitCommandBuffer);
 }
 
 }  // namespace Muyo
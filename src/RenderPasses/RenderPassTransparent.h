@@ -1,25 +1,90 @@
 #pragma once
 
+#include "PerFrameStaging.h"
 #include "RenderPass.h"
 #include "Scene.h"
 
 namespace Muyo
 {
+template <class T>
+class DrawCommandBuffer;
+class Geometry;
+class BlendStateCIBuilder;
 class RenderPassTransparent : public RenderPass
 {
 public:
+    enum Mode
+    {
+        MODE_SORTED,                  // Alpha blended back to front, see SortDrawCommands
+        MODE_WEIGHTED_BLENDED_OIT,    // Weighted blended order-independent transparency, no sorting
+    };
+
+    static constexpr VkFormat OIT_ACCUMULATION_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr VkFormat OIT_REVEALAGE_FORMAT = VK_FORMAT_R16_SFLOAT;
+
     explicit RenderPassTransparent(VkExtent2D renderArea);
     ~RenderPassTransparent() override;
 
     void PrepareRenderPass() override;
     void CreatePipeline() override;
 
-    VkCommandBuffer GetCommandBuffer() const override { return m_commandBuffer; }
+    // Both modes are recorded, switching is free
+    VkCommandBuffer GetCommandBuffer() const override { return m_mode == MODE_SORTED ? m_commandBuffer : m_oitCommandBuffer; }
+    void SetMode(Mode mode) { m_mode = mode; }
+    Mode GetMode() const { return m_mode; }
+
     void RecordCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes);
 
+    // Split recording for multi-threading, see RenderPassRSM
+    bool PrepareCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes);
+    void RecordSecondaryCommandBuffer(uint32_t nThreadIdx);
+    void RecordPrimaryCommandBuffer();
+
+    // Sort draws back to front into the copy of frame slot nFrameIdx, the command buffer is not re-recorded.
+    // RecordDrawCommandCopy writes them to the indirect buffer at the start of the frame, earlier frames in flight
+    // keep their order.
+    void SortDrawCommands(const glm::mat4& mView, uint32_t nFrameIdx);
+    void RecordDrawCommandCopy(VkCommandBuffer cmdBuf, uint32_t nFrameIdx) const;
+
 private:
+    struct TransparentDraw
+    {
+        const Geometry* pGeometry = nullptr;
+        glm::vec3 vObjectCenter = glm::vec3(0.0);  // Sorting position in object space
+        VkDrawIndexedIndirectCommand command = {};
+    };
+
+    // Scene parameters shared by the sorted and the accumulation passes
+    static void AddSceneParameters(RenderPassParameters& renderPassParameters);
+    VkPipeline CreateScenePipeline(const RenderPassParameters& renderPassParameters, const std::string& sFragShader, const BlendStateCIBuilder& blendBuilder) const;
+    void CreateCompositePipeline();
+    void RecordDraws(VkCommandBuffer cmdBuf, VkPipeline pipeline, VkPipelineLayout pipelineLayout, const std::vector<VkDescriptorSet>& vDescSets) const;
+    void RecordOITPrimaryCommandBuffer();
+
+    Mode m_mode = MODE_SORTED;
+
     VkPipeline m_pipeline = VK_NULL_HANDLE;
     VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+    VkCommandBuffer m_secondaryCommandBuffer = VK_NULL_HANDLE;
+
+    // Weighted blended OIT: accumulation pass into private targets, then composite pass onto the lighting output.
+    // The targets never leave the pass so they are not tracked by the render graph.
+    RenderPassParameters m_oitParameters;
+    RenderPassParameters m_compositeParameters;
+    VkPipeline m_oitPipeline = VK_NULL_HANDLE;
+    VkPipeline m_compositePipeline = VK_NULL_HANDLE;
+    VkCommandBuffer m_oitCommandBuffer = VK_NULL_HANDLE;
+    VkCommandBuffer m_oitSecondaryCommandBuffer = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_vOITDescSets;
+    VkDescriptorSet m_compositeDescSet = VK_NULL_HANDLE;
+    DrawCommandBuffer<VkDrawIndexedIndirectCommand>* m_pDrawCommandBuffer = nullptr;
+    PerFrameStaging m_sortedDrawCommands;
+
+    // Draws in scene order, and sort keys (depth key << 32 | draw index) with scratch memory for radix sort
+    std::vector<TransparentDraw> m_vDraws;
+    std::vector<uint64_t> m_vSortKeys;
+    std::vector<uint64_t> m_vSortScratch;
+    std::vector<VkDescriptorSet> m_vDescSets;
     VkExtent2D m_renderArea = {0, 0};
 };
 
@@ -37,8 +37,11 @@ void ImGuiResource::CreateResources()
         0}};
     std::vector<ImDrawIdx> vDummpyIndex = {0};
 
-    pVertexBuffers = GetRenderResourceManager()->GetVertexBuffer<ImDrawVert>("UIVertex_buffer", vDummyVert, false);
-    pIndexBuffers = GetRenderResourceManager()->GetIndexBuffer("UIIndex_buffer", vDummpyIndex, false);
+    for (uint32_t i = 0; i < VkRenderDevice::FRAMES_IN_FLIGHT; i++)
+    {
+        apVertexBuffers[i] = GetRenderResourceManager()->GetVertexBuffer<ImDrawVert>("UIVertex_buffer_" + std::to_string(i), vDummyVert, false);
+        apIndexBuffers[i] = GetRenderResourceManager()->GetIndexBuffer("UIIndex_buffer_" + std::to_string(i), vDummpyIndex, false);
+    }
 }
 
 RenderPassUI::RenderPassUI(const VkExtent2D& renderArea)
@@ -50,6 +53,8 @@ RenderPassUI::RenderPassUI(const VkExtent2D& renderArea)
 
 void RenderPassUI::PrepareRenderPass()
 {
+    m_renderPassParameters.Reset();
+
     m_renderPassParameters.SetRenderArea(m_renderArea);
 
     RenderTarget* pTarget = GetRenderResourceManager()->GetRenderTarget(OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME, m_renderArea, VK_FORMAT_R16G16B16A16_SFLOAT);
@@ -91,8 +96,8 @@ void RenderPassUI::CreatePipeline()
     // Dynmaic state
     std::vector<VkDynamicState> dynamicStateEnables = {VK_DYNAMIC_STATE_SCISSOR };
 
-    VkShaderModule vertShdr = CreateShaderModule(ReadSpv("shaders/ui.vert.slang.spv"));
-    VkShaderModule fragShdr = CreateShaderModule(ReadSpv("shaders/ui.frag.spv"));
+    VkShaderModule vertShdr = GetShaderLibrary()->AcquireShaderModule("shaders/ui.vert.slang.spv");
+    VkShaderModule fragShdr = GetShaderLibrary()->AcquireShaderModule("shaders/ui.frag.spv");
     PipelineStateBuilder builder;
     // Build pipeline
     InputAssemblyStateCIBuilder iaBuilder;
@@ -122,8 +127,8 @@ void RenderPassUI::CreatePipeline()
                      .setSubpassIndex(0)
                      .Build(GetRenderDevice()->GetDevice());
 
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), vertShdr, nullptr);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), fragShdr, nullptr);
+    GetShaderLibrary()->ReleaseShaderModule(vertShdr);
+    GetShaderLibrary()->ReleaseShaderModule(fragShdr);
 
     setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_pipeline),
                             VK_OBJECT_TYPE_PIPELINE, "ImGui");
@@ -145,8 +150,9 @@ void RenderPassUI::NewFrame(VkExtent2D screenExtent)
     ImGui::Render();
 }
 
-void RenderPassUI::UpdateBuffers()
+void RenderPassUI::UpdateBuffers(uint32_t nFrameIdx)
 {
+    m_nFrameIdx = nFrameIdx;
     ImDrawData* imDrawData = ImGui::GetDrawData();
 
     // Note: Alignment is done inside buffer creation
@@ -161,12 +167,14 @@ void RenderPassUI::UpdateBuffers()
         return;
     }
 
-    // Prepare vertex buffer and index buffer
-    m_uiResources.pVertexBuffers->SetData(nullptr, vertexBufferSize);
-    m_uiResources.pIndexBuffers->SetData(nullptr, indexBufferSize);
+    // Buffers only grow and stay mapped, filling them is a memcpy
+    VertexBuffer<ImDrawVert>* pVertexBuffer = m_uiResources.apVertexBuffers[m_nFrameIdx];
+    IndexBuffer* pIndexBuffer = m_uiResources.apIndexBuffers[m_nFrameIdx];
+    pVertexBuffer->SetData(nullptr, vertexBufferSize);
+    pIndexBuffer->SetData(nullptr, indexBufferSize);
 
-    ImDrawVert* vtxDst = (ImDrawVert*)m_uiResources.pVertexBuffers->Map();
-    ImDrawIdx* idxDst = (ImDrawIdx*)m_uiResources.pIndexBuffers->Map();
+    ImDrawVert* vtxDst = (ImDrawVert*)pVertexBuffer->Map();
+    ImDrawIdx* idxDst = (ImDrawIdx*)pIndexBuffer->Map();
 
     for (int n = 0; n < imDrawData->CmdListsCount; n++)
     {
@@ -176,9 +184,6 @@ void RenderPassUI::UpdateBuffers()
         vtxDst += cmd_list->VtxBuffer.size();
         idxDst += cmd_list->IdxBuffer.size();
     }
-
-    m_uiResources.pVertexBuffers->Unmap();
-    m_uiResources.pIndexBuffers->Unmap();
 }
 
 void RenderPassUI::RecordCommandBuffer()
@@ -197,7 +202,7 @@ void RenderPassUI::RecordCommandBuffer()
     ImGuiIO& io = ImGui::GetIO();
 
     {
-        VkCommandBuffer& curCmdBuf = m_commandBuffer;
+        VkCommandBuffer& curCmdBuf = m_aCommandBuffers[m_nFrameIdx];
         if (curCmdBuf == VK_NULL_HANDLE)
         {
             curCmdBuf = GetRenderDevice()->AllocateReusablePrimaryCommandbuffer();
@@ -234,8 +239,8 @@ void RenderPassUI::RecordCommandBuffer()
 
             vkCmdBindPipeline(curCmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
 
-            VkBuffer vertexBuffer = m_uiResources.pVertexBuffers->buffer();
-            VkBuffer indexBuffer = m_uiResources.pIndexBuffers->buffer();
+            VkBuffer vertexBuffer = m_uiResources.apVertexBuffers[m_nFrameIdx]->buffer();
+            VkBuffer indexBuffer = m_uiResources.apIndexBuffers[m_nFrameIdx]->buffer();
 
             ImDrawData* pDrawData = ImGui::GetDrawData();
             int32_t nVertexOffset = 0;
@@ -254,9 +259,10 @@ void RenderPassUI::RecordCommandBuffer()
                     {
                         const ImDrawCmd& drawCmd = pDrawList->CmdBuffer[j];
                         // Bind correct texture
+                        const VkDescriptorSet textureDescSet = GetDescriptorManager()->GetImGuiTextureDescriptorSet((size_t)drawCmd.TextureId);
                         vkCmdBindDescriptorSets(curCmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS,
                                                 m_renderPassParameters.GetPipelineLayout(), 0, 1,
-                                                &GetDescriptorManager()->GetImGuiTextureDescriptorSet((size_t)drawCmd.TextureId), 0, nullptr);
+                                                &textureDescSet, 0, nullptr);
                         // Setup scissor rect according to the draw cmd
                         VkRect2D scissorRect;
                         scissorRect.offset.x = std::max((int32_t)(drawCmd.ClipRect.x), 0);
@@ -1,6 +1,7 @@
 #pragma once
 #include <imgui.h>
 
+#include <array>
 #include <memory>
 
 #include "DebugUI.h"
@@ -25,9 +26,9 @@ struct UISettings
 struct UIVertex;
 struct ImGuiResource
 {
-    // Vertex buffer and index buffer can be updated each frame
-    VertexBuffer<ImDrawVert>* pVertexBuffers;
-    IndexBuffer* pIndexBuffers;
+    // Vertex buffer and index buffer are updated each frame, one of each per frame in flight
+    std::array<VertexBuffer<ImDrawVert>*, VkRenderDevice::FRAMES_IN_FLIGHT> apVertexBuffers = {};
+    std::array<IndexBuffer*, VkRenderDevice::FRAMES_IN_FLIGHT> apIndexBuffers = {};
 
     VkSampler sampler;
     VkDeviceMemory fontMemory = VK_NULL_HANDLE;
@@ -49,12 +50,14 @@ public:
 
   void PrepareRenderPass() override;
   void CreatePipeline() override;
+  // Records the command buffer of the frame slot passed to UpdateBuffers
   void RecordCommandBuffer();
-  VkCommandBuffer GetCommandBuffer() const override { return m_commandBuffer; }
+  VkCommandBuffer GetCommandBuffer() const override { return m_aCommandBuffers[m_nFrameIdx]; }
 
   // ImGui Related functions
   void NewFrame(VkExtent2D screenExtent);
-  void UpdateBuffers();
+  // Fill the buffers of frame slot nFrameIdx, the GPU must be done with the frame that used it before
+  void UpdateBuffers(uint32_t nFrameIdx);
   void CreateImGuiResources();
   template<class DebugPageType>
   DebugPageType* RegisterDebugPage(const std::string& sName)
@@ -74,6 +77,7 @@ private:
 
     VkExtent2D m_renderArea;
     VkPipeline m_pipeline           = VK_NULL_HANDLE;
-    VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+    std::array<VkCommandBuffer, VkRenderDevice::FRAMES_IN_FLIGHT> m_aCommandBuffers = {};
+    uint32_t m_nFrameIdx = 0;
 };
 }  // namespace Muyo
@@ -11,6 +11,9 @@ static const std::string OPAQUE_LIGHTING_OUTPUT_ATTACHMENT_NAME = "opaqueLightin
 static const std::string PER_VIEW = "perView";
 static const std::string LIGHT_COUNT = "light count";
 static const std::string LIGHT_DATA = "light data";
+static const std::string LIGHT_CLUSTERS = "light clusters";                        // Offset and count of each cluster
+static const std::string CLUSTER_LIGHT_INDICES = "cluster light indices";          // Light indices of all clusters
+static const std::string CLUSTER_LIGHT_INDEX_COUNT = "cluster light index count";  // Allocated indices
 
 
 
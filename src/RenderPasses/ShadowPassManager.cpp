@@ -1,52 +1,370 @@
 #include "ShadowPassManager.h"
 
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
 
+#include "Geometry.h"
 #include "LightSceneNode.h"
+#include "ParallelCommandRecorder.h"
+#include "RenderResourceManager.h"
+#include "glm/gtc/constants.hpp"
 
 namespace Muyo
 {
 
+// Conservative test of an object space box against the clip volume, the box is rejected only when all its corners
+// are outside the same plane.
+static bool IsAABBInFrustum(const AABB& aabb, const glm::mat4& mObjectToClip)
+{
+    std::array<glm::vec4, 8> aCorners;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        glm::vec3 vCorner((i & 1) ? aabb.vMax.x : aabb.vMin.x,
+                          (i & 2) ? aabb.vMax.y : aabb.vMin.y,
+                          (i & 4) ? aabb.vMax.z : aabb.vMin.z);
+        aCorners[i] = mObjectToClip * glm::vec4(vCorner, 1.0f);
+    }
+    // Vulkan clip volume: -w <= x <= w, -w <= y <= w, 0 <= z <= w
+    auto AllOutside = [&aCorners](auto fIsOutside)
+    {
+        return std::all_of(aCorners.begin(), aCorners.end(), fIsOutside);
+    };
+    return !(AllOutside([](const glm::vec4& v) { return v.x < -v.w; }) ||
+             AllOutside([](const glm::vec4& v) { return v.x > v.w; }) ||
+             AllOutside([](const glm::vec4& v) { return v.y < -v.w; }) ||
+             AllOutside([](const glm::vec4& v) { return v.y > v.w; }) ||
+             AllOutside([](const glm::vec4& v) { return v.z < 0.0f; }) ||
+             AllOutside([](const glm::vec4& v) { return v.z > v.w; }));
+}
+
+// World space bounds of an object space box
+static AABB TransformAABB(const AABB& aabb, const glm::mat4& mWorld)
+{
+    AABB worldAABB = {glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest())};
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        glm::vec3 vCorner((i & 1) ? aabb.vMax.x : aabb.vMin.x,
+                          (i & 2) ? aabb.vMax.y : aabb.vMin.y,
+                          (i & 4) ? aabb.vMax.z : aabb.vMin.z);
+        glm::vec3 vWorldCorner = glm::vec3(mWorld * glm::vec4(vCorner, 1.0f));
+        worldAABB.vMin = glm::min(worldAABB.vMin, vWorldCorner);
+        worldAABB.vMax = glm::max(worldAABB.vMax, vWorldCorner);
+    }
+    return worldAABB;
+}
+
+void ShadowPassManager::CullShadowCasters(const SpotLightNode& light, const std::vector<const SceneNode*>& vpGeometryNodes, std::vector<const SceneNode*>& vpCasters)
+{
+    const glm::mat4 mLightViewProj = light.GetLightViewProjectionMatrix();
+    const glm::vec3 vLightPosition = light.GetWorldPosition();
+    const float fRangeSquared = light.GetRange() * light.GetRange();
+
+    vpCasters.clear();
+    for (const SceneNode* pGeometryNode : vpGeometryNodes)
+    {
+        const glm::mat4& mWorld = static_cast<const GeometrySceneNode*>(pGeometryNode)->GetGeometry()->GetWorldMatrix();
+        const AABB aabb = pGeometryNode->GetAABB();
+
+        // Out of light range, closest point of the box is further than the range
+        const AABB worldAABB = TransformAABB(aabb, mWorld);
+        const glm::vec3 vClosest = glm::clamp(vLightPosition, worldAABB.vMin, worldAABB.vMax);
+        const glm::vec3 vDelta = vClosest - vLightPosition;
+        if (glm::dot(vDelta, vDelta) > fRangeSquared)
+        {
+            continue;
+        }
+
+        // Outside of the shadow map frustum
+        if (!IsAABBInFrustum(aabb, mLightViewProj * mWorld))
+        {
+            continue;
+        }
+        vpCasters.push_back(pGeometryNode);
+    }
+}
+
+// Fraction of the screen covered by the sphere bounding the light's shadow range
+float ShadowPassManager::ComputeScreenCoverage(const SpotLightNode& light, const glm::mat4& mView, const glm::mat4& mProj)
+{
+    const float fRadius = std::min(light.GetRange(), light.GetShadowMapRange());
+    const glm::vec4 vViewPos = mView * glm::vec4(light.GetWorldPosition(), 1.0f);
+    const float fDepth = -vViewPos.z;
+    // Camera inside the sphere
+    if (glm::length(glm::vec3(vViewPos)) <= fRadius)
+    {
+        return 1.0f;
+    }
+    // Entirely behind the camera
+    if (fDepth < -fRadius)
+    {
+        return 0.0f;
+    }
+    // A sphere crossing the camera plane is projected as if it touched the plane, scaled by the part in front of it
+    const float fVisibleFraction = std::min((fDepth + fRadius) / (2.0f * fRadius), 1.0f);
+    const float fProjectedDepth = std::max(fDepth, fRadius);
+    // Projected ellipse area over the NDC area of 4
+    const float fRadiusX = fRadius * std::abs(mProj[0][0]) / fProjectedDepth;
+    const float fRadiusY = fRadius * std::abs(mProj[1][1]) / fProjectedDepth;
+    return std::min(glm::pi<float>() * fRadiusX * fRadiusY * 0.25f * fVisibleFraction, 1.0f);
+}
+
+// Remove every other bit, decodes one coordinate of a Morton index
+static uint32_t CompactBits(uint32_t n)
+{
+    n &= 0x55555555;
+    n = (n ^ (n >> 1)) & 0x33333333;
+    n = (n ^ (n >> 2)) & 0x0f0f0f0f;
+    n = (n ^ (n >> 4)) & 0x00ff00ff;
+    n = (n ^ (n >> 8)) & 0x0000ffff;
+    return n;
+}
+
 void ShadowPassManager::SetLights(const DrawList& lightList)
 {
+    // Lights are set again whenever static command buffers are recorded
+    m_vpLights.clear();
+    m_vLightDataIndices.clear();
+    m_vCaches.clear();
     for (size_t i = 0; i < lightList.size(); ++i)
     {
         const SpotLightNode* pLight = dynamic_cast<const SpotLightNode*>(lightList[i]);
         if (pLight)
         {
             // Shadow map index is set when gethring the light from draw list.
-            m_vpShadowPasses.emplace_back(std::make_unique<RenderPassRSM>(pLight->GetName(), VkExtent2D{1024, 1024}, static_cast<uint32_t>(i)));
+            assert(pLight->GetShadowMapIndex() == static_cast<int>(m_vpLights.size()));
+            m_vpLights.push_back(pLight);
+            m_vLightDataIndices.push_back(static_cast<uint32_t>(i));
+            m_vCaches.emplace_back();
+        }
+    }
+}
+
+void ShadowPassManager::AllocateAtlasTiles(const glm::mat4& mView, const glm::mat4& mProj)
+{
+    const size_t nNumLights = m_vpLights.size();
+    if (nNumLights == 0)
+    {
+        m_pShadowPass->SetTiles({});
+        return;
+    }
+
+    // Importance of a light is its screen coverage weighted by its intensity. The most important light gets the
+    // largest tile, the others are scaled by the square root of their relative importance so their texel count
+    // follows it.
+    std::vector<float> vImportances(nNumLights);
+    for (size_t i = 0; i < nNumLights; i++)
+    {
+        vImportances[i] = ComputeScreenCoverage(*m_vpLights[i], mView, mProj) * m_vpLights[i]->GetIntensity();
+    }
+    const float fMaxImportance = *std::max_element(vImportances.begin(), vImportances.end());
+
+    std::vector<uint32_t> vTileSizes(nNumLights, MIN_TILE_SIZE);
+    for (size_t i = 0; i < nNumLights; i++)
+    {
+        const float fRelativeImportance = fMaxImportance > 0.0f ? vImportances[i] / fMaxImportance : 0.0f;
+        const uint32_t nSize = std::min(static_cast<uint32_t>(MAX_TILE_SIZE * std::sqrt(fRelativeImportance)), MAX_TILE_SIZE);
+        // Round down to a power of two so tiles pack without gaps
+        while (vTileSizes[i] * 2 <= nSize)
+        {
+            vTileSizes[i] *= 2;
+        }
+    }
+
+    // Halve the largest tiles until all of them fit in the atlas
+    const uint64_t nAtlasArea = static_cast<uint64_t>(ATLAS_SIZE.width) * ATLAS_SIZE.height;
+    auto TotalArea = [&vTileSizes]()
+    {
+        uint64_t nArea = 0;
+        for (uint32_t nSize : vTileSizes)
+        {
+            nArea += static_cast<uint64_t>(nSize) * nSize;
+        }
+        return nArea;
+    };
+    while (TotalArea() > nAtlasArea)
+    {
+        const uint32_t nLargest = *std::max_element(vTileSizes.begin(), vTileSizes.end());
+        if (nLargest == MIN_TILE_SIZE)
+        {
+            assert(false && "Too many shadow casting lights for the shadow atlas");
+            break;
+        }
+        std::for_each(vTileSizes.begin(), vTileSizes.end(), [nLargest](uint32_t& nSize)
+                      { nSize = nSize == nLargest ? nSize / 2 : nSize; });
+    }
+
+    // Place tiles from largest to smallest along the Morton curve of MIN_TILE_SIZE cells. Sizes are powers of two in
+    // decreasing order, each tile starts at a cell index aligned to its cell count and covers a square block.
+    std::vector<size_t> vOrder(nNumLights);
+    std::iota(vOrder.begin(), vOrder.end(), 0);
+    std::stable_sort(vOrder.begin(), vOrder.end(), [&vTileSizes](size_t a, size_t b)
+                     { return vTileSizes[a] > vTileSizes[b]; });
+
+    std::vector<RenderPassRSM::ShadowTile> vTiles(nNumLights);
+    std::vector<glm::vec4> vTileRects(nNumLights, glm::vec4(0.0f));
+    const uint32_t nAtlasCells = (ATLAS_SIZE.width / MIN_TILE_SIZE) * (ATLAS_SIZE.height / MIN_TILE_SIZE);
+    uint32_t nCell = 0;
+    for (size_t i : vOrder)
+    {
+        vTiles[i].nLightIndex = m_vLightDataIndices[i];
+        const uint32_t nSize = vTileSizes[i];
+        const uint32_t nCellCount = (nSize / MIN_TILE_SIZE) * (nSize / MIN_TILE_SIZE);
+        if (nCell + nCellCount > nAtlasCells)
+        {
+            // Atlas is full, the light is left without a tile
+            continue;
         }
+        const int32_t nX = static_cast<int32_t>(CompactBits(nCell) * MIN_TILE_SIZE);
+        const int32_t nY = static_cast<int32_t>(CompactBits(nCell >> 1) * MIN_TILE_SIZE);
+        nCell += nCellCount;
+
+        vTiles[i].rect = {{nX, nY}, {nSize, nSize}};
+        vTileRects[i] = glm::vec4(static_cast<float>(nX) / ATLAS_SIZE.width, static_cast<float>(nY) / ATLAS_SIZE.height,
+                                  static_cast<float>(nSize) / ATLAS_SIZE.width, static_cast<float>(nSize) / ATLAS_SIZE.height);
+    }
+    m_pShadowPass->SetTiles(vTiles);
+
+    // Tiles are indexed by shadow map index in lighting
+    StorageBuffer<glm::vec4>* pTileBuffer = GetRenderResourceManager()->GetResource<StorageBuffer<glm::vec4>>(TILE_BUFFER_NAME);
+    if (pTileBuffer != nullptr)
+    {
+        pTileBuffer->SetData(vTileRects.data(), sizeof(glm::vec4) * vTileRects.size());
+    }
+    else
+    {
+        GetRenderResourceManager()->GetStorageBuffer(TILE_BUFFER_NAME, vTileRects);
     }
+
+    // Tiles moved, all maps must be re-rendered
+    InvalidateShadowMaps();
 }
 
 void ShadowPassManager::PrepareRenderPasses()
 {
-    std::for_each(m_vpShadowPasses.begin(), m_vpShadowPasses.end(), [](auto& pShadowPass)
-                  { pShadowPass->PrepareRenderPass(); });
+    // Atlases are only created when there are shadow casting lights
+    if (!HasShadowMaps())
+    {
+        return;
+    }
+    m_pShadowPass->PrepareRenderPass();
+    // Lighting binds the settings, they are written every frame
+    GetRenderResourceManager()->GetPerFrameUniformBuffer<ShadowFilterSettings>(FILTER_SETTINGS_NAME);
+}
+
+void ShadowPassManager::PrecompilePipelines()
+{
+    m_pShadowPass->PrepareRenderPass();
+    m_pShadowPass->WaitForPipelines();
+}
+
+uint32_t ShadowPassManager::GetTapCountBucket(uint32_t nTapCount)
+{
+    for (uint32_t nBucket : TAP_COUNT_BUCKETS)
+    {
+        if (nTapCount <= nBucket)
+        {
+            return nBucket;
+        }
+    }
+    return TAP_COUNT_BUCKETS.back();
+}
+
+void ShadowPassManager::SetFilterSettings(const ShadowFilterSettings& settings)
+{
+    m_filterSettings = settings;
+    m_filterSettings.nMode = std::min(settings.nMode, SHADOW_FILTER_COUNT - 1);
+    m_filterSettings.nTapCount = std::clamp(settings.nTapCount, 1u, SHADOW_FILTER_MAX_TAPS);
+}
+
+void ShadowPassManager::UpdateFilterSettings(uint32_t nFrameIdx)
+{
+    // Every frame slot has its own copy, each one must be rewritten
+    GetRenderResourceManager()->GetPerFrameUniformBuffer<ShadowFilterSettings>(FILTER_SETTINGS_NAME)->SetData(m_filterSettings, nFrameIdx);
 }
 
 void ShadowPassManager::RecordCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes)
 {
-    std::for_each(m_vpShadowPasses.begin(), m_vpShadowPasses.end(), [&vpGeometryNodes](auto& pShadowPass)
-                  { pShadowPass->RecordCommandBuffers(vpGeometryNodes); });
+    PrepareCommandBuffers(vpGeometryNodes);
+    ParallelCommandRecorder recorder;
+    AddRecordingJobs(recorder);
+    recorder.Execute();
 }
 
-std::vector<VkCommandBuffer> ShadowPassManager::GetCommandBuffers() const
+void ShadowPassManager::PrepareCommandBuffers(const std::vector<const SceneNode*>& vpGeometryNodes)
 {
-    std::vector<VkCommandBuffer> vCommandBuffers;
-    std::for_each(m_vpShadowPasses.begin(), m_vpShadowPasses.end(), [&vCommandBuffers](const auto& pShadowPass)
-                  { vCommandBuffers.push_back(pShadowPass->GetCommandBuffer()); });
-    return vCommandBuffers;
+    if (!HasShadowMaps())
+    {
+        return;
+    }
+    // Draw commands are uploaded in prepare, the caster lists are only needed there
+    std::vector<std::vector<const SceneNode*>> vvpCasters(m_vpLights.size());
+    for (size_t i = 0; i < m_vpLights.size(); i++)
+    {
+        CullShadowCasters(*m_vpLights[i], vpGeometryNodes, vvpCasters[i]);
+    }
+    m_pShadowPass->PrepareCommandBuffers(vvpCasters);
+    // Caster lists are rebuilt
+    InvalidateShadowMaps();
 }
 
-std::vector<RSMResources> ShadowPassManager::GetShadowMaps() const
+void ShadowPassManager::RecordDirtyShadowMaps(uint32_t nFrameIdx)
 {
-    std::vector<RSMResources> vpShadowMaps;
+    std::vector<uint32_t> vDirtyTiles;
+    for (size_t i = 0; i < m_vpLights.size(); i++)
+    {
+        ShadowMapCache& cache = m_vCaches[i];
+        const SpotLightNode* pLight = m_vpLights[i];
+        const glm::mat4 mLightViewProj = pLight->GetLightViewProjectionMatrix();
+        // Flux stored in the RSM is scaled by the light color and intensity
+        if (!cache.bIsValid || cache.mLightViewProj != mLightViewProj ||
+            cache.vColor != pLight->GetColor() || cache.fIntensity != pLight->GetIntensity())
+        {
+            vDirtyTiles.push_back(static_cast<uint32_t>(i));
+            cache.mLightViewProj = mLightViewProj;
+            cache.vColor = pLight->GetColor();
+            cache.fIntensity = pLight->GetIntensity();
+            cache.bIsValid = false;
+            cache.bIsPending = true;
+        }
+    }
+    m_pShadowPass->RecordPrimaryCommandBuffer(vDirtyTiles, nFrameIdx);
+}
 
-    std::for_each(m_vpShadowPasses.begin(), m_vpShadowPasses.end(), [&vpShadowMaps](const std::unique_ptr<RenderPassRSM>& pShadowPass)
-                  { vpShadowMaps.push_back(pShadowPass->GetRSM()); });
-    return vpShadowMaps;
+void ShadowPassManager::OnShadowMapsSubmitted()
+{
+    for (ShadowMapCache& cache : m_vCaches)
+    {
+        cache.bIsValid |= cache.bIsPending;
+        cache.bIsPending = false;
+    }
+}
+
+void ShadowPassManager::InvalidateShadowMaps()
+{
+    for (ShadowMapCache& cache : m_vCaches)
+    {
+        cache.bIsValid = false;
+        cache.bIsPending = false;
+    }
+}
+
+void ShadowPassManager::AddRecordingJobs(ParallelCommandRecorder& recorder)
+{
+    // Jobs bind the pipeline on recording threads, wait for it here
+    m_pShadowPass->WaitForPipelines();
+    for (uint32_t nTileIdx = 0; nTileIdx < static_cast<uint32_t>(m_vpLights.size()); nTileIdx++)
+    {
+        recorder.AddJob([pPass = m_pShadowPass.get(), nTileIdx](uint32_t nThreadIdx)
+                        { pPass->RecordSecondaryCommandBuffer(nTileIdx, nThreadIdx); });
+    }
+}
+
+RSMResources ShadowPassManager::GetShadowMaps() const
+{
+    return m_pShadowPass->GetRSM();
 }
 
 }  // namespace Muyo
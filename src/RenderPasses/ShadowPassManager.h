@@ -1,25 +1,95 @@
 #pragma once
 
+#include <array>
+
 #include "RenderPassRSM.h"
 #include "Scene.h"
+#include "SharedStructures.h"
 #include "UniformBuffer.h"
 
 namespace Muyo
 {
 class RenderPassRSM;
 class RenderTarget;
+class ParallelCommandRecorder;
+class SpotLightNode;
+
+/*
+ * Shadow maps of all spot lights are rendered into a shared atlas. Each light gets a tile whose resolution is picked
+ * from the light's screen coverage and intensity, tiles are packed when static command buffers are recorded.
+ * Tile placements are uploaded to "shadow atlas tiles", indexed by shadow map index, as atlas UV offset (xy) and
+ * scale (zw).
+ */
 class ShadowPassManager
 {
 public:
-    ShadowPassManager() = default;
+    static constexpr VkExtent2D ATLAS_SIZE = {2048, 2048};
+    static constexpr uint32_t MIN_TILE_SIZE = 64;
+    static constexpr uint32_t MAX_TILE_SIZE = 1024;
+    static constexpr const char* TILE_BUFFER_NAME = "shadow atlas tiles";
+    static constexpr const char* FILTER_SETTINGS_NAME = "shadow filter settings";
+    // Tap counts specialize the lighting pipeline rounded up to one of these, the bucket bounds the filter loop and
+    // the exact count is read from the filter settings
+    static constexpr std::array<uint32_t, 5> TAP_COUNT_BUCKETS = {4, 8, 16, 32, SHADOW_FILTER_MAX_TAPS};
+    static uint32_t GetTapCountBucket(uint32_t nTapCount);
+
+    ShadowPassManager() : m_pShadowPass(std::make_unique<RenderPassRSM>(ATLAS_SIZE)) {}
     ShadowPassManager(const ShadowPassManager&) = delete;
     void SetLights(const DrawList& lightList);
+
+    // Pick tile sizes from the camera and pack them into the atlas, must be called after SetLights
+    void AllocateAtlasTiles(const glm::mat4& mView, const glm::mat4& mProj);
+
     void PrepareRenderPasses();
+    // Build the atlas pipelines without lights, no atlas command buffer is recorded
+    void PrecompilePipelines();
     void RecordCommandBuffers(const std::vector<const SceneNode*>& geometryNodes);
-    std::vector<VkCommandBuffer> GetCommandBuffers() const;
-    std::vector<RSMResources> GetShadowMaps() const;
+
+    // Multi-threaded recording steps, the tile of each light is recorded as a separate job. Each tile only draws the
+    // casters inside its light's frustum and range.
+    void PrepareCommandBuffers(const std::vector<const SceneNode*>& geometryNodes);
+    void AddRecordingJobs(ParallelCommandRecorder& recorder);
+
+    // Shadow maps are cached across frames. Records the atlas command buffer of frame slot nFrameIdx with the tiles
+    // that must be re-rendered because their light moved or changed color or intensity (RSM flux), or their casters
+    // changed. The tiles are only treated as valid once the command buffer has been submitted.
+    void RecordDirtyShadowMaps(uint32_t nFrameIdx);
+    void OnShadowMapsSubmitted();
+    void InvalidateShadowMaps();
+
+    // Filter used when lighting samples the shadow maps. Settings are written to the copy of frame slot nFrameIdx of
+    // "shadow filter settings" by UpdateFilterSettings every frame. Mode and tap count bucket are also specialization
+    // constants of the lighting pipeline, the lighting pass picks them up when it's prepared.
+    void SetFilterSettings(const ShadowFilterSettings& settings);
+    const ShadowFilterSettings& GetFilterSettings() const { return m_filterSettings; }
+    void UpdateFilterSettings(uint32_t nFrameIdx);
+
+    bool HasShadowMaps() const { return !m_vpLights.empty(); }
+    RSMResources GetShadowMaps() const;
+    const RenderPassRSM* GetShadowPass() const { return m_pShadowPass.get(); }
 
 private:
-    std::vector<std::unique_ptr<RenderPassRSM>> m_vpShadowPasses;
+    // Keep geometry nodes whose bounds intersect the light frustum and range
+    static void CullShadowCasters(const SpotLightNode& light, const std::vector<const SceneNode*>& vpGeometryNodes, std::vector<const SceneNode*>& vpCasters);
+
+    // Fraction of the screen covered by the light's range
+    static float ComputeScreenCoverage(const SpotLightNode& light, const glm::mat4& mView, const glm::mat4& mProj);
+
+    // Light state the cached maps were rendered with
+    struct ShadowMapCache
+    {
+        glm::mat4 mLightViewProj = glm::mat4(1.0);
+        glm::vec3 vColor = glm::vec3(0.0);
+        float fIntensity = 0.0f;
+        bool bIsValid = false;
+        bool bIsPending = false;  // Recorded in this frame's atlas command buffer, not submitted yet
+    };
+
+    std::unique_ptr<RenderPassRSM> m_pShadowPass;
+    std::vector<const SpotLightNode*> m_vpLights;  // Light of each tile, in shadow map index order
+    std::vector<uint32_t> m_vLightDataIndices;     // Index of each light in light data
+    std::vector<ShadowMapCache> m_vCaches;
+
+    ShadowFilterSettings m_filterSettings = {SHADOW_FILTER_POISSON, 16, 2.5f, 1, 0, 0, 0, 0};
 };
 }  // namespace Muyo
@@ -0,0 +1,139 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "Debug.h"
+#include "VkRenderDevice.h"
+
+namespace Muyo
+{
+
+// Each pool holds up to nSetsPerPool sets and this many descriptors of each type per set on average. Sets rarely use
+// more than a couple of types, a pool running out of one type is chained like a pool running out of sets.
+static const uint32_t DESCRIPTORS_PER_SET = 2;
+static const std::array<VkDescriptorType, 11> POOL_DESCRIPTOR_TYPES = {
+    VK_DESCRIPTOR_TYPE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+    VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,
+    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+    VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT};
+
+DescriptorPoolChain::DescriptorPoolChain(const std::string& sName, bool bCanFreeSets, uint32_t nSetsPerPool)
+    : m_sName(sName), m_bCanFreeSets(bCanFreeSets), m_nSetsPerPool(nSetsPerPool)
+{
+}
+
+VkDescriptorPool DescriptorPoolChain::CreatePool()
+{
+    std::vector<VkDescriptorPoolSize> vPoolSizes;
+    vPoolSizes.reserve(POOL_DESCRIPTOR_TYPES.size());
+    for (VkDescriptorType type : POOL_DESCRIPTOR_TYPES)
+    {
+        vPoolSizes.push_back({type, m_nSetsPerPool * DESCRIPTORS_PER_SET});
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = m_bCanFreeSets ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(vPoolSizes.size());
+    poolInfo.pPoolSizes = vPoolSizes.data();
+    poolInfo.maxSets = m_nSetsPerPool;
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VK_ASSERT(vkCreateDescriptorPool(GetRenderDevice()->GetDevice(), &poolInfo, nullptr, &pool));
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(pool), VK_OBJECT_TYPE_DESCRIPTOR_POOL, (m_sName + " " + std::to_string(m_vPools.size())).c_str());
+    return pool;
+}
+
+VkDescriptorSet DescriptorPoolChain::Allocate(VkDescriptorSetLayout layout)
+{
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    // Start from the pool of the last allocation. Linear chains never look back, full pools are only refilled by a
+    // reset. Free-able chains wrap around since freed sets leave room in earlier pools.
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    const size_t nPoolsToTry = m_bCanFreeSets ? m_vPools.size() : m_vPools.size() - std::min(m_nCurrentPool, m_vPools.size());
+    size_t nPoolIdx = m_nCurrentPool;
+    bool bAllocated = false;
+    for (size_t i = 0; i < nPoolsToTry && !bAllocated; i++)
+    {
+        nPoolIdx = (m_nCurrentPool + i) % m_vPools.size();
+        allocInfo.descriptorPool = m_vPools[nPoolIdx];
+        const VkResult result = vkAllocateDescriptorSets(GetRenderDevice()->GetDevice(), &allocInfo, &descriptorSet);
+        if (result == VK_SUCCESS)
+        {
+            bAllocated = true;
+        }
+        else if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+        {
+            VK_ASSERT(result);
+        }
+    }
+
+    if (!bAllocated)
+    {
+        // All pools are full, chain a new one
+        m_vPools.push_back(CreatePool());
+        nPoolIdx = m_vPools.size() - 1;
+        allocInfo.descriptorPool = m_vPools[nPoolIdx];
+        VK_ASSERT(vkAllocateDescriptorSets(GetRenderDevice()->GetDevice(), &allocInfo, &descriptorSet));
+    }
+
+    m_nCurrentPool = nPoolIdx;
+    if (m_bCanFreeSets)
+    {
+        m_mSetPools[descriptorSet] = nPoolIdx;
+    }
+    m_nSetCount++;
+    m_nPeakSetCount = std::max(m_nPeakSetCount, m_nSetCount);
+    return descriptorSet;
+}
+
+void DescriptorPoolChain::Free(const std::vector<VkDescriptorSet>& vDescriptorSets)
+{
+    assert(m_bCanFreeSets && "Sets of a linear chain are released by Reset");
+    for (VkDescriptorSet descriptorSet : vDescriptorSets)
+    {
+        auto it = m_mSetPools.find(descriptorSet);
+        assert(it != m_mSetPools.end());
+        VK_ASSERT(vkFreeDescriptorSets(GetRenderDevice()->GetDevice(), m_vPools[it->second], 1, &descriptorSet));
+        m_mSetPools.erase(it);
+        m_nSetCount--;
+    }
+}
+
+void DescriptorPoolChain::Reset()
+{
+    for (VkDescriptorPool pool : m_vPools)
+    {
+        VK_ASSERT(vkResetDescriptorPool(GetRenderDevice()->GetDevice(), pool, 0));
+    }
+    m_mSetPools.clear();
+    m_nCurrentPool = 0;
+    m_nSetCount = 0;
+}
+
+void DescriptorPoolChain::Destroy()
+{
+    for (VkDescriptorPool pool : m_vPools)
+    {
+        vkDestroyDescriptorPool(GetRenderDevice()->GetDevice(), pool, nullptr);
+    }
+    m_vPools.clear();
+    m_mSetPools.clear();
+    m_nCurrentPool = 0;
+    m_nSetCount = 0;
+}
+
+}  // namespace Muyo
@@ -0,0 +1,59 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Muyo
+{
+/*
+ * A chain of descriptor pools of the same size. A new pool is chained when the existing ones are out of memory, so
+ * allocations never fail because of the pool sizes.
+ *
+ * Free-able chains are created with FREE_DESCRIPTOR_SET_BIT and remember the pool of each set, they hold persistent
+ * sets. Linear chains only allocate forward and are reset as a whole, they hold transient sets.
+ */
+class DescriptorPoolChain
+{
+public:
+    DescriptorPoolChain(const std::string& sName, bool bCanFreeSets, uint32_t nSetsPerPool);
+
+    // Pools are created lazily by the first allocation
+    VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+    void Free(const std::vector<VkDescriptorSet>& vDescriptorSets);
+    // Release all the sets, the pools are kept for the next allocations
+    void Reset();
+    void Destroy();
+
+    uint32_t GetPoolCount() const { return static_cast<uint32_t>(m_vPools.size()); }
+    uint32_t GetSetCount() const { return m_nSetCount; }
+    uint32_t GetPeakSetCount() const { return m_nPeakSetCount; }
+
+private:
+    VkDescriptorPool CreatePool();
+
+    const std::string m_sName;
+    const bool m_bCanFreeSets;
+    const uint32_t m_nSetsPerPool;
+
+    std::vector<VkDescriptorPool> m_vPools;
+    size_t m_nCurrentPool = 0;  // Pool the last allocation succeeded in
+    std::unordered_map<VkDescriptorSet, size_t> m_mSetPools;  // Pool index of each set, free-able chains only
+
+    uint32_t m_nSetCount = 0;
+    uint32_t m_nPeakSetCount = 0;
+};
+
+struct DescriptorAllocatorStats
+{
+    uint32_t nPersistentPools = 0;
+    uint32_t nPersistentSets = 0;
+    uint32_t nCachedSets = 0;      // Persistent sets owned by the render pass descriptor set cache
+    uint32_t nRetiredSets = 0;     // Waiting for submitted frames to finish
+    uint32_t nTransientPools = 0;  // All frames
+    uint32_t nTransientSets = 0;   // Current frame
+    uint32_t nPeakTransientSets = 0;
+};
+}  // namespace Muyo
@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
 #include <cassert>
 
 #include "Debug.h"
@@ -17,21 +18,38 @@ static DescriptorManager descriptorManager;
 
 void DescriptorManager::createDescriptorPool()
 {
-    VkDescriptorPoolCreateInfo poolInfo = {};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(POOL_SIZES.size());
-    poolInfo.pPoolSizes = POOL_SIZES.data();
-    poolInfo.maxSets =
-        DESCRIPTOR_COUNT_EACH_TYPE * static_cast<uint32_t>(POOL_SIZES.size());
-    VK_ASSERT(vkCreateDescriptorPool(GetRenderDevice()->GetDevice(), &poolInfo,
-                                  nullptr, &m_descriptorPool) );
+    // Persistent and transient pools are chained on demand by their first allocations.
+    // Bindless heap lives in its own pool, update-after-bind sets can't be allocated from a regular one
+    const std::array<VkDescriptorPoolSize, 3> bindlessPoolSizes = {{
+        {VK_DESCRIPTOR_TYPE_SAMPLER, SAMPLER_TYPE_COUNT},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, MAX_BINDLESS_TEXTURES},
+    }};
+    VkDescriptorPoolCreateInfo bindlessPoolInfo = {};
+    bindlessPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    bindlessPoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    bindlessPoolInfo.poolSizeCount = static_cast<uint32_t>(bindlessPoolSizes.size());
+    bindlessPoolInfo.pPoolSizes = bindlessPoolSizes.data();
+    bindlessPoolInfo.maxSets = 1;
+    VK_ASSERT(vkCreateDescriptorPool(GetRenderDevice()->GetDevice(), &bindlessPoolInfo,
+                                  nullptr, &m_bindlessDescriptorPool) );
 }
 
 void DescriptorManager::destroyDescriptorPool()
 {
-    vkDestroyDescriptorPool(GetRenderDevice()->GetDevice(), m_descriptorPool,
+    m_persistentPools.Destroy();
+    for (TransientFrame& frame : m_aTransientFrames)
+    {
+        frame.pools.Destroy();
+    }
+    vkDestroyDescriptorPool(GetRenderDevice()->GetDevice(), m_bindlessDescriptorPool,
                             nullptr);
+    m_bindlessDescriptorSet = VK_NULL_HANDLE;
+    m_nBindlessTextureCount = 0;
+
+    // Cached and retired sets are freed with their pool
+    m_mDescriptorSetCache.clear();
+    m_vRetiredDescriptorSets.clear();
 }
 
 void DescriptorManager::createDescriptorSetLayouts()
@@ -139,16 +157,29 @@ void DescriptorManager::createDescriptorSetLayouts()
         m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_PER_OBJ_DATA] = layout;
     }
 
-    // Material layout
+    // Bindless layout
     {
+        std::array<VkDescriptorSetLayoutBinding, BINDLESS_BINDING_COUNT> bindings = {
+            GetBinding(BINDLESS_BINDING_SAMPLERS, VK_DESCRIPTOR_TYPE_SAMPLER, SAMPLER_TYPE_COUNT, VK_SHADER_STAGE_FRAGMENT_BIT),
+            GetBinding(BINDLESS_BINDING_MATERIALS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT),
+            GetBinding(BINDLESS_BINDING_TEXTURES, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, MAX_BINDLESS_TEXTURES, VK_SHADER_STAGE_FRAGMENT_BIT)};
+
+        // Textures are added while the set is bound by recorded command buffers, slots that aren't registered yet
+        // are never indexed
+        std::array<VkDescriptorBindingFlags, BINDLESS_BINDING_COUNT> bindingFlags = {
+            0,
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT};
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = (uint32_t)bindingFlags.size();
+        bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo = {};
         descriptorSetLayoutInfo.sType =
             VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings = {
-            GetSamplerArrayBinding(0, Material::TEX_COUNT),
-            GetUniformBufferBinding(1, VK_SHADER_STAGE_FRAGMENT_BIT)};  // PBR material
-
+        descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+        descriptorSetLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
         descriptorSetLayoutInfo.bindingCount = (uint32_t)bindings.size();
         descriptorSetLayoutInfo.pBindings = bindings.data();
 
@@ -159,8 +190,8 @@ void DescriptorManager::createDescriptorSetLayouts()
 
         setDebugUtilsObjectName(reinterpret_cast<uint64_t>(layout),
                                 VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT,
-                                "Material");
-        m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_MATERIALS] = layout;
+                                "Bindless");
+        m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_BINDLESS] = layout;
     }
 
     // IBL layout
@@ -243,97 +274,247 @@ void DescriptorManager::destroyDescriptorSetLayouts()
     }
 }
 
-VkDescriptorSet DescriptorManager::AllocateMaterialDescriptorSet()
+void DescriptorManager::CreateBindlessDescriptorSet()
 {
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-    // Create descriptor sets
+    const uint32_t nTextureCount = MAX_BINDLESS_TEXTURES;
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo = {};
+    variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+    variableCountInfo.descriptorSetCount = 1;
+    variableCountInfo.pDescriptorCounts = &nTextureCount;
+
     VkDescriptorSetAllocateInfo allocInfo = {};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.pNext = &variableCountInfo;
+    allocInfo.descriptorPool = m_bindlessDescriptorPool;
     allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts =
-        &m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_MATERIALS];
+    allocInfo.pSetLayouts = &m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_BINDLESS];
     VK_ASSERT(vkAllocateDescriptorSets(GetRenderDevice()->GetDevice(), &allocInfo,
-                                    &descriptorSet) );
+                                    &m_bindlessDescriptorSet) );
 
-    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(descriptorSet),
-                            VK_OBJECT_TYPE_DESCRIPTOR_SET, "Material");
+    setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_bindlessDescriptorSet),
+                            VK_OBJECT_TYPE_DESCRIPTOR_SET, "Bindless");
 
-    return descriptorSet;
+    // Global sampler table, written once
+    std::array<VkDescriptorImageInfo, SAMPLER_TYPE_COUNT> samplerInfos = {};
+    for (uint32_t i = 0; i < SAMPLER_TYPE_COUNT; i++)
+    {
+        samplerInfos[i].sampler = GetSamplerManager()->getSampler(static_cast<SamplerTypes>(i));
+    }
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = m_bindlessDescriptorSet;
+    descriptorWrite.dstBinding = BINDLESS_BINDING_SAMPLERS;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    descriptorWrite.descriptorCount = static_cast<uint32_t>(samplerInfos.size());
+    descriptorWrite.pImageInfo = samplerInfos.data();
+
+    vkUpdateDescriptorSets(GetRenderDevice()->GetDevice(), 1,
+                           &descriptorWrite, 0, nullptr);
 }
 
-VkDescriptorSet DescriptorManager::AllocateMaterialDescriptorSet(const Material::MaterialParameters& materialParameters)
+uint32_t DescriptorManager::RegisterTexture(VkImageView textureView)
 {
-    VkDescriptorSet descSet = AllocateMaterialDescriptorSet();
-    UpdateMaterialDescriptorSet(descSet, materialParameters);
-    return descSet;
+    assert(m_bindlessDescriptorSet != VK_NULL_HANDLE);
+    assert(m_nBindlessTextureCount < MAX_BINDLESS_TEXTURES && "Bindless texture heap is full");
+    const uint32_t nSlot = m_nBindlessTextureCount++;
+
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = textureView;
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = m_bindlessDescriptorSet;
+    descriptorWrite.dstBinding = BINDLESS_BINDING_TEXTURES;
+    descriptorWrite.dstArrayElement = nSlot;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(GetRenderDevice()->GetDevice(), 1,
+                           &descriptorWrite, 0, nullptr);
+    return nSlot;
 }
 
-void DescriptorManager::UpdateMaterialDescriptorSet(VkDescriptorSet descriptorSet, const Material::MaterialParameters& materialParameters)
+void DescriptorManager::SetMaterialBuffer(const BufferResource& materialBuffer)
 {
-    assert(materialParameters.m_apTextures.size() == Material::TEX_COUNT);
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = materialBuffer.buffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = materialBuffer.GetSize();
 
-    // prepare image array info for descriptor
-    std::array<VkDescriptorImageInfo, Material::TEX_COUNT> imageInfos = {};
-    for (size_t i = 0; i < Material::TEX_COUNT; i++)
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = m_bindlessDescriptorSet;
+    descriptorWrite.dstBinding = BINDLESS_BINDING_MATERIALS;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(GetRenderDevice()->GetDevice(), 1,
+                           &descriptorWrite, 0, nullptr);
+}
+
+DescriptorManager::TimelineValues DescriptorManager::GetLastSubmittedValues()
+{
+    TimelineValues aValues;
+    for (uint32_t i = 0; i < VkRenderDevice::QUEUE_COUNT; i++)
     {
-        imageInfos[i] = {
-            GetSamplerManager()->getSampler(SAMPLER_1_MIPS),
-            materialParameters.m_apTextures[i]->getView(),
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        };
+        aValues[i] = GetRenderDevice()->GetLastSubmittedValue(static_cast<VkRenderDevice::QueueType>(i));
     }
+    return aValues;
+}
+
+VkDescriptorSet DescriptorManager::AllocatePersistentDescriptorSet(VkDescriptorSetLayout layout)
+{
+    return m_persistentPools.Allocate(layout);
+}
+
+VkDescriptorSet DescriptorManager::AllocateTransientDescriptorSet(VkDescriptorSetLayout layout)
+{
+    return m_aTransientFrames[m_nCurrentFrame].pools.Allocate(layout);
+}
+
+void DescriptorManager::BeginFrame()
+{
+    // Command buffers recorded with the transient sets of the frame being left are submitted by now
+    m_aTransientFrames[m_nCurrentFrame].aTimelineValues = GetLastSubmittedValues();
+    m_nCurrentFrame = (m_nCurrentFrame + 1) % VkRenderDevice::FRAMES_IN_FLIGHT;
 
-    // Two writes, one for PBR texture array, another for PBR factors
-    std::array<VkWriteDescriptorSet, 2> aWriteDescriptorSets = {};
+    // Usually a no-op, the render pass manager already waited for the frame before the previous one
+    TransientFrame& frame = m_aTransientFrames[m_nCurrentFrame];
+    for (uint32_t i = 0; i < VkRenderDevice::QUEUE_COUNT; i++)
     {
-        // Material sampler views
-        VkWriteDescriptorSet& writeDescriptorSet = aWriteDescriptorSets[0];
-        writeDescriptorSet = {};
-        writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writeDescriptorSet.dstSet = descriptorSet;
-        writeDescriptorSet.dstBinding = 0;
-        writeDescriptorSet.dstArrayElement = 0;
-        writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        writeDescriptorSet.descriptorCount = static_cast<uint32_t>(imageInfos.size());
-        writeDescriptorSet.pImageInfo = imageInfos.data();
+        GetRenderDevice()->WaitForTimelineValue(static_cast<VkRenderDevice::QueueType>(i), frame.aTimelineValues[i]);
     }
+    frame.pools.Reset();
+    frame.vImGuiTextureDescriptorSets.clear();
 
-    // Material parameters
-    VkDescriptorBufferInfo bufferInfo = {};
-    bufferInfo.buffer = materialParameters.m_pFactors->buffer();
-    bufferInfo.offset = 0;
-    bufferInfo.range = sizeof(PBRMaterial);
+    RecycleRetiredDescriptorSets();
+}
+
+DescriptorAllocatorStats DescriptorManager::GetStats() const
+{
+    DescriptorAllocatorStats stats;
+    stats.nPersistentPools = m_persistentPools.GetPoolCount();
+    stats.nPersistentSets = m_persistentPools.GetSetCount();
+    stats.nCachedSets = static_cast<uint32_t>(m_mDescriptorSetCache.size());
+    stats.nRetiredSets = static_cast<uint32_t>(m_vRetiredDescriptorSets.size());
+    for (const TransientFrame& frame : m_aTransientFrames)
     {
-        VkWriteDescriptorSet& writeDescriptorSet = aWriteDescriptorSets[1];
-        writeDescriptorSet = {};
-        writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writeDescriptorSet.dstSet = descriptorSet;
-        writeDescriptorSet.dstBinding = 1;
-        writeDescriptorSet.dstArrayElement = 0;
-        writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        writeDescriptorSet.descriptorCount = 1;
-        writeDescriptorSet.pBufferInfo = &bufferInfo;
+        stats.nTransientPools += frame.pools.GetPoolCount();
+        stats.nPeakTransientSets = std::max(stats.nPeakTransientSets, frame.pools.GetPeakSetCount());
+    }
+    stats.nTransientSets = m_aTransientFrames[m_nCurrentFrame].pools.GetSetCount();
+    return stats;
+}
+
+size_t DescriptorSetKeyHash::operator()(const DescriptorSetKey& key) const
+{
+    size_t nHash = std::hash<uint64_t>()(reinterpret_cast<uint64_t>(key.layout));
+    for (uint64_t nDescriptor : key.vDescriptors)
+    {
+        nHash ^= std::hash<uint64_t>()(nDescriptor) + 0x9e3779b9 + (nHash << 6) + (nHash >> 2);
+    }
+    return nHash;
+}
+
+VkDescriptorSet DescriptorManager::GetCachedDescriptorSet(const DescriptorSetKey& key)
+{
+    auto it = m_mDescriptorSetCache.find(key);
+    if (it == m_mDescriptorSetCache.end())
+    {
+        return VK_NULL_HANDLE;
+    }
+    it->second.nLastUsedEpoch = m_nDescriptorSetEpoch;
+    return it->second.descriptorSet;
+}
+
+void DescriptorManager::AddCachedDescriptorSet(const DescriptorSetKey& key, VkDescriptorSet descriptorSet)
+{
+    assert(m_mDescriptorSetCache.find(key) == m_mDescriptorSetCache.end());
+    m_mDescriptorSetCache[key] = {descriptorSet, m_nDescriptorSetEpoch};
+}
+
+void DescriptorManager::RetireUnusedDescriptorSets()
+{
+    for (auto it = m_mDescriptorSetCache.begin(); it != m_mDescriptorSetCache.end();)
+    {
+        if (it->second.nLastUsedEpoch != m_nDescriptorSetEpoch)
+        {
+            RetireDescriptorSet(it->second.descriptorSet);
+            it = m_mDescriptorSetCache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    m_nDescriptorSetEpoch++;
+}
+
+void DescriptorManager::RetireDescriptorSets(VkDescriptorSetLayout layout)
+{
+    for (auto it = m_mDescriptorSetCache.begin(); it != m_mDescriptorSetCache.end();)
+    {
+        if (it->first.layout == layout)
+        {
+            RetireDescriptorSet(it->second.descriptorSet);
+            it = m_mDescriptorSetCache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void DescriptorManager::RetireDescriptorSet(VkDescriptorSet descriptorSet)
+{
+    m_vRetiredDescriptorSets.push_back({descriptorSet, GetLastSubmittedValues()});
+}
+
+void DescriptorManager::RecycleRetiredDescriptorSets()
+{
+    if (m_vRetiredDescriptorSets.empty())
+    {
+        return;
+    }
+    TimelineValues aCompletedValues;
+    for (uint32_t i = 0; i < VkRenderDevice::QUEUE_COUNT; i++)
+    {
+        aCompletedValues[i] = GetRenderDevice()->GetCompletedValue(static_cast<VkRenderDevice::QueueType>(i));
     }
 
-    vkUpdateDescriptorSets(GetRenderDevice()->GetDevice(), static_cast<uint32_t>(aWriteDescriptorSets.size()), aWriteDescriptorSets.data(),
-                           0, nullptr);
+    std::vector<VkDescriptorSet> vFreeSets;
+    auto itRetained = std::remove_if(m_vRetiredDescriptorSets.begin(), m_vRetiredDescriptorSets.end(),
+                                     [&](const RetiredDescriptorSet& retired)
+                                     {
+                                         for (uint32_t i = 0; i < VkRenderDevice::QUEUE_COUNT; i++)
+                                         {
+                                             if (aCompletedValues[i] < retired.aTimelineValues[i])
+                                             {
+                                                 return false;
+                                             }
+                                         }
+                                         vFreeSets.push_back(retired.descriptorSet);
+                                         return true;
+                                     });
+    m_vRetiredDescriptorSets.erase(itRetained, m_vRetiredDescriptorSets.end());
+
+    if (!vFreeSets.empty())
+    {
+        m_persistentPools.Free(vFreeSets);
+    }
 }
 
 VkDescriptorSet DescriptorManager::AllocateSingleSamplerDescriptorSet(
     VkImageView textureView)
 {
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-    // Create descriptor sets
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts =
-        &m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_SINGLE_SAMPLER];
-
-    VK_ASSERT(vkAllocateDescriptorSets(GetRenderDevice()->GetDevice(), &allocInfo,
-                                    &descriptorSet) );
+    VkDescriptorSet descriptorSet = AllocatePersistentDescriptorSet(m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_SINGLE_SAMPLER]);
 
     setDebugUtilsObjectName(reinterpret_cast<uint64_t>(descriptorSet),
                             VK_OBJECT_TYPE_DESCRIPTOR_SET, "Single Sampler");
@@ -368,16 +549,7 @@ void DescriptorManager::UpdateSingleSamplerDescriptorSet(VkDescriptorSet& descri
 
 VkDescriptorSet DescriptorManager::AllocateSingleStorageImageDescriptorSet(VkImageView imageView)
 {
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-    // Create descriptor sets
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_SIGNLE_STORAGE_IMAGE];
-
-    VK_ASSERT(vkAllocateDescriptorSets(GetRenderDevice()->GetDevice(), &allocInfo,
-                                    &descriptorSet) );
+    VkDescriptorSet descriptorSet = AllocatePersistentDescriptorSet(m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_SIGNLE_STORAGE_IMAGE]);
 
     setDebugUtilsObjectName(reinterpret_cast<uint64_t>(descriptorSet),
                             VK_OBJECT_TYPE_DESCRIPTOR_SET, "Single storage image");
@@ -413,16 +585,7 @@ VkDescriptorSet DescriptorManager::AllocatePerviewDataDescriptorSet(
 
 VkDescriptorSet DescriptorManager::AllocateIBLDescriptorSet()
 {
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-    // Create descriptor sets
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts =
-        &m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_IBL];
-    VK_ASSERT(vkAllocateDescriptorSets(GetRenderDevice()->GetDevice(), &allocInfo,
-                                    &descriptorSet) );
+    VkDescriptorSet descriptorSet = AllocatePersistentDescriptorSet(m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_IBL]);
 
     setDebugUtilsObjectName(reinterpret_cast<uint64_t>(descriptorSet),
                             VK_OBJECT_TYPE_DESCRIPTOR_SET, "IBL");
@@ -471,15 +634,7 @@ void DescriptorManager::UpdateIBLDescriptorSet(
 
 VkDescriptorSet DescriptorManager::AllocateLightDataDescriptorSet(uint32_t nNumLights, const StorageBuffer<LightData>& lightData)
 {
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-    // Create descriptor sets
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_LIGHT_DATA];
-    VK_ASSERT(vkAllocateDescriptorSets(GetRenderDevice()->GetDevice(), &allocInfo,
-                                    &descriptorSet) );
+    VkDescriptorSet descriptorSet = AllocatePersistentDescriptorSet(m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_LIGHT_DATA]);
 
     setDebugUtilsObjectName(reinterpret_cast<uint64_t>(descriptorSet),
                             VK_OBJECT_TYPE_DESCRIPTOR_SET, "Light Data");
@@ -532,26 +687,37 @@ void DescriptorManager::UpdateRayLightDataDescriptorSet(VkDescriptorSet descript
 
 size_t DescriptorManager::GetImGuiTextureId(const std::string& sResourceName)
 {
-    if (m_mImGuiTextureIds.find(sResourceName) == m_mImGuiTextureIds.end())
+    auto it = m_mImGuiTextureIds.find(sResourceName);
+    if (it == m_mImGuiTextureIds.end())
     {
-        TextureResource* pTexture = GetRenderResourceManager()->GetResource<TextureResource>(sResourceName);
-        if (pTexture)
+        // Draws the font texture until the resource exists
+        if (GetRenderResourceManager()->GetResource<TextureResource>(sResourceName) == nullptr)
         {
-            // Allocate a descriptor for this resource.
-            m_mImGuiTextureIds[sResourceName] = m_vImGuiTextureDescriptorSets.size();
-            m_vImGuiTextureDescriptorSets.push_back(GetDescriptorManager()->AllocateSingleSamplerDescriptorSet(pTexture->getView()));
+            return 0;
         }
+        // Descriptor sets are allocated per frame, the resource could be destroyed and recreated with another view
+        it = m_mImGuiTextureIds.emplace(sResourceName, m_vImGuiTextureNames.size()).first;
+        m_vImGuiTextureNames.push_back(sResourceName);
+    }
+    return it->second;
+}
+
+VkDescriptorSet DescriptorManager::GetImGuiTextureDescriptorSet(size_t nTextureId)
+{
+    std::vector<VkDescriptorSet>& vDescriptorSets = m_aTransientFrames[m_nCurrentFrame].vImGuiTextureDescriptorSets;
+    if (vDescriptorSets.size() < m_vImGuiTextureNames.size())
+    {
+        vDescriptorSets.resize(m_vImGuiTextureNames.size(), VK_NULL_HANDLE);
     }
-    else
+    VkDescriptorSet& descriptorSet = vDescriptorSets[nTextureId];
+    if (descriptorSet == VK_NULL_HANDLE)
     {
-        // Update descriptor set each time we get the texture id, This is because the resource could be destroyed and recreated.
-        // It's a little bit overkill but not too bad for UI render.
-        // We should only update the descriptoer set when the texture view is changed on the resource.
-        // This update takes 0.01ms on GTX 1070 card. Not cheap
-        VkImageView textureView = GetRenderResourceManager()->GetResource<TextureResource>(sResourceName)->getView();
-        GetDescriptorManager()->UpdateSingleSamplerDescriptorSet(m_vImGuiTextureDescriptorSets[m_mImGuiTextureIds[sResourceName]], textureView);
+        const TextureResource* pTexture = GetRenderResourceManager()->GetResource<TextureResource>(m_vImGuiTextureNames[nTextureId]);
+        assert(pTexture != nullptr && "ImGui texture doesn't exist");
+        descriptorSet = AllocateTransientDescriptorSet(m_aDescriptorSetLayouts[DESCRIPTOR_LAYOUT_SINGLE_SAMPLER]);
+        UpdateSingleSamplerDescriptorSet(descriptorSet, pTexture->getView());
     }
-    return m_mImGuiTextureIds[sResourceName];
+    return descriptorSet;
 }
 
 DescriptorManager* GetDescriptorManager() { return &descriptorManager; }
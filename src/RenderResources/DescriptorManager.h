@@ -4,9 +4,11 @@
 #include <array>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Camera.h"
+#include "DescriptorAllocator.h"
 #include "Material.h"
 #include "UniformBuffer.h"
 namespace Muyo
@@ -20,12 +22,34 @@ enum DescriptorLayoutType
     DESCRIPTOR_LAYOUT_SIGNLE_STORAGE_IMAGE,
     DESCRIPTOR_LAYOUT_PER_VIEW_DATA,  // A layout contains mvp matrices at binding 0
     DESCRIPTOR_LAYOUT_PER_OBJ_DATA,   // Per object data layout
-    DESCRIPTOR_LAYOUT_MATERIALS,      // A sampler array contains material textures
+    DESCRIPTOR_LAYOUT_BINDLESS,       // Global samplers, material table and all textures, see BindlessBinding
     DESCRIPTOR_LAYOUT_IBL,            // IBL descriptor sets
     DESCRIPTOR_LAYOUT_LIGHT_DATA,     // Light data layout
     DESCRIPTOR_LAYOUT_COUNT,
 };
 
+// Bindings of the bindless heap, matches MATERIAL_SSBO in material.h
+enum BindlessBinding
+{
+    BINDLESS_BINDING_SAMPLERS,   // All samplers of the sampler manager, indexed by SamplerType
+    BINDLESS_BINDING_MATERIALS,  // PBRMaterial table
+    BINDLESS_BINDING_TEXTURES,   // Variable count sampled image array, indexed by PBRMaterial::textureIds
+    BINDLESS_BINDING_COUNT
+};
+
+// Layout and everything written into a descriptor set, sets with equal keys have identical contents
+struct DescriptorSetKey
+{
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    std::vector<uint64_t> vDescriptors;
+    bool operator==(const DescriptorSetKey &other) const = default;
+};
+
+struct DescriptorSetKeyHash
+{
+    size_t operator()(const DescriptorSetKey &key) const;
+};
+
 class DescriptorManager
 {
 public:
@@ -34,16 +58,40 @@ public:
     void createDescriptorSetLayouts();
     void destroyDescriptorSetLayouts();
 
+    // Descriptor set allocation
+    // Persistent sets live until they are freed and come from a chain of pools that grows when it runs out.
+    // Transient sets are only valid for the frame they are allocated in. They are bumped from the pools of the
+    // current frame, which are reset all at once when the frame is retired.
+    VkDescriptorSet AllocatePersistentDescriptorSet(VkDescriptorSetLayout layout);
+    VkDescriptorSet AllocateTransientDescriptorSet(VkDescriptorSetLayout layout);
+    // Retire the current frame and start the next one, waits for the queues to finish with the frame it reuses
+    void BeginFrame();
+    DescriptorAllocatorStats GetStats() const;
+
     VkDescriptorSet AllocateSingleSamplerDescriptorSet(VkImageView textureView);
     void UpdateSingleSamplerDescriptorSet(VkDescriptorSet &descriptorSet, VkImageView textureView);
     VkDescriptorSet AllocateSingleStorageImageDescriptorSet(VkImageView imageView);
 
     VkDescriptorSet AllocatePerviewDataDescriptorSet(const UniformBuffer<PerViewData> &perViewData);
 
-    // Material Descriptor Set
-    VkDescriptorSet AllocateMaterialDescriptorSet();
-    VkDescriptorSet AllocateMaterialDescriptorSet(const Material::MaterialParameters &materialParameters);
-    static void UpdateMaterialDescriptorSet(VkDescriptorSet descriptorSet, const Material::MaterialParameters &materialParameters);
+    // Bindless heap
+    // A single update-after-bind set shared by every pass that shades materials. Textures are written into a stable
+    // slot when they are created and materials only carry the slots, so nothing is rebound per material and the
+    // number of textures isn't limited by the regular pool.
+    void CreateBindlessDescriptorSet();  // Samplers must be created
+    uint32_t RegisterTexture(VkImageView textureView);
+    void SetMaterialBuffer(const BufferResource &materialBuffer);
+    VkDescriptorSet GetBindlessDescriptorSet() const { return m_bindlessDescriptorSet; }
+
+    // Descriptor set cache
+    // Sets allocated by render passes are cached by their key, recording the same bindings again reuses the set.
+    // Sets that are no longer used are freed once the queues are done with the command buffers referencing them.
+    VkDescriptorSet GetCachedDescriptorSet(const DescriptorSetKey &key);  // VK_NULL_HANDLE on miss
+    void AddCachedDescriptorSet(const DescriptorSetKey &key, VkDescriptorSet descriptorSet);
+    // Call after static command buffers are re-recorded, sets not requested since the previous call are retired
+    void RetireUnusedDescriptorSets();
+    // Retire the sets of a layout about to be destroyed
+    void RetireDescriptorSets(VkDescriptorSetLayout layout);
 
     // IBL descriptor set
     VkDescriptorSet AllocateIBLDescriptorSet();
@@ -70,15 +118,7 @@ public:
     template <class T>
     VkDescriptorSet AllocateUniformBufferDescriptorSet(const UniformBuffer<T> &uniformBuffer, uint32_t nBinding, const VkDescriptorSetLayout &descLayout)
     {
-        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-        // Create descriptor sets
-        VkDescriptorSetAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = m_descriptorPool;
-        allocInfo.descriptorSetCount = 1;
-        allocInfo.pSetLayouts = &descLayout;
-
-        VK_ASSERT(vkAllocateDescriptorSets(GetRenderDevice()->GetDevice(), &allocInfo, &descriptorSet) );
+        VkDescriptorSet descriptorSet = AllocatePersistentDescriptorSet(descLayout);
 
         // Bind uniform buffer to descriptor
         {
@@ -106,15 +146,8 @@ public:
 
     // Register or get a texture id to be used in ImGui
     size_t GetImGuiTextureId(const std::string &sResourceName);
-    const VkDescriptorSet &GetImGuiTextureDescriptorSet(size_t nTextureId) const
-    {
-        return m_vImGuiTextureDescriptorSets[nTextureId];
-    }
-
-    VkDescriptorPool GetDescriptorPool() const
-    {
-        return m_descriptorPool;
-    }
+    // Transient set of the current frame, written with the texture's current view the first time it is used in a frame
+    VkDescriptorSet GetImGuiTextureDescriptorSet(size_t nTextureId);
 
 private:
     static VkDescriptorSetLayoutBinding GetUniformBufferBinding(uint32_t binding, VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
@@ -168,27 +201,50 @@ private:
 
     std::array<VkDescriptorSetLayout, DESCRIPTOR_LAYOUT_COUNT> m_aDescriptorSetLayouts = {VK_NULL_HANDLE};
 
-    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
-
-    const uint32_t DESCRIPTOR_COUNT_EACH_TYPE = 500;
-    const std::vector<VkDescriptorPoolSize> POOL_SIZES = {
-        {VK_DESCRIPTOR_TYPE_SAMPLER, DESCRIPTOR_COUNT_EACH_TYPE},
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, DESCRIPTOR_COUNT_EACH_TYPE},
-        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, DESCRIPTOR_COUNT_EACH_TYPE},
-        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, DESCRIPTOR_COUNT_EACH_TYPE},
-        {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, DESCRIPTOR_COUNT_EACH_TYPE},
-        {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, DESCRIPTOR_COUNT_EACH_TYPE},
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, DESCRIPTOR_COUNT_EACH_TYPE},
-        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DESCRIPTOR_COUNT_EACH_TYPE},
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, DESCRIPTOR_COUNT_EACH_TYPE},
-        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, DESCRIPTOR_COUNT_EACH_TYPE},
-        {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, DESCRIPTOR_COUNT_EACH_TYPE}};
+    using TimelineValues = std::array<uint64_t, VkRenderDevice::QUEUE_COUNT>;
+    static TimelineValues GetLastSubmittedValues();
+
+    DescriptorPoolChain m_persistentPools = DescriptorPoolChain("Persistent descriptor pool", true, 512);
+
+    // Transient pools of each frame in flight
+    struct TransientFrame
+    {
+        DescriptorPoolChain pools = DescriptorPoolChain("Transient descriptor pool", false, 128);
+        TimelineValues aTimelineValues = {};  // Last submission of each queue when the frame was retired
+        std::vector<VkDescriptorSet> vImGuiTextureDescriptorSets;  // Indexed by ImGui texture id
+    };
+    std::array<TransientFrame, VkRenderDevice::FRAMES_IN_FLIGHT> m_aTransientFrames;
+    uint32_t m_nCurrentFrame = 0;
+
+    // Bindless heap
+    static const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+    VkDescriptorPool m_bindlessDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_bindlessDescriptorSet = VK_NULL_HANDLE;
+    uint32_t m_nBindlessTextureCount = 0;
+
+    // Descriptor set cache
+    void RetireDescriptorSet(VkDescriptorSet descriptorSet);
+    // Free retired sets the queues are done with
+    void RecycleRetiredDescriptorSets();
+    struct CachedDescriptorSet
+    {
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        uint64_t nLastUsedEpoch = 0;
+    };
+    struct RetiredDescriptorSet
+    {
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        TimelineValues aTimelineValues;  // Last submission of each queue when retired
+    };
+    std::unordered_map<DescriptorSetKey, CachedDescriptorSet, DescriptorSetKeyHash> m_mDescriptorSetCache;
+    std::vector<RetiredDescriptorSet> m_vRetiredDescriptorSets;
+    uint64_t m_nDescriptorSetEpoch = 0;
 
     // UI texture descriptor tracker
     // ImGui uses textureId to track the bond texture in each draw command.
     // I add a map to bind the textureId to corresbonding texture to show.
     // This allows me to bind the image I want to show in UI with the texture's resource name
-    std::vector<VkDescriptorSet> m_vImGuiTextureDescriptorSets;
+    std::vector<std::string> m_vImGuiTextureNames;
     std::map<std::string, size_t> m_mImGuiTextureIds;
 };
 DescriptorManager *GetDescriptorManager();
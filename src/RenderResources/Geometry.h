@@ -5,7 +5,6 @@
 
 #include "MeshVertex.h"
 #include "RenderResourceManager.h"
-#include "UniformBuffer.h"
 #include "VertexBuffer.h"
 #include "Material.h"
 namespace Muyo
@@ -87,10 +86,9 @@ public:
     {
         return m_vSubmeshes;
     }
+    // CPU side only, shaders read the world matrix from the node's PerObjData
     void SetWorldMatrix(const glm::mat4& mObjectToWorld)
     {
-        assert(m_mWorldMatrixBuffer != nullptr);
-        m_mWorldMatrixBuffer->SetData(mObjectToWorld);
         m_mWorldMatrix = mObjectToWorld;
     }
 
@@ -99,19 +97,8 @@ public:
         return m_mWorldMatrix;
     }
 
-    const UniformBuffer<glm::mat4>* GetWorldMatrixBuffer() const
-    {
-        return m_mWorldMatrixBuffer;
-    }
-
-    void SetWorldMatrixUniformBuffer(UniformBuffer<glm::mat4>* pWorldMatBuffer)
-    {
-        m_mWorldMatrixBuffer = pWorldMatBuffer;
-    }
-
 private:
     std::vector<std::unique_ptr<Submesh>> m_vSubmeshes;
-    UniformBuffer<glm::mat4>* m_mWorldMatrixBuffer = nullptr;
     glm::mat4 m_mWorldMatrix = glm::mat4(1.0);  // Cached world matrix
 };
 
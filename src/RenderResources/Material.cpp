@@ -48,14 +48,14 @@ void MaterialManager::CreateDefaultMaterial()
             .LoadTexture(Material::TEX_ROUGHNESS, "assets/Materials/white5x5.png", "defaultRoughness")
             .LoadTexture(Material::TEX_AO, "assets/Materials/white5x5.png", "defaultOcclusion")
             .LoadTexture(Material::TEX_EMISSIVE, "assets/Materials/white5x5.png", "defaultOcclusion");
-        material.AllocateDescriptorSet();
     }
     
 }
 
 void MaterialManager::UploadMaterialBuffer() const
 {
-    GetRenderResourceManager()->GetStorageBuffer(sMaterialBufferName, m_vMaterialBufferCPU);
+    const StorageBuffer<PBRMaterial>* pMaterialBuffer = GetRenderResourceManager()->GetStorageBuffer(sMaterialBufferName, m_vMaterialBufferCPU);
+    GetDescriptorManager()->SetMaterialBuffer(*pMaterialBuffer);
 }
 
 const StorageBuffer<PBRMaterial>* MaterialManager::GetMaterialBuffer() const
@@ -95,17 +95,4 @@ Material &Material::SetMaterialParameterFactors(const PBRMaterial &factors, cons
     return *this;
 }
 
-void Material::AllocateDescriptorSet()
-{
-    if (m_descriptorSet == VK_NULL_HANDLE)
-    {
-        m_descriptorSet = GetDescriptorManager()->AllocateMaterialDescriptorSet(m_materialParameters);
-    }
-}
-
-VkDescriptorSet Material::GetDescriptorSet() const
-{
-    return m_descriptorSet;
-}
-
 }  // namespace Muyo
@@ -56,9 +56,6 @@ public:
     }
 
 
-    VkDescriptorSet GetDescriptorSet() const;
-    void AllocateDescriptorSet();
-
     bool IsTransparent() const { return m_bIsTransparent; }
     void SetTransparent() { m_bIsTransparent = true; }
     void SetOpaque() { m_bIsTransparent = false; }
@@ -72,7 +69,6 @@ private:
     MaterialParameters m_materialParameters;
     const std::array<std::string, TEX_COUNT> m_aNames = {
         "TEX_ALBEDO", "TEX_NORMAL", "TEX_METALNESS", "TEX_ROUGHNESS", "TEX_AO", "TEX_EMISSIVE"};
-    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
     bool m_bIsTransparent = false;
 
     uint32_t m_nMaterialIndex = 0;      // Material index in material resource manager
@@ -90,6 +86,7 @@ public:
 
     bool HasMaterial(const std::string sMaterialName);
 
+    // Upload the material table and bind it to the bindless heap
     void UploadMaterialBuffer() const;
     const StorageBuffer<PBRMaterial>* GetMaterialBuffer() const;
 
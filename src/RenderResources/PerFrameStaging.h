@@ -0,0 +1,91 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <string>
+
+#include "VkMemoryAllocator.h"
+#include "VkRenderDevice.h"
+
+namespace Muyo
+{
+/*
+ * Host visible copies of a buffer's content, one per frame in flight. The CPU fills the copy of the frame it records
+ * while earlier frames may still read the buffer on the GPU, RecordCopy copies it into the buffer at the start of the
+ * frame. Descriptors and static command buffers keep pointing at the one buffer.
+ */
+class PerFrameStaging
+{
+public:
+    PerFrameStaging() = default;
+    PerFrameStaging(const PerFrameStaging&) = delete;
+    PerFrameStaging& operator=(const PerFrameStaging&) = delete;
+    ~PerFrameStaging() { Free(); }
+
+    // GPU must be done with the previous copies
+    void Allocate(VkDeviceSize nFrameSize, const std::string& sName)
+    {
+        Free();
+        m_nFrameSize = nFrameSize;
+        GetMemoryAllocator()->AllocateBuffer(nFrameSize * VkRenderDevice::FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                             VMA_MEMORY_USAGE_CPU_TO_GPU, m_buffer, m_allocation, sName);
+        m_pMappedData = static_cast<uint8_t*>(GetMemoryAllocator()->GetMappedData(m_allocation));
+    }
+
+    void Free()
+    {
+        if (m_buffer != VK_NULL_HANDLE)
+        {
+            GetMemoryAllocator()->FreeBuffer(m_buffer, m_allocation);
+        }
+        m_buffer = VK_NULL_HANDLE;
+        m_allocation = VK_NULL_HANDLE;
+        m_pMappedData = nullptr;
+        m_nFrameSize = 0;
+    }
+
+    VkDeviceSize GetFrameSize() const { return m_nFrameSize; }
+
+    // The GPU must be done with the frame that used nFrameIdx before
+    void* GetFrameData(uint32_t nFrameIdx) const
+    {
+        assert(m_pMappedData != nullptr && nFrameIdx < VkRenderDevice::FRAMES_IN_FLIGHT);
+        return m_pMappedData + m_nFrameSize * nFrameIdx;
+    }
+
+    // Copy the first nSize bytes of the frame's copy into dstBuffer. Reads of dstBuffer in dstStages submitted
+    // earlier on the queue finish before the copy, later ones see its result.
+    void RecordCopy(VkCommandBuffer cmdBuf, uint32_t nFrameIdx, VkBuffer dstBuffer, VkDeviceSize nSize,
+                    VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) const
+    {
+        assert(nSize <= m_nFrameSize && nFrameIdx < VkRenderDevice::FRAMES_IN_FLIGHT);
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = dstBuffer;
+        barrier.offset = 0;
+        barrier.size = nSize;
+
+        // Write after read, the old content is discarded
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(cmdBuf, dstStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        VkBufferCopy copyRegion = {};
+        copyRegion.srcOffset = m_nFrameSize * nFrameIdx;
+        copyRegion.size = nSize;
+        vkCmdCopyBuffer(cmdBuf, m_buffer, dstBuffer, 1, &copyRegion);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+
+private:
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    VmaAllocation m_allocation = VK_NULL_HANDLE;
+    uint8_t* m_pMappedData = nullptr;
+    VkDeviceSize m_nFrameSize = 0;
+};
+}  // namespace Muyo
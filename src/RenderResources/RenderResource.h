@@ -2,9 +2,11 @@
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan_core.h>
 
+#include <atomic>
 #include <cassert>
 
 #include "Debug.h"
+#include "StagingRing.h"
 #include "VkExtFuncsLoader.h"
 #include "VkMemoryAllocator.h"
 #include "VkRenderDevice.h"
@@ -14,9 +16,16 @@ namespace Muyo
 class IRenderResource
 {
 public:
+    IRenderResource() : m_nResourceId(s_nNextResourceId++) {}
     virtual ~IRenderResource(){};
     virtual VkObjectType GetVkObjectType() const = 0;
     virtual void SetDebugName(const std::string& sName) const = 0;
+    // Unique for the lifetime of the application, unlike Vulkan handles which can be reused after destruction
+    uint64_t GetResourceId() const { return m_nResourceId; }
+
+private:
+    uint64_t m_nResourceId;
+    static inline std::atomic<uint64_t> s_nNextResourceId = 1;
 };
 
 class ImageResource : public IRenderResource
@@ -39,6 +48,7 @@ public:
                                 GetVkObjectType(), sName.c_str());
     }
     VkFormat GetImageFormat() const { return m_imageInfo.format; }
+    VkImageUsageFlags GetImageUsage() const { return m_imageInfo.usage; }
 
 protected:
     void CreateImageInternal(const VmaMemoryUsage& memoryUsage)
@@ -121,87 +131,147 @@ public:
     }
     void SetData(const void* pData, size_t size)
     {
-        if (m_buffer != VK_NULL_HANDLE && size > m_nSize)
+        // Shrinking keeps the buffer, per frame updates of varying size don't reallocate
+        if (m_buffer != VK_NULL_HANDLE && size > m_nCapacity)
         {
-            GetMemoryAllocator()->FreeBuffer(m_buffer, m_allocation);
+            // Uploads and frames in flight may still access the old buffer
+            GetRenderDevice()->FreeBufferAfterSubmitted(m_buffer, m_allocation);
             m_buffer = VK_NULL_HANDLE;
+            m_eOwnerQueue = VkRenderDevice::QUEUE_COUNT;
         }
         if (m_buffer == VK_NULL_HANDLE)
         {
-            GetMemoryAllocator()->AllocateBuffer(size, BUFFER_USAGE,
-                                                 MEMORY_USAGE, m_buffer,
-                                                 m_allocation);
+            AllocateBuffer(size, "Buffer");
         }
         m_nSize = (uint32_t)size;
 
         if (BUFFER_USAGE & VK_BUFFER_USAGE_TRANSFER_DST_BIT)
         {
             assert(pData != nullptr && "Need to have data to upload");
-            // Create staging buffer
-            VkBuffer stagingBuffer = VK_NULL_HANDLE;
+            StagingRing::Allocation staging;
             VmaAllocation stagingAllocation = VK_NULL_HANDLE;
-            GetMemoryAllocator()->AllocateBuffer(
-                size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
-                stagingBuffer, stagingAllocation);
-
-            void* pMappedMemory = nullptr;
-            GetMemoryAllocator()->MapBuffer(stagingAllocation, &pMappedMemory);
-            memcpy(pMappedMemory, pData, size);
-            GetMemoryAllocator()->UnmapBuffer(stagingAllocation);
+            const bool bUseRing = GetStagingRing()->Allocate(size, staging);
+            if (!bUseRing)
+            {
+                // Too big for the ring, e.g. scene data at load time
+                GetMemoryAllocator()->AllocateBuffer(
+                    size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
+                    staging.buffer, stagingAllocation);
+                staging.pMappedData = GetMemoryAllocator()->GetMappedData(stagingAllocation);
+            }
+            memcpy(staging.pMappedData, pData, size);
 
-            // Submit the copy immedietly
-            GetRenderDevice()->ExecuteImmediateCommand(
+            // Copy on transfer queue and hand the buffer to the queue that reads it first
+            VkBufferMemoryBarrier bufferBarrier = {};
+            bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            bufferBarrier.buffer = m_buffer;
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+            VkRenderDevice::UploadConsumer consumer = {m_eConsumerQueue, 0};
+            GetConsumerStagesAndAccess(consumer.stages, bufferBarrier.dstAccessMask);
+            const uint64_t nUploadValue = GetRenderDevice()->ExecuteUploadCommand(
                 [&](VkCommandBuffer commandBuffer)
                 {
                     VkBufferCopy copyRegion = {};
+                    copyRegion.srcOffset = staging.nOffset;
                     copyRegion.size = size;
-                    vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_buffer, 1,
+                    vkCmdCopyBuffer(commandBuffer, staging.buffer, m_buffer, 1,
                                     &copyRegion);
-#ifdef FEATURE_RAY_TRACING
-                    // Make sure the copy of the instance buffer are copied before triggering the
-                    // acceleration structure build
-                    VkMemoryBarrier barrier{
-                        VK_STRUCTURE_TYPE_MEMORY_BARRIER,
-                        nullptr, VK_ACCESS_TRANSFER_WRITE_BIT,
-                        VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR};
-                    vkCmdPipelineBarrier(commandBuffer,
-                                         VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                         VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
-                                         0, 1, &barrier, 0, nullptr, 0, nullptr);
-#endif
-                });
+                },
+                {bufferBarrier}, {}, consumer, m_eOwnerQueue);
+            m_eOwnerQueue = m_eConsumerQueue;
 
-            GetMemoryAllocator()->FreeBuffer(stagingBuffer, stagingAllocation);
-        }
-        else
-        {
-            if (pData != nullptr)
+            // Staging memory is released once the copy is done, nothing waits for it here
+            if (bUseRing)
+            {
+                GetStagingRing()->Free(staging, nUploadValue);
+            }
+            else
             {
-                void* pMappedMemory = nullptr;
-                GetMemoryAllocator()->MapBuffer(m_allocation, &pMappedMemory);
-                memcpy(pMappedMemory, pData, size);
-                GetMemoryAllocator()->UnmapBuffer(m_allocation);
+                GetRenderDevice()->FreeStagingBuffer(staging.buffer, stagingAllocation, nUploadValue);
             }
         }
+        else if (pData != nullptr)
+        {
+            memcpy(Map(), pData, size);
+        }
     }
 
-    void* Map()
-    {
-        void* pMappedPointer;
-        GetMemoryAllocator()->MapBuffer(m_allocation, &pMappedPointer);
-        return pMappedPointer;
-    }
-    void Unmap()
+    // Host visible buffers stay mapped for their whole lifetime, there is nothing to unmap
+    void* Map() const
     {
-        GetMemoryAllocator()->UnmapBuffer(m_allocation);
+        assert(m_pMappedData != nullptr && "Buffer isn't host visible");
+        return m_pMappedData;
     }
 
     uint32_t GetSize() const { return m_nSize; }
 
+    // Queue reading the buffer first after an upload, e.g. compute for buffers consumed by async compute passes.
+    // Takes effect on the next upload.
+    void SetConsumerQueue(VkRenderDevice::QueueType eQueue)
+    {
+        assert(eQueue == VkRenderDevice::QUEUE_GRAPHICS || eQueue == VkRenderDevice::QUEUE_COMPUTE);
+        m_eConsumerQueue = eQueue;
+    }
+
 protected:
+    void AllocateBuffer(size_t size, const std::string& sName, PoolType ePoolType = PoolType::Default)
+    {
+        GetMemoryAllocator()->AllocateBuffer(size, BUFFER_USAGE, MEMORY_USAGE,
+                                             m_buffer, m_allocation,
+                                             sName, ePoolType);
+        m_nCapacity = (uint32_t)size;
+        m_pMappedData = VkMemoryAllocator::IsHostVisible(MEMORY_USAGE) ? GetMemoryAllocator()->GetMappedData(m_allocation) : nullptr;
+    }
+
+    // Stages and accesses reading the buffer on the consumer queue, derived from its usage
+    void GetConsumerStagesAndAccess(VkPipelineStageFlags& stages, VkAccessFlags& access) const
+    {
+        const bool bCompute = m_eConsumerQueue == VkRenderDevice::QUEUE_COMPUTE;
+        stages = 0;
+        access = 0;
+        if (!bCompute && (BUFFER_USAGE & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT))
+        {
+            stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+            access |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        }
+        if (!bCompute && (BUFFER_USAGE & VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+        {
+            stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+            access |= VK_ACCESS_INDEX_READ_BIT;
+        }
+        if (BUFFER_USAGE & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)
+        {
+            stages |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+            access |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        }
+        if (BUFFER_USAGE & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT))
+        {
+            stages |= bCompute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : (VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            access |= (BUFFER_USAGE & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) ? VK_ACCESS_UNIFORM_READ_BIT : 0;
+            access |= (BUFFER_USAGE & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) ? VK_ACCESS_SHADER_READ_BIT : 0;
+        }
+#ifdef FEATURE_RAY_TRACING
+        if (BUFFER_USAGE & VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR)
+        {
+            stages |= VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+            access |= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+        }
+#endif
+        if (stages == 0)
+        {
+            stages = bCompute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            access = VK_ACCESS_MEMORY_READ_BIT;
+        }
+    }
+
     VkBuffer m_buffer = VK_NULL_HANDLE;
     VmaAllocation m_allocation = VK_NULL_HANDLE;
-    uint32_t m_nSize = 0;
+    void* m_pMappedData = nullptr;
+    uint32_t m_nSize = 0;      // Size of the data last set
+    uint32_t m_nCapacity = 0;  // Size of the allocation
+    VkRenderDevice::QueueType m_eConsumerQueue = VkRenderDevice::QUEUE_GRAPHICS;
+    VkRenderDevice::QueueType m_eOwnerQueue = VkRenderDevice::QUEUE_COUNT;  // Queue owning the uploaded content, none before the first upload
     const VkBufferUsageFlags BUFFER_USAGE = 0x0;
     const VmaMemoryUsage MEMORY_USAGE = VMA_MEMORY_USAGE_UNKNOWN;
 };
@@ -215,9 +285,7 @@ public:
               VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_EXT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
               VMA_MEMORY_USAGE_GPU_ONLY)
     {
-        GetMemoryAllocator()->AllocateBuffer(size, BUFFER_USAGE, MEMORY_USAGE,
-                                             m_buffer, m_allocation,
-                                             "AccelerationStrucutre", PoolType::BVH);
+        AllocateBuffer(size, "AccelerationStrucutre", PoolType::BVH);
     }
 
     AccelerationStructureBuffer(const void* pData, uint32_t size)
@@ -225,9 +293,7 @@ public:
               VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_EXT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
               VMA_MEMORY_USAGE_GPU_ONLY)
     {
-        GetMemoryAllocator()->AllocateBuffer(size, BUFFER_USAGE, MEMORY_USAGE,
-                                             m_buffer, m_allocation,
-                                             "AccelerationStrucutre", PoolType::BVH);
+        AllocateBuffer(size, "AccelerationStrucutre", PoolType::BVH);
         SetData(pData, size);
     }
 };
@@ -290,9 +356,7 @@ public:
                   VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_EXT,
               VMA_MEMORY_USAGE_CPU_TO_GPU)
     {
-        GetMemoryAllocator()->AllocateBuffer(size, BUFFER_USAGE, MEMORY_USAGE,
-                                             m_buffer, m_allocation,
-                                             "SBT", PoolType::SBT);
+        AllocateBuffer(size, "SBT", PoolType::SBT);
     }
 };
 
@@ -307,14 +371,37 @@ public:
               VMA_MEMORY_USAGE_GPU_ONLY)
     {
         uint32_t nSize = sizeof(T) * nNumStructs;
-        GetMemoryAllocator()->AllocateBuffer(nSize, BUFFER_USAGE, MEMORY_USAGE,
-                                             m_buffer, m_allocation,
-                                             "Storage Buffer");
+        AllocateBuffer(nSize, "Storage Buffer");
         SetData((void*)buffer, nSize);
         m_nNumStructs = nNumStructs;
     }
     uint32_t GetNumStructs() const { return m_nNumStructs; }
 
+private:
+    uint32_t m_nNumStructs = 0;
+};
+
+// Host visible storage buffer mapped for its whole lifetime, elements are updated in place without staging or
+// allocator calls. Suits data the CPU rewrites sparsely, e.g. per object transforms.
+template <class T>
+class MappedStorageBuffer : public BufferResource
+{
+public:
+    MappedStorageBuffer(const T* buffer, uint32_t nNumStructs)
+        : BufferResource(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU)
+    {
+        uint32_t nSize = sizeof(T) * nNumStructs;
+        AllocateBuffer(nSize, "Mapped Storage Buffer");
+        SetData(buffer, nSize);
+        m_nNumStructs = nNumStructs;
+    }
+    T& operator[](uint32_t nIndex)
+    {
+        assert(nIndex < m_nNumStructs);
+        return static_cast<T*>(m_pMappedData)[nIndex];
+    }
+    uint32_t GetNumStructs() const { return m_nNumStructs; }
+
 private:
     uint32_t m_nNumStructs = 0;
 };
@@ -58,27 +58,47 @@ public:
         return static_cast<IndexBuffer*>(m_mResources[sName].get());
     }
 
+    // Usage flags of render targets created by the resource manager
+    static VkImageUsageFlags GetRenderTargetUsage(VkFormat format, VkImageUsageFlags nAdditionalUsageFlags = 0)
+    {
+        bool bIsColorAttachment = FormatSupportsOptimalTilingColorAttachment(format) && !FormatSupportsOptimalTilingDepthAttachment(format);
+        return nAdditionalUsageFlags | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+               (bIsColorAttachment ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    }
+
     RenderTarget* GetRenderTarget(const std::string& sName, VkExtent2D extent, VkFormat format,
                                   uint32_t numMips = 1, uint32_t numLayers = 1,
                                   VkImageUsageFlags nAdditionalUsageFlags = 0)
     {
         if (m_mResources.find(sName) == m_mResources.end())
         {
-            bool bIsColorAttachment = FormatSupportsOptimalTilingColorAttachment(format) && !FormatSupportsOptimalTilingDepthAttachment(format);
-            VkImageUsageFlags nUsageFlags = nAdditionalUsageFlags;
             m_mResources[sName] = std::make_unique<RenderTarget>(
                 format,
-                nUsageFlags |
-                    (bIsColorAttachment
-                         ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
-                               VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT
-                         : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT),
+                GetRenderTargetUsage(format, nAdditionalUsageFlags),
                 extent.width, extent.height, numMips, numLayers);
             m_mResources[sName]->SetDebugName(sName);
         }
         return static_cast<RenderTarget*>(m_mResources[sName].get());
     }
 
+    // Render target bound to externally owned memory, the memory must outlive the render target
+    RenderTarget* GetAliasedRenderTarget(const std::string& sName, VkExtent2D extent, VkFormat format,
+                                         VmaAllocation memory, VkDeviceSize nMemoryOffset,
+                                         uint32_t numMips = 1, uint32_t numLayers = 1,
+                                         VkImageUsageFlags nAdditionalUsageFlags = 0)
+    {
+        if (m_mResources.find(sName) == m_mResources.end())
+        {
+            m_mResources[sName] = std::make_unique<RenderTarget>(
+                format,
+                GetRenderTargetUsage(format, nAdditionalUsageFlags),
+                extent.width, extent.height, numMips, numLayers,
+                memory, nMemoryOffset);
+            m_mResources[sName]->SetDebugName(sName);
+        }
+        return static_cast<RenderTarget*>(m_mResources[sName].get());
+    }
+
     RenderTarget* GetDepthTarget(const std::string sName, VkExtent2D extent,
                                  VkFormat format = VK_FORMAT_D32_SFLOAT)
     {
@@ -142,15 +162,31 @@ public:
         return static_cast<UniformBuffer<T>*>(m_mResources[sName].get());
     }
 
+    // Readers can get it as UniformBuffer<T>, only writers need the per frame type
     template <class T>
-    DrawCommandBuffer<T>* GetDrawCommandBuffer(const std::string sName, const std::vector<T>& drawCommands)
+    PerFrameUniformBuffer<T>* GetPerFrameUniformBuffer(const std::string sName)
     {
         if (m_mResources.find(sName) == m_mResources.end())
         {
-            m_mResources[sName] = std::make_unique<DrawCommandBuffer<T>>(drawCommands.data(), (uint32_t)drawCommands.size());
+            m_mResources[sName] = std::make_unique<PerFrameUniformBuffer<T>>();
             m_mResources[sName]->SetDebugName(sName);
         }
-        return static_cast<DrawCommandBuffer<T>*>(m_mResources[sName].get());
+        return static_cast<PerFrameUniformBuffer<T>*>(m_mResources[sName].get());
+    }
+
+    template <class T>
+    DrawCommandBuffer<T>* GetDrawCommandBuffer(const std::string sName, const std::vector<T>& drawCommands, VkBufferUsageFlags additionalUsage = 0)
+    {
+        if (m_mResources.find(sName) == m_mResources.end())
+        {
+            m_mResources[sName] = std::make_unique<DrawCommandBuffer<T>>(drawCommands.data(), (uint32_t)drawCommands.size(), additionalUsage);
+            m_mResources[sName]->SetDebugName(sName);
+            return static_cast<DrawCommandBuffer<T>*>(m_mResources[sName].get());
+        }
+        // Draw lists change between recordings, the existing buffer gets the new commands
+        DrawCommandBuffer<T>* pDrawCommandBuffer = static_cast<DrawCommandBuffer<T>*>(m_mResources[sName].get());
+        pDrawCommandBuffer->SetDrawCommands(drawCommands.data(), (uint32_t)drawCommands.size());
+        return pDrawCommandBuffer;
     }
 
     template <class T>
@@ -164,6 +200,17 @@ public:
         return static_cast<StorageBuffer<T>*>(m_mResources[sName].get());
     }
 
+    template <class T>
+    MappedStorageBuffer<T>* GetMappedStorageBuffer(const std::string sName, const std::vector<T>& structuredBuffers)
+    {
+        if (m_mResources.find(sName) == m_mResources.end())
+        {
+            m_mResources[sName] = std::make_unique<MappedStorageBuffer<T>>(structuredBuffers.data(), (uint32_t)structuredBuffers.size());
+            m_mResources[sName]->SetDebugName(sName);
+        }
+        return static_cast<MappedStorageBuffer<T>*>(m_mResources[sName].get());
+    }
+
     AccelerationStructureBuffer* GetAccelerationStructureBuffer(
         const std::string& sName, VkDeviceSize nSize)
     {
@@ -11,6 +11,54 @@ namespace Muyo
 
 RenderTarget::RenderTarget(VkFormat format, VkImageUsageFlags usage,
                            uint32_t width, uint32_t height, uint32_t numMips, uint32_t numLayers)
+{
+    m_imageInfo = GetImageCreateInfo(format, usage, width, height, numMips, numLayers);
+
+    CreateImageInternal(VMA_MEMORY_USAGE_GPU_ONLY);
+    assert(m_image != VK_NULL_HANDLE && "Failed to allocate image");
+
+    CreateImageView(usage);
+}
+
+RenderTarget::RenderTarget(VkFormat format, VkImageUsageFlags usage,
+                           uint32_t width, uint32_t height, uint32_t numMips, uint32_t numLayers,
+                           VmaAllocation memory, VkDeviceSize nMemoryOffset)
+{
+    m_imageInfo = GetImageCreateInfo(format, usage, width, height, numMips, numLayers);
+
+    // m_allocation stays null so the aliased memory is not freed with this image
+    VK_ASSERT(vkCreateImage(GetRenderDevice()->GetDevice(), &m_imageInfo, nullptr, &m_image));
+    GetMemoryAllocator()->BindImageMemory(memory, nMemoryOffset, m_image);
+
+    CreateImageView(usage);
+}
+
+VkImageCreateInfo RenderTarget::GetImageCreateInfo(VkFormat format, VkImageUsageFlags usage,
+                                                   uint32_t width, uint32_t height, uint32_t numMips, uint32_t numLayers)
+{
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = width;
+    imageInfo.extent.height = height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = numMips;
+    imageInfo.arrayLayers = numLayers;
+    imageInfo.format = format;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    // Transient attachments can only be used as attachments
+    imageInfo.usage = (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) ? usage : usage | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (numLayers > 1)
+    {
+        imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+    }
+    return imageInfo;
+}
+
+void RenderTarget::CreateImageView(VkImageUsageFlags usage)
 {
     VkImageAspectFlags aspectMask = 0;
     VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -25,27 +73,10 @@ RenderTarget::RenderTarget(VkFormat format, VkImageUsageFlags usage,
         aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
         imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
     }
-
     assert(aspectMask > 0);
-    m_imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    m_imageInfo.extent.width = width;
-    m_imageInfo.extent.height = height;
-    m_imageInfo.extent.depth = 1;
-    m_imageInfo.mipLevels = numMips;
-    m_imageInfo.arrayLayers = numLayers;
-    m_imageInfo.format = format;
-    m_imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    m_imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    m_imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    m_imageInfo.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
-    m_imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    if (numLayers > 1)
-    {
-        m_imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
-    }
 
-    CreateImageInternal(VMA_MEMORY_USAGE_GPU_ONLY);
-    assert(m_image != VK_NULL_HANDLE && "Failed to allocate image");
+    const uint32_t numMips = m_imageInfo.mipLevels;
+    const uint32_t numLayers = m_imageInfo.arrayLayers;
 
     // Create Image View
     m_imageViewInfo.viewType = numLayers == 1 ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_CUBE;
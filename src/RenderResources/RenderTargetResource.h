@@ -9,5 +9,18 @@ class RenderTarget : public ImageResource
 public:
     RenderTarget(VkFormat format, VkImageUsageFlags usage, uint32_t width,
                  uint32_t height, uint32_t numMips, uint32_t numLayers);
+
+    // Create a render target on memory owned by someone else, the memory is not freed with the render target.
+    // Used by render graph to alias transient render targets.
+    RenderTarget(VkFormat format, VkImageUsageFlags usage, uint32_t width,
+                 uint32_t height, uint32_t numMips, uint32_t numLayers,
+                 VmaAllocation memory, VkDeviceSize nMemoryOffset);
+
+    // Image create info of a render target, can be used to query memory requirements before creating it
+    static VkImageCreateInfo GetImageCreateInfo(VkFormat format, VkImageUsageFlags usage, uint32_t width,
+                                                uint32_t height, uint32_t numMips, uint32_t numLayers);
+
+private:
+    void CreateImageView(VkImageUsageFlags usage);
 };
 }  // namespace Muyo
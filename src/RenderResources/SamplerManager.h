@@ -18,6 +18,7 @@ enum SamplerTypes
     SAMPLER_8_MIPS,
     SAMPLER_16_MIPS,
     SAMPLER_32_MIPS,
+    SAMPLER_SHADOW_COMPARE,  // Depth comparison with bilinear filtering, hardware 2x2 PCF
     SAMPLER_TYPE_COUNT
 };
 class SamplerManager
@@ -62,12 +63,20 @@ public:
         samplerInfo.maxLod = 1.0f;
 
         // full screen texture sampler
-        for (int i = 0; i < SAMPLER_TYPE_COUNT; i++)
+        for (int i = 0; i <= SAMPLER_32_MIPS; i++)
         {
             samplerInfo.maxLod = powf(2, static_cast<float>(i));
             VK_ASSERT(vkCreateSampler(GetRenderDevice()->GetDevice(), &samplerInfo, nullptr, &m_aSamplers[i]));
             setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_aSamplers[i]), VK_OBJECT_TYPE_SAMPLER, "Frame Sampler");
         }
+
+        // Shadow map sampler, returns the filtered result of comparing the reference depth with 2x2 texels
+        samplerInfo.compareEnable = VK_TRUE;
+        samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.maxLod = 0.0f;
+        VK_ASSERT(vkCreateSampler(GetRenderDevice()->GetDevice(), &samplerInfo, nullptr, &m_aSamplers[SAMPLER_SHADOW_COMPARE]));
+        setDebugUtilsObjectName(reinterpret_cast<uint64_t>(m_aSamplers[SAMPLER_SHADOW_COMPARE]), VK_OBJECT_TYPE_SAMPLER, "Shadow Compare Sampler");
     }
     void destroySamplers()
     {
@@ -19,7 +19,7 @@ StorageImageResource::StorageImageResource(VkFormat format, uint32_t nWidth, uin
     m_imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     m_imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     m_imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    m_imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    m_imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
     m_imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     CreateImageInternal(VMA_MEMORY_USAGE_GPU_ONLY);
     assert(m_image != VK_NULL_HANDLE && "Failed to allocate image");
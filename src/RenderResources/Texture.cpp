@@ -1,6 +1,7 @@
 #include "Texture.h"
 
 #include "../thirdparty/stb/stb_image.h"
+#include "DescriptorManager.h"
 
 namespace Muyo
 {
@@ -12,6 +13,25 @@ TextureResourceManager *GetTextureResourceManager()
     return &s_textureManager;
 }
 
+const TextureResource *TextureResourceManager::CreateAndLoadOrGetTexture(const std::string &name, const std::string &path)
+{
+    if (m_mTextureIndices.find(name) == m_mTextureIndices.end())
+    {
+        m_vpTextures.emplace_back(std::make_unique<TextureResource>());
+        m_vpTextures.back()->LoadImage(path);
+        m_vpTextures.back()->SetDebugName(name);
+
+        const uint32_t nSlot = GetDescriptorManager()->RegisterTexture(m_vpTextures.back()->getView());
+        assert(nSlot == m_vpTextures.size() - 1 && "Textures are registered in creation order");
+        m_mTextureIndices[name] = nSlot;
+        return m_vpTextures.back().get();
+    }
+    else
+    {
+        return m_vpTextures[m_mTextureIndices[name]].get();
+    }
+}
+
 TextureResource::TextureResource() : m_textureSampler(VK_NULL_HANDLE) {}
 
 TextureResource::~TextureResource()
@@ -42,20 +62,24 @@ void TextureResource::LoadPixels(void *pixels, int width, int height)
                 VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                 VMA_MEMORY_USAGE_GPU_ONLY);
 
-    // UNDEFINED -> DST_OPTIMAL
-    sTransitionImageLayout(m_image,
-                           VK_IMAGE_LAYOUT_UNDEFINED,
-                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-    // Copy source to image
-    mCopyBufferToImage(stagingBuffer, m_image, static_cast<uint32_t>(width),
-                       static_cast<uint32_t>(height));
+    // Copy on transfer queue, then DST_OPTIMAL -> SHADER_READ_ONLY with the ownership transfer to graphics queue.
+    // The image is new, there is no previous owner to release it.
+    VkImageMemoryBarrier imageBarrier = {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageBarrier.image = m_image;
+    imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    const uint64_t nUploadValue = GetRenderDevice()->ExecuteUploadCommand(
+        [&](VkCommandBuffer commandBuffer)
+        {
+            mCopyBufferToImage(commandBuffer, stagingBuffer, m_image, static_cast<uint32_t>(width),
+                               static_cast<uint32_t>(height));
+        },
+        {}, {imageBarrier}, {VkRenderDevice::QUEUE_GRAPHICS, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT});
 
-    // DST_OPTIMAL -> SHADER_READ_ONLY
-    sTransitionImageLayout(m_image,
-                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                           VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    GetMemoryAllocator()->FreeBuffer(stagingBuffer, stagingAllocation);
+    GetRenderDevice()->FreeStagingBuffer(stagingBuffer, stagingAllocation, nUploadValue);
     mInitImageView();
     mInitSampler();
 }
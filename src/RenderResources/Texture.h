@@ -135,9 +135,24 @@ public:
     }
 
 private:
-    void mCopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width,
+    // UNDEFINED -> DST_OPTIMAL and copy, only uses transfer stages so it can be recorded on transfer queue
+    void mCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width,
                             uint32_t height)
     {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                             nullptr, 1, &barrier);
+
         VkBufferImageCopy region = {};
         region.bufferOffset = 0;
         region.bufferRowLength = 0;
@@ -148,14 +163,9 @@ private:
         region.imageSubresource.layerCount = 1;
         region.imageOffset = {0, 0, 0};
         region.imageExtent = {width, height, 1};
-
-        GetRenderDevice()->ExecuteImmediateCommand(
-            [&](VkCommandBuffer commandBuffer)
-            {
-                vkCmdCopyBufferToImage(commandBuffer, buffer, image,
-                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
-                                       &region);
-            });
+        vkCmdCopyBufferToImage(commandBuffer, buffer, image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+                               &region);
     }
     void mInitImageView()
     {
@@ -209,21 +219,8 @@ private:
 class TextureResourceManager
 {
 public:
-    const TextureResource* CreateAndLoadOrGetTexture(const std::string& name, const std::string& path)
-    {
-        if (m_mTextureIndices.find(name) == m_mTextureIndices.end())
-        {
-            m_mTextureIndices[name] = (uint32_t)m_vpTextures.size();
-            m_vpTextures.emplace_back(std::make_unique<TextureResource>());
-            m_vpTextures.back()->LoadImage(path);
-            m_vpTextures.back()->SetDebugName(name);
-            return m_vpTextures.back().get();
-        }
-        else
-        {
-            return m_vpTextures[m_mTextureIndices[name]].get();
-        }
-    }
+    // Texture index is the texture's slot in the bindless heap
+    const TextureResource* CreateAndLoadOrGetTexture(const std::string& name, const std::string& path);
     uint32_t GetTextureIndex(const std::string& name) const
     {
         return m_mTextureIndices.at(name);
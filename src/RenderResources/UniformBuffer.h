@@ -4,6 +4,7 @@
 #include <cstring>
 #include <glm/glm.hpp>
 
+#include "PerFrameStaging.h"
 #include "RenderResource.h"
 #include "VkMemoryAllocator.h"
 #include "VkRenderDevice.h"
@@ -15,25 +16,57 @@ class UniformBuffer : public BufferResource
 {
 public:
     UniformBuffer()
-        : BufferResource(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+        : UniformBuffer(0, VMA_MEMORY_USAGE_CPU_TO_GPU)
+    {
+    }
+    void SetData(const T& buffer)
+    {
+        BufferResource::SetData(&buffer, sizeof(T));
+    }
+
+protected:
+    UniformBuffer(VkBufferUsageFlags additionalUsage, VmaMemoryUsage memoryUsage)
+        : BufferResource(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | additionalUsage
 #ifdef FEATURE_RAY_TRACING
 
                              | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
 
 #endif
                          ,
-                         VMA_MEMORY_USAGE_CPU_TO_GPU)
+                         memoryUsage)
 
     {
         const size_t size = sizeof(T);
-        GetMemoryAllocator()->AllocateBuffer(size, BUFFER_USAGE, MEMORY_USAGE,
-                                             m_buffer, m_allocation,
-                                             "Uniform Buffer");
+        AllocateBuffer(size, "Uniform Buffer");
         m_nSize = size;
     }
-    void SetData(const T& buffer)
+};
+
+// Uniform buffer written every frame, e.g. per view data. Each frame in flight writes its own copy, the device local
+// buffer is filled by RecordCopy at the start of the frame.
+template <class T>
+class PerFrameUniformBuffer : public UniformBuffer<T>
+{
+public:
+    PerFrameUniformBuffer()
+        : UniformBuffer<T>(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY)
     {
-        BufferResource::SetData(&buffer, sizeof(T));
+        m_frameCopies.Allocate(sizeof(T), "Uniform buffer frame copies");
     }
+    // The GPU must be done with the frame that used nFrameIdx before
+    void SetData(const T& buffer, uint32_t nFrameIdx)
+    {
+        memcpy(m_frameCopies.GetFrameData(nFrameIdx), &buffer, sizeof(T));
+    }
+    void RecordCopy(VkCommandBuffer cmdBuf, uint32_t nFrameIdx) const
+    {
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+        this->GetConsumerStagesAndAccess(stages, access);
+        m_frameCopies.RecordCopy(cmdBuf, nFrameIdx, this->buffer(), sizeof(T), stages, access);
+    }
+
+private:
+    PerFrameStaging m_frameCopies;
 };
 }  // namespace Muyo
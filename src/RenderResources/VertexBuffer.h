@@ -33,7 +33,7 @@ public:
     VertexBuffer(const std::vector<VertexType>& vVertexData, bool bStagedUpoload = true) : VertexBuffer(bStagedUpoload)
     {
         size_t nSizeInByte = vVertexData.size() * sizeof(VertexType);
-        GetMemoryAllocator()->AllocateBuffer(nSizeInByte, BUFFER_USAGE, MEMORY_USAGE, m_buffer, m_allocation, "VertexBuffer");
+        AllocateBuffer(nSizeInByte, "VertexBuffer");
         SetData(vVertexData.data(), nSizeInByte);
     }
 };
@@ -57,7 +57,7 @@ public:
     IndexBuffer(const std::vector<IndexType>& vIndexData, bool bStagedUpoload = true) : IndexBuffer(bStagedUpoload)
     {
         size_t nSizeInByte = vIndexData.size() * sizeof(IndexType);
-        GetMemoryAllocator()->AllocateBuffer(nSizeInByte, BUFFER_USAGE, MEMORY_USAGE, m_buffer, m_allocation, "IndexBuffer");
+        AllocateBuffer(nSizeInByte, "IndexBuffer");
         SetData(vIndexData.data(), nSizeInByte);
     }
 };
@@ -102,7 +102,7 @@ const DrawLists &Scene::GatherDrawLists()
             }
             else
             {
-                assert("TODO: update node date");
+                GetPerObjResourceManager()->SetWorldMatrix(pNode->GetPerObjId(), mWorldMatrix);
             }
 
             for (const auto &pChild : pNode->GetChildren())
@@ -6,7 +6,6 @@
 #include <functional>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
-#include <sstream>  // std::stringstream
 
 #include "Geometry.h"
 #include "LightSceneNode.h"
@@ -521,8 +520,6 @@ void GLTFImporter::ConstructGeometryNode(GeometrySceneNode &geomNode,
                 material.FillPbrTextureIndices(pbrMaterial.textureIds);
             }
 
-            material.AllocateDescriptorSet();
-            assert(material.GetDescriptorSet() != VK_NULL_HANDLE);
             if (gltfMaterial.alphaMode != "OPAQUE")
             {
                 assert(gltfMaterial.alphaMode == "BLEND" && "Unsupported alpha mode");
@@ -541,13 +538,6 @@ void GLTFImporter::ConstructGeometryNode(GeometrySceneNode &geomNode,
     }
     Geometry *pGeometry = new Geometry(vSubmeshes);
     geomNode.SetAABB({vAABBMin, vAABBMax});
-    // Setup world transformation uniform buffer object
-    // Use pointer address as string
-    std::stringstream ss;
-    ss << static_cast<void *>(pGeometry);
-    auto *worldMatBuffer = GetRenderResourceManager()->GetUniformBuffer<glm::mat4>(ss.str());
-    pGeometry->SetWorldMatrixUniformBuffer(worldMatBuffer);
-    pGeometry->SetWorldMatrix(glm::mat4(1.0));
     GetGeometryManager()->vpGeometries.emplace_back(pGeometry);
     geomNode.SetGeometry(pGeometry);
     if (bIsMeshTransparent)
@@ -1,143 +1,40 @@
-/* This is an example to serialize PSO cache file to disk
+/* Build time tool writing the pipeline cache shipped with the renderer.
+ * Render passes are instantiated headlessly, without window or swapchain, and every pipeline they create lands in
+ * the cache. The output is the blob loaded by PipelineCache at startup, so a first launch on a machine with the
+ * same driver doesn't compile the pipelines.
+ *
+ * Usage: PSOCompiler [output cache path]
+ * No scene is loaded. Every pass is prepared from its description and the lighting pass builds all its shadow and
+ * filter permutations. The final pass needs a swapchain and ray tracing a built scene, they compile on first launch.
+ * The PipelineCache target of the build runs the tool.
  */
 
-#include "PipelineStateBuilder.h"
-#include "VkMemoryAllocator.h"
-#include "VkRenderDevice.h"
-#include <filesystem>
-#include <fstream>
-#include <ios>
-#include <vulkan/vulkan_core.h>
 #include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <vector>
+
+#include "Debug.h"
+#include "DescriptorManager.h"
+#include "Geometry.h"
+#include "Material.h"
+#include "PipelineCache.h"
+#include "RenderPassManager.h"
+#include "RenderResourceManager.h"
+#include "SamplerManager.h"
+#include "ShaderLibrary.h"
+#include "StagingRing.h"
+#include "Texture.h"
+#include "VkExtFuncsLoader.h"
+#include "VkMemoryAllocator.h"
+#include "VkRenderDevice.h"
 using namespace Muyo;
 
-std::vector<VkDescriptorSetLayout> CreateDescriptorSetLayout()
-{
-    std::vector<VkDescriptorSetLayout> res(2, VK_NULL_HANDLE);
-
-    // Set0, binding 0
-    VkDescriptorSetLayoutBinding bindingInfo = {};
-    bindingInfo.binding                      = 0;
-    bindingInfo.descriptorType               = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindingInfo.descriptorCount              = 1;
-    bindingInfo.stageFlags                   = VK_SHADER_STAGE_COMPUTE_BIT;
-
-    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-    layoutInfo.sType                           = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.pBindings                       = &bindingInfo;
-    layoutInfo.bindingCount                    = 1;
-
-    VK_ASSERT(vkCreateDescriptorSetLayout(GetRenderDevice()->GetDevice(), &layoutInfo, nullptr, &res[0]));
-
-    bindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-
-    VK_ASSERT(vkCreateDescriptorSetLayout(GetRenderDevice()->GetDevice(), &layoutInfo, nullptr, &res[1]));
-
-    return res;
-}
-
-VkPipelineLayout CreatePipelineLayout(const std::vector<VkDescriptorSetLayout>& descLayouts)
-{
-    VkPipelineLayoutCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    createInfo.setLayoutCount = static_cast<uint32_t>(descLayouts.size());
-    createInfo.pSetLayouts = descLayouts.data();
-    
-    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
-    VK_ASSERT(vkCreatePipelineLayout(GetRenderDevice()->GetDevice(), &createInfo, nullptr, &pipelineLayout));
-    return pipelineLayout;
-}
-
-VkPipeline CreatePipeline(VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache)
-{
-    ComputePipelineBuilder builder;
-
-    VkShaderModule compShader = CreateShaderModule(ReadSpv("shaders/linearizeDepth.comp.spv"));
-
-    VkComputePipelineCreateInfo createInfo = builder.AddShaderModule(compShader).SetPipelineLayout(pipelineLayout).Build();
-
-    VkPipeline computePipeline = VK_NULL_HANDLE;
-    vkCreateComputePipelines(GetRenderDevice()->GetDevice(), pipelineCache, 1, &createInfo, nullptr, &computePipeline);
-    vkDestroyShaderModule(GetRenderDevice()->GetDevice(), compShader, nullptr);
-    return computePipeline;
-}
-
-VkPipelineCache CreatePipelineCache()
-{
-    VkPipelineCacheCreateInfo info = {};
-    info.sType                     = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-    info.initialDataSize           = 0;
-    info.pInitialData              = nullptr;
-
-    VkPipelineCache cache = VK_NULL_HANDLE;
-    vkCreatePipelineCache(
-      GetRenderDevice()->GetDevice(),
-      &info,
-      nullptr,
-      &cache);
-
-    return cache;
-}
-
-void SerializeCacheData(VkPipelineCache pipelineCache, std::filesystem::path filePath)
-{
-    size_t bufferSize = 0;
-    VK_ASSERT(vkGetPipelineCacheData(GetRenderDevice()->GetDevice(), pipelineCache, &bufferSize, nullptr));
-    bufferSize += sizeof(size_t); // buffer contains buffer size and buffer
+// Viewport state is baked into the pipelines, must match the renderer's resolution
+const uint32_t WIDTH = 1920;
+const uint32_t HEIGHT = 1080;
+const char *DEFAULT_CACHE_PATH = "pipelineCache.bin";
 
-
-    uint8_t* buffer = new uint8_t[bufferSize + sizeof(size_t)];
-    memcpy(buffer, &bufferSize, sizeof(size_t));
-
-    uint8_t* cacheBuffer = buffer + sizeof(size_t);
-    VK_ASSERT(vkGetPipelineCacheData(GetRenderDevice()->GetDevice(), pipelineCache, &bufferSize, cacheBuffer));
-
-    std::ofstream outputFile(filePath);
-
-    outputFile.write(reinterpret_cast<const char*>(buffer), bufferSize);
-    outputFile.close();
-
-    // Extract header
-    struct VkPipelineCacheHeaderVersionOne
-    {
-        uint32_t headerSize;
-        VkPipelineCacheHeaderVersion headerVersion;
-        uint32_t vendorID;
-        uint32_t deviceID;
-        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
-    } pipelineCacheHeader;
-
-    memcpy(&pipelineCacheHeader, cacheBuffer, sizeof(VkPipelineCacheHeaderVersionOne));
-
-    delete[] buffer;
-}
-
-VkPipelineCache DeserializeCacheData(std::filesystem::path filePath)
-{
-    std::ifstream inFile(filePath, std::ios::binary);
-    size_t fileSize = 0;
-    inFile.read(reinterpret_cast<char*>(&fileSize), sizeof(size_t));
-    assert (fileSize != 0);
-    uint8_t* buffer = new uint8_t[fileSize];
-    inFile.read(reinterpret_cast<char*>(buffer), fileSize);
-
-    VkPipelineCacheCreateInfo info = {};
-    info.sType                     = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-    info.initialDataSize           = fileSize;
-    info.pInitialData              = buffer+sizeof(size_t);
-
-    VkPipelineCache cache = VK_NULL_HANDLE;
-    vkCreatePipelineCache(
-      GetRenderDevice()->GetDevice(),
-      &info,
-      nullptr,
-      &cache);
-
-    return cache;
-}
-
-using std::chrono::duration;
 using std::chrono::duration_cast;
 using std::chrono::high_resolution_clock;
 using std::chrono::milliseconds;
@@ -152,65 +49,88 @@ class ScopedTimer
     ~ScopedTimer()
     {
         auto endTime = high_resolution_clock::now();
-        auto elapsedTime = duration_cast<std::chrono::nanoseconds>(endTime - m_StartTime);
-        std::cout << elapsedTime.count() << "ns\n";
+        auto elapsedTime = duration_cast<milliseconds>(endTime - m_StartTime);
+        std::cout << "Pipelines compiled in " << elapsedTime.count() << "ms\n";
     }
 
   private:
     std::chrono::steady_clock::time_point m_StartTime;
 };
 
-int main()
+// Same device setup as the renderer minus presentation, pipelines using these features must compile
+std::vector<const char*> GetRequiredDeviceExtensions()
 {
-    std::vector<const char*> vInstanceExtensions = {};
-    Muyo::GetRenderDevice()->Initialize(vInstanceExtensions);
+    std::vector<const char*> vDeviceExtensions = {
+        VK_EXT_MESH_SHADER_EXTENSION_NAME,
+        VK_KHR_SPIRV_1_4_EXTENSION_NAME,
+
+        VK_KHR_MULTIVIEW_EXTENSION_NAME,
+        VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
+    };
+    return vDeviceExtensions;
+}
 
-    std::vector<const char*> vDeviceExtensions = {};
-    Muyo::GetRenderDevice()->CreateDevice(vDeviceExtensions,              // Extensions
-                                          std::vector<const char*>());    // Layers
+int main(int argc, char** argv)
+{
+    const std::filesystem::path cachePath(argc > 1 ? argv[1] : DEFAULT_CACHE_PATH);
+
+    std::vector<const char*> vInstanceExtensions = {"VK_KHR_get_physical_device_properties2"};
+    GetRenderDevice()->Initialize(vInstanceExtensions);
+    VkExt::LoadInstanceFunctions(GetRenderDevice()->GetInstance());
+
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeature = {};
+    meshShaderFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    meshShaderFeature.meshShader = VK_TRUE;
+    std::vector<void*> features = {&meshShaderFeature};
+    GetRenderDevice()->CreateDevice(GetRequiredDeviceExtensions(),  // Extensions
+                                    std::vector<const char*>(),      // Layers
+                                    nullptr, features);
 
     GetMemoryAllocator()->Initalize(GetRenderDevice());
     GetRenderDevice()->CreateCommandPools();
+    GetStagingRing()->Initialize();
 
-    std::vector<VkDescriptorSetLayout> descLayouts = CreateDescriptorSetLayout();
-    VkPipelineLayout layout = CreatePipelineLayout(descLayouts);
+    // Pipelines of a previous run are not carried over, the blob only contains pipelines of the current shaders
+    std::error_code error;
+    std::filesystem::remove(cachePath, error);
+    GetPipelineCache()->Load(cachePath);
+    GetShaderLibrary()->Preload("shaders");
 
-    std::filesystem::path cacheBinary("psoCache.bin");
+    GetDescriptorManager()->createDescriptorPool();
+    GetDescriptorManager()->createDescriptorSetLayouts();
+    GetSamplerManager()->createSamplers();
+    GetDescriptorManager()->CreateBindlessDescriptorSet();
 
-    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
-    if (std::filesystem::exists(cacheBinary))
-    {
-        pipelineCache = DeserializeCacheData(cacheBinary);
-    }
-    else
-    {
-        pipelineCache = CreatePipelineCache();
-    }
-
-    VkPipeline pipeline = VK_NULL_HANDLE;
+    GetMaterialManager()->CreateDefaultMaterial();
+    GetMaterialManager()->UploadMaterialBuffer();
 
+    GetRenderPassManager()->InitializeHeadless(WIDTH, HEIGHT);
     {
         ScopedTimer timer;
-        pipeline = CreatePipeline(layout, pipelineCache);
-    }
-
-    if (!std::filesystem::exists(cacheBinary))
-    {
-        SerializeCacheData(pipelineCache, cacheBinary);
+        GetRenderPassManager()->PrecompilePipelines();
     }
+    VK_ASSERT(vkDeviceWaitIdle(GetRenderDevice()->GetDevice()));
 
-    vkDestroyPipeline(GetRenderDevice()->GetDevice(), pipeline, nullptr);
-    vkDestroyPipelineCache(GetRenderDevice()->GetDevice(), pipelineCache, nullptr);
-
-    vkDestroyDescriptorSetLayout(GetRenderDevice()->GetDevice(), descLayouts[0], nullptr);
-    vkDestroyDescriptorSetLayout(GetRenderDevice()->GetDevice(), descLayouts[1], nullptr);
-    vkDestroyPipelineLayout(GetRenderDevice()->GetDevice(), layout, nullptr);
+    GetPipelineCache()->Save();
+    std::cout << "Pipeline cache written to " << cachePath << std::endl;
 
     // Clean up
-    GetRenderDevice() ->DestroyCommandPools();
+    GetMaterialManager()->DestroyMaterials();
+    GetGeometryManager()->Destroy();
+    GetSamplerManager()->destroySamplers();
+    GetTextureResourceManager()->Destroy();
+
+    GetDescriptorManager()->destroyDescriptorSetLayouts();
+    GetDescriptorManager()->destroyDescriptorPool();
+
+    GetRenderPassManager()->Unintialize();
+    GetRenderDevice()->DestroyCommandPools();
+    GetPipelineCache()->Destroy();
+    GetShaderLibrary()->Destroy();
+    GetStagingRing()->Destroy();
+    GetRenderResourceManager()->Unintialize();
     GetMemoryAllocator()->Unintialize();
     GetRenderDevice()->DestroyDevice();
     GetRenderDevice()->Unintialize();
     return 0;
 }
-
@@ -22,11 +22,14 @@
 #include "Geometry.h"
 #include "ImGuiControl.h"
 #include "Material.h"
+#include "PipelineCache.h"
 #include "RenderPassManager.h"
 #include "RenderResourceManager.h"
 #include "SamplerManager.h"
 #include "SceneImporter.h"
 #include "SceneManager.h"
+#include "ShaderLibrary.h"
+#include "StagingRing.h"
 #include "Texture.h"
 #include "UniformBuffer.h"
 #include "VkExtFuncsLoader.h"
@@ -48,6 +51,7 @@ using namespace Muyo;
 bool g_bWaylandExt = false;
 const int WIDTH    = 1920;
 const int HEIGHT   = 1080;
+const char *PIPELINE_CACHE_PATH = "pipelineCache.bin";
 
 ///
 // Arcball callbacks
@@ -157,6 +161,10 @@ void cleanup()
 
     GetRenderPassManager()->Unintialize();
     GetRenderDevice()->DestroyCommandPools();
+    GetPipelineCache()->Save();
+    GetPipelineCache()->Destroy();
+    GetShaderLibrary()->Destroy();
+    GetStagingRing()->Destroy();
     GetRenderResourceManager()->Unintialize();
     GetMemoryAllocator()->Unintialize();
     GetRenderDevice()->DestroyDevice();
@@ -218,12 +226,16 @@ int main(int argc, char **argv)
     GetMemoryAllocator()->Initalize(GetRenderDevice());
 
     GetRenderDevice()->CreateCommandPools();
+    GetStagingRing()->Initialize();
+    GetPipelineCache()->Load(PIPELINE_CACHE_PATH);
+    GetShaderLibrary()->Preload("shaders");
 
     // Initialize managers
     GetDescriptorManager()->createDescriptorPool();
     GetDescriptorManager()->createDescriptorSetLayouts();
 
     GetSamplerManager()->createSamplers();
+    GetDescriptorManager()->CreateBindlessDescriptorSet();
 
     InitEventHandlers();
 
@@ -271,7 +283,7 @@ int main(int argc, char **argv)
         DrawLists dl = GetSceneManager()->GatherDrawLists();
         GetSceneManager()->ConstructLightBufferFromDrawLists(dl);
 
-        UniformBuffer<PerViewData> *pUniformBuffer = GetRenderResourceManager()->GetUniformBuffer<PerViewData>("perView");
+        UniformBuffer<PerViewData> *pUniformBuffer = GetRenderResourceManager()->GetPerFrameUniformBuffer<PerViewData>("perView");
 
         // Load materials
 
@@ -332,12 +344,13 @@ int main(int argc, char **argv)
             // Handle resizing
             {
                 // TODO: Resizing doesn't work properly, need to investigate
-                VK_ASSERT(vkDeviceWaitIdle(GetRenderDevice()->GetDevice()));
                 int width, height;
                 std::tie(width, height) = Window::GetWindowSize();
                 VkExtent2D currentVp    = GetRenderPassManager()->GetViewportSize();
                 if (width != (int)currentVp.width || height != (int)currentVp.height)
                 {
+                    // Static command buffers are re-recorded, wait for submitted frames
+                    GetRenderDevice()->WaitForAllQueues();
                     // VkExtent2D vp = {(uint32_t)width, (uint32_t)height};
                     GetRenderPassManager()->OnResize(width, height);
                     GetRenderPassManager()->RecordStaticCmdBuffers(dl);